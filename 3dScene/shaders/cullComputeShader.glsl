@@ -0,0 +1,198 @@
+///////////////////////////////////////////////////////////////////////////////
+// cullComputeShader.glsl
+// ============
+// GPU culling compute shader - tests the bounding sphere of every
+// object against the frustum and the Hi-Z pyramid of the previous
+// frame, and writes the indirect draws of the visible objects
+//
+// The objects are sorted by batch, the objects that share a program,
+// a texture and a material, and each batch owns the range of the
+// command buffer that starts at its first object.  A visible object
+// appends its draw to the range of its batch through the atomic count
+// of the batch, so the draws are packed at the start of the range for
+// glMultiDrawElementsIndirectCount.  Without bCompact, for drivers
+// that cannot read the draw count from a buffer, every object keeps
+// its own command and a hidden object draws no instance.
+//
+// The binding points match the constants of GpuCulling.
+///////////////////////////////////////////////////////////////////////////////
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+// camera of the frame, shared by every program and only
+// rewritten when the camera changes
+layout (std140, binding = 0) uniform CameraBlock {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 inverseViewProjection;
+	vec4 frustumPlanes[6];
+	vec4 cameraPosition;
+};
+
+// bounding sphere in world space and the mesh and batch of an object
+struct CullObject {
+	vec4 sphere;
+	uint mesh;
+	uint batch;
+	uint padding0;
+	uint padding1;
+};
+
+// range of a basic mesh in the index buffer of the mesh pool
+struct MeshRange {
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+
+// layout of the indirect draw of glMultiDrawElementsIndirect
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer ObjectBuffer {
+	CullObject objects[];
+};
+layout (std430, binding = 1) readonly buffer MeshBuffer {
+	MeshRange meshes[];
+};
+// first command of every batch
+layout (std430, binding = 2) readonly buffer BatchBuffer {
+	uint batchFirstCommands[];
+};
+layout (std430, binding = 3) writeonly buffer CommandBuffer {
+	DrawCommand commands[];
+};
+// visible objects of every batch, followed by the visible objects
+// of all batches together
+layout (std430, binding = 4) buffer CountBuffer {
+	uint drawCounts[];
+};
+
+uniform int objectCount;
+uniform int batchCount;
+// false to keep one command per object instead of packing them
+uniform bool bCompact = true;
+
+// Hi-Z pyramid of the previous frame, each texel holds the
+// farthest depth of the pixels it covers, and the camera the
+// previous frame was drawn with
+uniform bool bUseHiZ = false;
+uniform sampler2D hiZ;
+uniform mat4 previousViewProjection;
+
+bool IsInFrustum(vec4 sphere)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (dot(frustumPlanes[i].xyz, sphere.xyz) + frustumPlanes[i].w < -sphere.w)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// the box around the sphere is projected with the camera of the
+// pyramid, and the object is hidden when its nearest depth lies
+// behind the farthest depth of every pixel the box covers
+bool IsOccluded(vec4 sphere)
+{
+	if (!bUseHiZ)
+	{
+		return false;
+	}
+
+	vec3 minimum = vec3(1e30);
+	vec3 maximum = vec3(-1e30);
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = sphere.xyz + sphere.w * vec3(
+			((i & 1) != 0) ? 1.0 : -1.0,
+			((i & 2) != 0) ? 1.0 : -1.0,
+			((i & 4) != 0) ? 1.0 : -1.0);
+		vec4 clip = previousViewProjection * vec4(corner, 1.0);
+		// a box that reaches behind the camera is kept
+		if (clip.w <= 0.0)
+		{
+			return false;
+		}
+		vec3 window = clip.xyz / clip.w * 0.5 + 0.5;
+		minimum = min(minimum, window);
+		maximum = max(maximum, window);
+	}
+	if ((minimum.z <= 0.0) || any(lessThan(maximum.xy, vec2(0.0))) || any(greaterThan(minimum.xy, vec2(1.0))))
+	{
+		return false;
+	}
+
+	// the covered pixels of the first level, and the level where
+	// they fall into at most two texels in each direction
+	ivec2 size = textureSize(hiZ, 0);
+	ivec2 first = clamp(ivec2(minimum.xy * vec2(size)), ivec2(0), size - 1);
+	ivec2 last = clamp(ivec2(maximum.xy * vec2(size)), ivec2(0), size - 1);
+	int levelCount = textureQueryLevels(hiZ);
+	int level = 0;
+	while ((level < levelCount - 1) && any(greaterThan((last >> level) - (first >> level), ivec2(1))))
+	{
+		level++;
+	}
+
+	// the last texel of a level also covers the row or column
+	// that the halving of an odd size dropped
+	ivec2 levelLast = textureSize(hiZ, level) - 1;
+	first = min(first >> level, levelLast);
+	last = min(last >> level, levelLast);
+	float farthest = max(
+		max(texelFetch(hiZ, first, level).r, texelFetch(hiZ, ivec2(last.x, first.y), level).r),
+		max(texelFetch(hiZ, ivec2(first.x, last.y), level).r, texelFetch(hiZ, last, level).r));
+
+	return minimum.z > farthest;
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= uint(objectCount))
+	{
+		return;
+	}
+
+	CullObject object = objects[index];
+	bool bVisible = IsInFrustum(object.sphere) && !IsOccluded(object.sphere);
+
+	MeshRange mesh = meshes[object.mesh];
+	DrawCommand command;
+	command.count = mesh.indexCount;
+	command.instanceCount = 1u;
+	command.firstIndex = mesh.firstIndex;
+	command.baseVertex = mesh.baseVertex;
+	// the base instance selects the settings of the object
+	command.baseInstance = index;
+
+	if (bCompact)
+	{
+		if (bVisible)
+		{
+			uint slot = atomicAdd(drawCounts[object.batch], 1u);
+			commands[batchFirstCommands[object.batch] + slot] = command;
+		}
+	}
+	else
+	{
+		command.instanceCount = bVisible ? 1u : 0u;
+		commands[index] = command;
+	}
+
+	if (bVisible)
+	{
+		atomicAdd(drawCounts[batchCount], 1u);
+	}
+}
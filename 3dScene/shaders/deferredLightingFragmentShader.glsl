@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredLightingFragmentShader.glsl
+// ============
+// lighting pass of the deferred shading path - runs the Phong
+// lighting loop once per covered pixel using the G-buffer, and
+// writes its depth so the forward draws can be tested against it
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+#define MAX_MATERIALS 16
+#define MAX_LIGHTS 4
+
+struct Material {
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource {
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+in vec2 screenTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform usampler2D gMaterial;
+uniform sampler2D gDepth;
+
+// camera of the frame, shared by every program and only
+// rewritten when the camera changes
+layout (std140) uniform CameraBlock {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 inverseViewProjection;
+	vec4 frustumPlanes[6];
+	vec4 cameraPosition;
+};
+#define viewPosition (cameraPosition.xyz)
+
+// fraction of the G-buffer that holds the rendered region
+uniform vec2 gBufferScale = vec2(1.0);
+
+uniform Material materials[MAX_MATERIALS];
+uniform int materialCount = 0;
+uniform LightSource lightSources[MAX_LIGHTS];
+uniform int lightCount = 0;
+
+vec3 DecodeOctahedral(vec2 encoded)
+{
+	vec3 n = vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+	if (n.z < 0.0)
+	{
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return normalize(n);
+}
+
+vec3 CalcLightSource(LightSource light, Material material, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	// ambient lighting
+	ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+
+	// diffuse lighting
+	vec3 lightDirection = normalize(light.position - vertexPosition);
+	float impact = max(dot(lightNormal, lightDirection), 0.0);
+	diffuse = impact * light.diffuseColor * material.diffuseColor;
+
+	// specular lighting
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0), light.focalStrength);
+	specular = light.specularIntensity * specularComponent * light.specularColor * material.specularColor;
+
+	return ambient + diffuse + specular;
+}
+
+void main()
+{
+	vec2 gBufferCoordinate = screenTextureCoordinate * gBufferScale;
+	float depth = texture(gDepth, gBufferCoordinate).r;
+	// nothing was drawn here, keep the clear color
+	if (depth >= 1.0)
+	{
+		discard;
+	}
+	gl_FragDepth = depth;
+
+	// rebuild the world space position from the hardware depth
+	vec4 clipPosition = vec4(vec3(screenTextureCoordinate, depth) * 2.0 - 1.0, 1.0);
+	vec4 worldPosition = inverseViewProjection * clipPosition;
+	vec3 fragmentPosition = worldPosition.xyz / worldPosition.w;
+
+	vec3 lightNormal = DecodeOctahedral(texture(gNormal, gBufferCoordinate).xy);
+	vec4 albedo = texture(gAlbedo, gBufferCoordinate);
+	uint materialIndex = texture(gMaterial, gBufferCoordinate).r;
+	Material material = materials[min(int(materialIndex), max(materialCount - 1, 0))];
+
+	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+	vec3 phongResult = vec3(0.0);
+	for (int i = 0; i < lightCount; i++)
+	{
+		phongResult += CalcLightSource(lightSources[i], material, lightNormal, fragmentPosition, viewDirection);
+	}
+
+	outFragmentColor = vec4(phongResult * albedo.rgb, 1.0);
+}
@@ -0,0 +1,11 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthPrepassFragmentShader.glsl
+// ============
+// depth pre-pass fragment shader - the color writes are masked, only
+// the depth of the fragment is kept
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+void main()
+{
+}
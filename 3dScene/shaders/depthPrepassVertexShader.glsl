@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthPrepassVertexShader.glsl
+// ============
+// position only vertex shader of the depth pre-pass and the overdraw
+// count
+//
+// Only the position attribute is read.  The position is computed with
+// the same expression as the scene and G-buffer vertex shaders, and
+// all of them declare gl_Position invariant, so the shading pass can
+// match the pre-pass depth with GL_EQUAL.
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+
+invariant gl_Position;
+
+// camera of the frame, shared by every program and only
+// rewritten when the camera changes
+layout (std140) uniform CameraBlock {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 inverseViewProjection;
+	vec4 frustumPlanes[6];
+	vec4 cameraPosition;
+};
+
+#ifdef USE_DRAW_BUFFER
+// settings of one draw, written into the frame ring buffer
+struct DrawData {
+	mat4 model;
+	mat3 normalMatrix;
+	vec4 color;
+	// UV scale in xy, texture flag in z, material index in w
+	vec4 parameters;
+	// lightmap cells of a static surface, zero without one
+	vec4 lightmapRect;
+};
+
+layout (std140) uniform DrawBlock {
+	DrawData draws[MAX_DRAWS];
+};
+
+// index of the current draw within the bound draw block
+uniform int drawIndex = 0;
+#else
+uniform mat4 model;
+#endif
+
+void main()
+{
+#ifdef USE_DRAW_BUFFER
+	mat4 model = draws[drawIndex].model;
+#endif
+
+	gl_Position = viewProjection * model * vec4(inVertexPosition, 1.0);
+}
@@ -0,0 +1,16 @@
+///////////////////////////////////////////////////////////////////////////////
+// fullscreenVertexShader.glsl
+// ============
+// full screen triangle generated from gl_VertexID, no vertex
+// buffer is bound for the full screen passes
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+out vec2 screenTextureCoordinate;
+
+void main()
+{
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	screenTextureCoordinate = corner;
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
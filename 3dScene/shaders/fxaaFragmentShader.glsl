@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// fxaaFragmentShader.glsl
+// ============
+// fast approximate anti-aliasing - find the direction of an edge from
+// the luminance of the four diagonal neighbors and blend along it
+//
+// Pixels whose neighborhood has little contrast are passed through.
+// Along an edge two taps at a short and two at a long distance are
+// averaged, and the short average is kept when the long one leaves
+// the luminance range of the neighborhood, which means it crossed a
+// second edge.
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec2 screenTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D sceneColor;
+// fraction of the target covered by the rendered region
+uniform vec2 renderScale = vec2(1.0);
+// size of one texel of the target
+uniform vec2 texelSize;
+
+// contrast below which a pixel is not treated as an edge, relative
+// to its brightest neighbor and absolute for the dark pixels
+const float EDGE_THRESHOLD = 0.125;
+const float EDGE_THRESHOLD_MIN = 0.0312;
+// the direction is damped in flat dark areas by this fraction of the
+// average luminance, but never below the minimum
+const float REDUCE_MUL = 1.0 / 8.0;
+const float REDUCE_MIN = 1.0 / 128.0;
+// longest blend along an edge in texels
+const float SPAN_MAX = 8.0;
+
+float Luminance(vec3 color)
+{
+	return(dot(color, vec3(0.299, 0.587, 0.114)));
+}
+
+void main()
+{
+	// keep every tap inside the rendered region so the clear
+	// color beyond it does not bleed into the edges
+	vec2 minCoordinate = texelSize * 0.5;
+	vec2 maxCoordinate = renderScale - texelSize * 0.5;
+	vec2 coordinate = clamp(screenTextureCoordinate * renderScale, minCoordinate, maxCoordinate);
+
+	vec3 center = texture(sceneColor, coordinate).rgb;
+	float lumaCenter = Luminance(center);
+	float lumaNorthWest = Luminance(texture(sceneColor, clamp(coordinate + vec2(-1.0, 1.0) * texelSize, minCoordinate, maxCoordinate)).rgb);
+	float lumaNorthEast = Luminance(texture(sceneColor, clamp(coordinate + vec2(1.0, 1.0) * texelSize, minCoordinate, maxCoordinate)).rgb);
+	float lumaSouthWest = Luminance(texture(sceneColor, clamp(coordinate + vec2(-1.0, -1.0) * texelSize, minCoordinate, maxCoordinate)).rgb);
+	float lumaSouthEast = Luminance(texture(sceneColor, clamp(coordinate + vec2(1.0, -1.0) * texelSize, minCoordinate, maxCoordinate)).rgb);
+
+	float lumaMin = min(lumaCenter, min(min(lumaNorthWest, lumaNorthEast), min(lumaSouthWest, lumaSouthEast)));
+	float lumaMax = max(lumaCenter, max(max(lumaNorthWest, lumaNorthEast), max(lumaSouthWest, lumaSouthEast)));
+	if (lumaMax - lumaMin < max(EDGE_THRESHOLD_MIN, lumaMax * EDGE_THRESHOLD))
+	{
+		outFragmentColor = vec4(center, 1.0);
+		return;
+	}
+
+	// the gradient of the diagonals, turned to run along the edge
+	vec2 direction;
+	direction.x = -((lumaNorthWest + lumaNorthEast) - (lumaSouthWest + lumaSouthEast));
+	direction.y = (lumaNorthWest + lumaSouthWest) - (lumaNorthEast + lumaSouthEast);
+
+	float directionReduce = max(
+		(lumaNorthWest + lumaNorthEast + lumaSouthWest + lumaSouthEast) * 0.25 * REDUCE_MUL,
+		REDUCE_MIN);
+	float inverseDirectionMin = 1.0 / (min(abs(direction.x), abs(direction.y)) + directionReduce);
+	direction = clamp(direction * inverseDirectionMin, vec2(-SPAN_MAX), vec2(SPAN_MAX)) * texelSize;
+
+	vec3 shortBlend = 0.5 * (
+		texture(sceneColor, clamp(coordinate + direction * (1.0 / 3.0 - 0.5), minCoordinate, maxCoordinate)).rgb +
+		texture(sceneColor, clamp(coordinate + direction * (2.0 / 3.0 - 0.5), minCoordinate, maxCoordinate)).rgb);
+	vec3 longBlend = shortBlend * 0.5 + 0.25 * (
+		texture(sceneColor, clamp(coordinate - direction * 0.5, minCoordinate, maxCoordinate)).rgb +
+		texture(sceneColor, clamp(coordinate + direction * 0.5, minCoordinate, maxCoordinate)).rgb);
+
+	float lumaLong = Luminance(longBlend);
+	if ((lumaLong < lumaMin) || (lumaLong > lumaMax))
+	{
+		outFragmentColor = vec4(shortBlend, 1.0);
+	}
+	else
+	{
+		outFragmentColor = vec4(longBlend, 1.0);
+	}
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// gBufferFragmentShader.glsl
+// ============
+// geometry pass of the deferred shading path - writes the packed
+// G-buffer instead of running the lighting loop
+//
+//  target 0: RG16_SNORM  octahedral encoded world space normal
+//  target 1: RGBA8       albedo
+//  target 2: R8UI        index into the OBJECT_MATERIAL table
+//  depth:    DEPTH24     hardware depth, position is reconstructed
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec3 fragmentNormal;
+in vec2 fragmentTextureCoordinate;
+
+layout (location = 0) out vec2 outNormal;
+layout (location = 1) out vec4 outAlbedo;
+layout (location = 2) out uint outMaterial;
+
+uniform sampler2D objectTexture;
+#ifdef USE_DRAW_BUFFER
+// settings of one draw, written into the frame ring buffer
+struct DrawData {
+	mat4 model;
+	mat3 normalMatrix;
+	vec4 color;
+	// UV scale in xy, texture flag in z, material index in w
+	vec4 parameters;
+	// lightmap cells of a static surface, zero without one
+	vec4 lightmapRect;
+};
+
+layout (std140) uniform DrawBlock {
+	DrawData draws[MAX_DRAWS];
+};
+
+// index of the current draw within the bound draw block
+uniform int drawIndex = 0;
+
+// the per-draw settings keep the names of the uniforms they replace
+#define objectColor (draws[drawIndex].color)
+#define UVscale (draws[drawIndex].parameters.xy)
+#define bUseTexture (draws[drawIndex].parameters.z > 0.5)
+#define materialIndex int(draws[drawIndex].parameters.w)
+#else
+uniform bool bUseTexture = false;
+uniform vec4 objectColor = vec4(1.0);
+uniform vec2 UVscale = vec2(1.0, 1.0);
+uniform int materialIndex = 0;
+#endif
+
+// map a unit vector onto the octahedron and unfold it into [-1,1]^2
+vec2 EncodeOctahedral(vec3 n)
+{
+	n /= (abs(n.x) + abs(n.y) + abs(n.z));
+	vec2 encoded = n.xy;
+	if (n.z < 0.0)
+	{
+		encoded = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	}
+	return encoded;
+}
+
+void main()
+{
+	outNormal = EncodeOctahedral(normalize(fragmentNormal));
+
+	if (bUseTexture)
+	{
+		outAlbedo = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+	}
+	else
+	{
+		outAlbedo = objectColor;
+	}
+
+	outMaterial = uint(max(materialIndex, 0));
+}
@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////
+// gBufferVertexShader.glsl
+// ============
+// geometry pass of the deferred shading path - transforms the
+// scene meshes exactly like the forward vertex shader, including
+// the camera block and the draw block of the frame ring buffer
+// with USE_DRAW_BUFFER
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+// the depth pre-pass computes the same position, the shading pass
+// matches its depth exactly with GL_EQUAL
+invariant gl_Position;
+
+out vec3 fragmentNormal;
+out vec2 fragmentTextureCoordinate;
+
+// camera of the frame, shared by every program and only
+// rewritten when the camera changes
+layout (std140) uniform CameraBlock {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 inverseViewProjection;
+	vec4 frustumPlanes[6];
+	vec4 cameraPosition;
+};
+
+#ifdef USE_DRAW_BUFFER
+// settings of one draw, written into the frame ring buffer
+struct DrawData {
+	mat4 model;
+	mat3 normalMatrix;
+	vec4 color;
+	// UV scale in xy, texture flag in z, material index in w
+	vec4 parameters;
+	// lightmap cells of a static surface, zero without one
+	vec4 lightmapRect;
+};
+
+layout (std140) uniform DrawBlock {
+	DrawData draws[MAX_DRAWS];
+};
+
+// index of the current draw within the bound draw block
+uniform int drawIndex = 0;
+#else
+uniform mat4 model;
+#endif
+
+void main()
+{
+#ifdef USE_DRAW_BUFFER
+	mat4 model = draws[drawIndex].model;
+	mat3 normalMatrix = draws[drawIndex].normalMatrix;
+#else
+	mat3 normalMatrix = mat3(transpose(inverse(model)));
+#endif
+
+	gl_Position = viewProjection * model * vec4(inVertexPosition, 1.0);
+
+	fragmentNormal = normalMatrix * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// hiZComputeShader.glsl
+// ============
+// Hi-Z pyramid compute shader - builds one level of the pyramid that
+// the GPU culling tests the objects against
+//
+// The first level is a copy of the depth buffer, every further level
+// keeps the farthest depth of the 2 by 2 texels below it.  The last
+// texel of a level also covers the row or column that the halving of
+// an odd size drops, so a texel never misses a pixel it stands for.
+///////////////////////////////////////////////////////////////////////////////
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// depth copy for the first level, the pyramid itself for the others
+uniform sampler2D sourceDepth;
+uniform int sourceLevel;
+// true when the first level is copied from the depth
+uniform bool bCopyDepth;
+
+layout (r32f, binding = 0) uniform writeonly image2D targetLevel;
+
+void main()
+{
+	ivec2 target = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 targetSize = imageSize(targetLevel);
+	if (any(greaterThanEqual(target, targetSize)))
+	{
+		return;
+	}
+
+	float depth = 0.0;
+	if (bCopyDepth)
+	{
+		depth = texelFetch(sourceDepth, target, 0).r;
+	}
+	else
+	{
+		ivec2 sourceSize = textureSize(sourceDepth, sourceLevel);
+		ivec2 first = target * 2;
+		ivec2 last = min(first + 1, sourceSize - 1);
+		if (target.x == targetSize.x - 1)
+		{
+			last.x = sourceSize.x - 1;
+		}
+		if (target.y == targetSize.y - 1)
+		{
+			last.y = sourceSize.y - 1;
+		}
+		for (int y = first.y; y <= last.y; y++)
+		{
+			for (int x = first.x; x <= last.x; x++)
+			{
+				depth = max(depth, texelFetch(sourceDepth, ivec2(x, y), sourceLevel).r);
+			}
+		}
+	}
+
+	imageStore(targetLevel, target, vec4(depth));
+}
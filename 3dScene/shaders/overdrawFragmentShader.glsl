@@ -0,0 +1,14 @@
+///////////////////////////////////////////////////////////////////////////////
+// overdrawFragmentShader.glsl
+// ============
+// overdraw count fragment shader - every fragment that passes the
+// depth test adds one to the count target through additive blending
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+out float outOverdraw;
+
+void main()
+{
+	outOverdraw = 1.0;
+}
@@ -0,0 +1,42 @@
+///////////////////////////////////////////////////////////////////////////////
+// overdrawHeatmapFragmentShader.glsl
+// ============
+// show the overdraw count of each pixel as a heatmap - black for no
+// fragment, then blue, green, yellow and red up to maxOverdraw
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+out vec4 outFragmentColor;
+
+// number of fragments shaded for each pixel
+uniform sampler2D overdrawTexture;
+// count shown in full red
+uniform float maxOverdraw = 8.0;
+
+void main()
+{
+	float count = texelFetch(overdrawTexture, ivec2(gl_FragCoord.xy), 0).r;
+	if (count < 0.5)
+	{
+		outFragmentColor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	// one fragment per pixel is blue, the ideal of the pre-pass
+	float heat = clamp((count - 1.0) / max(maxOverdraw - 1.0, 1.0), 0.0, 1.0);
+	vec3 color;
+	if (heat < 1.0 / 3.0)
+	{
+		color = mix(vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0), heat * 3.0);
+	}
+	else if (heat < 2.0 / 3.0)
+	{
+		color = mix(vec3(0.0, 1.0, 0.0), vec3(1.0, 1.0, 0.0), heat * 3.0 - 1.0);
+	}
+	else
+	{
+		color = mix(vec3(1.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0), heat * 3.0 - 2.0);
+	}
+
+	outFragmentColor = vec4(color, 1.0);
+}
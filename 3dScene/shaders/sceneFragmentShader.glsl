@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneFragmentShader.glsl
+// ============
+// forward shading fragment shader
+//
+// Built without defines this is the generic program, which selects
+// texturing and lighting with the bUseTexture and bUseLighting
+// uniforms.  ShaderPermutations builds specialized variants by
+// injecting these defines after the #version line:
+//
+//   PERMUTATION      set for every specialized variant
+//   USE_TEXTURE      sample objectTexture instead of objectColor
+//   USE_LIGHTING     run the Phong lighting loop
+//   LIGHT_COUNT n    number of light sources in the loop
+//   USE_ALPHA        keep the alpha channel, otherwise output 1.0
+//   USE_WEIGHTED_OIT write the weighted color and the revealage of
+//                    weighted blended transparency to two targets
+//   USE_LIGHTMAP     read the baked lighting of a static surface
+//                    instead of running the lighting loop
+//   USE_GPU_CULLING  read the settings of the draw from the object
+//                    storage buffer of the GPU culling pass
+//
+// Independent of the variant, USE_DRAW_BUFFER and MAX_DRAWS select
+// the uniform block of the frame ring buffer for the per-draw
+// settings.  The camera always comes from the shared camera block.
+//
+// The specialized variants contain no uniform branches, and the
+// compiler removes the code of the disabled features.
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+#ifndef LIGHT_COUNT
+#define LIGHT_COUNT 4
+#endif
+
+struct Material {
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource {
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+#ifdef USE_GPU_CULLING
+flat in uint fragmentDrawIndex;
+#endif
+#ifdef USE_LIGHTMAP
+in vec2 fragmentLightmapCoordinate;
+
+// baked ambient and diffuse lighting of the static surfaces
+uniform sampler2D lightmap;
+#endif
+
+#ifdef USE_WEIGHTED_OIT
+layout (location = 0) out vec4 outAccumulation;
+layout (location = 1) out float outRevealage;
+#else
+out vec4 outFragmentColor;
+#endif
+
+#ifndef PERMUTATION
+uniform bool bUseLighting = false;
+#endif
+uniform sampler2D objectTexture;
+uniform Material material;
+// opacity of the material, multiplied into the alpha
+uniform float materialOpacity = 1.0;
+// camera of the frame, shared by every program and only
+// rewritten when the camera changes
+layout (std140) uniform CameraBlock {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 inverseViewProjection;
+	vec4 frustumPlanes[6];
+	vec4 cameraPosition;
+};
+#define viewPosition (cameraPosition.xyz)
+
+#if defined(USE_DRAW_BUFFER) || defined(USE_GPU_CULLING)
+// settings of one draw, written into the frame ring buffer
+struct DrawData {
+	mat4 model;
+	mat3 normalMatrix;
+	vec4 color;
+	// UV scale in xy, texture flag in z, material index in w
+	vec4 parameters;
+	// lightmap cells of a static surface, zero without one
+	vec4 lightmapRect;
+};
+
+#ifdef USE_GPU_CULLING
+// settings of every object of the culling pass
+layout (std430) buffer DrawBuffer {
+	DrawData draws[];
+};
+
+#define drawIndex (int(fragmentDrawIndex))
+#else
+layout (std140) uniform DrawBlock {
+	DrawData draws[MAX_DRAWS];
+};
+
+// index of the current draw within the bound draw block
+uniform int drawIndex = 0;
+#endif
+
+// the per-draw settings keep the names of the uniforms they replace
+#define objectColor (draws[drawIndex].color)
+#define UVscale (draws[drawIndex].parameters.xy)
+#define bUseTexture (draws[drawIndex].parameters.z > 0.5)
+#else
+#ifndef PERMUTATION
+uniform bool bUseTexture = false;
+#endif
+uniform vec4 objectColor = vec4(1.0);
+uniform vec2 UVscale = vec2(1.0, 1.0);
+#endif
+#if LIGHT_COUNT > 0
+uniform LightSource lightSources[LIGHT_COUNT];
+#endif
+
+vec3 CalcLightSource(LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection)
+{
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	// ambient lighting
+	ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+
+	// diffuse lighting
+	vec3 lightDirection = normalize(light.position - vertexPosition);
+	float impact = max(dot(lightNormal, lightDirection), 0.0);
+	diffuse = impact * light.diffuseColor * material.diffuseColor;
+
+	// specular lighting
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0), light.focalStrength);
+	specular = light.specularIntensity * specularComponent * light.specularColor * material.specularColor;
+
+	return ambient + diffuse + specular;
+}
+
+vec3 CalcPhongLighting()
+{
+	vec3 phongResult = vec3(0.0);
+#if LIGHT_COUNT > 0
+	vec3 lightNormal = normalize(fragmentVertexNormal);
+	vec3 viewDirection = normalize(viewPosition - fragmentPosition);
+	for (int i = 0; i < LIGHT_COUNT; i++)
+	{
+		phongResult += CalcLightSource(lightSources[i], lightNormal, fragmentPosition, viewDirection);
+	}
+#endif
+	return phongResult;
+}
+
+#ifdef USE_WEIGHTED_OIT
+// weight of a transparent fragment, which favors fragments that
+// are close to the camera and cover more, and stays within the
+// range of the half float accumulation target
+float CalcTransparencyWeight(float alpha)
+{
+	float coverage = min(1.0, alpha * 10.0) + 0.01;
+	float distance = 1.0 - gl_FragCoord.z * 0.9;
+	return clamp(coverage * coverage * coverage * 1e8 * distance * distance * distance, 1e-2, 3e3);
+}
+#endif
+
+void main()
+{
+	vec4 baseColor;
+	vec3 litColor;
+
+#ifdef PERMUTATION
+	#ifdef USE_TEXTURE
+	baseColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+	#else
+	baseColor = objectColor;
+	#endif
+
+	#if defined(USE_LIGHTMAP)
+	litColor = texture(lightmap, fragmentLightmapCoordinate).rgb * baseColor.rgb;
+	#elif defined(USE_LIGHTING)
+	litColor = CalcPhongLighting() * baseColor.rgb;
+	#else
+	litColor = baseColor.rgb;
+	#endif
+
+	#ifdef USE_ALPHA
+	float alpha = baseColor.a * materialOpacity;
+	#else
+	float alpha = 1.0;
+	#endif
+
+	#ifdef USE_WEIGHTED_OIT
+	float weight = CalcTransparencyWeight(alpha);
+	outAccumulation = vec4(litColor * alpha, alpha) * weight;
+	outRevealage = alpha;
+	#else
+	outFragmentColor = vec4(litColor, alpha);
+	#endif
+#else
+	if (bUseTexture)
+	{
+		baseColor = texture(objectTexture, fragmentTextureCoordinate * UVscale);
+	}
+	else
+	{
+		baseColor = objectColor;
+	}
+
+	if (bUseLighting)
+	{
+		litColor = CalcPhongLighting() * baseColor.rgb;
+	}
+	else
+	{
+		litColor = baseColor.rgb;
+	}
+
+	outFragmentColor = vec4(litColor, baseColor.a * materialOpacity);
+#endif
+}
@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneVertexShader.glsl
+// ============
+// forward shading vertex shader shared by every program variant
+//
+// The camera is read from the shared camera block.  With
+// USE_DRAW_BUFFER the settings of each draw are read from the uniform
+// block in the frame ring buffer, otherwise from plain uniforms.
+// With USE_GPU_CULLING the draws come from the indirect commands of
+// the culling pass, and the settings of every object are read from a
+// storage buffer at the index the base instance passes in.
+// With USE_LIGHTMAP the vertex is also projected onto the lightmap
+// cell of its face.
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+#ifdef USE_GPU_CULLING
+// instanced attribute that counts up from the base instance of the
+// draw, which is the index of the object
+layout (location = 3) in uint inDrawIndex;
+#endif
+
+// the depth pre-pass computes the same position, the shading pass
+// matches its depth exactly with GL_EQUAL
+invariant gl_Position;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+#ifdef USE_GPU_CULLING
+flat out uint fragmentDrawIndex;
+#endif
+#ifdef USE_LIGHTMAP
+out vec2 fragmentLightmapCoordinate;
+
+// baked lighting of the static surfaces
+uniform sampler2D lightmap;
+#endif
+
+// camera of the frame, shared by every program and only
+// rewritten when the camera changes
+layout (std140) uniform CameraBlock {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	mat4 inverseViewProjection;
+	vec4 frustumPlanes[6];
+	vec4 cameraPosition;
+};
+
+#if defined(USE_DRAW_BUFFER) || defined(USE_GPU_CULLING)
+// settings of one draw, written into the frame ring buffer
+struct DrawData {
+	mat4 model;
+	mat3 normalMatrix;
+	vec4 color;
+	// UV scale in xy, texture flag in z, material index in w
+	vec4 parameters;
+	// lightmap cells of a static surface, zero without one
+	vec4 lightmapRect;
+};
+#endif
+
+#if defined(USE_GPU_CULLING)
+// settings of every object of the culling pass
+layout (std430) buffer DrawBuffer {
+	DrawData draws[];
+};
+
+#define drawIndex (int(inDrawIndex))
+#elif defined(USE_DRAW_BUFFER)
+layout (std140) uniform DrawBlock {
+	DrawData draws[MAX_DRAWS];
+};
+
+// index of the current draw within the bound draw block
+uniform int drawIndex = 0;
+#else
+uniform mat4 model;
+#ifdef USE_LIGHTMAP
+uniform vec4 lightmapRect;
+#endif
+#endif
+
+#ifdef USE_LIGHTMAP
+// the lightmap has a cell for every face of the unit box, one
+// column per axis with the positive face in the first row, and
+// the baker projects the faces the same way: the X faces onto
+// z and y, the Y faces onto x and z, the Z faces onto x and y
+vec2 CalcLightmapCoordinate(vec4 rect)
+{
+	vec3 side = abs(inVertexNormal);
+	vec2 planar;
+	vec2 cell;
+	if ((side.x >= side.y) && (side.x >= side.z))
+	{
+		planar = inVertexPosition.zy;
+		cell = vec2(0.0, (inVertexNormal.x > 0.0) ? 0.0 : 1.0);
+	}
+	else if (side.y >= side.z)
+	{
+		planar = inVertexPosition.xz;
+		cell = vec2(1.0, (inVertexNormal.y > 0.0) ? 0.0 : 1.0);
+	}
+	else
+	{
+		planar = inVertexPosition.xy;
+		cell = vec2(2.0, (inVertexNormal.z > 0.0) ? 0.0 : 1.0);
+	}
+
+	// the cells are apart by a border of two texels
+	vec2 cellStride = rect.zw + 2.0 / vec2(textureSize(lightmap, 0));
+	return rect.xy + cell * cellStride + (planar + 0.5) * rect.zw;
+}
+#endif
+
+void main()
+{
+#if defined(USE_DRAW_BUFFER) || defined(USE_GPU_CULLING)
+	mat4 model = draws[drawIndex].model;
+	mat3 normalMatrix = draws[drawIndex].normalMatrix;
+	vec4 lightmapRect = draws[drawIndex].lightmapRect;
+#else
+	mat3 normalMatrix = mat3(transpose(inverse(model)));
+#endif
+
+	gl_Position = viewProjection * model * vec4(inVertexPosition, 1.0);
+
+	fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
+	fragmentVertexNormal = normalMatrix * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+#ifdef USE_GPU_CULLING
+	fragmentDrawIndex = inDrawIndex;
+#endif
+#ifdef USE_LIGHTMAP
+	fragmentLightmapCoordinate = CalcLightmapCoordinate(lightmapRect);
+#endif
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// taaResolveFragmentShader.glsl
+// ============
+// temporal anti-aliasing resolve - blend the jittered frame into the
+// history of the previous frames
+//
+// The depth of the pixel moves it back into the world and onto the
+// previous frame, where the history is read.  The history is clamped
+// to the range of the colors around the pixel in this frame, so a
+// surface that was uncovered or has moved does not drag the old color
+// along.  Without a history, or where the previous frame did not see
+// the point, the frame is passed through.
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec2 screenTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D sceneColor;
+uniform sampler2D sceneDepth;
+uniform sampler2D historyColor;
+// fraction of the target covered by the rendered region of this
+// frame and of the history
+uniform vec2 renderScale = vec2(1.0);
+uniform vec2 historyScale = vec2(1.0);
+// size of one texel of the target
+uniform vec2 texelSize;
+// from the device coordinates of this frame to the clip space of
+// the previous frame
+uniform mat4 reprojection;
+uniform bool bHistoryValid = false;
+// weight of this frame in the blend
+uniform float frameWeight = 0.1;
+
+void main()
+{
+	vec2 coordinate = screenTextureCoordinate * renderScale;
+	vec3 current = texture(sceneColor, coordinate).rgb;
+	if (!bHistoryValid)
+	{
+		outFragmentColor = vec4(current, 1.0);
+		return;
+	}
+
+	// range of the colors in the 3 by 3 neighborhood
+	vec2 minCoordinate = texelSize * 0.5;
+	vec2 maxCoordinate = renderScale - texelSize * 0.5;
+	vec3 minColor = current;
+	vec3 maxColor = current;
+	for (int y = -1; y <= 1; y++)
+	{
+		for (int x = -1; x <= 1; x++)
+		{
+			vec3 neighbor = texture(sceneColor,
+				clamp(coordinate + vec2(x, y) * texelSize, minCoordinate, maxCoordinate)).rgb;
+			minColor = min(minColor, neighbor);
+			maxColor = max(maxColor, neighbor);
+		}
+	}
+
+	float depth = texture(sceneDepth, coordinate).r;
+	vec4 previous = reprojection * vec4(screenTextureCoordinate * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+	vec2 previousCoordinate = (previous.xy / previous.w) * 0.5 + 0.5;
+	if ((previous.w <= 0.0) ||
+		any(lessThan(previousCoordinate, vec2(0.0))) ||
+		any(greaterThan(previousCoordinate, vec2(1.0))))
+	{
+		outFragmentColor = vec4(current, 1.0);
+		return;
+	}
+
+	vec3 history = texture(historyColor, previousCoordinate * historyScale).rgb;
+	history = clamp(history, minColor, maxColor);
+
+	outFragmentColor = vec4(mix(history, current, frameWeight), 1.0);
+}
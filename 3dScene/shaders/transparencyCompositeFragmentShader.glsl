@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+// transparencyCompositeFragmentShader.glsl
+// ============
+// resolve weighted blended order independent transparency - divide the
+// summed colors by their weight and output the remaining revealage,
+// which the blend state uses to mix the average over the opaque image
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+out vec4 outFragmentColor;
+
+// premultiplied weighted color sum in rgb, weight sum in a
+uniform sampler2D accumulationTexture;
+// product of the transmission of every transparent layer
+uniform sampler2D revealageTexture;
+
+void main()
+{
+	ivec2 coordinate = ivec2(gl_FragCoord.xy);
+
+	// pixels without transparent surfaces keep the opaque color
+	float revealage = texelFetch(revealageTexture, coordinate, 0).r;
+	if (revealage >= 0.9999)
+	{
+		discard;
+	}
+
+	vec4 accumulation = texelFetch(accumulationTexture, coordinate, 0);
+	// a half float sum that overflowed is replaced by its weight
+	if (isinf(max(max(abs(accumulation.r), abs(accumulation.g)), abs(accumulation.b))))
+	{
+		accumulation.rgb = vec3(accumulation.a);
+	}
+	vec3 averageColor = accumulation.rgb / max(accumulation.a, 0.00001);
+
+	outFragmentColor = vec4(averageColor, revealage);
+}
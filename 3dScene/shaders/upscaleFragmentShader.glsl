@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// upscaleFragmentShader.glsl
+// ============
+// stretch the dynamic resolution region over the window and sharpen
+// the result with a contrast adaptive cross filter
+///////////////////////////////////////////////////////////////////////////////
+#version 330 core
+
+in vec2 screenTextureCoordinate;
+
+out vec4 outFragmentColor;
+
+uniform sampler2D sceneColor;
+// fraction of the target covered by the rendered region
+uniform vec2 renderScale = vec2(1.0);
+// size of one texel of the target
+uniform vec2 texelSize;
+// strength of the sharpening, 0 leaves the bilinear result
+uniform float sharpness = 0.0;
+
+void main()
+{
+	// keep every tap inside the rendered region so the clear
+	// color beyond it does not bleed into the edges
+	vec2 minCoordinate = texelSize * 0.5;
+	vec2 maxCoordinate = renderScale - texelSize * 0.5;
+	vec2 coordinate = clamp(screenTextureCoordinate * renderScale, minCoordinate, maxCoordinate);
+
+	vec3 center = texture(sceneColor, coordinate).rgb;
+	if (sharpness <= 0.0)
+	{
+		outFragmentColor = vec4(center, 1.0);
+		return;
+	}
+
+	vec3 north = texture(sceneColor, clamp(coordinate + vec2(0.0, texelSize.y), minCoordinate, maxCoordinate)).rgb;
+	vec3 south = texture(sceneColor, clamp(coordinate - vec2(0.0, texelSize.y), minCoordinate, maxCoordinate)).rgb;
+	vec3 east = texture(sceneColor, clamp(coordinate + vec2(texelSize.x, 0.0), minCoordinate, maxCoordinate)).rgb;
+	vec3 west = texture(sceneColor, clamp(coordinate - vec2(texelSize.x, 0.0), minCoordinate, maxCoordinate)).rgb;
+
+	vec3 minColor = min(center, min(min(north, south), min(east, west)));
+	vec3 maxColor = max(center, max(max(north, south), max(east, west)));
+
+	// sharpen less where the local contrast is already high,
+	// which avoids halos around hard edges
+	vec3 amount = sharpness * (1.0 - (maxColor - minColor));
+	vec3 detail = center * 4.0 - north - south - east - west;
+	vec3 sharpened = center + detail * 0.25 * amount;
+
+	outFragmentColor = vec4(clamp(sharpened, minColor, maxColor), 1.0);
+}
@@ -0,0 +1,560 @@
+///////////////////////////////////////////////////////////////////////////////
+// antialiasing.cpp
+// ============
+// smooth the edges of the rendered scene with multisampling, a FXAA
+// post-process or temporal accumulation of jittered frames
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AntiAliasing.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texture units of the scene color, the scene depth and the
+	// history in the resolve passes
+	const int SCENE_COLOR_UNIT = 26;
+	const int SCENE_DEPTH_UNIT = 27;
+	const int HISTORY_UNIT = 28;
+
+	// weight of the new frame in the history, lower values
+	// smooth more and take longer to follow a change
+	const float TAA_FRAME_WEIGHT = 0.1f;
+
+	// command line names and profiler scopes of the modes
+	const char* const MODE_ARGUMENTS[AntiAliasing::MODE_COUNT] =
+	{
+		"off", "msaa2", "msaa4", "msaa8", "fxaa", "taa"
+	};
+	const char* const MODE_NAMES[AntiAliasing::MODE_COUNT] =
+	{
+		"aa off", "aa msaa 2x", "aa msaa 4x", "aa msaa 8x", "aa fxaa", "aa taa"
+	};
+	const char* const RESOLVE_NAMES[AntiAliasing::MODE_COUNT] =
+	{
+		"aa none", "msaa 2x resolve", "msaa 4x resolve", "msaa 8x resolve", "fxaa pass", "taa resolve"
+	};
+
+	/***********************************************************
+	 *  GetModeSamples()
+	 *
+	 *  Number of samples per pixel a mode renders with, zero
+	 *  for the modes without a multisampled target.
+	 ***********************************************************/
+	int GetModeSamples(AntiAliasing::MODE mode)
+	{
+		switch (mode)
+		{
+		case AntiAliasing::MODE_MSAA_2X:
+			return(2);
+		case AntiAliasing::MODE_MSAA_4X:
+			return(4);
+		case AntiAliasing::MODE_MSAA_8X:
+			return(8);
+		default:
+			return(0);
+		}
+	}
+
+	/***********************************************************
+	 *  Halton()
+	 *
+	 *  Element of the Halton sequence of a base, which spreads
+	 *  the offsets of consecutive frames evenly over the pixel.
+	 ***********************************************************/
+	float Halton(unsigned int index, unsigned int base)
+	{
+		float result = 0.0f;
+		float fraction = 1.0f / (float)base;
+		while (index > 0)
+		{
+			result += fraction * (float)(index % base);
+			index /= base;
+			fraction /= (float)base;
+		}
+		return(result);
+	}
+
+	/***********************************************************
+	 *  CreateColorTexture()
+	 *
+	 *  Allocate a filtered color texture for one of the targets
+	 *  and attach it to the bound framebuffer.
+	 ***********************************************************/
+	GLuint CreateColorTexture(GLenum format, int width, int height, const char* label)
+	{
+		GLuint texture = 0;
+		glGenTextures(1, &texture);
+		GLStateCache::BindTextureForUpdate(texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA,
+			(GL_RGBA16F == format) ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+
+		ResourceRegistry::Track(GL_TEXTURE, texture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+			ResourceRegistry::GetTextureSize(format, width, height, false), label);
+		return(texture);
+	}
+}
+
+/***********************************************************
+ *  AntiAliasing()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+AntiAliasing::AntiAliasing()
+{
+	m_mode = MODE_OFF;
+	m_bTargetFailed = false;
+	m_samples = 0;
+	m_maxSamples = 0;
+	m_pFxaaShader = new ShaderManager();
+	m_pFxaaShader->m_programID = 0;
+	m_pTaaShader = new ShaderManager();
+	m_pTaaShader->m_programID = 0;
+	m_bShadersReady = false;
+	m_emptyVAO = 0;
+	for (int i = 0; i < 2; i++)
+	{
+		m_historyFBOs[i] = 0;
+		m_historyTextures[i] = 0;
+	}
+	m_currentHistory = 0;
+	m_bHistoryValid = false;
+	m_historyWidth = 0;
+	m_historyHeight = 0;
+	m_historyViewProjection = glm::mat4(1.0f);
+	m_historyScale = glm::vec2(1.0f);
+	m_frameIndex = 0;
+	m_jitter = glm::vec2(0.0f);
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~AntiAliasing()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+AntiAliasing::~AntiAliasing()
+{
+	DestroyHistory();
+	if (0 != m_emptyVAO)
+	{
+		GLStateCache::DeleteVertexArrays(1, &m_emptyVAO);
+		m_emptyVAO = 0;
+	}
+	if (NULL != m_pFxaaShader)
+	{
+		delete m_pFxaaShader;
+		m_pFxaaShader = NULL;
+	}
+	if (NULL != m_pTaaShader)
+	{
+		delete m_pTaaShader;
+		m_pTaaShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for building the FXAA and the TAA
+ *  resolve programs.  They are small, so they are built right
+ *  away.  MSAA needs no program and works without them.
+ ***********************************************************/
+bool AntiAliasing::LoadShaders(
+	ShaderCache* pShaderCache,
+	const char* vertexShaderPath,
+	const char* fxaaFragmentShaderPath,
+	const char* taaFragmentShaderPath)
+{
+	if (!pShaderCache->LoadShaders(m_pFxaaShader, vertexShaderPath, fxaaFragmentShaderPath) ||
+		!pShaderCache->LoadShaders(m_pTaaShader, vertexShaderPath, taaFragmentShaderPath))
+	{
+		return(false);
+	}
+
+	GLStateCache::UseProgram(m_pFxaaShader->m_programID);
+	m_pFxaaShader->setSampler2DValue("sceneColor", SCENE_COLOR_UNIT);
+
+	GLStateCache::UseProgram(m_pTaaShader->m_programID);
+	m_pTaaShader->setSampler2DValue("sceneColor", SCENE_COLOR_UNIT);
+	m_pTaaShader->setSampler2DValue("sceneDepth", SCENE_DEPTH_UNIT);
+	m_pTaaShader->setSampler2DValue("historyColor", HISTORY_UNIT);
+	m_pTaaShader->setFloatValue("frameWeight", TAA_FRAME_WEIGHT);
+
+	// the full screen triangle is generated in the vertex shader
+	// but core profile still requires a bound vertex array
+	glGenVertexArrays(1, &m_emptyVAO);
+	m_bShadersReady = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetMode()
+ *
+ *  This method is used for selecting the anti-aliasing mode.
+ *  A new mode starts without a history and gets another try
+ *  at allocating its targets.  It is called on the thread
+ *  that owns the context, which is asked for the most samples
+ *  of MSAA.
+ ***********************************************************/
+void AntiAliasing::SetMode(MODE mode)
+{
+	if ((mode < MODE_OFF) || (mode >= MODE_COUNT) || (mode == m_mode))
+	{
+		return;
+	}
+	m_mode = mode;
+	m_bTargetFailed = false;
+	m_bHistoryValid = false;
+
+	m_samples = GetModeSamples(mode);
+	if (m_samples > 0)
+	{
+		if (0 == m_maxSamples)
+		{
+			glGetIntegerv(GL_MAX_SAMPLES, &m_maxSamples);
+		}
+		if (m_samples > m_maxSamples)
+		{
+			std::cout << "MSAA " << m_samples << "x is not supported, using "
+				<< m_maxSamples << " samples" << std::endl;
+			m_samples = m_maxSamples;
+		}
+	}
+}
+
+/***********************************************************
+ *  ParseMode()
+ *
+ *  This method is used for finding a mode by the name that is
+ *  passed on the command line.
+ ***********************************************************/
+AntiAliasing::MODE AntiAliasing::ParseMode(const char* name)
+{
+	for (int i = 0; i < MODE_COUNT; i++)
+	{
+		if (strcmp(name, MODE_ARGUMENTS[i]) == 0)
+		{
+			return((MODE)i);
+		}
+	}
+	return(MODE_COUNT);
+}
+
+/***********************************************************
+ *  GetModeName()
+ *
+ *  This method is used for getting the profiler scope name of
+ *  a mode.  Each mode averages under its own name, so the
+ *  report keeps the cost of every mode that was tried.
+ ***********************************************************/
+const char* AntiAliasing::GetModeName(MODE mode)
+{
+	if ((mode < MODE_OFF) || (mode >= MODE_COUNT))
+	{
+		return(MODE_NAMES[MODE_OFF]);
+	}
+	return(MODE_NAMES[mode]);
+}
+
+/***********************************************************
+ *  GetResolveName()
+ *
+ *  This method is used for getting the profiler scope name of
+ *  the resolve of the selected mode.
+ ***********************************************************/
+const char* AntiAliasing::GetResolveName() const
+{
+	return(RESOLVE_NAMES[m_mode]);
+}
+
+/***********************************************************
+ *  NextJitter()
+ *
+ *  This method is used for getting the offset of the
+ *  projection for the frame about to be rendered.  The
+ *  offsets run through the Halton sequence in bases 2 and 3
+ *  within one pixel of the region rendered last, which is
+ *  the size of the new region unless it just changed.
+ ***********************************************************/
+glm::vec2 AntiAliasing::NextJitter()
+{
+	m_jitter = glm::vec2(0.0f);
+	if ((MODE_TAA != m_mode) || m_bTargetFailed || !m_bShadersReady ||
+		(m_width <= 0) || (m_height <= 0))
+	{
+		return(m_jitter);
+	}
+
+	unsigned int sample = (m_frameIndex % JITTER_SAMPLE_COUNT) + 1;
+	glm::vec2 offset(Halton(sample, 2) - 0.5f, Halton(sample, 3) - 0.5f);
+	m_jitter = glm::vec2(
+		offset.x * 2.0f / (float)m_width,
+		offset.y * 2.0f / (float)m_height);
+	return(m_jitter);
+}
+
+/***********************************************************
+ *  CreateHistory()
+ *
+ *  This method is used for allocating the two history
+ *  textures of TAA.  The history keeps half floats so the
+ *  small weight of a new frame is not lost to rounding.  It
+ *  outlives the frame, so it is not a transient texture of
+ *  the frame graph.
+ ***********************************************************/
+bool AntiAliasing::CreateHistory(int width, int height)
+{
+	DestroyHistory();
+
+	bool bComplete = true;
+	for (int i = 0; i < 2; i++)
+	{
+		glGenFramebuffers(1, &m_historyFBOs[i]);
+		GLStateCache::BindFramebuffer(m_historyFBOs[i]);
+		m_historyTextures[i] = CreateColorTexture(GL_RGBA16F, width, height, "taa history");
+		bComplete = bComplete && (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	}
+
+	GLStateCache::BindFramebuffer(0);
+	if (!bComplete)
+	{
+		std::cout << "Anti-aliasing history framebuffer is not complete" << std::endl;
+		DestroyHistory();
+		return(false);
+	}
+
+	m_historyWidth = width;
+	m_historyHeight = height;
+	m_currentHistory = 0;
+	m_bHistoryValid = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyHistory()
+ *
+ *  This method is used for freeing the history.
+ ***********************************************************/
+void AntiAliasing::DestroyHistory()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (0 != m_historyTextures[i])
+		{
+			ResourceRegistry::Release(GL_TEXTURE, 1, &m_historyTextures[i]);
+			GLStateCache::DeleteTextures(1, &m_historyTextures[i]);
+			m_historyTextures[i] = 0;
+		}
+		if (0 != m_historyFBOs[i])
+		{
+			GLStateCache::DeleteFramebuffers(1, &m_historyFBOs[i]);
+			m_historyFBOs[i] = 0;
+		}
+	}
+	m_historyWidth = 0;
+	m_historyHeight = 0;
+	m_bHistoryValid = false;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame of the selected
+ *  mode.  The history of TAA is allocated again when the
+ *  region outgrew it, and freed when another mode is
+ *  selected.  Without a mode, or while a
+ *  post-process mode has no program, the scene is rendered
+ *  into the output framebuffer as before.
+ ***********************************************************/
+bool AntiAliasing::BeginFrame(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+
+	if (MODE_TAA != m_mode)
+	{
+		DestroyHistory();
+	}
+	if ((MODE_OFF == m_mode) || m_bTargetFailed || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	if (GetModeSamples(m_mode) > 0)
+	{
+		return(m_samples > 0);
+	}
+	if (!m_bShadersReady)
+	{
+		return(false);
+	}
+
+	if ((MODE_TAA == m_mode) && ((width > m_historyWidth) || (height > m_historyHeight)))
+	{
+		int historyWidth = (width > m_historyWidth) ? width : m_historyWidth;
+		int historyHeight = (height > m_historyHeight) ? height : m_historyHeight;
+		if (!CreateHistory(historyWidth, historyHeight))
+		{
+			m_bTargetFailed = true;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DisableTarget()
+ *
+ *  This method is used for rendering the scene without the
+ *  selected mode after its scene target could not be
+ *  allocated.  Selecting a mode tries again.
+ ***********************************************************/
+void AntiAliasing::DisableTarget()
+{
+	if (!m_bTargetFailed && (MODE_OFF != m_mode))
+	{
+		std::cout << "Anti-aliasing target for " << GetModeName(m_mode)
+			<< " could not be allocated" << std::endl;
+	}
+	m_bTargetFailed = true;
+	m_bHistoryValid = false;
+	m_jitter = glm::vec2(0.0f);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for resolving the rendered region into
+ *  the same region of the output framebuffer.  The samples of
+ *  MSAA are averaged by a blit, FXAA runs its full screen
+ *  pass, and TAA blends the frame into its history.
+ ***********************************************************/
+void AntiAliasing::EndFrame(
+	const SCENE_TARGET& scene,
+	GLuint outputFramebuffer,
+	const glm::mat4& view,
+	const glm::mat4& projection)
+{
+	if (MODE_TAA == m_mode)
+	{
+		ResolveTemporal(scene, outputFramebuffer, view, projection);
+		m_frameIndex++;
+		return;
+	}
+
+	if (m_samples > 0)
+	{
+		// the blit binds the read and draw framebuffers separately,
+		// so the cached binding is replaced right after it
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, scene.framebuffer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+		glBlitFramebuffer(
+			0, 0, m_width, m_height,
+			0, 0, m_width, m_height,
+			GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		GLStateCache::BindFramebuffer(scene.framebuffer);
+		GLStateCache::BindFramebuffer(outputFramebuffer);
+		return;
+	}
+
+	GLStateCache::BindFramebuffer(outputFramebuffer);
+	GLStateCache::Viewport(0, 0, m_width, m_height);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
+	GLStateCache::SetEnabled(GL_BLEND, false);
+
+	GLStateCache::UseProgram(m_pFxaaShader->m_programID);
+	m_pFxaaShader->setVec2Value("renderScale", glm::vec2(
+		(float)m_width / (float)scene.width,
+		(float)m_height / (float)scene.height));
+	m_pFxaaShader->setVec2Value("texelSize", glm::vec2(
+		1.0f / (float)scene.width,
+		1.0f / (float)scene.height));
+	GLStateCache::BindTexture(SCENE_COLOR_UNIT, scene.colorTexture);
+
+	GLStateCache::BindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	// restore the state that the forward path relies on
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+}
+
+/***********************************************************
+ *  ResolveTemporal()
+ *
+ *  This method is used for blending the frame into the
+ *  history.  A pixel is moved back to the world with the
+ *  offset camera it was rendered with, and onto the history
+ *  with the camera of the previous frame without its offset.
+ *  The blended frame becomes the history of the next frame
+ *  and is copied into the output.
+ ***********************************************************/
+void AntiAliasing::ResolveTemporal(
+	const SCENE_TARGET& scene,
+	GLuint outputFramebuffer,
+	const glm::mat4& view,
+	const glm::mat4& projection)
+{
+	// the offset of this frame is taken back out of the
+	// projection for the camera the next frame reprojects to
+	glm::mat4 removeJitter(1.0f);
+	removeJitter[3][0] = -m_jitter.x;
+	removeJitter[3][1] = -m_jitter.y;
+	glm::mat4 viewProjection = removeJitter * projection * view;
+	glm::mat4 reprojection = m_historyViewProjection * glm::inverse(projection * view);
+
+	int writeHistory = 1 - m_currentHistory;
+	GLStateCache::BindFramebuffer(m_historyFBOs[writeHistory]);
+	GLStateCache::Viewport(0, 0, m_width, m_height);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
+	GLStateCache::SetEnabled(GL_BLEND, false);
+
+	GLStateCache::UseProgram(m_pTaaShader->m_programID);
+	m_pTaaShader->setVec2Value("renderScale", glm::vec2(
+		(float)m_width / (float)scene.width,
+		(float)m_height / (float)scene.height));
+	m_pTaaShader->setVec2Value("historyScale", m_historyScale);
+	m_pTaaShader->setVec2Value("texelSize", glm::vec2(
+		1.0f / (float)scene.width,
+		1.0f / (float)scene.height));
+	m_pTaaShader->setMat4Value("reprojection", reprojection);
+	m_pTaaShader->setBoolValue("bHistoryValid", m_bHistoryValid);
+	GLStateCache::BindTexture(SCENE_COLOR_UNIT, scene.colorTexture);
+	GLStateCache::BindTexture(SCENE_DEPTH_UNIT, scene.depthTexture);
+	GLStateCache::BindTexture(HISTORY_UNIT, m_historyTextures[m_currentHistory]);
+
+	GLStateCache::BindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_historyFBOs[writeHistory]);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, outputFramebuffer);
+	glBlitFramebuffer(
+		0, 0, m_width, m_height,
+		0, 0, m_width, m_height,
+		GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	GLStateCache::BindFramebuffer(m_historyFBOs[writeHistory]);
+	GLStateCache::BindFramebuffer(outputFramebuffer);
+
+	// restore the state that the forward path relies on
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+
+	m_currentHistory = writeHistory;
+	m_historyViewProjection = viewProjection;
+	m_historyScale = glm::vec2(
+		(float)m_width / (float)m_historyWidth,
+		(float)m_height / (float)m_historyHeight);
+	m_bHistoryValid = true;
+}
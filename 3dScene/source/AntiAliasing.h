@@ -0,0 +1,175 @@
+///////////////////////////////////////////////////////////////////////////////
+// antialiasing.h
+// ============
+// smooth the edges of the rendered scene with multisampling, a FXAA
+// post-process or temporal accumulation of jittered frames
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderCache.h"
+
+#include <GL/glew.h>
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  AntiAliasing
+ *
+ *  This class resolves the offscreen target the scene is
+ *  rendered into while an anti-aliasing mode is selected into
+ *  the framebuffer the frame would otherwise have been
+ *  rendered into, the window or the dynamic resolution target.
+ *  The scene target is a transient texture of the frame graph,
+ *  only the history of TAA is kept here.
+ *
+ *  MSAA renders into multisampled color and depth buffers and
+ *  resolves them with a blit, so its cost is in the scene
+ *  passes themselves.  It only smooths what is rasterized into
+ *  the target, so the lighting pass of the deferred path gains
+ *  nothing from it.
+ *
+ *  FXAA is one full screen pass over the finished image that
+ *  blends across the edges it finds in the luminance, at a
+ *  fixed cost per pixel whatever the scene holds.
+ *
+ *  TAA moves the projection by a sub-pixel offset every frame
+ *  and blends each frame into a history of the previous ones.
+ *  The history is found again through the depth of the pixel
+ *  and the camera of the previous frame, and clamped to the
+ *  colors around the pixel so moving edges do not leave
+ *  trails behind.
+ *
+ *  The scene target and the history may be larger than the
+ *  frame, which is rendered into their lower left region.
+ ***********************************************************/
+class AntiAliasing
+{
+public:
+	// selectable modes, in the order of the number keys
+	enum MODE
+	{
+		MODE_OFF,
+		MODE_MSAA_2X,
+		MODE_MSAA_4X,
+		MODE_MSAA_8X,
+		MODE_FXAA,
+		MODE_TAA,
+		MODE_COUNT
+	};
+
+	// target the scene was rendered into, with the allocated
+	// size of its textures
+	struct SCENE_TARGET
+	{
+		GLuint framebuffer;
+		GLuint colorTexture;
+		GLuint depthTexture;
+		int width;
+		int height;
+	};
+
+	// constructor
+	AntiAliasing();
+	// destructor
+	~AntiAliasing();
+
+	// build the FXAA and the TAA resolve programs
+	bool LoadShaders(
+		ShaderCache* pShaderCache,
+		const char* vertexShaderPath,
+		const char* fxaaFragmentShaderPath,
+		const char* taaFragmentShaderPath);
+
+	// select a mode, the history is allocated by the next frame
+	void SetMode(MODE mode);
+	MODE GetMode() const { return(m_mode); }
+	// find a mode by its command line name, MODE_COUNT when the
+	// name is unknown
+	static MODE ParseMode(const char* name);
+	// name of the profiler scope of a mode, which covers the
+	// scene passes and the resolve
+	static const char* GetModeName(MODE mode);
+	// name of the profiler scope of the resolve of the mode
+	const char* GetResolveName() const;
+
+	// offset of the projection in normalized device coordinates
+	// for the frame about to be rendered, zero unless TAA is
+	// selected, it is kept for the resolve of the frame
+	glm::vec2 NextJitter();
+
+	// start a frame with the size of the region the scene is
+	// rendered into, false when the scene renders into the
+	// output framebuffer itself
+	bool BeginFrame(int width, int height);
+	// samples per pixel of the scene target, zero when it is
+	// single sampled
+	int GetSampleCount() const { return(m_samples); }
+	// true when the mode reads the depth of the scene, which the
+	// lighting pass of the deferred path does not write
+	bool NeedsSceneDepth() const { return(MODE_TAA == m_mode); }
+	// resolve the scene target into the output framebuffer, with
+	// the camera the frame was rendered with
+	void EndFrame(
+		const SCENE_TARGET& scene,
+		GLuint outputFramebuffer,
+		const glm::mat4& view,
+		const glm::mat4& projection);
+	// stop rendering into a scene target, when it could not be
+	// allocated, until another mode is selected
+	void DisableTarget();
+
+private:
+	// number of projection offsets before the sequence repeats
+	static const int JITTER_SAMPLE_COUNT = 8;
+
+	// selected mode
+	MODE m_mode;
+	// true when the targets of the selected mode could not be
+	// allocated, cleared when another mode is selected
+	bool m_bTargetFailed;
+	// samples of the scene target, and the most the driver allows
+	int m_samples;
+	int m_maxSamples;
+
+	// programs of the FXAA pass and the TAA resolve
+	ShaderManager* m_pFxaaShader;
+	ShaderManager* m_pTaaShader;
+	bool m_bShadersReady;
+	// empty vertex array for the full screen triangle
+	GLuint m_emptyVAO;
+
+	// accumulated frames of TAA, one is read while the other one
+	// is written
+	GLuint m_historyFBOs[2];
+	GLuint m_historyTextures[2];
+	int m_currentHistory;
+	bool m_bHistoryValid;
+	// allocated size of the history, it only grows
+	int m_historyWidth;
+	int m_historyHeight;
+	// camera without the offset and region of the history
+	glm::mat4 m_historyViewProjection;
+	glm::vec2 m_historyScale;
+	// number of the frame in the offset sequence and the offset
+	// of the current frame
+	unsigned int m_frameIndex;
+	glm::vec2 m_jitter;
+
+	// size of the region rendered in the current frame
+	int m_width;
+	int m_height;
+
+	// allocate the history of TAA
+	bool CreateHistory(int width, int height);
+	// free the history
+	void DestroyHistory();
+	// blend the frame into the history and copy it to the output
+	void ResolveTemporal(
+		const SCENE_TARGET& scene,
+		GLuint outputFramebuffer,
+		const glm::mat4& view,
+		const glm::mat4& projection);
+};
@@ -0,0 +1,311 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.cpp
+// ============
+// render a list of camera views of the scene to image files
+// with the software renderer, several views at the same time
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRenderer.h"
+#include "SoftwareRenderer.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// most images each view thread may have waiting for the writer
+	const int PENDING_IMAGES_PER_THREAD = 2;
+	// most view threads, one software renderer each
+	const int MAX_VIEW_THREADS = 64;
+}
+
+/***********************************************************
+ *  BatchRenderer()
+ *
+ *  The constructor for the class.  The scene must have been
+ *  prepared and rendered once, so its draw list is recorded.
+ ***********************************************************/
+BatchRenderer::BatchRenderer(
+	const SceneManager* pScene,
+	int width,
+	int height,
+	int threadCount)
+{
+	m_pScene = pScene;
+	m_width = glm::max(width, 1);
+	m_height = glm::max(height, 1);
+
+	m_threadCount = threadCount;
+	if (m_threadCount <= 0)
+	{
+		m_threadCount = (int)std::thread::hardware_concurrency();
+	}
+	m_threadCount = glm::clamp(m_threadCount, 1, MAX_VIEW_THREADS);
+
+	m_nextView = 0;
+	m_bRenderingDone = false;
+	m_writtenCount = 0;
+	m_failedCount = 0;
+	m_elapsedTime = 0.0;
+	m_renderTime = 0.0;
+}
+
+/***********************************************************
+ *  ~BatchRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BatchRenderer::~BatchRenderer()
+{
+	m_pScene = NULL;
+}
+
+/***********************************************************
+ *  LoadViews()
+ *
+ *  This method is used for reading the views to render.  Each
+ *  line names the image file and the projection, optionally
+ *  followed by the camera position, the viewing direction and
+ *  the field of view in degrees:
+ *
+ *    image.png perspective|orthographic [px py pz fx fy fz [zoom]]
+ *
+ *  Without a position the view uses the startup camera, or the
+ *  front view that the O key selects for the orthographic
+ *  projection.  Empty lines and lines starting with # are
+ *  skipped.  The file type follows the image extension, which
+ *  is .png, .tga or .ppm.
+ ***********************************************************/
+bool BatchRenderer::LoadViews(const std::string& filename)
+{
+	std::ifstream file(filename.c_str());
+	if (!file)
+	{
+		std::cout << "Could not open the view list:" << filename << std::endl;
+		return(false);
+	}
+
+	std::vector<BATCH_VIEW> views;
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		std::istringstream stream(line);
+		BATCH_VIEW view;
+		std::string projection;
+		if (!(stream >> view.filename) || (view.filename[0] == '#'))
+		{
+			continue;
+		}
+
+		bool bValid = (bool)(stream >> projection);
+		bool bOrthographic = (projection == "orthographic");
+		bValid = bValid && (bOrthographic || (projection == "perspective"));
+		if (bValid)
+		{
+			view.pose = ViewManager::GetDefaultPose(bOrthographic);
+
+			glm::vec3 position;
+			if (stream >> position.x)
+			{
+				glm::vec3 front;
+				bValid = (bool)(stream >> position.y >> position.z >> front.x >> front.y >> front.z);
+				view.pose.position = position;
+				view.pose.front = front;
+
+				float zoom;
+				if (bValid && (stream >> zoom))
+				{
+					view.pose.zoom = zoom;
+				}
+				bValid = bValid && (glm::length(front) > 0.0f);
+			}
+		}
+
+		if (!bValid)
+		{
+			std::cout << "Invalid view in " << filename << " line " << lineNumber << ": " << line << std::endl;
+			return(false);
+		}
+		views.push_back(view);
+	}
+
+	m_views.swap(views);
+	return(true);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering every view of the list.
+ *  It starts the view threads and the writer thread and waits
+ *  until the last image has been written.
+ ***********************************************************/
+bool BatchRenderer::Run()
+{
+	m_nextView = 0;
+	m_bRenderingDone = false;
+	m_pendingImages.clear();
+	m_writtenCount = 0;
+	m_failedCount = 0;
+	m_renderTime = 0.0;
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	std::thread writer(&BatchRenderer::WriteImages, this);
+
+	// no more view threads than views
+	int threadCount = glm::min(m_threadCount, glm::max((int)m_views.size(), 1));
+	std::vector<std::thread> viewThreads;
+	for (int i = 0; i < threadCount; i++)
+	{
+		viewThreads.push_back(std::thread(&BatchRenderer::RenderViews, this));
+	}
+	for (size_t i = 0; i < viewThreads.size(); i++)
+	{
+		viewThreads[i].join();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bRenderingDone = true;
+	}
+	m_imageQueued.notify_one();
+	writer.join();
+
+	m_elapsedTime = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - startTime).count();
+
+	return(m_failedCount == 0);
+}
+
+/***********************************************************
+ *  RenderViews()
+ *
+ *  This method is the body of a view thread.  It renders the
+ *  views it takes from the list with its own single threaded
+ *  software renderer, which shares the scene with the other
+ *  view threads, and queues the pixels for the writer.
+ ***********************************************************/
+void BatchRenderer::RenderViews()
+{
+	SoftwareRenderer renderer(m_width, m_height, 1);
+	float aspectRatio = (float)m_width / (float)m_height;
+	size_t maxPendingImages = (size_t)(m_threadCount * PENDING_IMAGES_PER_THREAD);
+	double renderTime = 0.0;
+
+	for (int index = m_nextView++; index < (int)m_views.size(); index = m_nextView++)
+	{
+		const BATCH_VIEW& view = m_views[index];
+
+		glm::mat4 viewMatrix;
+		glm::mat4 projection;
+		ViewManager::CalculatePoseView(view.pose, aspectRatio, viewMatrix, projection);
+		bool bRendered = renderer.Render(*m_pScene, viewMatrix, projection, view.pose.position);
+		renderTime += renderer.GetRenderTime();
+		if (!bRendered)
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_failedCount++;
+			continue;
+		}
+
+		PENDING_IMAGE image;
+		image.filename = view.filename;
+		image.pixels = renderer.GetColorBuffer();
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_imageTaken.wait(lock, [this, maxPendingImages] { return(m_pendingImages.size() < maxPendingImages); });
+			m_pendingImages.push_back(std::move(image));
+		}
+		m_imageQueued.notify_one();
+	}
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_renderTime += renderTime;
+}
+
+/***********************************************************
+ *  WriteImages()
+ *
+ *  This method is the body of the writer thread.  It encodes
+ *  and writes the queued images in the order they finished
+ *  until the view threads are done and the queue is empty.
+ ***********************************************************/
+void BatchRenderer::WriteImages()
+{
+	while (true)
+	{
+		PENDING_IMAGE image;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_imageQueued.wait(lock, [this] { return(!m_pendingImages.empty() || m_bRenderingDone); });
+			if (m_pendingImages.empty())
+			{
+				break;
+			}
+			image = std::move(m_pendingImages.front());
+			m_pendingImages.pop_front();
+		}
+		m_imageTaken.notify_all();
+
+		bool bWritten = SoftwareRenderer::WriteImageFile(
+			image.filename,
+			m_width,
+			m_height,
+			image.pixels.data());
+
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		if (bWritten)
+		{
+			m_writtenCount++;
+		}
+		else
+		{
+			m_failedCount++;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetImagesPerSecond()
+ *
+ *  This method is used for getting the throughput of the last
+ *  run, from the start of the first view to the last write.
+ ***********************************************************/
+double BatchRenderer::GetImagesPerSecond() const
+{
+	if (m_elapsedTime <= 0.0)
+	{
+		return(0.0);
+	}
+	return(m_writtenCount / m_elapsedTime);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the results of the last
+ *  run on the console.
+ ***********************************************************/
+void BatchRenderer::PrintReport() const
+{
+	std::cout << "Batch render: " << m_writtenCount << " of " << m_views.size()
+		<< " images at " << m_width << "x" << m_height
+		<< " with " << m_threadCount << " view threads" << std::endl;
+	std::cout << "  elapsed              " << m_elapsedTime << " s" << std::endl;
+	std::cout << "  images per second    " << GetImagesPerSecond() << std::endl;
+	if (!m_views.empty())
+	{
+		std::cout << "  render ms per view   " << m_renderTime / m_views.size() << std::endl;
+	}
+	if (m_failedCount > 0)
+	{
+		std::cout << "  failed images        " << m_failedCount << std::endl;
+	}
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.h
+// ============
+// render a list of camera views of the scene to image files
+// with the software renderer, several views at the same time
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  BatchRenderer
+ *
+ *  This class renders still images of the scene for a list of
+ *  camera poses without a window.  The scene is prepared once
+ *  and shared read only by the view threads, each of which owns
+ *  a single threaded software renderer and takes the next view
+ *  from the list.  The finished images are handed to a writer
+ *  thread, so encoding and disk access overlap the rendering.
+ ***********************************************************/
+class BatchRenderer
+{
+public:
+	// constructor, a thread count of 0 uses every core
+	BatchRenderer(
+		const SceneManager* pScene,
+		int width,
+		int height,
+		int threadCount = 0);
+	// destructor
+	~BatchRenderer();
+
+	// read the camera poses and the image files from a text file
+	bool LoadViews(const std::string& filename);
+	// render every view and wait until all images are written,
+	// returns false when an image could not be written
+	bool Run();
+
+	// print the image count and the throughput of the last run
+	void PrintReport() const;
+
+	int GetViewCount() const { return((int)m_views.size()); }
+	int GetThreadCount() const { return(m_threadCount); }
+	// images written by the last run
+	int GetImageCount() const { return(m_writtenCount); }
+	// duration of the last run in seconds
+	double GetElapsedTime() const { return(m_elapsedTime); }
+	// images written per second in the last run
+	double GetImagesPerSecond() const;
+
+private:
+	// a camera pose and the file its image is written to
+	struct BATCH_VIEW
+	{
+		ViewManager::CAMERA_POSE pose;
+		std::string filename;
+	};
+
+	// a rendered image waiting for the writer thread
+	struct PENDING_IMAGE
+	{
+		std::string filename;
+		std::vector<unsigned char> pixels;
+	};
+
+	const SceneManager* m_pScene;
+	int m_width;
+	int m_height;
+	int m_threadCount;
+	std::vector<BATCH_VIEW> m_views;
+
+	// index of the next view a view thread takes
+	std::atomic<int> m_nextView;
+	// images between the view threads and the writer thread, the
+	// view threads wait when the queue is full to bound the memory
+	std::deque<PENDING_IMAGE> m_pendingImages;
+	std::mutex m_queueMutex;
+	std::condition_variable m_imageQueued;
+	std::condition_variable m_imageTaken;
+	bool m_bRenderingDone;
+
+	// results of the last run
+	int m_writtenCount;
+	int m_failedCount;
+	double m_elapsedTime;
+	// summed render time of the views, in milliseconds
+	double m_renderTime;
+	std::mutex m_statsMutex;
+
+	// body of a view thread
+	void RenderViews();
+	// body of the writer thread
+	void WriteImages();
+};
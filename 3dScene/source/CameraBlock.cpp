@@ -0,0 +1,228 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerablock.cpp
+// ============
+// std140 uniform block with the camera of the frame, shared by every
+// program and only rewritten when the camera changes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CameraBlock.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// name of the camera block in the shaders
+	const char* g_CameraBlockName = "CameraBlock";
+}
+
+/***********************************************************
+ *  CameraBlock()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CameraBlock::CameraBlock()
+{
+	m_buffer = 0;
+	m_slotStride = sizeof(CAMERA_DATA);
+	m_boundSlot = 0;
+	for (int i = 0; i < MAX_VIEWS; i++)
+	{
+		m_data[i].view = glm::mat4(1.0f);
+		m_data[i].projection = glm::mat4(1.0f);
+		m_data[i].viewProjection = glm::mat4(1.0f);
+		m_data[i].inverseViewProjection = glm::mat4(1.0f);
+		CalculateFrustumPlanes(m_data[i].viewProjection, m_data[i].frustumPlanes);
+		m_data[i].position = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		m_bValid[i] = false;
+	}
+	m_updateCount = 0;
+	m_skippedCount = 0;
+}
+
+/***********************************************************
+ *  ~CameraBlock()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CameraBlock::~CameraBlock()
+{
+	if (0 != m_buffer)
+	{
+		ResourceRegistry::Release(GL_BUFFER, 1, &m_buffer);
+		GLStateCache::DeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the uniform buffer with
+ *  a slot for every view and binding the first slot to the
+ *  camera binding point.  The slots are spaced by the offset
+ *  alignment, which glBindBufferRange() requires.
+ ***********************************************************/
+bool CameraBlock::Create()
+{
+	glGenBuffers(1, &m_buffer);
+	if (0 == m_buffer)
+	{
+		std::cout << "Could not create the camera block buffer" << std::endl;
+		return(false);
+	}
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment < 1)
+	{
+		alignment = 256;
+	}
+	m_slotStride = ((sizeof(CAMERA_DATA) + alignment - 1) / alignment) * alignment;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferData(GL_UNIFORM_BUFFER, m_slotStride * MAX_VIEWS, NULL, GL_DYNAMIC_DRAW);
+	for (int i = 0; i < MAX_VIEWS; i++)
+	{
+		glBufferSubData(GL_UNIFORM_BUFFER, m_slotStride * i, sizeof(CAMERA_DATA), &m_data[i]);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	m_boundSlot = 0;
+	glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, m_buffer, 0, sizeof(CAMERA_DATA));
+
+	ResourceRegistry::Track(GL_BUFFER, m_buffer, ResourceRegistry::CATEGORY_BUFFER,
+		(size_t)(m_slotStride * MAX_VIEWS), "camera block");
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for uploading the camera of a view to
+ *  its slot.  A camera that has not moved since the last
+ *  upload is not written again, the programs keep reading the
+ *  old values.
+ ***********************************************************/
+bool CameraBlock::Update(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& position,
+	int slot)
+{
+	if ((slot < 0) || (slot >= MAX_VIEWS))
+	{
+		return(false);
+	}
+
+	CAMERA_DATA& data = m_data[slot];
+	if (m_bValid[slot] &&
+		(view == data.view) &&
+		(projection == data.projection) &&
+		(position == glm::vec3(data.position)))
+	{
+		m_skippedCount++;
+		return(false);
+	}
+
+	data.view = view;
+	data.projection = projection;
+	data.viewProjection = projection * view;
+	data.inverseViewProjection = glm::inverse(data.viewProjection);
+	CalculateFrustumPlanes(data.viewProjection, data.frustumPlanes);
+	data.position = glm::vec4(position, 1.0f);
+	m_bValid[slot] = true;
+	m_updateCount++;
+
+	if (0 != m_buffer)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, m_slotStride * slot, sizeof(CAMERA_DATA), &data);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  BindView()
+ *
+ *  This method is used for pointing the camera binding point
+ *  at the slot of a view, the programs read that camera until
+ *  another slot is bound.
+ ***********************************************************/
+void CameraBlock::BindView(int slot)
+{
+	if ((0 == m_buffer) || (slot < 0) || (slot >= MAX_VIEWS) || (slot == m_boundSlot))
+	{
+		return;
+	}
+
+	m_boundSlot = slot;
+	glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, m_buffer,
+		m_slotStride * slot, sizeof(CAMERA_DATA));
+}
+
+/***********************************************************
+ *  CalculateFrustumPlanes()
+ *
+ *  This method is used for extracting the six clip planes
+ *  from the rows of a view projection matrix.  The planes are
+ *  normalized, so the dot product with a world position gives
+ *  its signed distance, which is positive inside the frustum.
+ ***********************************************************/
+void CameraBlock::CalculateFrustumPlanes(
+	const glm::mat4& viewProjection,
+	glm::vec4 planes[FRUSTUM_PLANE_COUNT])
+{
+	// glm matrices are column major, so a row is gathered from
+	// the same component of every column
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(
+			viewProjection[0][i],
+			viewProjection[1][i],
+			viewProjection[2][i],
+			viewProjection[3][i]);
+	}
+
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[3] + rows[2];
+	planes[5] = rows[3] - rows[2];
+
+	for (int i = 0; i < FRUSTUM_PLANE_COUNT; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.0f)
+		{
+			planes[i] = planes[i] * (1.0f / length);
+		}
+	}
+}
+
+/***********************************************************
+ *  BindProgramBlock()
+ *
+ *  This method is used for attaching the camera block of a
+ *  linked program to the camera binding point.  GLSL 3.30 has
+ *  no binding layout qualifier, so this is done once per
+ *  program.
+ ***********************************************************/
+void CameraBlock::BindProgramBlock(GLuint program)
+{
+	if (0 == program)
+	{
+		return;
+	}
+
+	GLuint cameraBlock = glGetUniformBlockIndex(program, g_CameraBlockName);
+	if (cameraBlock != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(program, cameraBlock, CAMERA_BLOCK_BINDING);
+	}
+}
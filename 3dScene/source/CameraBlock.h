@@ -0,0 +1,98 @@
+///////////////////////////////////////////////////////////////////////////////
+// camerablock.h
+// ============
+// std140 uniform block with the camera of the frame, shared by every
+// program and only rewritten when the camera changes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  CameraBlock
+ *
+ *  This class owns the uniform buffer that holds the camera:
+ *  the view and projection, their product and its inverse, the
+ *  frustum planes and the camera position.  The buffer stays
+ *  bound to a fixed binding point, and every program attaches
+ *  its CameraBlock there once after linking, so a new camera
+ *  costs one upload no matter how many programs read it.
+ *
+ *  Update() compares the passed in camera with the uploaded
+ *  one and leaves the buffer alone when nothing changed.
+ *
+ *  The buffer holds one slot per view, each at the offset
+ *  alignment of the driver.  BindView() points the binding at
+ *  the slot of a view, so views rendered one after another in
+ *  a frame all keep their camera in the same buffer.
+ ***********************************************************/
+class CameraBlock
+{
+public:
+	// uniform block binding point of the camera
+	static const GLuint CAMERA_BLOCK_BINDING = 0;
+	// number of frustum planes
+	static const int FRUSTUM_PLANE_COUNT = 6;
+	// number of views the buffer has room for
+	static const int MAX_VIEWS = 4;
+
+	// std140 layout of the camera block
+	struct CAMERA_DATA
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
+		glm::mat4 inverseViewProjection;
+		// left, right, bottom, top, near and far plane, with the
+		// normal pointing inside in xyz and the distance in w
+		glm::vec4 frustumPlanes[FRUSTUM_PLANE_COUNT];
+		glm::vec4 position;
+	};
+
+	// constructor
+	CameraBlock();
+	// destructor
+	~CameraBlock();
+
+	// create the buffer and bind its first slot to the binding point
+	bool Create();
+	// upload the camera of a view when it differs from the one
+	// uploaded to its slot, returns true when the buffer was written
+	bool Update(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& position,
+		int slot = 0);
+	// bind the slot of a view to the binding point
+	void BindView(int slot);
+
+	// camera values of the last upload to a slot
+	const CAMERA_DATA& GetData(int slot = 0) const { return(m_data[slot]); }
+	// number of uploads since the start
+	unsigned int GetUpdateCount() const { return(m_updateCount); }
+	// number of Update() calls that found the camera unchanged
+	unsigned int GetSkippedCount() const { return(m_skippedCount); }
+
+	// calculate the frustum planes of a view projection matrix
+	static void CalculateFrustumPlanes(
+		const glm::mat4& viewProjection,
+		glm::vec4 planes[FRUSTUM_PLANE_COUNT]);
+	// attach the camera block of a linked program to its binding point
+	static void BindProgramBlock(GLuint program);
+
+private:
+	GLuint m_buffer;
+	// distance between the slots in the buffer
+	GLsizeiptr m_slotStride;
+	// slot bound to the binding point
+	int m_boundSlot;
+	CAMERA_DATA m_data[MAX_VIEWS];
+	// false until the first camera was uploaded to a slot
+	bool m_bValid[MAX_VIEWS];
+	unsigned int m_updateCount;
+	unsigned int m_skippedCount;
+};
@@ -0,0 +1,577 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.cpp
+// ============
+// optional deferred shading path - a geometry pass writes a packed
+// G-buffer and a single full screen pass evaluates the scene lights
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DeferredRenderer.h"
+#include "FrameRingBuffer.h"
+#include "CameraBlock.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+
+#include <iostream>
+#include <string>
+
+// declaration of global variables
+namespace
+{
+	// the G-buffer textures are bound above the 16 slots that
+	// are reserved for the scene textures
+	const int GBUFFER_NORMAL_UNIT = 16;
+	const int GBUFFER_ALBEDO_UNIT = 17;
+	const int GBUFFER_MATERIAL_UNIT = 18;
+	const int GBUFFER_DEPTH_UNIT = 19;
+
+	// limits of the uniform arrays in the lighting shader
+	const int MAX_MATERIALS = 16;
+	const int MAX_LIGHTS = 4;
+}
+
+/***********************************************************
+ *  DeferredRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DeferredRenderer::DeferredRenderer()
+{
+	m_pGeometryShader = new ShaderManager();
+	m_pLightingShader = new ShaderManager();
+	m_pShaderCache = NULL;
+	m_geometryProgram = -1;
+	m_lightingProgram = -1;
+	m_bReady = false;
+	m_geometryReload = -1;
+	m_lightingReload = -1;
+	m_bSceneChanged = false;
+	m_gBufferFBO = 0;
+	m_normalTexture = 0;
+	m_albedoTexture = 0;
+	m_materialTexture = 0;
+	m_depthTexture = 0;
+	m_emptyVAO = 0;
+	m_width = 0;
+	m_height = 0;
+	m_viewWidth = 0;
+	m_viewHeight = 0;
+}
+
+/***********************************************************
+ *  ~DeferredRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DeferredRenderer::~DeferredRenderer()
+{
+	DestroyGBuffer();
+	if (0 != m_emptyVAO)
+	{
+		GLStateCache::DeleteVertexArrays(1, &m_emptyVAO);
+		m_emptyVAO = 0;
+	}
+	if (NULL != m_pGeometryShader)
+	{
+		delete m_pGeometryShader;
+		m_pGeometryShader = NULL;
+	}
+	if (NULL != m_pLightingShader)
+	{
+		delete m_pLightingShader;
+		m_pLightingShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  RequestShaders()
+ *
+ *  This method is used for queuing the geometry pass and the
+ *  lighting pass shader programs.  They are compiled in the
+ *  background, so the deferred path does not delay startup.
+ *  The geometry defines select how the draw settings are read
+ *  and must match the forward programs.
+ ***********************************************************/
+void DeferredRenderer::RequestShaders(
+	ShaderCache* pShaderCache,
+	const char* gBufferVertexShader,
+	const char* gBufferFragmentShader,
+	const char* lightingVertexShader,
+	const char* lightingFragmentShader,
+	const std::string& geometryDefines)
+{
+	m_pShaderCache = pShaderCache;
+	m_geometryVertexShader = gBufferVertexShader;
+	m_geometryFragmentShader = gBufferFragmentShader;
+	m_lightingVertexShader = lightingVertexShader;
+	m_lightingFragmentShader = lightingFragmentShader;
+	m_geometryDefines = geometryDefines;
+	m_geometryProgram = m_pShaderCache->RequestProgram(
+		gBufferVertexShader,
+		gBufferFragmentShader,
+		geometryDefines);
+	m_lightingProgram = m_pShaderCache->RequestProgram(lightingVertexShader, lightingFragmentShader);
+}
+
+/***********************************************************
+ *  IsReady()
+ *
+ *  This method is used for checking whether both programs
+ *  have been built.  The first time they are, the programs
+ *  are handed to the shader managers and the fixed sampler
+ *  units are set.
+ ***********************************************************/
+bool DeferredRenderer::IsReady()
+{
+	if (m_bReady)
+	{
+		return true;
+	}
+	if ((NULL == m_pShaderCache) ||
+		!m_pShaderCache->IsReady(m_geometryProgram) ||
+		!m_pShaderCache->IsReady(m_lightingProgram))
+	{
+		return false;
+	}
+
+	m_pGeometryShader->m_programID = m_pShaderCache->GetProgram(m_geometryProgram, 0);
+	m_pLightingShader->m_programID = m_pShaderCache->GetProgram(m_lightingProgram, 0);
+	SetupGeometryProgram();
+	SetupLightingProgram();
+
+	// the full screen triangle is generated in the vertex shader
+	// but core profile still requires a bound vertex array
+	glGenVertexArrays(1, &m_emptyVAO);
+
+	m_bReady = true;
+
+	return true;
+}
+
+/***********************************************************
+ *  SetupGeometryProgram()
+ *
+ *  This method is used for attaching the uniform blocks of
+ *  the linked geometry pass program.
+ ***********************************************************/
+void DeferredRenderer::SetupGeometryProgram()
+{
+	FrameRingBuffer::BindProgramBlocks(m_pGeometryShader->m_programID);
+	CameraBlock::BindProgramBlock(m_pGeometryShader->m_programID);
+}
+
+/***********************************************************
+ *  SetupLightingProgram()
+ *
+ *  This method is used for attaching the camera block of the
+ *  linked lighting pass program and pointing its samplers at
+ *  the G-buffer units.
+ ***********************************************************/
+void DeferredRenderer::SetupLightingProgram()
+{
+	CameraBlock::BindProgramBlock(m_pLightingShader->m_programID);
+
+	// the G-buffer samplers always read from the same units
+	GLStateCache::UseProgram(m_pLightingShader->m_programID);
+	m_pLightingShader->setSampler2DValue("gNormal", GBUFFER_NORMAL_UNIT);
+	m_pLightingShader->setSampler2DValue("gAlbedo", GBUFFER_ALBEDO_UNIT);
+	m_pLightingShader->setSampler2DValue("gMaterial", GBUFFER_MATERIAL_UNIT);
+	m_pLightingShader->setSampler2DValue("gDepth", GBUFFER_DEPTH_UNIT);
+}
+
+/***********************************************************
+ *  GetShaderFiles()
+ *
+ *  This method is used for getting the GLSL files that the
+ *  two programs are built from.
+ ***********************************************************/
+void DeferredRenderer::GetShaderFiles(std::vector<std::string>& files) const
+{
+	files.clear();
+	files.push_back(m_geometryVertexShader);
+	files.push_back(m_geometryFragmentShader);
+	files.push_back(m_lightingVertexShader);
+	files.push_back(m_lightingFragmentShader);
+}
+
+/***********************************************************
+ *  ReloadShaders()
+ *
+ *  This method is used for queuing a rebuild of the programs
+ *  that are built from a changed GLSL file.  The old programs
+ *  keep drawing until the new ones are ready.  Before the
+ *  first programs are ready the rebuilt ones simply take the
+ *  place of the requests.
+ ***********************************************************/
+bool DeferredRenderer::ReloadShaders(const std::string& changedFile)
+{
+	if (NULL == m_pShaderCache)
+	{
+		return(false);
+	}
+
+	bool bGeometry = (changedFile == m_geometryVertexShader) ||
+		(changedFile == m_geometryFragmentShader);
+	bool bLighting = (changedFile == m_lightingVertexShader) ||
+		(changedFile == m_lightingFragmentShader);
+
+	if (bGeometry)
+	{
+		m_geometryReload = m_pShaderCache->RequestProgram(
+			m_geometryVertexShader.c_str(),
+			m_geometryFragmentShader.c_str(),
+			m_geometryDefines);
+		if (!m_bReady)
+		{
+			m_geometryProgram = m_geometryReload;
+			m_geometryReload = -1;
+		}
+	}
+	if (bLighting)
+	{
+		m_lightingReload = m_pShaderCache->RequestProgram(
+			m_lightingVertexShader.c_str(),
+			m_lightingFragmentShader.c_str());
+		if (!m_bReady)
+		{
+			m_lightingProgram = m_lightingReload;
+			m_lightingReload = -1;
+		}
+	}
+
+	return(bGeometry || bLighting);
+}
+
+/***********************************************************
+ *  SwapReloadedProgram()
+ *
+ *  This method is used for handing a rebuilt program to its
+ *  shader manager once it is ready.  The cache deletes the
+ *  program it replaces.  A rebuild that failed is dropped, so
+ *  a typo in a shader leaves the last working program in use.
+ ***********************************************************/
+bool DeferredRenderer::SwapReloadedProgram(
+	int& reloadHandle,
+	int& programHandle,
+	ShaderManager* pShader)
+{
+	if (reloadHandle < 0)
+	{
+		return(false);
+	}
+	if (m_pShaderCache->IsFailed(reloadHandle))
+	{
+		std::cout << "Rebuilt deferred shader failed, the previous program is kept" << std::endl;
+		reloadHandle = -1;
+		return(false);
+	}
+	if (!m_pShaderCache->IsReady(reloadHandle))
+	{
+		return(false);
+	}
+
+	GLuint oldProgram = pShader->m_programID;
+	programHandle = reloadHandle;
+	reloadHandle = -1;
+	pShader->m_programID = m_pShaderCache->GetProgram(programHandle, 0);
+	if (oldProgram != pShader->m_programID)
+	{
+		m_pShaderCache->ReleaseProgram(oldProgram);
+	}
+	GLStateCache::InvalidateProgram();
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateReloads()
+ *
+ *  This method is used for swapping in the rebuilt programs
+ *  that are ready.  It is called between frames, so a frame
+ *  never mixes an old and a new program.  The new lighting
+ *  program receives its samplers and the scene data again.
+ ***********************************************************/
+bool DeferredRenderer::UpdateReloads()
+{
+	if (!m_bReady)
+	{
+		return(false);
+	}
+
+	bool bChanged = false;
+	if (SwapReloadedProgram(m_geometryReload, m_geometryProgram, m_pGeometryShader))
+	{
+		SetupGeometryProgram();
+		bChanged = true;
+	}
+	if (SwapReloadedProgram(m_lightingReload, m_lightingProgram, m_pLightingShader))
+	{
+		SetupLightingProgram();
+		m_bSceneChanged = true;
+		bChanged = true;
+	}
+
+	return(bChanged);
+}
+
+/***********************************************************
+ *  SetSceneMaterials()
+ *
+ *  This method is used for passing the OBJECT_MATERIAL table
+ *  into the lighting pass.  The G-buffer only stores the index
+ *  of the material, so the table is only uploaded when it
+ *  changes.
+ ***********************************************************/
+void DeferredRenderer::SetSceneMaterials(
+	const std::vector<SceneManager::OBJECT_MATERIAL>& materials)
+{
+	m_materials = materials;
+	if ((int)m_materials.size() > MAX_MATERIALS)
+	{
+		std::cout << "Deferred shading supports " << MAX_MATERIALS << " materials, "
+			<< m_materials.size() - MAX_MATERIALS << " will be ignored" << std::endl;
+		m_materials.resize(MAX_MATERIALS);
+	}
+	m_bSceneChanged = true;
+}
+
+/***********************************************************
+ *  SetSceneLights()
+ *
+ *  This method is used for passing the light sources into
+ *  the lighting pass.
+ ***********************************************************/
+void DeferredRenderer::SetSceneLights(
+	const std::vector<SceneManager::LIGHT_SOURCE>& lights)
+{
+	m_lights = lights;
+	if ((int)m_lights.size() > MAX_LIGHTS)
+	{
+		m_lights.resize(MAX_LIGHTS);
+	}
+	m_bSceneChanged = true;
+}
+
+/***********************************************************
+ *  UploadSceneData()
+ *
+ *  This method is used for uploading the material table and
+ *  the light sources into the bound lighting program.
+ ***********************************************************/
+void DeferredRenderer::UploadSceneData()
+{
+	for (int i = 0; i < (int)m_materials.size(); i++)
+	{
+		std::string name = "materials[" + std::to_string(i) + "].";
+		m_pLightingShader->setVec3Value(name + "ambientColor", m_materials[i].ambientColor);
+		m_pLightingShader->setFloatValue(name + "ambientStrength", m_materials[i].ambientStrength);
+		m_pLightingShader->setVec3Value(name + "diffuseColor", m_materials[i].diffuseColor);
+		m_pLightingShader->setVec3Value(name + "specularColor", m_materials[i].specularColor);
+		m_pLightingShader->setFloatValue(name + "shininess", m_materials[i].shininess);
+	}
+	m_pLightingShader->setIntValue("materialCount", (int)m_materials.size());
+
+	for (int i = 0; i < (int)m_lights.size(); i++)
+	{
+		std::string name = "lightSources[" + std::to_string(i) + "].";
+		m_pLightingShader->setVec3Value(name + "position", m_lights[i].position);
+		m_pLightingShader->setVec3Value(name + "ambientColor", m_lights[i].ambientColor);
+		m_pLightingShader->setVec3Value(name + "diffuseColor", m_lights[i].diffuseColor);
+		m_pLightingShader->setVec3Value(name + "specularColor", m_lights[i].specularColor);
+		m_pLightingShader->setFloatValue(name + "focalStrength", m_lights[i].focalStrength);
+		m_pLightingShader->setFloatValue(name + "specularIntensity", m_lights[i].specularIntensity);
+	}
+	m_pLightingShader->setIntValue("lightCount", (int)m_lights.size());
+
+	m_bSceneChanged = false;
+}
+
+/***********************************************************
+ *  CreateGBuffer()
+ *
+ *  This method is used for allocating the G-buffer targets.
+ *  Normals are octahedral encoded into two 16 bit channels,
+ *  which keeps the whole G-buffer at 13 bytes per pixel.
+ ***********************************************************/
+bool DeferredRenderer::CreateGBuffer(int width, int height)
+{
+	DestroyGBuffer();
+
+	glGenFramebuffers(1, &m_gBufferFBO);
+	GLStateCache::BindFramebuffer(m_gBufferFBO);
+
+	// octahedral encoded normals
+	glGenTextures(1, &m_normalTexture);
+	GLStateCache::BindTextureForUpdate(m_normalTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16_SNORM, width, height, 0, GL_RG, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_normalTexture, 0);
+
+	// albedo from the object texture or the object color
+	glGenTextures(1, &m_albedoTexture);
+	GLStateCache::BindTextureForUpdate(m_albedoTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_albedoTexture, 0);
+
+	// index into the OBJECT_MATERIAL table
+	glGenTextures(1, &m_materialTexture);
+	GLStateCache::BindTextureForUpdate(m_materialTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_materialTexture, 0);
+
+	// depth, the lighting pass rebuilds the position from it
+	glGenTextures(1, &m_depthTexture);
+	GLStateCache::BindTextureForUpdate(m_depthTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	GLenum drawBuffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
+	glDrawBuffers(3, drawBuffers);
+
+	ResourceRegistry::Track(GL_TEXTURE, m_normalTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_RG16_SNORM, width, height, false), "G-buffer normal");
+	ResourceRegistry::Track(GL_TEXTURE, m_albedoTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_RGBA8, width, height, false), "G-buffer albedo");
+	ResourceRegistry::Track(GL_TEXTURE, m_materialTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_R8UI, width, height, false), "G-buffer material");
+	ResourceRegistry::Track(GL_TEXTURE, m_depthTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_DEPTH_COMPONENT24, width, height, false), "G-buffer depth");
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "G-buffer framebuffer is not complete" << std::endl;
+		GLStateCache::BindFramebuffer(0);
+		DestroyGBuffer();
+		return false;
+	}
+
+	GLStateCache::BindFramebuffer(0);
+	m_width = width;
+	m_height = height;
+
+	return true;
+}
+
+/***********************************************************
+ *  DestroyGBuffer()
+ *
+ *  This method is used for freeing the G-buffer targets.
+ ***********************************************************/
+void DeferredRenderer::DestroyGBuffer()
+{
+	GLuint textures[4] = { m_normalTexture, m_albedoTexture, m_materialTexture, m_depthTexture };
+	ResourceRegistry::Release(GL_TEXTURE, 4, textures);
+	GLStateCache::DeleteTextures(4, textures);
+	m_normalTexture = 0;
+	m_albedoTexture = 0;
+	m_materialTexture = 0;
+	m_depthTexture = 0;
+
+	if (0 != m_gBufferFBO)
+	{
+		GLStateCache::DeleteFramebuffers(1, &m_gBufferFBO);
+		m_gBufferFBO = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  BeginGeometryPass()
+ *
+ *  This method is used for binding the G-buffer and the
+ *  geometry pass program before the scene is rendered.  The
+ *  G-buffer only grows, a smaller render size - such as the
+ *  scaled size of the dynamic resolution - uses the lower left
+ *  region of the attachments instead of reallocating them.
+ *  An empty size, such as a minimized window, keeps the
+ *  G-buffer as it is and draws nothing.  The camera is read
+ *  from the camera block.
+ ***********************************************************/
+bool DeferredRenderer::BeginGeometryPass(
+	int width,
+	int height)
+{
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	if ((width > m_width) || (height > m_height))
+	{
+		if (!CreateGBuffer(glm::max(width, m_width), glm::max(height, m_height)))
+		{
+			return(false);
+		}
+	}
+	m_viewWidth = width;
+	m_viewHeight = height;
+
+	GLStateCache::BindFramebuffer(m_gBufferFBO);
+	GLStateCache::Viewport(0, 0, width, height);
+
+	// the G-buffer holds raw surface data, it must not be blended
+	GLStateCache::SetEnabled(GL_BLEND, false);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+
+	// the material target is an integer format and has to be
+	// cleared with the matching entry point
+	const GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLuint clearMaterial[4] = { 0, 0, 0, 0 };
+	const GLfloat clearDepth = 1.0f;
+	glClearBufferfv(GL_COLOR, 0, clearColor);
+	glClearBufferfv(GL_COLOR, 1, clearColor);
+	glClearBufferuiv(GL_COLOR, 2, clearMaterial);
+	glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+
+	GLStateCache::UseProgram(m_pGeometryShader->m_programID);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RenderLightingPass()
+ *
+ *  This method is used for lighting every covered pixel of
+ *  the G-buffer into the passed in framebuffer, which is the
+ *  default framebuffer or the dynamic resolution target.  The
+ *  pixel positions are rebuilt with the inverse view
+ *  projection of the camera block.  The depth of every lit
+ *  pixel is written as well, for the forward draws and the
+ *  passes after the lighting that read the depth.
+ ***********************************************************/
+void DeferredRenderer::RenderLightingPass(
+	GLuint targetFramebuffer)
+{
+	GLStateCache::BindFramebuffer(targetFramebuffer);
+	GLStateCache::Viewport(0, 0, m_viewWidth, m_viewHeight);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+	GLStateCache::DepthFunc(GL_ALWAYS);
+	GLStateCache::DepthMask(true);
+
+	GLStateCache::UseProgram(m_pLightingShader->m_programID);
+	if (m_bSceneChanged)
+	{
+		UploadSceneData();
+	}
+	// fraction of the G-buffer covered by the rendered region
+	m_pLightingShader->setVec2Value("gBufferScale", glm::vec2(
+		(float)m_viewWidth / (float)m_width,
+		(float)m_viewHeight / (float)m_height));
+
+	GLStateCache::BindTexture(GBUFFER_NORMAL_UNIT, m_normalTexture);
+	GLStateCache::BindTexture(GBUFFER_ALBEDO_UNIT, m_albedoTexture);
+	GLStateCache::BindTexture(GBUFFER_MATERIAL_UNIT, m_materialTexture);
+	GLStateCache::BindTexture(GBUFFER_DEPTH_UNIT, m_depthTexture);
+
+	GLStateCache::BindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	// restore the state that the forward path relies on
+	GLStateCache::DepthFunc(GL_LESS);
+}
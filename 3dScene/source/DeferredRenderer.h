@@ -0,0 +1,128 @@
+///////////////////////////////////////////////////////////////////////////////
+// deferredrenderer.h
+// ============
+// optional deferred shading path - a geometry pass writes a packed
+// G-buffer and a single full screen pass evaluates the scene lights
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderCache.h"
+#include "SceneManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  DeferredRenderer
+ *
+ *  This class owns the G-buffer and the two shader programs
+ *  used by the deferred shading path.  The scene objects are
+ *  drawn by SceneManager::RenderScene() into the G-buffer,
+ *  then the lighting runs once per pixel instead of once per
+ *  shaded fragment.  The lighting pass also writes the depth
+ *  of the G-buffer, so the transparent draws can follow with
+ *  the forward path.
+ ***********************************************************/
+class DeferredRenderer
+{
+public:
+	// constructor
+	DeferredRenderer();
+	// destructor
+	~DeferredRenderer();
+
+	// queue the geometry pass and lighting pass shader programs
+	void RequestShaders(
+		ShaderCache* pShaderCache,
+		const char* gBufferVertexShader,
+		const char* gBufferFragmentShader,
+		const char* lightingVertexShader,
+		const char* lightingFragmentShader,
+		const std::string& geometryDefines = "");
+	// true once both programs are built, the forward path draws until then
+	bool IsReady();
+
+	// get the GLSL files of both programs
+	void GetShaderFiles(std::vector<std::string>& files) const;
+	// queue a rebuild of the programs that use a changed GLSL file,
+	// returns false when neither of them does
+	bool ReloadShaders(const std::string& changedFile);
+	// swap in the rebuilt programs that are ready, returns true
+	// when a program changed
+	bool UpdateReloads();
+
+	// pass the material table into the lighting pass
+	void SetSceneMaterials(const std::vector<SceneManager::OBJECT_MATERIAL>& materials);
+	// pass the light sources into the lighting pass
+	void SetSceneLights(const std::vector<SceneManager::LIGHT_SOURCE>& lights);
+
+	// bind the G-buffer and the geometry pass program, false when
+	// there is no G-buffer for the passed in size
+	bool BeginGeometryPass(
+		int width,
+		int height);
+	// evaluate the lights and write the depth into the target
+	// framebuffer
+	void RenderLightingPass(
+		GLuint targetFramebuffer);
+
+	// the program that receives the draw settings in the geometry pass
+	ShaderManager* GetGeometryShader() { return(m_pGeometryShader); }
+
+private:
+	// shader program writing the G-buffer
+	ShaderManager* m_pGeometryShader;
+	// shader program reading the G-buffer and lighting the scene
+	ShaderManager* m_pLightingShader;
+	// cache building the two programs and their request handles
+	ShaderCache* m_pShaderCache;
+	int m_geometryProgram;
+	int m_lightingProgram;
+	bool m_bReady;
+	// GLSL files and defines of the programs, for rebuilding them
+	std::string m_geometryVertexShader;
+	std::string m_geometryFragmentShader;
+	std::string m_lightingVertexShader;
+	std::string m_lightingFragmentShader;
+	std::string m_geometryDefines;
+	// request handles of the rebuilt programs, -1 when none
+	int m_geometryReload;
+	int m_lightingReload;
+
+	// scene data for the lighting pass, uploaded when it changes
+	std::vector<SceneManager::OBJECT_MATERIAL> m_materials;
+	std::vector<SceneManager::LIGHT_SOURCE> m_lights;
+	bool m_bSceneChanged;
+
+	// G-buffer framebuffer and its attachments
+	GLuint m_gBufferFBO;
+	GLuint m_normalTexture;
+	GLuint m_albedoTexture;
+	GLuint m_materialTexture;
+	GLuint m_depthTexture;
+	// empty vertex array for the full screen triangle
+	GLuint m_emptyVAO;
+	// current size of the G-buffer attachments
+	int m_width;
+	int m_height;
+	// size of the region rendered in the current frame
+	int m_viewWidth;
+	int m_viewHeight;
+
+	// allocate the G-buffer attachments for the passed in size
+	bool CreateGBuffer(int width, int height);
+	// free the G-buffer attachments
+	void DestroyGBuffer();
+	// upload the material table and light sources to the lighting program
+	void UploadSceneData();
+	// attach the uniform blocks of a linked geometry program
+	void SetupGeometryProgram();
+	// attach the camera block and set the samplers of a linked
+	// lighting program
+	void SetupLightingProgram();
+	// hand a rebuilt program to its shader manager when it is ready,
+	// returns true when the program was replaced
+	bool SwapReloadedProgram(int& reloadHandle, int& programHandle, ShaderManager* pShader);
+};
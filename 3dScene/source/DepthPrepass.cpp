@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.cpp
+// ============
+// depth only pre-pass, so the shading pass runs the fragment shader
+// only for the visible surface of each pixel
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DepthPrepass.h"
+#include "GLStateCache.h"
+#include "FrameRingBuffer.h"
+#include "CameraBlock.h"
+
+/***********************************************************
+ *  DepthPrepass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DepthPrepass::DepthPrepass()
+{
+	m_pDepthShader = new ShaderManager();
+	m_pDepthShader->m_programID = 0;
+}
+
+/***********************************************************
+ *  ~DepthPrepass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DepthPrepass::~DepthPrepass()
+{
+	if (NULL != m_pDepthShader)
+	{
+		delete m_pDepthShader;
+		m_pDepthShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for building the depth only program.
+ *  It reads the draws from the same uniforms or draw block as
+ *  the scene programs, so it is built with their defines.
+ ***********************************************************/
+bool DepthPrepass::LoadShaders(
+	ShaderCache* pShaderCache,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath,
+	const std::string& defines)
+{
+	if (!pShaderCache->LoadShaders(m_pDepthShader, vertexShaderPath, fragmentShaderPath, defines))
+	{
+		m_pDepthShader->m_programID = 0;
+		return(false);
+	}
+
+	FrameRingBuffer::BindProgramBlocks(m_pDepthShader->m_programID);
+	CameraBlock::BindProgramBlock(m_pDepthShader->m_programID);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginDepthPass()
+ *
+ *  This method is used for binding the depth only program and
+ *  masking the color writes.  The depth is tested and written
+ *  as usual.
+ ***********************************************************/
+void DepthPrepass::BeginDepthPass()
+{
+	GLStateCache::UseProgram(m_pDepthShader->m_programID);
+	GLStateCache::ColorMask(false);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+	GLStateCache::DepthFunc(GL_LESS);
+	GLStateCache::DepthMask(true);
+}
+
+/***********************************************************
+ *  BeginShadingPass()
+ *
+ *  This method is used for restoring the color writes and
+ *  passing only the fragments that match the depth of the
+ *  pre-pass.  The depth buffer already holds the final depth,
+ *  so it is not written again.
+ ***********************************************************/
+void DepthPrepass::BeginShadingPass()
+{
+	GLStateCache::ColorMask(true);
+	GLStateCache::DepthFunc(GL_EQUAL);
+	GLStateCache::DepthMask(false);
+}
+
+/***********************************************************
+ *  EndShadingPass()
+ *
+ *  This method is used for restoring the depth comparison and
+ *  the depth writes of the draws without a pre-pass.
+ ***********************************************************/
+void DepthPrepass::EndShadingPass()
+{
+	GLStateCache::DepthFunc(GL_LESS);
+	GLStateCache::DepthMask(true);
+}
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthprepass.h
+// ============
+// depth only pre-pass, so the shading pass runs the fragment shader
+// only for the visible surface of each pixel
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderCache.h"
+
+#include <string>
+
+/***********************************************************
+ *  DepthPrepass
+ *
+ *  This class owns the program and the state changes of the
+ *  depth pre-pass.  The opaque draws are drawn once with a
+ *  program that only reads the vertex positions and with the
+ *  color writes masked, which fills the depth buffer with the
+ *  nearest surfaces.  The shading pass then draws the same
+ *  draws with GL_EQUAL and without depth writes, so every
+ *  covered pixel is shaded once however much the geometry
+ *  overlaps.
+ *
+ *  The pre-pass costs a second transform of the opaque draws,
+ *  so it pays off only when the overdraw of the shading pass
+ *  costs more, which the OverdrawMeter measures.
+ ***********************************************************/
+class DepthPrepass
+{
+public:
+	// constructor
+	DepthPrepass();
+	// destructor
+	~DepthPrepass();
+
+	// build the depth only program with the defines of the
+	// scene programs
+	bool LoadShaders(
+		ShaderCache* pShaderCache,
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath,
+		const std::string& defines);
+	// true once the depth only program is built
+	bool IsReady() const { return(0 != m_pDepthShader->m_programID); }
+	// the depth only program
+	ShaderManager* GetShader() const { return(m_pDepthShader); }
+
+	// bind the program and the state of the depth only draws
+	void BeginDepthPass();
+	// set the state of the shading pass that matches the depth
+	void BeginShadingPass();
+	// restore the depth state of the draws after the shading pass
+	void EndShadingPass();
+
+private:
+	// program that only writes the depth
+	ShaderManager* m_pDepthShader;
+};
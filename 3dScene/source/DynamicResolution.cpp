@@ -0,0 +1,236 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// render the scene at a scaled resolution that holds a frame time
+// budget and upscale it to the window with a sharpening filter
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+#include "GLStateCache.h"
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texture unit of the offscreen color target in the upscale pass
+	const int UPSCALE_COLOR_UNIT = 20;
+
+	// limits of the render scale
+	const float MIN_SCALE = 0.5f;
+	const float MAX_SCALE = 1.0f;
+	// fraction of the error corrected per frame, the GPU times
+	// arrive a few frames late so the controller moves slowly
+	const float SCALE_GAIN = 0.1f;
+	// no change while the GPU time is this close to the budget
+	const float BUDGET_TOLERANCE = 0.05f;
+
+	// number of frames kept in the scale history
+	const size_t MAX_HISTORY = 36000;
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution(float frameBudget)
+{
+	m_pUpscaleShader = new ShaderManager();
+	m_emptyVAO = 0;
+	m_windowWidth = 0;
+	m_windowHeight = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_frameBudget = frameBudget;
+	m_scale = MAX_SCALE;
+	m_sharpness = 0.5f;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+	if (0 != m_emptyVAO)
+	{
+		GLStateCache::DeleteVertexArrays(1, &m_emptyVAO);
+		m_emptyVAO = 0;
+	}
+	if (NULL != m_pUpscaleShader)
+	{
+		delete m_pUpscaleShader;
+		m_pUpscaleShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for building the upscale program.  It
+ *  is small, so it is built right away.
+ ***********************************************************/
+bool DynamicResolution::LoadShaders(
+	ShaderCache* pShaderCache,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath)
+{
+	if (!pShaderCache->LoadShaders(m_pUpscaleShader, vertexShaderPath, fragmentShaderPath))
+	{
+		return(false);
+	}
+
+	GLStateCache::UseProgram(m_pUpscaleShader->m_programID);
+	m_pUpscaleShader->setSampler2DValue("sceneColor", UPSCALE_COLOR_UNIT);
+
+	// the full screen triangle is generated in the vertex shader
+	// but core profile still requires a bound vertex array
+	glGenVertexArrays(1, &m_emptyVAO);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for finding the size of the region
+ *  the scene is rendered into in this frame.
+ ***********************************************************/
+void DynamicResolution::BeginFrame(int windowWidth, int windowHeight)
+{
+	m_windowWidth = windowWidth;
+	m_windowHeight = windowHeight;
+
+	m_renderWidth = (int)((float)windowWidth * m_scale + 0.5f);
+	m_renderHeight = (int)((float)windowHeight * m_scale + 0.5f);
+	if (m_renderWidth < 1)
+	{
+		m_renderWidth = 1;
+	}
+	if (m_renderHeight < 1)
+	{
+		m_renderHeight = 1;
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for stretching the rendered region
+ *  over the window and then adjusting the scale for the next
+ *  frame.  The texture may be larger than the window, so the
+ *  region is found from its allocated size.  The sharpening
+ *  fades out as the scale approaches the native resolution.
+ ***********************************************************/
+void DynamicResolution::EndFrame(GLuint colorTexture, int textureWidth, int textureHeight, float gpuFrameTime)
+{
+	GLStateCache::BindFramebuffer(0);
+	GLStateCache::Viewport(0, 0, m_windowWidth, m_windowHeight);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
+	GLStateCache::SetEnabled(GL_BLEND, false);
+
+	float sharpness = m_sharpness * (MAX_SCALE - m_scale) / (MAX_SCALE - MIN_SCALE);
+
+	GLStateCache::UseProgram(m_pUpscaleShader->m_programID);
+	m_pUpscaleShader->setVec2Value("renderScale", glm::vec2(
+		(float)m_renderWidth / (float)textureWidth,
+		(float)m_renderHeight / (float)textureHeight));
+	m_pUpscaleShader->setVec2Value("texelSize", glm::vec2(
+		1.0f / (float)textureWidth,
+		1.0f / (float)textureHeight));
+	m_pUpscaleShader->setFloatValue("sharpness", sharpness);
+
+	GLStateCache::BindTexture(UPSCALE_COLOR_UNIT, colorTexture);
+
+	GLStateCache::BindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	// restore the state that the forward path relies on
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+
+	// record the frame before the scale moves on
+	HISTORY_ENTRY entry;
+	entry.frame = m_frameCount++;
+	entry.gpuFrameTime = gpuFrameTime;
+	entry.scale = m_scale;
+	entry.renderWidth = m_renderWidth;
+	entry.renderHeight = m_renderHeight;
+	m_history.push_back(entry);
+	if (m_history.size() > MAX_HISTORY)
+	{
+		m_history.pop_front();
+	}
+
+	UpdateScale(gpuFrameTime);
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method is used for moving the scale toward the value
+ *  that would make the scene passes fit the frame budget.  A
+ *  time of zero means no GPU measurement has arrived yet.
+ ***********************************************************/
+void DynamicResolution::UpdateScale(float gpuFrameTime)
+{
+	if ((gpuFrameTime <= 0.0f) || (m_frameBudget <= 0.0f))
+	{
+		return;
+	}
+
+	float ratio = m_frameBudget / gpuFrameTime;
+	if (std::fabs(ratio - 1.0f) < BUDGET_TOLERANCE)
+	{
+		return;
+	}
+
+	float targetScale = m_scale * std::sqrt(ratio);
+	m_scale += (targetScale - m_scale) * SCALE_GAIN;
+
+	if (m_scale < MIN_SCALE)
+	{
+		m_scale = MIN_SCALE;
+	}
+	if (m_scale > MAX_SCALE)
+	{
+		m_scale = MAX_SCALE;
+	}
+}
+
+/***********************************************************
+ *  ExportHistory()
+ *
+ *  This method is used for writing the recorded frames into
+ *  a CSV file for offline analysis.
+ ***********************************************************/
+bool DynamicResolution::ExportHistory(const char* filePath) const
+{
+	std::ofstream file(filePath);
+	if (!file.is_open())
+	{
+		std::cout << "Could not write the dynamic resolution history to " << filePath << std::endl;
+		return(false);
+	}
+
+	file << "frame,gpu_ms,budget_ms,scale,width,height\n";
+	std::deque<HISTORY_ENTRY>::const_iterator it;
+	for (it = m_history.begin(); it != m_history.end(); ++it)
+	{
+		file << it->frame << ","
+			<< it->gpuFrameTime << ","
+			<< m_frameBudget << ","
+			<< it->scale << ","
+			<< it->renderWidth << ","
+			<< it->renderHeight << "\n";
+	}
+
+	std::cout << "INFO: wrote " << m_history.size() << " frames of dynamic resolution history to "
+		<< filePath << std::endl;
+
+	return(true);
+}
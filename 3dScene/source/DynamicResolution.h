@@ -0,0 +1,100 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// render the scene at a scaled resolution that holds a frame time
+// budget and upscale it to the window with a sharpening filter
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderCache.h"
+
+#include <deque>
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  Each frame the scene is rendered into the lower left region
+ *  of an offscreen target at the size of the window, whose
+ *  size is the window size times the current scale, and then
+ *  stretched over the window by a full screen pass that
+ *  sharpens the upscaled image.  The target is a transient
+ *  texture of the frame graph.
+ *
+ *  The scale is driven by the measured GPU time of the scene
+ *  passes.  The area of the region, and so roughly the shading
+ *  cost, follows the square of the scale, so the scale moves
+ *  toward the square root of the budget to time ratio.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	// constructor
+	DynamicResolution(float frameBudget);
+	// destructor
+	~DynamicResolution();
+
+	// build the upscale program
+	bool LoadShaders(
+		ShaderCache* pShaderCache,
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath);
+
+	// find the scaled size of the window for this frame
+	void BeginFrame(int windowWidth, int windowHeight);
+	// upscale the rendered region of the passed in texture into
+	// the default framebuffer and update the scale from the GPU
+	// time of the scene passes in milliseconds
+	void EndFrame(GLuint colorTexture, int textureWidth, int textureHeight, float gpuFrameTime);
+
+	// size of the region rendered in the current frame
+	int GetRenderWidth() const { return(m_renderWidth); }
+	int GetRenderHeight() const { return(m_renderHeight); }
+	// current scale of the render size to the window size
+	float GetScale() const { return(m_scale); }
+
+	// set the frame time budget in milliseconds
+	void SetFrameBudget(float frameBudget) { m_frameBudget = frameBudget; }
+	// set the strength of the sharpening filter, 0 turns it off
+	void SetSharpness(float sharpness) { m_sharpness = sharpness; }
+
+	// write the recorded scale history as comma separated values
+	bool ExportHistory(const char* filePath) const;
+
+private:
+	// properties of one recorded frame
+	struct HISTORY_ENTRY
+	{
+		unsigned int frame;
+		float gpuFrameTime;
+		float scale;
+		int renderWidth;
+		int renderHeight;
+	};
+
+	// shader program of the upscale pass
+	ShaderManager* m_pUpscaleShader;
+	// empty vertex array for the full screen triangle
+	GLuint m_emptyVAO;
+	// size of the window
+	int m_windowWidth;
+	int m_windowHeight;
+	// size of the region rendered in the current frame
+	int m_renderWidth;
+	int m_renderHeight;
+
+	// frame time budget in milliseconds
+	float m_frameBudget;
+	// scale of the render size to the window size
+	float m_scale;
+	// strength of the sharpening filter
+	float m_sharpness;
+
+	// recorded scale of the past frames
+	std::deque<HISTORY_ENTRY> m_history;
+	unsigned int m_frameCount;
+
+	// move the scale toward the frame time budget
+	void UpdateScale(float gpuFrameTime);
+};
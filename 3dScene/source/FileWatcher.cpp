@@ -0,0 +1,343 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// report the files of a list that were written since the last check
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// time the changes are collected after the first one, in
+	// milliseconds, long enough to fold the steps of one save
+	const int CHANGE_SETTLE_TIME = 50;
+	// longest sleep between two polls, in milliseconds
+	const int POLL_INTERVAL = 250;
+}
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher()
+{
+	m_bOpen = false;
+	m_notifyFD = -1;
+}
+
+/***********************************************************
+ *  ~FileWatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FileWatcher::~FileWatcher()
+{
+	Close();
+}
+
+/***********************************************************
+ *  AddFile()
+ *
+ *  This method is used for adding a file to the watch list.
+ *  The path is split into its directory and name, with either
+ *  kind of slash, so the Windows style paths of the scene work
+ *  on every platform.
+ ***********************************************************/
+void FileWatcher::AddFile(const std::string& path)
+{
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		if (m_files[i].path == path)
+		{
+			return;
+		}
+	}
+
+	WATCHED_FILE file;
+	file.path = path;
+	std::string normalized = path;
+	std::replace(normalized.begin(), normalized.end(), '\\', '/');
+	size_t separator = normalized.find_last_of('/');
+	if (separator == std::string::npos)
+	{
+		file.directory = ".";
+		file.name = normalized;
+	}
+	else
+	{
+		file.directory = normalized.substr(0, separator);
+		file.name = normalized.substr(separator + 1);
+	}
+	ReadFileState(file, file.modifiedTime, file.size);
+
+	m_files.push_back(file);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for starting to watch the added files.
+ *  Each directory is watched once for files that were closed
+ *  after writing or moved into it, which covers editors that
+ *  save through a temporary file.  When inotify is not
+ *  available the files are polled instead.
+ ***********************************************************/
+bool FileWatcher::Open()
+{
+	Close();
+
+#ifdef __linux__
+	m_notifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_notifyFD >= 0)
+	{
+		for (size_t i = 0; i < m_files.size(); i++)
+		{
+			bool bWatched = false;
+			std::map<int, std::string>::const_iterator it;
+			for (it = m_watchDirectories.begin(); it != m_watchDirectories.end(); ++it)
+			{
+				bWatched = bWatched || (it->second == m_files[i].directory);
+			}
+			if (bWatched)
+			{
+				continue;
+			}
+
+			int watch = inotify_add_watch(
+				m_notifyFD,
+				m_files[i].directory.c_str(),
+				IN_CLOSE_WRITE | IN_MOVED_TO);
+			if (watch < 0)
+			{
+				std::cout << "Could not watch directory " << m_files[i].directory
+					<< ", its files are polled" << std::endl;
+				close(m_notifyFD);
+				m_notifyFD = -1;
+				m_watchDirectories.clear();
+				break;
+			}
+			m_watchDirectories[watch] = m_files[i].directory;
+		}
+	}
+#endif
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		ReadFileState(m_files[i], m_files[i].modifiedTime, m_files[i].size);
+	}
+	m_bOpen = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for stopping the watch.
+ ***********************************************************/
+void FileWatcher::Close()
+{
+#ifdef __linux__
+	if (m_notifyFD >= 0)
+	{
+		close(m_notifyFD);
+	}
+#endif
+	m_notifyFD = -1;
+	m_watchDirectories.clear();
+	m_bOpen = false;
+}
+
+/***********************************************************
+ *  WaitForChanges()
+ *
+ *  This method is used for waiting until watched files change
+ *  or the timeout passes.  After the first change it keeps
+ *  collecting for a moment, so one save is reported once.
+ ***********************************************************/
+bool FileWatcher::WaitForChanges(std::vector<std::string>& changedFiles, int timeout)
+{
+	changedFiles.clear();
+	if (!m_bOpen)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+		return(false);
+	}
+
+	if (m_notifyFD >= 0)
+	{
+		if (ReadNotifications(changedFiles, timeout))
+		{
+			while (ReadNotifications(changedFiles, CHANGE_SETTLE_TIME))
+			{
+			}
+		}
+	}
+	else
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(std::min(timeout, POLL_INTERVAL)));
+		PollFiles(changedFiles);
+		if (!changedFiles.empty())
+		{
+			// a file that is still being written changes again
+			std::this_thread::sleep_for(std::chrono::milliseconds(CHANGE_SETTLE_TIME));
+			PollFiles(changedFiles);
+		}
+	}
+
+	return(!changedFiles.empty());
+}
+
+/***********************************************************
+ *  ReadFileState()
+ *
+ *  This method is used for reading the modification time and
+ *  size of a file.  A missing file reads as zero, so deleting
+ *  and recreating it counts as a change.
+ ***********************************************************/
+void FileWatcher::ReadFileState(const WATCHED_FILE& file, long long& modifiedTime, long long& size)
+{
+	std::error_code error;
+	std::filesystem::path path(file.directory + "/" + file.name);
+
+	modifiedTime = 0;
+	size = 0;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+	if (!error)
+	{
+		modifiedTime = (long long)time.time_since_epoch().count();
+	}
+	std::uintmax_t fileSize = std::filesystem::file_size(path, error);
+	if (!error)
+	{
+		size = (long long)fileSize;
+	}
+}
+
+/***********************************************************
+ *  PollFiles()
+ *
+ *  This method is used for comparing every watched file with
+ *  the state it had at the last poll.
+ ***********************************************************/
+void FileWatcher::PollFiles(std::vector<std::string>& changedFiles)
+{
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		WATCHED_FILE& file = m_files[i];
+		long long modifiedTime = 0;
+		long long size = 0;
+		ReadFileState(file, modifiedTime, size);
+		if ((modifiedTime != file.modifiedTime) || (size != file.size))
+		{
+			file.modifiedTime = modifiedTime;
+			file.size = size;
+			// a file that disappeared is not reported until it
+			// comes back, there is nothing to reload from
+			if (0 != modifiedTime)
+			{
+				AddChangedFile(changedFiles, file.path);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ReadNotifications()
+ *
+ *  This method is used for reading the inotify events that
+ *  arrive within the timeout and matching them to the watched
+ *  files.  Events for other files in the watched directories
+ *  are skipped.  Returns true when an event was read.
+ ***********************************************************/
+bool FileWatcher::ReadNotifications(std::vector<std::string>& changedFiles, int timeout)
+{
+#ifdef __linux__
+	struct pollfd descriptor;
+	descriptor.fd = m_notifyFD;
+	descriptor.events = POLLIN;
+	descriptor.revents = 0;
+	if (poll(&descriptor, 1, timeout) <= 0)
+	{
+		return(false);
+	}
+
+	alignas(struct inotify_event) char buffer[4096];
+	bool bRead = false;
+	for (;;)
+	{
+		ssize_t length = read(m_notifyFD, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			break;
+		}
+		bRead = true;
+
+		for (char* pEvent = buffer; pEvent < buffer + length; )
+		{
+			const struct inotify_event* pNotify = (const struct inotify_event*)pEvent;
+			pEvent += sizeof(struct inotify_event) + pNotify->len;
+
+			// the queue overflowed, so any file might have changed
+			if (pNotify->mask & IN_Q_OVERFLOW)
+			{
+				for (size_t i = 0; i < m_files.size(); i++)
+				{
+					AddChangedFile(changedFiles, m_files[i].path);
+				}
+				continue;
+			}
+			if (0 == pNotify->len)
+			{
+				continue;
+			}
+
+			std::map<int, std::string>::const_iterator it = m_watchDirectories.find(pNotify->wd);
+			if (it == m_watchDirectories.end())
+			{
+				continue;
+			}
+			for (size_t i = 0; i < m_files.size(); i++)
+			{
+				if ((m_files[i].directory == it->second) && (m_files[i].name == pNotify->name))
+				{
+					AddChangedFile(changedFiles, m_files[i].path);
+				}
+			}
+		}
+	}
+
+	return(bRead);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  AddChangedFile()
+ *
+ *  This method is used for adding a file to the changed
+ *  files, each file is only listed once.
+ ***********************************************************/
+void FileWatcher::AddChangedFile(std::vector<std::string>& changedFiles, const std::string& path)
+{
+	if (std::find(changedFiles.begin(), changedFiles.end(), path) == changedFiles.end())
+	{
+		changedFiles.push_back(path);
+	}
+}
@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// report the files of a list that were written since the last check
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  This class watches a list of files for changes.  On Linux
+ *  the directories of the files are watched with inotify, so
+ *  a write is reported as soon as the file is closed without
+ *  reading anything from the disk.  Elsewhere the modification
+ *  time and size of every file are compared at an interval.
+ *
+ *  Editors often write a file in several steps, or replace it
+ *  through a temporary file, so the changes are collected for
+ *  a short moment after the first one and each file is
+ *  reported once.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	// constructor
+	FileWatcher();
+	// destructor
+	~FileWatcher();
+
+	// add a file to the watch list, must be called before Open()
+	void AddFile(const std::string& path);
+	// start watching the added files
+	bool Open();
+	// stop watching
+	void Close();
+
+	// wait up to the timeout in milliseconds for changes, fills in
+	// the changed files as they were added and returns true when
+	// there were any
+	bool WaitForChanges(std::vector<std::string>& changedFiles, int timeout);
+
+	// true when the changes are reported by the operating system
+	bool IsUsingNotifications() const { return(m_notifyFD >= 0); }
+
+private:
+	// properties of one watched file
+	struct WATCHED_FILE
+	{
+		// path as it was added
+		std::string path;
+		// directory and name with forward slashes
+		std::string directory;
+		std::string name;
+		// last seen state for the polling
+		long long modifiedTime;
+		long long size;
+	};
+
+	std::vector<WATCHED_FILE> m_files;
+	bool m_bOpen;
+	// inotify descriptor and the watched directories by watch
+	// descriptor, -1 while polling
+	int m_notifyFD;
+	std::map<int, std::string> m_watchDirectories;
+
+	// read the state of a file for the polling
+	static void ReadFileState(const WATCHED_FILE& file, long long& modifiedTime, long long& size);
+	// compare every file with its last seen state
+	void PollFiles(std::vector<std::string>& changedFiles);
+	// read the pending notifications, waiting up to the timeout
+	bool ReadNotifications(std::vector<std::string>& changedFiles, int timeout);
+	// add a file to the changed files unless it is already there
+	static void AddChangedFile(std::vector<std::string>& changedFiles, const std::string& path);
+};
@@ -0,0 +1,262 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// double buffered linear allocator for the transient data of a frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// declaration of global variables
+namespace
+{
+	// alignment of the blocks and the smallest block size
+	const size_t BLOCK_ALIGNMENT = 64;
+	const size_t MIN_BLOCK_SIZE = 4096;
+
+	// heap allocations counted for the thread that runs a check
+	thread_local bool t_bCountAllocations = false;
+	thread_local unsigned int t_allocationCount = 0;
+
+	/***********************************************************
+	 *  AlignUp()
+	 *
+	 *  Round a size or an offset up to a power of two alignment.
+	 ***********************************************************/
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return((value + alignment - 1) & ~(alignment - 1));
+	}
+
+	/***********************************************************
+	 *  AllocateBlock()
+	 *
+	 *  Allocate the memory of a block with the cache line
+	 *  alignment, the size is a multiple of the alignment.
+	 ***********************************************************/
+	unsigned char* AllocateBlock(size_t size)
+	{
+		return((unsigned char*)::operator new(size, std::align_val_t(BLOCK_ALIGNMENT)));
+	}
+
+	void FreeBlock(unsigned char* pMemory)
+	{
+		::operator delete(pMemory, std::align_val_t(BLOCK_ALIGNMENT));
+	}
+}
+
+#ifdef FRAME_HEAP_CHECK
+// the global allocation functions are replaced to count the
+// allocations of a thread that runs a heap check, the array
+// forms end up in these as well
+void* operator new(size_t size)
+{
+	if (t_bCountAllocations)
+	{
+		t_allocationCount++;
+	}
+	void* pMemory = malloc((size > 0) ? size : 1);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, size_t) noexcept
+{
+	free(pMemory);
+}
+#endif
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t blockSize)
+{
+	size_t size = AlignUp((blockSize > MIN_BLOCK_SIZE) ? blockSize : MIN_BLOCK_SIZE, BLOCK_ALIGNMENT);
+	for (int i = 0; i < BLOCK_COUNT; i++)
+	{
+		m_blocks[i].pMemory = AllocateBlock(size);
+		m_blocks[i].size = size;
+		m_blocks[i].offset = 0;
+		m_blocks[i].peak = 0;
+		// keep room for a few overflows, so recording one does
+		// not allocate as well
+		m_blocks[i].overflow.reserve(16);
+	}
+	m_currentBlock = 0;
+	m_overflowCount = 0;
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	for (int i = 0; i < BLOCK_COUNT; i++)
+	{
+		for (size_t j = 0; j < m_blocks[i].overflow.size(); j++)
+		{
+			::operator delete(m_blocks[i].overflow[j]);
+		}
+		FreeBlock(m_blocks[i].pMemory);
+		m_blocks[i].pMemory = NULL;
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving to the other block.  What
+ *  was handed out from it two frames ago is released at once.
+ *  A block that overflowed is replaced by one that holds its
+ *  peak usage, so only the first frames after a change in the
+ *  scene touch the heap.
+ ***********************************************************/
+void FrameArena::BeginFrame()
+{
+	m_currentBlock = (m_currentBlock + 1) % BLOCK_COUNT;
+	ARENA_BLOCK& block = m_blocks[m_currentBlock];
+
+	for (size_t i = 0; i < block.overflow.size(); i++)
+	{
+		::operator delete(block.overflow[i]);
+	}
+	block.overflow.clear();
+
+	if (block.peak > block.size)
+	{
+		size_t size = AlignUp(block.peak + block.peak / 4, BLOCK_ALIGNMENT);
+		FreeBlock(block.pMemory);
+		block.pMemory = AllocateBlock(size);
+		block.size = size;
+	}
+	block.offset = 0;
+	block.peak = 0;
+}
+
+/***********************************************************
+ *  GetUsedBytes()
+ *
+ *  This method is used for getting the bytes handed out in
+ *  the current frame, including the overflow.
+ ***********************************************************/
+size_t FrameArena::GetUsedBytes() const
+{
+	return(m_blocks[m_currentBlock].peak);
+}
+
+/***********************************************************
+ *  GetCapacity()
+ *
+ *  This method is used for getting the size of the block of
+ *  the current frame.
+ ***********************************************************/
+size_t FrameArena::GetCapacity() const
+{
+	return(m_blocks[m_currentBlock].size);
+}
+
+/***********************************************************
+ *  do_allocate()
+ *
+ *  This method is used for handing out aligned memory from
+ *  the block of the current frame.
+ ***********************************************************/
+void* FrameArena::do_allocate(size_t bytes, size_t alignment)
+{
+	ARENA_BLOCK& block = m_blocks[m_currentBlock];
+
+	uintptr_t base = (uintptr_t)block.pMemory;
+	size_t offset = AlignUp(base + block.offset, alignment) - base;
+	if (offset + bytes <= block.size)
+	{
+		block.offset = offset + bytes;
+		if (block.offset > block.peak)
+		{
+			block.peak = block.offset;
+		}
+		return(block.pMemory + offset);
+	}
+
+	// the block is full, the memory comes from the heap and is
+	// released with the block
+	m_overflowCount++;
+	block.peak += bytes + alignment;
+	void* pMemory = ::operator new(AlignUp(bytes, alignment) + alignment);
+	block.overflow.push_back(pMemory);
+	return((void*)AlignUp((uintptr_t)pMemory, alignment));
+}
+
+/***********************************************************
+ *  do_deallocate()
+ *
+ *  This method is used for returning memory, which does not
+ *  do anything: the block is recycled as a whole.
+ ***********************************************************/
+void FrameArena::do_deallocate(void* /*pMemory*/, size_t /*bytes*/, size_t /*alignment*/)
+{
+}
+
+/***********************************************************
+ *  do_is_equal()
+ *
+ *  This method is used for comparing resources, memory of an
+ *  arena can only be returned to the same arena.
+ ***********************************************************/
+bool FrameArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return(this == &other);
+}
+
+/***********************************************************
+ *  BeginHeapCheck()
+ *
+ *  This method is used for starting to count the heap
+ *  allocations of the calling thread.
+ ***********************************************************/
+void FrameArena::BeginHeapCheck()
+{
+	t_allocationCount = 0;
+	t_bCountAllocations = true;
+}
+
+/***********************************************************
+ *  EndHeapCheck()
+ *
+ *  This method is used for stopping the count started by
+ *  BeginHeapCheck().  Without FRAME_HEAP_CHECK it returns 0.
+ ***********************************************************/
+unsigned int FrameArena::EndHeapCheck()
+{
+	t_bCountAllocations = false;
+	return(t_allocationCount);
+}
+
+/***********************************************************
+ *  IsHeapCheckAvailable()
+ *
+ *  This method is used for checking whether the allocation
+ *  functions that count the heap allocations are built in.
+ ***********************************************************/
+bool FrameArena::IsHeapCheckAvailable()
+{
+#ifdef FRAME_HEAP_CHECK
+	return(true);
+#else
+	return(false);
+#endif
+}
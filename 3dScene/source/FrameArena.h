@@ -0,0 +1,84 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// double buffered linear allocator for the transient data of a frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+// debug builds count the heap allocations of the render thread,
+// define FRAME_HEAP_CHECK to also count them in a release build
+#if defined(_DEBUG) && !defined(FRAME_HEAP_CHECK)
+#define FRAME_HEAP_CHECK
+#endif
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class hands out the memory for the temporary
+ *  containers of a frame, such as the sorted draw order, by
+ *  bumping an offset in a preallocated block.  Nothing is
+ *  freed on its own: BeginFrame() makes the block of the frame
+ *  before last reusable at once, so the data of the previous
+ *  frame stays valid for one more frame.
+ *
+ *  It is a std::pmr::memory_resource, so std::pmr containers
+ *  use it directly.  A request that does not fit is taken from
+ *  the heap and counted, and the block grows to the peak usage
+ *  when it is reused, so steady state frames stay inside it.
+ ***********************************************************/
+class FrameArena : public std::pmr::memory_resource
+{
+public:
+	// constructor, with the initial size of each of the blocks
+	explicit FrameArena(size_t blockSize);
+	// destructor
+	~FrameArena();
+
+	// start a new frame and recycle the block of the frame before
+	// the previous one, must not be called while its data is used
+	void BeginFrame();
+
+	// bytes handed out in the current frame
+	size_t GetUsedBytes() const;
+	// size of the block of the current frame
+	size_t GetCapacity() const;
+	// requests that did not fit into a block since the start
+	unsigned int GetOverflowCount() const { return(m_overflowCount); }
+
+	// count the heap allocations of the calling thread until
+	// EndHeapCheck(), which returns their number
+	static void BeginHeapCheck();
+	static unsigned int EndHeapCheck();
+	// true when the heap allocations can be counted in this build
+	static bool IsHeapCheckAvailable();
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* pMemory, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+	// number of blocks that are in use at the same time
+	static const int BLOCK_COUNT = 2;
+
+	// one preallocated block and what was taken from the heap
+	// because it was full
+	struct ARENA_BLOCK
+	{
+		unsigned char* pMemory;
+		size_t size;
+		size_t offset;
+		// largest usage of the block, including the overflow
+		size_t peak;
+		std::vector<void*> overflow;
+	};
+
+	ARENA_BLOCK m_blocks[BLOCK_COUNT];
+	int m_currentBlock;
+	unsigned int m_overflowCount;
+};
@@ -0,0 +1,462 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// record the presented frames through a ring of pixel pack buffers
+// and encode them on a separate thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+#include "SoftwareRenderer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// time waited per glClientWaitSync() call when the recording
+	// stops, in nanoseconds
+	const GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+	// longest file name an image sequence pattern may expand to
+	const int MAX_FILENAME_LENGTH = 1024;
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture()
+{
+	m_frameRate = 60;
+	m_bVideo = false;
+	m_bRequested = false;
+	m_bStarted = false;
+	m_width = 0;
+	m_height = 0;
+	m_frameSize = 0;
+	for (int i = 0; i < SLOT_COUNT; i++)
+	{
+		m_slots[i].buffer = 0;
+		m_slots[i].pMappedData = NULL;
+		m_slots[i].fence = NULL;
+		m_slots[i].frameNumber = 0;
+		m_slots[i].state = SLOT_FREE;
+	}
+	m_writeSlot = 0;
+	m_readSlot = 0;
+	m_bStopEncoder = false;
+	m_capturedCount = 0;
+	m_droppedCount = 0;
+	m_encodedCount = 0;
+	m_captureTime = 0.0;
+	m_captureCalls = 0;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class.  Stop() must have been called
+ *  while the OpenGL context was still current.
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	if (m_encoder.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_bStopEncoder = true;
+		}
+		m_queueCondition.notify_one();
+		m_encoder.join();
+	}
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for requesting a recording.  A name
+ *  that ends in .y4m is written as one raw video stream,
+ *  otherwise the name must contain a printf conversion for the
+ *  frame number and each frame is written as an image of the
+ *  type of the extension.  The buffers are created by the first
+ *  Capture() call, which knows the size of the framebuffer.
+ ***********************************************************/
+bool FrameCapture::Start(const std::string& output, int frameRate)
+{
+	if (m_bRequested)
+	{
+		return(false);
+	}
+
+	m_bVideo = (output.size() >= 4) &&
+		(output.compare(output.size() - 4, 4, ".y4m") == 0);
+	if (!m_bVideo && (output.find('%') == std::string::npos))
+	{
+		std::cout << "The capture output needs a .y4m extension or a frame number "
+			<< "pattern such as frame_%05d.png:" << output << std::endl;
+		return(false);
+	}
+
+	m_output = output;
+	m_frameRate = (frameRate > 0) ? frameRate : 60;
+	m_bRequested = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for creating the ring of pixel pack
+ *  buffers and the output for the size of the first captured
+ *  frame, and for starting the encoder thread.
+ ***********************************************************/
+bool FrameCapture::Begin(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+	m_frameSize = (GLsizeiptr)width * height * 4;
+
+	if (m_bVideo)
+	{
+		m_videoFile.open(m_output.c_str(), std::ios::binary);
+		if (!m_videoFile)
+		{
+			std::cout << "Could not create the capture file:" << m_output << std::endl;
+			return(false);
+		}
+		// 4:2:0 with JPEG chroma siting and full range samples
+		m_videoFile << "YUV4MPEG2 W" << width << " H" << height
+			<< " F" << m_frameRate << ":1 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n";
+	}
+
+	// a persistent mapping lets the encoder read the pixels in
+	// place, the client storage hint keeps them in cached memory
+	bool bPersistent = GLEW_ARB_buffer_storage ? true : false;
+	GLbitfield mapFlags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	for (int i = 0; i < SLOT_COUNT; i++)
+	{
+		CAPTURE_SLOT& slot = m_slots[i];
+		glGenBuffers(1, &slot.buffer);
+		GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		if (bPersistent)
+		{
+			glBufferStorage(GL_PIXEL_PACK_BUFFER, m_frameSize, NULL, mapFlags | GL_CLIENT_STORAGE_BIT);
+			slot.pMappedData = (const unsigned char*)glMapBufferRange(
+				GL_PIXEL_PACK_BUFFER, 0, m_frameSize, mapFlags);
+		}
+		else
+		{
+			glBufferData(GL_PIXEL_PACK_BUFFER, m_frameSize, NULL, GL_STREAM_READ);
+			slot.pixels.resize(m_frameSize);
+			ResourceRegistry::TrackHost(slot.pixels.data(), m_frameSize, "capture copy");
+		}
+		ResourceRegistry::Track(GL_BUFFER, slot.buffer, ResourceRegistry::CATEGORY_BUFFER,
+			m_frameSize, "capture readback");
+	}
+	GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_writeSlot = 0;
+	m_readSlot = 0;
+	m_bStopEncoder = false;
+	m_encoder = std::thread(&FrameCapture::EncoderMain, this);
+	m_bStarted = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method is used for queuing the readback of the frame
+ *  in the default framebuffer.  It first hands the readbacks
+ *  that have finished to the encoder, without waiting for the
+ *  ones still in flight, so a frame is encoded a few frames
+ *  after it was rendered.
+ ***********************************************************/
+void FrameCapture::Capture(int width, int height)
+{
+	if (!m_bRequested || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	if (!m_bStarted && !Begin(width, height))
+	{
+		m_bRequested = false;
+		return;
+	}
+
+	CollectReadbacks(false);
+
+	CAPTURE_SLOT& slot = m_slots[m_writeSlot];
+	if ((width != m_width) || (height != m_height) || (slot.state != SLOT_FREE))
+	{
+		// the output keeps the size of the first frame, and a
+		// full ring means the encoder cannot keep up
+		m_droppedCount++;
+	}
+	else
+	{
+		GLStateCache::BindFramebuffer(0);
+		GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.frameNumber = m_capturedCount++;
+		slot.state = SLOT_READING;
+		m_writeSlot = (m_writeSlot + 1) % SLOT_COUNT;
+	}
+
+	m_captureTime += std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - startTime).count();
+	m_captureCalls++;
+}
+
+/***********************************************************
+ *  CollectReadbacks()
+ *
+ *  This method is used for handing the finished readbacks to
+ *  the encoder in the order they were queued.  Without a
+ *  persistent mapping the pixels are copied out of the buffer
+ *  here, because only this thread may map it.
+ ***********************************************************/
+void FrameCapture::CollectReadbacks(bool bWait)
+{
+	while (m_slots[m_readSlot].state == SLOT_READING)
+	{
+		CAPTURE_SLOT& slot = m_slots[m_readSlot];
+
+		GLenum result = glClientWaitSync(slot.fence, 0, 0);
+		while (bWait && (result == GL_TIMEOUT_EXPIRED))
+		{
+			result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+		}
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			return;
+		}
+		glDeleteSync(slot.fence);
+		slot.fence = NULL;
+
+		if (NULL == slot.pMappedData)
+		{
+			GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			const void* pData = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_frameSize, GL_MAP_READ_BIT);
+			if (NULL != pData)
+			{
+				memcpy(slot.pixels.data(), pData, m_frameSize);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+
+		slot.state = SLOT_ENCODING;
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_encodeQueue.push_back(m_readSlot);
+		}
+		m_queueCondition.notify_one();
+
+		m_readSlot = (m_readSlot + 1) % SLOT_COUNT;
+	}
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for finishing the recording.  It waits
+ *  for the readbacks in flight, lets the encoder write every
+ *  queued frame and releases the buffers.
+ ***********************************************************/
+void FrameCapture::Stop()
+{
+	if (!m_bStarted)
+	{
+		m_bRequested = false;
+		return;
+	}
+
+	CollectReadbacks(true);
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bStopEncoder = true;
+	}
+	m_queueCondition.notify_one();
+	m_encoder.join();
+
+	for (int i = 0; i < SLOT_COUNT; i++)
+	{
+		CAPTURE_SLOT& slot = m_slots[i];
+		if (NULL != slot.pMappedData)
+		{
+			GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			slot.pMappedData = NULL;
+		}
+		ResourceRegistry::ReleaseHost(slot.pixels.data());
+		std::vector<unsigned char>().swap(slot.pixels);
+		slot.state = SLOT_FREE;
+	}
+	GLStateCache::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	for (int i = 0; i < SLOT_COUNT; i++)
+	{
+		ResourceRegistry::Release(GL_BUFFER, 1, &m_slots[i].buffer);
+		GLStateCache::DeleteBuffers(1, &m_slots[i].buffer);
+		m_slots[i].buffer = 0;
+	}
+
+	if (m_videoFile.is_open())
+	{
+		m_videoFile.close();
+	}
+
+	m_bStarted = false;
+	m_bRequested = false;
+}
+
+/***********************************************************
+ *  EncoderMain()
+ *
+ *  This method is the body of the encoder thread.  It writes
+ *  the queued frames and returns their buffers to the ring,
+ *  until Stop() is called and the queue is empty.
+ ***********************************************************/
+void FrameCapture::EncoderMain()
+{
+	while (true)
+	{
+		int slotIndex = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [this] { return(!m_encodeQueue.empty() || m_bStopEncoder); });
+			if (m_encodeQueue.empty())
+			{
+				break;
+			}
+			slotIndex = m_encodeQueue.front();
+			m_encodeQueue.pop_front();
+		}
+
+		CAPTURE_SLOT& slot = m_slots[slotIndex];
+		if (EncodeFrame(slot))
+		{
+			m_encodedCount++;
+		}
+		slot.state = SLOT_FREE;
+	}
+}
+
+/***********************************************************
+ *  EncodeFrame()
+ *
+ *  This method is used for writing the pixels of a slot, which
+ *  are RGBA with the bottom row first.
+ ***********************************************************/
+bool FrameCapture::EncodeFrame(const CAPTURE_SLOT& slot)
+{
+	const unsigned char* pPixels = (NULL != slot.pMappedData) ?
+		slot.pMappedData : slot.pixels.data();
+
+	if (m_bVideo)
+	{
+		return(WriteVideoFrame(pPixels));
+	}
+
+	char filename[MAX_FILENAME_LENGTH];
+	snprintf(filename, sizeof(filename), m_output.c_str(), slot.frameNumber);
+	return(SoftwareRenderer::WriteImageFile(filename, m_width, m_height, pPixels));
+}
+
+/***********************************************************
+ *  WriteVideoFrame()
+ *
+ *  This method is used for appending a frame to the Y4M file.
+ *  The pixels are converted to full range BT.601 YCbCr, with
+ *  the chroma averaged over blocks of 2x2 pixels, and the rows
+ *  are flipped to run top down.
+ ***********************************************************/
+bool FrameCapture::WriteVideoFrame(const unsigned char* pPixels)
+{
+	int chromaWidth = (m_width + 1) / 2;
+	int chromaHeight = (m_height + 1) / 2;
+	size_t lumaSize = (size_t)m_width * m_height;
+	size_t chromaSize = (size_t)chromaWidth * chromaHeight;
+	m_planes.resize(lumaSize + chromaSize * 2);
+	unsigned char* pLuma = m_planes.data();
+	unsigned char* pBlue = pLuma + lumaSize;
+	unsigned char* pRed = pBlue + chromaSize;
+
+	for (int y = 0; y < m_height; y++)
+	{
+		const unsigned char* pRow = pPixels + (size_t)(m_height - 1 - y) * m_width * 4;
+		unsigned char* pOut = pLuma + (size_t)y * m_width;
+		for (int x = 0; x < m_width; x++)
+		{
+			const unsigned char* pPixel = pRow + x * 4;
+			pOut[x] = (unsigned char)((77 * pPixel[0] + 150 * pPixel[1] + 29 * pPixel[2] + 128) >> 8);
+		}
+	}
+
+	for (int cy = 0; cy < chromaHeight; cy++)
+	{
+		// rows of the block, the last one repeats on odd heights
+		int y0 = cy * 2;
+		int y1 = (y0 + 1 < m_height) ? y0 + 1 : y0;
+		const unsigned char* pRow0 = pPixels + (size_t)(m_height - 1 - y0) * m_width * 4;
+		const unsigned char* pRow1 = pPixels + (size_t)(m_height - 1 - y1) * m_width * 4;
+		for (int cx = 0; cx < chromaWidth; cx++)
+		{
+			int x0 = cx * 2 * 4;
+			int x1 = (cx * 2 + 1 < m_width) ? x0 + 4 : x0;
+			int r = pRow0[x0] + pRow0[x1] + pRow1[x0] + pRow1[x1];
+			int g = pRow0[x0 + 1] + pRow0[x1 + 1] + pRow1[x0 + 1] + pRow1[x1 + 1];
+			int b = pRow0[x0 + 2] + pRow0[x1 + 2] + pRow1[x0 + 2] + pRow1[x1 + 2];
+			// the sums are four times the average, the offset keeps
+			// the products positive before the shift
+			int blue = (-43 * r - 85 * g + 128 * b + (128 << 10) + 512) >> 10;
+			int red = (128 * r - 107 * g - 21 * b + (128 << 10) + 512) >> 10;
+			pBlue[cy * chromaWidth + cx] = (unsigned char)((blue < 255) ? blue : 255);
+			pRed[cy * chromaWidth + cx] = (unsigned char)((red < 255) ? red : 255);
+		}
+	}
+
+	m_videoFile << "FRAME\n";
+	m_videoFile.write((const char*)m_planes.data(), m_planes.size());
+	return((bool)m_videoFile);
+}
+
+/***********************************************************
+ *  GetAverageCaptureTime()
+ *
+ *  This method is used for getting the averaged time that
+ *  Capture() took on the render thread, in milliseconds.
+ ***********************************************************/
+float FrameCapture::GetAverageCaptureTime() const
+{
+	if (m_captureCalls == 0)
+	{
+		return(0.0f);
+	}
+	return((float)(m_captureTime / m_captureCalls));
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the recording statistics
+ *  to the console.
+ ***********************************************************/
+void FrameCapture::PrintReport() const
+{
+	std::cout << "  capture frames       " << m_capturedCount
+		<< " (" << m_encodedCount << " encoded, " << m_droppedCount << " dropped)" << std::endl;
+	std::cout << "  capture ms per frame " << GetAverageCaptureTime() << std::endl;
+}
@@ -0,0 +1,139 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// record the presented frames through a ring of pixel pack buffers
+// and encode them on a separate thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class records the frames of the window without
+ *  stalling the render thread.  Capture() only queues a
+ *  glReadPixels() into the next pixel pack buffer of a ring
+ *  and places a fence after it.  A few frames later, once the
+ *  fence has signaled, the pixels are handed to an encoder
+ *  thread, which writes them as an image sequence or as a raw
+ *  Y4M video stream.
+ *
+ *  With GL_ARB_buffer_storage the buffers stay mapped, so the
+ *  encoder reads the pixels in place and the render thread
+ *  does not copy them.  When every buffer of the ring is still
+ *  in use the frame is dropped instead of waiting.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture();
+	// destructor
+	~FrameCapture();
+
+	// request a recording into a Y4M file, or into an image
+	// sequence when the name is a printf pattern such as
+	// frame_%05d.png, the size is taken from the first frame
+	bool Start(const std::string& output, int frameRate);
+	// finish the frames in flight and close the output, must be
+	// called on the thread that owns the OpenGL context
+	void Stop();
+	// true while a recording is requested or running
+	bool IsRecording() const { return(m_bRequested); }
+
+	// queue the readback of the default framebuffer, called
+	// after the frame is rendered and before the buffers swap
+	void Capture(int width, int height);
+
+	// frames queued for readback
+	unsigned int GetCapturedCount() const { return(m_capturedCount); }
+	// frames skipped because the ring was full or the size changed
+	unsigned int GetDroppedCount() const { return(m_droppedCount); }
+	// frames written by the encoder
+	unsigned int GetEncodedCount() const { return(m_encodedCount); }
+	// averaged render thread time of Capture() in milliseconds
+	float GetAverageCaptureTime() const;
+
+	// print the recording statistics to the console
+	void PrintReport() const;
+
+private:
+	// number of pixel pack buffers in the ring
+	static const int SLOT_COUNT = 4;
+
+	// state of a buffer of the ring
+	enum SLOT_STATE
+	{
+		SLOT_FREE = 0,
+		SLOT_READING,
+		SLOT_ENCODING
+	};
+
+	// one pixel pack buffer and the frame it holds
+	struct CAPTURE_SLOT
+	{
+		GLuint buffer;
+		// persistent mapping, NULL when the pixels are copied
+		const unsigned char* pMappedData;
+		// copy of the pixels when the buffer is not mapped
+		std::vector<unsigned char> pixels;
+		GLsync fence;
+		unsigned int frameNumber;
+		std::atomic<int> state;
+	};
+
+	std::string m_output;
+	int m_frameRate;
+	bool m_bVideo;
+	bool m_bRequested;
+	bool m_bStarted;
+	int m_width;
+	int m_height;
+	GLsizeiptr m_frameSize;
+
+	CAPTURE_SLOT m_slots[SLOT_COUNT];
+	// next slot to read into and oldest slot in flight
+	int m_writeSlot;
+	int m_readSlot;
+
+	// slots handed to the encoder thread in frame order
+	std::deque<int> m_encodeQueue;
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCondition;
+	bool m_bStopEncoder;
+	std::thread m_encoder;
+
+	// Y4M output and the planes of the frame being converted
+	std::ofstream m_videoFile;
+	std::vector<unsigned char> m_planes;
+
+	// statistics
+	unsigned int m_capturedCount;
+	unsigned int m_droppedCount;
+	std::atomic<unsigned int> m_encodedCount;
+	double m_captureTime;
+	unsigned int m_captureCalls;
+
+	// create the buffers and the output for the frame size
+	bool Begin(int width, int height);
+	// hand the finished readbacks to the encoder, optionally
+	// waiting for the ones that are still in flight
+	void CollectReadbacks(bool bWait);
+
+	// body of the encoder thread
+	void EncoderMain();
+	// write the pixels of a slot as the next frame
+	bool EncodeFrame(const CAPTURE_SLOT& slot);
+	bool WriteVideoFrame(const unsigned char* pPixels);
+};
@@ -0,0 +1,835 @@
+///////////////////////////////////////////////////////////////////////////////
+// framegraph.cpp
+// ============
+// record the render passes of a frame with the textures they read and
+// write, cull the unused passes and take the transient targets from a
+// pool that shares them between passes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameGraph.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+
+#include <iostream>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// frames an allocation stays in the pool without being used
+	const unsigned int POOL_IDLE_FRAMES = 120;
+	// allocated sizes are rounded up to a multiple of this, so a
+	// window that is resized a few pixels at a time keeps fitting
+	const int SIZE_GRANULARITY = 64;
+	// an allocation is only given to a texture that covers at
+	// least this fraction of its area, so a much smaller window
+	// does not keep the large allocations alive
+	const int MAX_AREA_RATIO = 2;
+
+	/***********************************************************
+	 *  IsDepthFormat()
+	 *
+	 *  True for the formats that attach as the depth buffer.
+	 ***********************************************************/
+	bool IsDepthFormat(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH32F_STENCIL8:
+			return(true);
+		default:
+			return(false);
+		}
+	}
+
+	/***********************************************************
+	 *  RoundUpSize()
+	 *
+	 *  Size of an allocation for a requested size.
+	 ***********************************************************/
+	int RoundUpSize(int size)
+	{
+		if (size < 1)
+		{
+			size = 1;
+		}
+		return(((size + SIZE_GRANULARITY - 1) / SIZE_GRANULARITY) * SIZE_GRANULARITY);
+	}
+
+	/***********************************************************
+	 *  GetDescSize()
+	 *
+	 *  Bytes of a texture of a description, counting every
+	 *  sample of a multisampled one.
+	 ***********************************************************/
+	size_t GetDescSize(const FrameGraph::TEXTURE_DESC& desc)
+	{
+		size_t bytes = ResourceRegistry::GetTextureSize(desc.format, desc.width, desc.height, false);
+		return((desc.samples > 0) ? bytes * desc.samples : bytes);
+	}
+}
+
+/***********************************************************
+ *  FrameGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameGraph::FrameGraph()
+{
+	m_passCount = 0;
+	m_frameIndex = 0;
+	m_culledPassCount = 0;
+	m_requestedBytes = 0;
+	m_assignedBytes = 0;
+	m_allocationCount = 0;
+}
+
+/***********************************************************
+ *  ~FrameGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameGraph::~FrameGraph()
+{
+	for (int i = 0; i < (int)m_pool.size(); i++)
+	{
+		DestroyAllocation(i);
+	}
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		if (0 != m_framebuffers[i].framebuffer)
+		{
+			GLStateCache::DeleteFramebuffers(1, &m_framebuffers[i].framebuffer);
+			m_framebuffers[i].framebuffer = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the recording of a new
+ *  frame.  The pass records stay allocated, only their count
+ *  goes back to zero.
+ ***********************************************************/
+void FrameGraph::BeginFrame()
+{
+	m_passCount = 0;
+	m_resources.clear();
+	m_accesses.clear();
+	m_frameIndex++;
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method is used for declaring a transient texture.  It
+ *  gets its allocation in Compile(), and only if a pass that
+ *  is kept uses it.
+ ***********************************************************/
+int FrameGraph::CreateTexture(const char* name, const TEXTURE_DESC& desc)
+{
+	GRAPH_RESOURCE resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.bImported = false;
+	resource.framebuffer = 0;
+	resource.bNeeded = false;
+	resource.firstPass = -1;
+	resource.lastPass = -1;
+	resource.allocation = -1;
+	m_resources.push_back(resource);
+
+	return((int)m_resources.size() - 1);
+}
+
+/***********************************************************
+ *  ImportFramebuffer()
+ *
+ *  This method is used for declaring a framebuffer that the
+ *  graph does not own.  What is written into it is the result
+ *  of the frame, so the passes that lead to it are kept.
+ ***********************************************************/
+int FrameGraph::ImportFramebuffer(const char* name, GLuint framebuffer)
+{
+	GRAPH_RESOURCE resource;
+	resource.name = name;
+	resource.desc.width = 0;
+	resource.desc.height = 0;
+	resource.desc.format = GL_NONE;
+	resource.desc.samples = 0;
+	resource.bImported = true;
+	resource.framebuffer = framebuffer;
+	resource.bNeeded = true;
+	resource.firstPass = -1;
+	resource.lastPass = -1;
+	resource.allocation = -1;
+	m_resources.push_back(resource);
+
+	return((int)m_resources.size() - 1);
+}
+
+/***********************************************************
+ *  AddPass()
+ *
+ *  This method is used for adding a pass after the passes
+ *  added so far.  The record of an earlier frame is reused
+ *  when there is one.
+ ***********************************************************/
+int FrameGraph::AddPass(const char* name, std::function<void()> work)
+{
+	if (m_passCount == (int)m_passes.size())
+	{
+		m_passes.push_back(GRAPH_PASS());
+	}
+
+	GRAPH_PASS& pass = m_passes[m_passCount];
+	pass.name = name;
+	pass.work = std::move(work);
+	pass.bCulled = false;
+	pass.framebuffer = 0;
+
+	return(m_passCount++);
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method is used for declaring that a pass samples or
+ *  blits from a resource.  Invalid numbers are ignored.
+ ***********************************************************/
+void FrameGraph::Read(int pass, int resource)
+{
+	if ((pass < 0) || (pass >= m_passCount) ||
+		(resource < 0) || (resource >= (int)m_resources.size()))
+	{
+		return;
+	}
+
+	GRAPH_ACCESS access;
+	access.pass = pass;
+	access.resource = resource;
+	access.bWrite = false;
+	m_accesses.push_back(access);
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method is used for declaring that a pass renders into
+ *  a resource.  The resources a pass writes become the
+ *  attachments of its framebuffer.  Invalid numbers are
+ *  ignored.
+ ***********************************************************/
+void FrameGraph::Write(int pass, int resource)
+{
+	if ((pass < 0) || (pass >= m_passCount) ||
+		(resource < 0) || (resource >= (int)m_resources.size()))
+	{
+		return;
+	}
+
+	GRAPH_ACCESS access;
+	access.pass = pass;
+	access.resource = resource;
+	access.bWrite = true;
+	m_accesses.push_back(access);
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method is used for preparing the recorded frame to
+ *  run.  The passes are culled, the transient textures get
+ *  their allocations and each pass its framebuffer.  The pass
+ *  of a framebuffer that is not complete is culled as well.
+ ***********************************************************/
+bool FrameGraph::Compile()
+{
+	CullPasses();
+	FindLifetimes();
+	AssignAllocations();
+
+	bool bComplete = true;
+	for (int i = 0; i < m_passCount; i++)
+	{
+		GRAPH_PASS& pass = m_passes[i];
+		if (pass.bCulled)
+		{
+			continue;
+		}
+
+		bool bPassComplete = true;
+		pass.framebuffer = AcquireFramebuffer(i, bPassComplete);
+		if (!bPassComplete)
+		{
+			std::cout << "Frame graph framebuffer of the " << pass.name
+				<< " pass is not complete" << std::endl;
+			pass.bCulled = true;
+			m_culledPassCount++;
+			bComplete = false;
+		}
+	}
+
+	ReleaseUnused();
+
+	return(bComplete);
+}
+
+/***********************************************************
+ *  CullPasses()
+ *
+ *  This method is used for culling the passes whose results
+ *  are never used.  Walking backward, a pass is kept when it
+ *  writes an imported framebuffer or a texture that a kept
+ *  pass after it reads, and then the textures it reads are
+ *  needed by the passes before it.
+ ***********************************************************/
+void FrameGraph::CullPasses()
+{
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		m_resources[i].bNeeded = m_resources[i].bImported;
+	}
+
+	m_culledPassCount = 0;
+	for (int pass = m_passCount - 1; pass >= 0; pass--)
+	{
+		bool bKeep = false;
+		for (size_t i = 0; i < m_accesses.size(); i++)
+		{
+			const GRAPH_ACCESS& access = m_accesses[i];
+			if ((access.pass == pass) && access.bWrite && m_resources[access.resource].bNeeded)
+			{
+				bKeep = true;
+				break;
+			}
+		}
+
+		m_passes[pass].bCulled = !bKeep;
+		if (!bKeep)
+		{
+			m_culledPassCount++;
+			continue;
+		}
+
+		for (size_t i = 0; i < m_accesses.size(); i++)
+		{
+			const GRAPH_ACCESS& access = m_accesses[i];
+			if ((access.pass == pass) && !access.bWrite)
+			{
+				m_resources[access.resource].bNeeded = true;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  FindLifetimes()
+ *
+ *  This method is used for finding the first and the last
+ *  kept pass that uses each resource.  The passes run in the
+ *  order they were added, so the allocation of a texture is
+ *  free again after its last pass.
+ ***********************************************************/
+void FrameGraph::FindLifetimes()
+{
+	for (size_t i = 0; i < m_accesses.size(); i++)
+	{
+		const GRAPH_ACCESS& access = m_accesses[i];
+		if (m_passes[access.pass].bCulled)
+		{
+			continue;
+		}
+
+		GRAPH_RESOURCE& resource = m_resources[access.resource];
+		if ((resource.firstPass < 0) || (access.pass < resource.firstPass))
+		{
+			resource.firstPass = access.pass;
+		}
+		if (access.pass > resource.lastPass)
+		{
+			resource.lastPass = access.pass;
+		}
+	}
+}
+
+/***********************************************************
+ *  AssignAllocations()
+ *
+ *  This method is used for giving the transient textures
+ *  their allocations in the order of their first pass.  A
+ *  texture takes over an allocation whose previous texture's
+ *  last pass has already run, which is where the memory of
+ *  two textures is shared.
+ ***********************************************************/
+void FrameGraph::AssignAllocations()
+{
+	for (size_t i = 0; i < m_pool.size(); i++)
+	{
+		m_pool[i].busyUntilPass = -1;
+	}
+
+	m_requestedBytes = 0;
+	for (int pass = 0; pass < m_passCount; pass++)
+	{
+		if (m_passes[pass].bCulled)
+		{
+			continue;
+		}
+
+		for (size_t i = 0; i < m_resources.size(); i++)
+		{
+			GRAPH_RESOURCE& resource = m_resources[i];
+			if (resource.bImported || (resource.firstPass != pass))
+			{
+				continue;
+			}
+
+			resource.allocation = AcquireAllocation(resource.desc, pass, resource.name);
+			if (resource.allocation >= 0)
+			{
+				POOL_ALLOCATION& allocation = m_pool[resource.allocation];
+				allocation.busyUntilPass = resource.lastPass;
+				allocation.lastUsedFrame = m_frameIndex;
+			}
+			m_requestedBytes += GetDescSize(resource.desc);
+		}
+	}
+
+	m_assignedBytes = 0;
+	for (size_t i = 0; i < m_pool.size(); i++)
+	{
+		if ((0 != m_pool[i].name) && (m_pool[i].busyUntilPass >= 0))
+		{
+			m_assignedBytes += m_pool[i].bytes;
+		}
+	}
+}
+
+/***********************************************************
+ *  AcquireAllocation()
+ *
+ *  This method is used for finding the smallest allocation of
+ *  the same format and samples that is large enough and free
+ *  from the passed in pass on.  When there is none, a new one
+ *  is created with its size rounded up, so it fits the next
+ *  slightly larger request as well.  -1 is returned when the
+ *  description is not valid.
+ ***********************************************************/
+int FrameGraph::AcquireAllocation(const TEXTURE_DESC& desc, int firstPass, const char* name)
+{
+	if ((desc.width <= 0) || (desc.height <= 0))
+	{
+		return(-1);
+	}
+
+	TEXTURE_DESC allocatedDesc = desc;
+	allocatedDesc.width = RoundUpSize(desc.width);
+	allocatedDesc.height = RoundUpSize(desc.height);
+	long long maxArea = (long long)allocatedDesc.width * allocatedDesc.height * MAX_AREA_RATIO;
+
+	int best = -1;
+	int freeSlot = -1;
+	for (int i = 0; i < (int)m_pool.size(); i++)
+	{
+		const POOL_ALLOCATION& allocation = m_pool[i];
+		if (0 == allocation.name)
+		{
+			if (freeSlot < 0)
+			{
+				freeSlot = i;
+			}
+			continue;
+		}
+		if ((allocation.desc.format != desc.format) ||
+			(allocation.desc.samples != desc.samples) ||
+			(allocation.busyUntilPass >= firstPass) ||
+			(allocation.desc.width < desc.width) ||
+			(allocation.desc.height < desc.height) ||
+			((long long)allocation.desc.width * allocation.desc.height > maxArea))
+		{
+			continue;
+		}
+		if ((best < 0) || (allocation.bytes < m_pool[best].bytes))
+		{
+			best = i;
+		}
+	}
+	if (best >= 0)
+	{
+		return(best);
+	}
+
+	POOL_ALLOCATION allocation;
+	allocation.desc = allocatedDesc;
+	allocation.name = 0;
+	allocation.bytes = GetDescSize(allocatedDesc);
+	allocation.busyUntilPass = -1;
+	allocation.lastUsedFrame = m_frameIndex;
+
+	// multisampled targets are only resolved with a blit, so a
+	// renderbuffer is enough for them
+	if (desc.samples > 0)
+	{
+		glGenRenderbuffers(1, &allocation.name);
+		glBindRenderbuffer(GL_RENDERBUFFER, allocation.name);
+		glRenderbufferStorageMultisample(GL_RENDERBUFFER, desc.samples, desc.format,
+			allocatedDesc.width, allocatedDesc.height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		ResourceRegistry::Track(GL_RENDERBUFFER, allocation.name, ResourceRegistry::CATEGORY_RENDER_TARGET,
+			allocation.bytes, name);
+	}
+	else
+	{
+		// color is filtered for the passes that resample it, a
+		// depth texture is only read texel by texel
+		GLint filter = IsDepthFormat(desc.format) ? GL_NEAREST : GL_LINEAR;
+		glGenTextures(1, &allocation.name);
+		GLStateCache::BindTextureForUpdate(allocation.name);
+		glTexStorage2D(GL_TEXTURE_2D, 1, desc.format, allocatedDesc.width, allocatedDesc.height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		ResourceRegistry::Track(GL_TEXTURE, allocation.name, ResourceRegistry::CATEGORY_RENDER_TARGET,
+			allocation.bytes, name);
+	}
+	m_allocationCount++;
+
+	if (freeSlot >= 0)
+	{
+		m_pool[freeSlot] = allocation;
+		return(freeSlot);
+	}
+	m_pool.push_back(allocation);
+	return((int)m_pool.size() - 1);
+}
+
+/***********************************************************
+ *  AcquireFramebuffer()
+ *
+ *  This method is used for getting the framebuffer a pass
+ *  renders into.  A pass that writes an imported framebuffer
+ *  renders into it, otherwise the textures it writes are
+ *  attached, colors in the order they were declared.  The
+ *  framebuffers are cached by their attachments, so a frame
+ *  with the same allocations as the last one creates none.
+ ***********************************************************/
+GLuint FrameGraph::AcquireFramebuffer(int pass, bool& bComplete)
+{
+	bComplete = true;
+
+	int colorAllocations[MAX_COLOR_ATTACHMENTS];
+	int colorCount = 0;
+	int depthAllocation = -1;
+	for (size_t i = 0; i < m_accesses.size(); i++)
+	{
+		const GRAPH_ACCESS& access = m_accesses[i];
+		if ((access.pass != pass) || !access.bWrite)
+		{
+			continue;
+		}
+
+		const GRAPH_RESOURCE& resource = m_resources[access.resource];
+		if (resource.bImported)
+		{
+			return(resource.framebuffer);
+		}
+		if (resource.allocation < 0)
+		{
+			continue;
+		}
+		if (IsDepthFormat(resource.desc.format))
+		{
+			depthAllocation = resource.allocation;
+		}
+		else if (colorCount < MAX_COLOR_ATTACHMENTS)
+		{
+			colorAllocations[colorCount++] = resource.allocation;
+		}
+	}
+	if ((0 == colorCount) && (depthAllocation < 0))
+	{
+		return(0);
+	}
+
+	int freeSlot = -1;
+	for (int i = 0; i < (int)m_framebuffers.size(); i++)
+	{
+		POOL_FRAMEBUFFER& cached = m_framebuffers[i];
+		if (0 == cached.framebuffer)
+		{
+			if (freeSlot < 0)
+			{
+				freeSlot = i;
+			}
+			continue;
+		}
+		if ((cached.colorCount != colorCount) || (cached.depthAllocation != depthAllocation))
+		{
+			continue;
+		}
+		bool bSame = true;
+		for (int j = 0; j < colorCount; j++)
+		{
+			bSame = bSame && (cached.colorAllocations[j] == colorAllocations[j]);
+		}
+		if (bSame)
+		{
+			cached.lastUsedFrame = m_frameIndex;
+			return(cached.framebuffer);
+		}
+	}
+
+	POOL_FRAMEBUFFER cached;
+	cached.colorCount = colorCount;
+	cached.depthAllocation = depthAllocation;
+	cached.lastUsedFrame = m_frameIndex;
+	glGenFramebuffers(1, &cached.framebuffer);
+	GLStateCache::BindFramebuffer(cached.framebuffer);
+
+	GLenum drawBuffers[MAX_COLOR_ATTACHMENTS];
+	for (int j = 0; j < colorCount; j++)
+	{
+		const POOL_ALLOCATION& allocation = m_pool[colorAllocations[j]];
+		cached.colorAllocations[j] = colorAllocations[j];
+		drawBuffers[j] = GL_COLOR_ATTACHMENT0 + j;
+		if (allocation.desc.samples > 0)
+		{
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, drawBuffers[j], GL_RENDERBUFFER, allocation.name);
+		}
+		else
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, drawBuffers[j], GL_TEXTURE_2D, allocation.name, 0);
+		}
+	}
+	if (depthAllocation >= 0)
+	{
+		const POOL_ALLOCATION& allocation = m_pool[depthAllocation];
+		bool bStencil = (GL_DEPTH24_STENCIL8 == allocation.desc.format) ||
+			(GL_DEPTH32F_STENCIL8 == allocation.desc.format);
+		GLenum attachment = bStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+		if (allocation.desc.samples > 0)
+		{
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, allocation.name);
+		}
+		else
+		{
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, allocation.name, 0);
+		}
+	}
+	if (colorCount > 0)
+	{
+		glDrawBuffers(colorCount, drawBuffers);
+	}
+	else
+	{
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+	}
+
+	bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	GLStateCache::BindFramebuffer(0);
+	if (!bComplete)
+	{
+		GLStateCache::DeleteFramebuffers(1, &cached.framebuffer);
+		return(0);
+	}
+
+	if (freeSlot >= 0)
+	{
+		m_framebuffers[freeSlot] = cached;
+	}
+	else
+	{
+		m_framebuffers.push_back(cached);
+	}
+	return(cached.framebuffer);
+}
+
+/***********************************************************
+ *  ReleaseUnused()
+ *
+ *  This method is used for freeing the allocations and the
+ *  framebuffers that no frame has used for a while, such as
+ *  the targets of a mode that was switched off or of a window
+ *  size that is gone.
+ ***********************************************************/
+void FrameGraph::ReleaseUnused()
+{
+	for (int i = 0; i < (int)m_pool.size(); i++)
+	{
+		if ((0 != m_pool[i].name) && (m_frameIndex - m_pool[i].lastUsedFrame > POOL_IDLE_FRAMES))
+		{
+			DestroyAllocation(i);
+		}
+	}
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		POOL_FRAMEBUFFER& cached = m_framebuffers[i];
+		if ((0 != cached.framebuffer) && (m_frameIndex - cached.lastUsedFrame > POOL_IDLE_FRAMES))
+		{
+			GLStateCache::DeleteFramebuffers(1, &cached.framebuffer);
+			cached.framebuffer = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  DestroyAllocation()
+ *
+ *  This method is used for deleting one allocation of the
+ *  pool, and the cached framebuffers it is attached to.
+ ***********************************************************/
+void FrameGraph::DestroyAllocation(int allocation)
+{
+	POOL_ALLOCATION& pooled = m_pool[allocation];
+	if (0 == pooled.name)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		POOL_FRAMEBUFFER& cached = m_framebuffers[i];
+		if (0 == cached.framebuffer)
+		{
+			continue;
+		}
+		bool bAttached = (cached.depthAllocation == allocation);
+		for (int j = 0; j < cached.colorCount; j++)
+		{
+			bAttached = bAttached || (cached.colorAllocations[j] == allocation);
+		}
+		if (bAttached)
+		{
+			GLStateCache::DeleteFramebuffers(1, &cached.framebuffer);
+			cached.framebuffer = 0;
+		}
+	}
+
+	if (pooled.desc.samples > 0)
+	{
+		ResourceRegistry::Release(GL_RENDERBUFFER, 1, &pooled.name);
+		glDeleteRenderbuffers(1, &pooled.name);
+	}
+	else
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &pooled.name);
+		GLStateCache::DeleteTextures(1, &pooled.name);
+	}
+	pooled.name = 0;
+	pooled.bytes = 0;
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method is used for running the kept passes, each with
+ *  its framebuffer bound.  The passes set their own viewport,
+ *  since they render into a region of a pooled texture.
+ ***********************************************************/
+void FrameGraph::Execute()
+{
+	for (int i = 0; i < m_passCount; i++)
+	{
+		GRAPH_PASS& pass = m_passes[i];
+		if (pass.bCulled)
+		{
+			continue;
+		}
+
+		GLStateCache::BindFramebuffer(pass.framebuffer);
+		pass.work();
+	}
+}
+
+/***********************************************************
+ *  IsPassCulled()
+ *
+ *  This method is used for checking whether a pass was culled
+ *  by the last Compile().
+ ***********************************************************/
+bool FrameGraph::IsPassCulled(int pass) const
+{
+	if ((pass < 0) || (pass >= m_passCount))
+	{
+		return(true);
+	}
+	return(m_passes[pass].bCulled);
+}
+
+/***********************************************************
+ *  GetFramebuffer()
+ *
+ *  This method is used for getting the framebuffer a pass
+ *  renders into.
+ ***********************************************************/
+GLuint FrameGraph::GetFramebuffer(int pass) const
+{
+	if ((pass < 0) || (pass >= m_passCount))
+	{
+		return(0);
+	}
+	return(m_passes[pass].framebuffer);
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method is used for getting the texture, or the
+ *  renderbuffer when it is multisampled, that a transient
+ *  resource was given in this frame.
+ ***********************************************************/
+GLuint FrameGraph::GetTexture(int resource) const
+{
+	if ((resource < 0) || (resource >= (int)m_resources.size()) ||
+		(m_resources[resource].allocation < 0))
+	{
+		return(0);
+	}
+	return(m_pool[m_resources[resource].allocation].name);
+}
+
+/***********************************************************
+ *  GetTextureSize()
+ *
+ *  This method is used for getting the size of the allocation
+ *  of a transient resource, which the passes that sample it
+ *  need to find the region that was rendered.
+ ***********************************************************/
+void FrameGraph::GetTextureSize(int resource, int& width, int& height) const
+{
+	width = 0;
+	height = 0;
+	if ((resource < 0) || (resource >= (int)m_resources.size()) ||
+		(m_resources[resource].allocation < 0))
+	{
+		return;
+	}
+	const POOL_ALLOCATION& allocation = m_pool[m_resources[resource].allocation];
+	width = allocation.desc.width;
+	height = allocation.desc.height;
+}
+
+/***********************************************************
+ *  GetPooledBytes()
+ *
+ *  This method is used for getting the memory of every
+ *  allocation in the pool.
+ ***********************************************************/
+size_t FrameGraph::GetPooledBytes() const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < m_pool.size(); i++)
+	{
+		bytes += m_pool[i].bytes;
+	}
+	return(bytes);
+}
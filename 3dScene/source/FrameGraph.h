@@ -0,0 +1,200 @@
+///////////////////////////////////////////////////////////////////////////////
+// framegraph.h
+// ============
+// record the render passes of a frame with the textures they read and
+// write, cull the unused passes and take the transient targets from a
+// pool that shares them between passes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+/***********************************************************
+ *  FrameGraph
+ *
+ *  This class runs the passes of a frame from a graph that is
+ *  recorded again every frame.  A pass declares the textures
+ *  it reads and writes, and the framebuffers from outside the
+ *  graph, such as the window, are imported into it.
+ *
+ *  Compile() walks the passes backward from the imported
+ *  framebuffers and culls every pass whose results nobody
+ *  reads.  The transient textures only live from the first to
+ *  the last pass that uses them, and are taken from a pool:
+ *  two textures of the same format whose lifetimes do not
+ *  overlap get the same allocation, and the allocations are
+ *  kept from frame to frame, so resizing the window or
+ *  switching a mode reuses them instead of creating new ones.
+ *  A pooled texture may be larger than requested, the passes
+ *  render into its lower left region.  Allocations unused for
+ *  a while are freed.
+ *
+ *  The pass records and the access lists keep their memory
+ *  from frame to frame, so recording a frame does not touch
+ *  the heap once they have grown.
+ ***********************************************************/
+class FrameGraph
+{
+public:
+	// format and smallest size of a transient texture, samples
+	// above zero make it a multisampled renderbuffer that can
+	// only be attached and resolved with a blit
+	struct TEXTURE_DESC
+	{
+		int width;
+		int height;
+		GLenum format;
+		int samples;
+	};
+
+	// constructor
+	FrameGraph();
+	// destructor
+	~FrameGraph();
+
+	// forget the passes and resources of the previous frame
+	void BeginFrame();
+
+	// declare a texture that only lives within this frame,
+	// returns the number of the resource
+	int CreateTexture(const char* name, const TEXTURE_DESC& desc);
+	// declare a framebuffer that lives outside the graph, a pass
+	// that writes it is never culled
+	int ImportFramebuffer(const char* name, GLuint framebuffer);
+
+	// add a pass that runs the passed in work with its
+	// framebuffer bound, returns the number of the pass
+	int AddPass(const char* name, std::function<void()> work);
+	// declare that a pass reads or writes a resource
+	void Read(int pass, int resource);
+	void Write(int pass, int resource);
+
+	// cull the passes, assign the pooled textures and build the
+	// framebuffers, false when a framebuffer is not complete
+	bool Compile();
+	// run the passes that were kept, in the order they were added
+	void Execute();
+
+	// true when the pass was culled by the last Compile()
+	bool IsPassCulled(int pass) const;
+	// framebuffer of the textures or the import a pass writes
+	GLuint GetFramebuffer(int pass) const;
+	// texture or renderbuffer of a transient resource
+	GLuint GetTexture(int resource) const;
+	// allocated size of a transient resource, at least its
+	// requested size
+	void GetTextureSize(int resource, int& width, int& height) const;
+
+	// passes recorded and culled in the last frame
+	int GetPassCount() const { return(m_passCount); }
+	int GetCulledPassCount() const { return(m_culledPassCount); }
+	// bytes the transient textures of the last frame would need
+	// with an allocation each, and the bytes of the allocations
+	// they were given
+	size_t GetRequestedBytes() const { return(m_requestedBytes); }
+	size_t GetAssignedBytes() const { return(m_assignedBytes); }
+	// bytes held by the pool, used or not
+	size_t GetPooledBytes() const;
+	// allocations created since the start
+	unsigned int GetAllocationCount() const { return(m_allocationCount); }
+
+private:
+	// most color attachments of a pass framebuffer
+	static const int MAX_COLOR_ATTACHMENTS = 4;
+
+	// one recorded pass
+	struct GRAPH_PASS
+	{
+		const char* name;
+		std::function<void()> work;
+		bool bCulled;
+		GLuint framebuffer;
+	};
+
+	// one transient texture or imported framebuffer
+	struct GRAPH_RESOURCE
+	{
+		const char* name;
+		TEXTURE_DESC desc;
+		bool bImported;
+		GLuint framebuffer;
+		// true when a kept pass reads it, or it is imported
+		bool bNeeded;
+		// first and last pass that was kept and uses it
+		int firstPass;
+		int lastPass;
+		// allocation in the pool, -1 when it has none
+		int allocation;
+	};
+
+	// one read or write of a resource by a pass
+	struct GRAPH_ACCESS
+	{
+		int pass;
+		int resource;
+		bool bWrite;
+	};
+
+	// one texture or renderbuffer of the pool, a name of zero
+	// marks a slot that can be filled again
+	struct POOL_ALLOCATION
+	{
+		TEXTURE_DESC desc;
+		GLuint name;
+		size_t bytes;
+		// last pass of the current frame that uses it, -1 while
+		// it is free for the whole frame
+		int busyUntilPass;
+		unsigned int lastUsedFrame;
+	};
+
+	// cached framebuffer of a set of pooled attachments, a
+	// framebuffer of zero marks a free slot
+	struct POOL_FRAMEBUFFER
+	{
+		int colorAllocations[MAX_COLOR_ATTACHMENTS];
+		int colorCount;
+		int depthAllocation;
+		GLuint framebuffer;
+		unsigned int lastUsedFrame;
+	};
+
+	// passes of the frame, the records beyond the count are kept
+	// for the next frames
+	std::vector<GRAPH_PASS> m_passes;
+	int m_passCount;
+	std::vector<GRAPH_RESOURCE> m_resources;
+	std::vector<GRAPH_ACCESS> m_accesses;
+
+	// pool of the transient textures and their framebuffers
+	std::vector<POOL_ALLOCATION> m_pool;
+	std::vector<POOL_FRAMEBUFFER> m_framebuffers;
+	unsigned int m_frameIndex;
+
+	// statistics of the last frame
+	int m_culledPassCount;
+	size_t m_requestedBytes;
+	size_t m_assignedBytes;
+	unsigned int m_allocationCount;
+
+	// mark the passes that nobody needs
+	void CullPasses();
+	// find the first and last kept pass of every resource
+	void FindLifetimes();
+	// give every live transient texture an allocation
+	void AssignAllocations();
+	// take a free allocation that fits, or create one
+	int AcquireAllocation(const TEXTURE_DESC& desc, int firstPass, const char* name);
+	// find or create the framebuffer of the writes of a pass
+	GLuint AcquireFramebuffer(int pass, bool& bComplete);
+	// free the allocations and framebuffers that were not used
+	// for a while
+	void ReleaseUnused();
+	// delete one allocation and the framebuffers that use it
+	void DestroyAllocation(int allocation);
+};
@@ -0,0 +1,256 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// measure named CPU and GPU scopes of each rendered frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+// declaration of global variables
+namespace
+{
+	// weight of a new sample in the moving average
+	const float AVERAGE_WEIGHT = 0.1f;
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class.  The query objects are
+ *  created up front, so it needs the current OpenGL context.
+ ***********************************************************/
+FrameProfiler::FrameProfiler()
+{
+	for (int i = 0; i < FRAME_LATENCY; i++)
+	{
+		glGenQueries(MAX_SCOPES * 2, m_frames[i].queries);
+		m_frames[i].samples.reserve(MAX_SCOPES);
+		m_frames[i].bPending = false;
+	}
+	m_currentFrame = 0;
+	m_frameCount = 0;
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	for (int i = 0; i < FRAME_LATENCY; i++)
+	{
+		glDeleteQueries(MAX_SCOPES * 2, m_frames[i].queries);
+	}
+}
+
+/***********************************************************
+ *  FindResult()
+ *
+ *  This method is used for finding the result entry of a
+ *  named scope, which is added the first time it is used.
+ ***********************************************************/
+int FrameProfiler::FindResult(const char* name)
+{
+	int index = ((const FrameProfiler*)this)->FindResult(name);
+	if (index >= 0)
+	{
+		return(index);
+	}
+
+	SCOPE_RESULT result;
+	result.name = name;
+	result.gpuTime = 0.0f;
+	result.cpuTime = 0.0f;
+	result.lastGpuTime = 0.0f;
+	m_results.push_back(result);
+
+	return((int)m_results.size() - 1);
+}
+
+int FrameProfiler::FindResult(const char* name) const
+{
+	for (int i = 0; i < (int)m_results.size(); i++)
+	{
+		if (m_results[i].name.compare(name) == 0)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  ResolveFrame()
+ *
+ *  This method is used for reading the queries of a frame
+ *  that was submitted FRAME_LATENCY frames ago.  When the GPU
+ *  has fallen even further behind, the frame is dropped from
+ *  the statistics instead of waiting for it.
+ ***********************************************************/
+void FrameProfiler::ResolveFrame(FRAME_SLOT& frame)
+{
+	if (!frame.bPending || frame.samples.empty())
+	{
+		frame.bPending = false;
+		return;
+	}
+
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(frame.samples.back().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+
+	for (size_t i = 0; i < frame.samples.size(); i++)
+	{
+		SCOPE_SAMPLE& sample = frame.samples[i];
+		SCOPE_RESULT& result = m_results[sample.resultIndex];
+
+		result.cpuTime += ((float)sample.cpuTime - result.cpuTime) * AVERAGE_WEIGHT;
+
+		if (available == GL_TRUE)
+		{
+			GLuint64 beginTime = 0;
+			GLuint64 endTime = 0;
+			glGetQueryObjectui64v(sample.beginQuery, GL_QUERY_RESULT, &beginTime);
+			glGetQueryObjectui64v(sample.endQuery, GL_QUERY_RESULT, &endTime);
+
+			float gpuTime = (float)((double)(endTime - beginTime) / 1000000.0);
+			result.lastGpuTime = gpuTime;
+			result.gpuTime += (gpuTime - result.gpuTime) * AVERAGE_WEIGHT;
+		}
+	}
+
+	frame.samples.clear();
+	frame.bPending = false;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a new frame.  The slot
+ *  it reuses belongs to the oldest frame in flight, whose
+ *  results are collected first.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	m_currentFrame = m_frameCount % FRAME_LATENCY;
+	ResolveFrame(m_frames[m_currentFrame]);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the current frame.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	m_frames[m_currentFrame].bPending = true;
+	m_frameCount++;
+}
+
+/***********************************************************
+ *  BeginScope()
+ *
+ *  This method is used for starting the measurement of a
+ *  named scope.  -1 is returned when the frame is full.
+ ***********************************************************/
+int FrameProfiler::BeginScope(const char* name)
+{
+	FRAME_SLOT& frame = m_frames[m_currentFrame];
+	int scope = (int)frame.samples.size();
+	if (scope >= MAX_SCOPES)
+	{
+		return(-1);
+	}
+
+	SCOPE_SAMPLE sample;
+	sample.resultIndex = FindResult(name);
+	sample.beginQuery = frame.queries[scope * 2];
+	sample.endQuery = frame.queries[scope * 2 + 1];
+	sample.cpuTime = 0.0;
+	sample.cpuBegin = std::chrono::high_resolution_clock::now();
+	frame.samples.push_back(sample);
+
+	glQueryCounter(sample.beginQuery, GL_TIMESTAMP);
+
+	return(scope);
+}
+
+/***********************************************************
+ *  EndScope()
+ *
+ *  This method is used for stopping the measurement of a
+ *  scope started by BeginScope().
+ ***********************************************************/
+void FrameProfiler::EndScope(int scope)
+{
+	FRAME_SLOT& frame = m_frames[m_currentFrame];
+	if ((scope < 0) || (scope >= (int)frame.samples.size()))
+	{
+		return;
+	}
+
+	SCOPE_SAMPLE& sample = frame.samples[scope];
+	glQueryCounter(sample.endQuery, GL_TIMESTAMP);
+
+	std::chrono::duration<double, std::milli> elapsed =
+		std::chrono::high_resolution_clock::now() - sample.cpuBegin;
+	sample.cpuTime = elapsed.count();
+}
+
+/***********************************************************
+ *  GetGpuTime()
+ *
+ *  This method is used for getting the averaged GPU time of
+ *  a named scope in milliseconds.
+ ***********************************************************/
+float FrameProfiler::GetGpuTime(const char* name) const
+{
+	int index = FindResult(name);
+	return((index >= 0) ? m_results[index].gpuTime : 0.0f);
+}
+
+/***********************************************************
+ *  GetCpuTime()
+ *
+ *  This method is used for getting the averaged CPU time of
+ *  a named scope in milliseconds.
+ ***********************************************************/
+float FrameProfiler::GetCpuTime(const char* name) const
+{
+	int index = FindResult(name);
+	return((index >= 0) ? m_results[index].cpuTime : 0.0f);
+}
+
+/***********************************************************
+ *  GetLastGpuTime()
+ *
+ *  This method is used for getting the GPU time of a named
+ *  scope from the most recently resolved frame.
+ ***********************************************************/
+float FrameProfiler::GetLastGpuTime(const char* name) const
+{
+	int index = FindResult(name);
+	return((index >= 0) ? m_results[index].lastGpuTime : 0.0f);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the averaged times of
+ *  all the measured scopes.
+ ***********************************************************/
+void FrameProfiler::PrintReport() const
+{
+	std::cout << "PROFILE: frame " << m_frameCount << std::endl;
+	for (size_t i = 0; i < m_results.size(); i++)
+	{
+		std::cout << "  " << std::left << std::setw(20) << m_results[i].name
+			<< " gpu " << std::fixed << std::setprecision(3) << m_results[i].gpuTime << " ms"
+			<< "  cpu " << m_results[i].cpuTime << " ms" << std::endl;
+	}
+}
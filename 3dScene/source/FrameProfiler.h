@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// measure named CPU and GPU scopes of each rendered frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class measures named scopes of the rendered frames.
+ *  GPU times come from GL_TIMESTAMP query pairs, which can be
+ *  nested, and are read back a few frames later once they are
+ *  available so the profiler never stalls the pipeline.  The
+ *  results are kept as a moving average per scope.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler();
+	// destructor
+	~FrameProfiler();
+
+	// start a new frame and collect the finished older frames
+	void BeginFrame();
+	// finish the current frame
+	void EndFrame();
+
+	// start measuring a named scope, returns its handle
+	int BeginScope(const char* name);
+	// stop measuring a scope
+	void EndScope(int scope);
+
+	// averaged GPU time of a scope in milliseconds
+	float GetGpuTime(const char* name) const;
+	// averaged CPU time of a scope in milliseconds
+	float GetCpuTime(const char* name) const;
+	// GPU time of a scope from the most recent resolved frame
+	float GetLastGpuTime(const char* name) const;
+
+	// print the averaged times of all scopes to the console
+	void PrintReport() const;
+
+private:
+	// number of frames in flight before the queries are read
+	static const int FRAME_LATENCY = 4;
+	// number of scopes that can be measured per frame
+	static const int MAX_SCOPES = 32;
+
+	// properties of one measured scope within a frame
+	struct SCOPE_SAMPLE
+	{
+		int resultIndex;
+		GLuint beginQuery;
+		GLuint endQuery;
+		double cpuTime;
+		std::chrono::high_resolution_clock::time_point cpuBegin;
+	};
+
+	// queries and samples of one frame in flight
+	struct FRAME_SLOT
+	{
+		GLuint queries[MAX_SCOPES * 2];
+		std::vector<SCOPE_SAMPLE> samples;
+		bool bPending;
+	};
+
+	// averaged results of a named scope
+	struct SCOPE_RESULT
+	{
+		std::string name;
+		float gpuTime;
+		float cpuTime;
+		float lastGpuTime;
+	};
+
+	FRAME_SLOT m_frames[FRAME_LATENCY];
+	std::vector<SCOPE_RESULT> m_results;
+	int m_currentFrame;
+	unsigned int m_frameCount;
+
+	// find or add the result entry of a named scope
+	int FindResult(const char* name);
+	int FindResult(const char* name) const;
+	// read the queries of a finished frame if they are available
+	void ResolveFrame(FRAME_SLOT& frame);
+};
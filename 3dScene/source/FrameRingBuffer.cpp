@@ -0,0 +1,333 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameringbuffer.cpp
+// ============
+// persistently mapped ring buffer for the per-draw shader data,
+// guarded by one fence per frame region
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameRingBuffer.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// name of the draw block in the scene shaders
+	const char* g_DrawBlockName = "DrawBlock";
+
+	// upper limit of the draw array, keeps the shader array small
+	// on drivers with very large uniform blocks
+	const int MAX_DRAWS_PER_BLOCK = 256;
+	// time waited per glClientWaitSync() call, in nanoseconds
+	const GLuint64 FENCE_WAIT_TIMEOUT = 1000000;
+}
+
+/***********************************************************
+ *  FrameRingBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameRingBuffer::FrameRingBuffer()
+{
+	m_buffer = 0;
+	m_pMappedData = NULL;
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		m_fences[i] = NULL;
+	}
+	m_regionSize = 0;
+	m_alignment = 256;
+	m_region = 0;
+	m_regionOffset = 0;
+	m_maxDrawsPerBlock = 0;
+	m_stallCount = 0;
+	m_bOverflowReported = false;
+}
+
+/***********************************************************
+ *  ~FrameRingBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameRingBuffer::~FrameRingBuffer()
+{
+	FreeBuffer();
+}
+
+/***********************************************************
+ *  Create()
+ *
+ *  This method is used for creating the buffer with room for
+ *  three regions of the passed in size and mapping it.  The
+ *  mapping is coherent, so writes need no explicit flush.
+ ***********************************************************/
+bool FrameRingBuffer::Create(GLsizeiptr regionSize)
+{
+	if (!GLEW_ARB_buffer_storage)
+	{
+		std::cout << "GL_ARB_buffer_storage is not supported, "
+			<< "the draw settings are sent as uniforms" << std::endl;
+		return(false);
+	}
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	if (alignment > 0)
+	{
+		m_alignment = alignment;
+	}
+
+	GLint maxBlockSize = 0;
+	glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlockSize);
+	m_maxDrawsPerBlock = maxBlockSize / (int)sizeof(DRAW_DATA);
+	if (m_maxDrawsPerBlock > MAX_DRAWS_PER_BLOCK)
+	{
+		m_maxDrawsPerBlock = MAX_DRAWS_PER_BLOCK;
+	}
+
+	return(MapBuffer(regionSize));
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for growing the regions so one frame
+ *  can write the passed in number of bytes.  The buffer is
+ *  created again, which waits for the GPU to finish reading
+ *  the old one, so the regions at least double each time and
+ *  this only happens when a frame records more draws than
+ *  any frame before.
+ ***********************************************************/
+bool FrameRingBuffer::Reserve(GLsizeiptr regionSize)
+{
+	if (!IsSupported() || (regionSize <= m_regionSize))
+	{
+		return(IsSupported());
+	}
+
+	GLsizeiptr newSize = glm::max(regionSize, m_regionSize * 2);
+	std::cout << "The frame ring buffer regions grow from " << m_regionSize
+		<< " to " << newSize << " bytes" << std::endl;
+
+	// the GPU may still read every region, including the one
+	// this frame already wrote
+	glFinish();
+	FreeBuffer();
+	m_regionOffset = 0;
+
+	return(MapBuffer(newSize));
+}
+
+/***********************************************************
+ *  GetFrameSize()
+ *
+ *  This method is used for finding the region size that holds
+ *  the draw blocks of a frame.  A pass can split its draws
+ *  into a deferred and a forward list, which adds one block,
+ *  and every block starts on an aligned offset.
+ ***********************************************************/
+GLsizeiptr FrameRingBuffer::GetFrameSize(int drawCount, int passCount) const
+{
+	int drawsPerBlock = glm::max(m_maxDrawsPerBlock, 1);
+	int blockCount = (drawCount + drawsPerBlock - 1) / drawsPerBlock + 1;
+
+	return(passCount * (drawCount * (GLsizeiptr)sizeof(DRAW_DATA) + blockCount * m_alignment));
+}
+
+/***********************************************************
+ *  MapBuffer()
+ *
+ *  This method is used for creating the buffer with room for
+ *  three regions of the passed in size and mapping it.
+ ***********************************************************/
+bool FrameRingBuffer::MapBuffer(GLsizeiptr regionSize)
+{
+	// every region starts on an aligned offset
+	m_regionSize = ((regionSize + m_alignment - 1) / m_alignment) * m_alignment;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+	glBufferStorage(GL_UNIFORM_BUFFER, m_regionSize * REGION_COUNT, NULL, flags);
+	m_pMappedData = (unsigned char*)glMapBufferRange(
+		GL_UNIFORM_BUFFER, 0, m_regionSize * REGION_COUNT, flags);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	if (NULL == m_pMappedData)
+	{
+		std::cout << "Could not map the frame ring buffer" << std::endl;
+		GLStateCache::DeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+		return(false);
+	}
+
+	ResourceRegistry::Track(GL_BUFFER, m_buffer, ResourceRegistry::CATEGORY_BUFFER,
+		m_regionSize * REGION_COUNT, "frame ring buffer");
+	return(true);
+}
+
+/***********************************************************
+ *  FreeBuffer()
+ *
+ *  This method is used for unmapping and deleting the buffer
+ *  and the fences of its regions.
+ ***********************************************************/
+void FrameRingBuffer::FreeBuffer()
+{
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		if (NULL != m_fences[i])
+		{
+			glDeleteSync(m_fences[i]);
+			m_fences[i] = NULL;
+		}
+	}
+	if (0 != m_buffer)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		ResourceRegistry::Release(GL_BUFFER, 1, &m_buffer);
+		GLStateCache::DeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+	m_pMappedData = NULL;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving to the next region.  The
+ *  GPU normally finished reading it two frames ago, so the
+ *  fence is already signaled and nothing waits.
+ ***********************************************************/
+void FrameRingBuffer::BeginFrame()
+{
+	if (!IsSupported())
+	{
+		return;
+	}
+
+	m_region = (m_region + 1) % REGION_COUNT;
+	m_regionOffset = 0;
+
+	GLsync fence = m_fences[m_region];
+	if (NULL == fence)
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if ((result == GL_TIMEOUT_EXPIRED) || (result == GL_WAIT_FAILED))
+	{
+		// the GPU is more than two frames behind
+		m_stallCount++;
+		do
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_TIMEOUT);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+
+	glDeleteSync(fence);
+	m_fences[m_region] = NULL;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for placing the fence after the last
+ *  command that reads the region of the current frame.
+ ***********************************************************/
+void FrameRingBuffer::EndFrame()
+{
+	if (!IsSupported())
+	{
+		return;
+	}
+
+	m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for reserving space in the region of
+ *  the current frame.  The returned memory is written directly
+ *  and offset receives its position in the buffer.
+ ***********************************************************/
+void* FrameRingBuffer::Allocate(GLsizeiptr size, GLintptr& offset)
+{
+	if (!IsSupported())
+	{
+		return(NULL);
+	}
+
+	GLsizeiptr alignedOffset = ((m_regionOffset + m_alignment - 1) / m_alignment) * m_alignment;
+	if (alignedOffset + size > m_regionSize)
+	{
+		if (!m_bOverflowReported)
+		{
+			std::cout << "The frame ring buffer region of " << m_regionSize
+				<< " bytes is full" << std::endl;
+			m_bOverflowReported = true;
+		}
+		return(NULL);
+	}
+
+	m_regionOffset = alignedOffset + size;
+	offset = (GLintptr)(m_region * m_regionSize + alignedOffset);
+
+	return(m_pMappedData + offset);
+}
+
+/***********************************************************
+ *  BindRange()
+ *
+ *  This method is used for binding an allocated range to a
+ *  uniform block binding point.
+ ***********************************************************/
+void FrameRingBuffer::BindRange(GLuint binding, GLintptr offset, GLsizeiptr size)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_buffer, offset, size);
+}
+
+/***********************************************************
+ *  GetShaderDefines()
+ *
+ *  This method is used for building the #define lines that
+ *  make the scene shaders read the uniform blocks.
+ ***********************************************************/
+std::string FrameRingBuffer::GetShaderDefines() const
+{
+	if (!IsSupported())
+	{
+		return("");
+	}
+
+	return("#define USE_DRAW_BUFFER\n#define MAX_DRAWS " +
+		std::to_string(m_maxDrawsPerBlock) + "\n");
+}
+
+/***********************************************************
+ *  BindProgramBlocks()
+ *
+ *  This method is used for attaching the draw block of a
+ *  linked program to its binding point.  GLSL 3.30 has no
+ *  binding layout qualifier, so this is done once per
+ *  program.
+ ***********************************************************/
+void FrameRingBuffer::BindProgramBlocks(GLuint program)
+{
+	if (0 == program)
+	{
+		return;
+	}
+
+	GLuint drawBlock = glGetUniformBlockIndex(program, g_DrawBlockName);
+	if (drawBlock != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(program, drawBlock, DRAW_BLOCK_BINDING);
+	}
+}
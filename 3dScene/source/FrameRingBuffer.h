@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameringbuffer.h
+// ============
+// persistently mapped ring buffer for the per-draw shader data,
+// guarded by one fence per frame region
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <string>
+
+/***********************************************************
+ *  FrameRingBuffer
+ *
+ *  This class owns one uniform buffer created with
+ *  glBufferStorage() and mapped once for the lifetime of the
+ *  application.  The buffer is split into three frame regions:
+ *  the CPU writes the region of the current frame while the GPU
+ *  still reads the two before it, and a fence placed at the end
+ *  of each frame tells when a region may be written again.
+ *
+ *  The scene shaders read the settings of each draw from an
+ *  array in the draw block, selected by a single drawIndex
+ *  uniform, instead of a series of glUniform calls per draw.
+ *  The camera lives in the separate CameraBlock, which does not
+ *  change every frame.  Without GL_ARB_buffer_storage
+ *  IsSupported() is false and the uniform path is used.
+ ***********************************************************/
+class FrameRingBuffer
+{
+public:
+	// uniform block binding point of the scene shaders, the
+	// camera block takes binding point 0
+	static const GLuint DRAW_BLOCK_BINDING = 1;
+
+	// std140 layout of one entry of the draw block, the mat3
+	// normal matrix is stored as three padded columns
+	struct DRAW_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 normalMatrix[3];
+		glm::vec4 color;
+		// UV scale in xy, texture flag in z, material index in w
+		glm::vec4 parameters;
+		// lightmap cells of a static surface, zero without one
+		glm::vec4 lightmapRect;
+	};
+
+	// constructor
+	FrameRingBuffer();
+	// destructor
+	~FrameRingBuffer();
+
+	// create and map the buffer, false when it is not supported
+	bool Create(GLsizeiptr regionSize);
+	// grow the regions to hold the passed in number of bytes
+	bool Reserve(GLsizeiptr regionSize);
+	// region size that holds the draw blocks of a number of
+	// draws written a number of times in one frame
+	GLsizeiptr GetFrameSize(int drawCount, int passCount) const;
+	// true when the buffer was created
+	bool IsSupported() const { return(NULL != m_pMappedData); }
+
+	// wait until the region of the new frame is free on the GPU
+	void BeginFrame();
+	// place the fence that guards the region of the frame
+	void EndFrame();
+
+	// reserve aligned space in the current region, returns NULL
+	// when the region is full
+	void* Allocate(GLsizeiptr size, GLintptr& offset);
+	// bind a range of the buffer to a uniform block binding point
+	void BindRange(GLuint binding, GLintptr offset, GLsizeiptr size);
+
+	// largest number of draws that one draw block range can hold
+	int GetMaxDrawsPerBlock() const { return(m_maxDrawsPerBlock); }
+	// defines that switch the scene shaders to the uniform blocks
+	std::string GetShaderDefines() const;
+	// attach the draw block of a linked program to its binding point
+	static void BindProgramBlocks(GLuint program);
+
+	// number of frames that had to wait for the GPU to free a region
+	unsigned int GetStallCount() const { return(m_stallCount); }
+
+private:
+	// number of frame regions in flight
+	static const int REGION_COUNT = 3;
+
+	GLuint m_buffer;
+	unsigned char* m_pMappedData;
+	GLsync m_fences[REGION_COUNT];
+	GLsizeiptr m_regionSize;
+	GLintptr m_alignment;
+	int m_region;
+	GLsizeiptr m_regionOffset;
+	int m_maxDrawsPerBlock;
+	unsigned int m_stallCount;
+	bool m_bOverflowReported;
+
+	// create and map the buffer with three regions of a size
+	bool MapBuffer(GLsizeiptr regionSize);
+	// unmap and delete the buffer and its fences
+	void FreeBuffer();
+};
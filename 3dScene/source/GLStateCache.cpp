@@ -0,0 +1,594 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.cpp
+// ============
+// shadow copy of the OpenGL binding and render state that drops
+// redundant state changes and counts them per frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLStateCache.h"
+
+#include <iostream>
+#include <iomanip>
+
+// declaration of global variables
+namespace
+{
+	// value of a cache entry whose state is not known
+	const GLuint UNKNOWN_NAME = 0xFFFFFFFF;
+	const int UNKNOWN_FLAG = -1;
+
+	// number of texture units that are tracked
+	const int MAX_TEXTURE_UNITS = 32;
+
+	// kinds of state changes that are counted
+	enum STATE_CATEGORY
+	{
+		CATEGORY_PROGRAM,
+		CATEGORY_VERTEX_ARRAY,
+		CATEGORY_FRAMEBUFFER,
+		CATEGORY_BUFFER,
+		CATEGORY_TEXTURE,
+		CATEGORY_CAPABILITY,
+		CATEGORY_FIXED_FUNCTION,
+		CATEGORY_VIEWPORT,
+		CATEGORY_COUNT
+	};
+	const char* g_CategoryNames[CATEGORY_COUNT] =
+	{
+		"program",
+		"vertex array",
+		"framebuffer",
+		"buffer",
+		"texture",
+		"enable/disable",
+		"blend/depth",
+		"viewport"
+	};
+
+	// the shadow copy of the context state
+	struct CACHED_STATE
+	{
+		GLuint program;
+		GLuint vertexArray;
+		GLuint framebuffer;
+		GLuint arrayBuffer;
+		GLuint pixelPackBuffer;
+		GLuint pixelUnpackBuffer;
+		GLuint activeUnit;
+		GLuint textures[MAX_TEXTURE_UNITS];
+		int bBlend;
+		int bDepthTest;
+		int bCullFace;
+		GLenum blendSource;
+		GLenum blendDestination;
+		GLenum depthFunction;
+		int bDepthWrite;
+		int bColorWrite;
+		GLint viewport[4];
+	};
+
+	// issued and filtered changes of a frame by category
+	struct FRAME_COUNTERS
+	{
+		unsigned int issued[CATEGORY_COUNT];
+		unsigned int filtered[CATEGORY_COUNT];
+	};
+
+	// true once the cached state has been reset to unknown
+	bool g_bInitialized = false;
+	CACHED_STATE g_state;
+	FRAME_COUNTERS g_currentFrame = {};
+	FRAME_COUNTERS g_lastFrame = {};
+
+	/***********************************************************
+	 *  State()
+	 *
+	 *  This function is used for accessing the cached state,
+	 *  which starts out unknown.
+	 ***********************************************************/
+	CACHED_STATE& State()
+	{
+		if (!g_bInitialized)
+		{
+			GLStateCache::Invalidate();
+		}
+		return(g_state);
+	}
+
+	/***********************************************************
+	 *  Changed()
+	 *
+	 *  This function is used for comparing a cached value with
+	 *  the requested one.  The cached value is updated and the
+	 *  change is counted, true means it has to be issued.
+	 ***********************************************************/
+	template <typename T>
+	bool Changed(T& cachedValue, T value, STATE_CATEGORY category)
+	{
+		if (cachedValue == value)
+		{
+			g_currentFrame.filtered[category]++;
+			return(false);
+		}
+		cachedValue = value;
+		g_currentFrame.issued[category]++;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  CapabilityFlag()
+	 *
+	 *  This function is used for finding the cache entry of an
+	 *  enable capability, NULL when it is not tracked.
+	 ***********************************************************/
+	int* CapabilityFlag(GLenum capability)
+	{
+		switch (capability)
+		{
+		case GL_BLEND:
+			return(&State().bBlend);
+		case GL_DEPTH_TEST:
+			return(&State().bDepthTest);
+		case GL_CULL_FACE:
+			return(&State().bCullFace);
+		default:
+			return(NULL);
+		}
+	}
+
+	/***********************************************************
+	 *  BufferBinding()
+	 *
+	 *  This function is used for finding the cache entry of a
+	 *  buffer target, NULL when it is not tracked.  The uniform
+	 *  buffer target is also changed by glBindBufferRange(), so
+	 *  it is not tracked.
+	 ***********************************************************/
+	GLuint* BufferBinding(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER:
+			return(&State().arrayBuffer);
+		case GL_PIXEL_PACK_BUFFER:
+			return(&State().pixelPackBuffer);
+		case GL_PIXEL_UNPACK_BUFFER:
+			return(&State().pixelUnpackBuffer);
+		default:
+			return(NULL);
+		}
+	}
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for binding a shader program.
+ ***********************************************************/
+void GLStateCache::UseProgram(GLuint program)
+{
+	if (Changed(State().program, program, CATEGORY_PROGRAM))
+	{
+		glUseProgram(program);
+	}
+}
+
+/***********************************************************
+ *  BindVertexArray()
+ *
+ *  This method is used for binding a vertex array.
+ ***********************************************************/
+void GLStateCache::BindVertexArray(GLuint vertexArray)
+{
+	if (Changed(State().vertexArray, vertexArray, CATEGORY_VERTEX_ARRAY))
+	{
+		glBindVertexArray(vertexArray);
+	}
+}
+
+/***********************************************************
+ *  BindFramebuffer()
+ *
+ *  This method is used for binding a framebuffer for both
+ *  drawing and reading.
+ ***********************************************************/
+void GLStateCache::BindFramebuffer(GLuint framebuffer)
+{
+	if (Changed(State().framebuffer, framebuffer, CATEGORY_FRAMEBUFFER))
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+}
+
+/***********************************************************
+ *  BindBuffer()
+ *
+ *  This method is used for binding a buffer to a target.
+ *  Targets that are not tracked are always issued.
+ ***********************************************************/
+void GLStateCache::BindBuffer(GLenum target, GLuint buffer)
+{
+	GLuint* pBinding = BufferBinding(target);
+	if (NULL == pBinding)
+	{
+		g_currentFrame.issued[CATEGORY_BUFFER]++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (Changed(*pBinding, buffer, CATEGORY_BUFFER))
+	{
+		glBindBuffer(target, buffer);
+	}
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a 2D texture to a unit.
+ *  The active unit is only switched when the binding of the
+ *  unit actually changes.
+ ***********************************************************/
+void GLStateCache::BindTexture(GLuint unit, GLuint texture)
+{
+	if (unit >= (GLuint)MAX_TEXTURE_UNITS)
+	{
+		g_currentFrame.issued[CATEGORY_TEXTURE]++;
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		State().activeUnit = unit;
+		return;
+	}
+
+	if (!Changed(State().textures[unit], texture, CATEGORY_TEXTURE))
+	{
+		return;
+	}
+	if (State().activeUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		State().activeUnit = unit;
+	}
+	glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+/***********************************************************
+ *  BindTextureForUpdate()
+ *
+ *  This method is used for binding a 2D texture that is being
+ *  created or updated.  It uses a unit of its own, so loading
+ *  or resizing a texture never replaces a bound scene texture.
+ ***********************************************************/
+void GLStateCache::BindTextureForUpdate(GLuint texture)
+{
+	BindTexture(UPDATE_TEXTURE_UNIT, texture);
+}
+
+/***********************************************************
+ *  SetEnabled()
+ *
+ *  This method is used for enabling or disabling a capability.
+ *  Capabilities that are not tracked are always issued.
+ ***********************************************************/
+void GLStateCache::SetEnabled(GLenum capability, bool bEnabled)
+{
+	int* pFlag = CapabilityFlag(capability);
+	if ((NULL == pFlag) || Changed(*pFlag, bEnabled ? 1 : 0, CATEGORY_CAPABILITY))
+	{
+		if (NULL == pFlag)
+		{
+			g_currentFrame.issued[CATEGORY_CAPABILITY]++;
+		}
+		if (bEnabled)
+		{
+			glEnable(capability);
+		}
+		else
+		{
+			glDisable(capability);
+		}
+	}
+}
+
+/***********************************************************
+ *  BlendFunc()
+ *
+ *  This method is used for setting the blend factors.
+ ***********************************************************/
+void GLStateCache::BlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+	CACHED_STATE& state = State();
+	if ((state.blendSource == sourceFactor) && (state.blendDestination == destinationFactor))
+	{
+		g_currentFrame.filtered[CATEGORY_FIXED_FUNCTION]++;
+		return;
+	}
+	state.blendSource = sourceFactor;
+	state.blendDestination = destinationFactor;
+	g_currentFrame.issued[CATEGORY_FIXED_FUNCTION]++;
+	glBlendFunc(sourceFactor, destinationFactor);
+}
+
+/***********************************************************
+ *  DepthFunc()
+ *
+ *  This method is used for setting the depth comparison.
+ ***********************************************************/
+void GLStateCache::DepthFunc(GLenum function)
+{
+	if (Changed(State().depthFunction, function, CATEGORY_FIXED_FUNCTION))
+	{
+		glDepthFunc(function);
+	}
+}
+
+/***********************************************************
+ *  DepthMask()
+ *
+ *  This method is used for turning the depth writes on or off.
+ ***********************************************************/
+void GLStateCache::DepthMask(bool bWrite)
+{
+	if (Changed(State().bDepthWrite, bWrite ? 1 : 0, CATEGORY_FIXED_FUNCTION))
+	{
+		glDepthMask(bWrite ? GL_TRUE : GL_FALSE);
+	}
+}
+
+/***********************************************************
+ *  ColorMask()
+ *
+ *  This method is used for turning the writes of all color
+ *  channels on or off.
+ ***********************************************************/
+void GLStateCache::ColorMask(bool bWrite)
+{
+	if (Changed(State().bColorWrite, bWrite ? 1 : 0, CATEGORY_FIXED_FUNCTION))
+	{
+		GLboolean mask = bWrite ? GL_TRUE : GL_FALSE;
+		glColorMask(mask, mask, mask, mask);
+	}
+}
+
+/***********************************************************
+ *  Viewport()
+ *
+ *  This method is used for setting the viewport.
+ ***********************************************************/
+void GLStateCache::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	GLint* viewport = State().viewport;
+	if ((viewport[0] == x) && (viewport[1] == y) &&
+		(viewport[2] == width) && (viewport[3] == height))
+	{
+		g_currentFrame.filtered[CATEGORY_VIEWPORT]++;
+		return;
+	}
+	viewport[0] = x;
+	viewport[1] = y;
+	viewport[2] = width;
+	viewport[3] = height;
+	g_currentFrame.issued[CATEGORY_VIEWPORT]++;
+	glViewport(x, y, width, height);
+}
+
+/***********************************************************
+ *  DeleteTextures()
+ *
+ *  This method is used for deleting textures.  OpenGL unbinds
+ *  a deleted texture from every unit, and so does the cache.
+ ***********************************************************/
+void GLStateCache::DeleteTextures(GLsizei count, const GLuint* textures)
+{
+	CACHED_STATE& state = State();
+	for (GLsizei i = 0; i < count; i++)
+	{
+		for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+		{
+			if ((0 != textures[i]) && (state.textures[unit] == textures[i]))
+			{
+				state.textures[unit] = 0;
+			}
+		}
+	}
+	glDeleteTextures(count, textures);
+}
+
+/***********************************************************
+ *  DeleteFramebuffers()
+ *
+ *  This method is used for deleting framebuffers.  Deleting
+ *  the bound framebuffer reverts the binding to 0.
+ ***********************************************************/
+void GLStateCache::DeleteFramebuffers(GLsizei count, const GLuint* framebuffers)
+{
+	CACHED_STATE& state = State();
+	for (GLsizei i = 0; i < count; i++)
+	{
+		if ((0 != framebuffers[i]) && (state.framebuffer == framebuffers[i]))
+		{
+			state.framebuffer = 0;
+		}
+	}
+	glDeleteFramebuffers(count, framebuffers);
+}
+
+/***********************************************************
+ *  DeleteVertexArrays()
+ *
+ *  This method is used for deleting vertex arrays.  Deleting
+ *  the bound vertex array reverts the binding to 0.
+ ***********************************************************/
+void GLStateCache::DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays)
+{
+	CACHED_STATE& state = State();
+	for (GLsizei i = 0; i < count; i++)
+	{
+		if ((0 != vertexArrays[i]) && (state.vertexArray == vertexArrays[i]))
+		{
+			state.vertexArray = 0;
+		}
+	}
+	glDeleteVertexArrays(count, vertexArrays);
+}
+
+/***********************************************************
+ *  DeleteBuffers()
+ *
+ *  This method is used for deleting buffers.  A deleted buffer
+ *  is unbound from every tracked target.
+ ***********************************************************/
+void GLStateCache::DeleteBuffers(GLsizei count, const GLuint* buffers)
+{
+	CACHED_STATE& state = State();
+	GLuint* bindings[3] =
+	{
+		&state.arrayBuffer,
+		&state.pixelPackBuffer,
+		&state.pixelUnpackBuffer
+	};
+	for (GLsizei i = 0; i < count; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			if ((0 != buffers[i]) && (*bindings[j] == buffers[i]))
+			{
+				*bindings[j] = 0;
+			}
+		}
+	}
+	glDeleteBuffers(count, buffers);
+}
+
+/***********************************************************
+ *  InvalidateVertexArray()
+ *
+ *  This method is used for forgetting the bound vertex array
+ *  after code outside the cache has changed it.
+ ***********************************************************/
+void GLStateCache::InvalidateVertexArray()
+{
+	State().vertexArray = UNKNOWN_NAME;
+	State().arrayBuffer = UNKNOWN_NAME;
+}
+
+/***********************************************************
+ *  InvalidateProgram()
+ *
+ *  This method is used for forgetting the bound program after
+ *  code outside the cache has changed it.
+ ***********************************************************/
+void GLStateCache::InvalidateProgram()
+{
+	State().program = UNKNOWN_NAME;
+}
+
+/***********************************************************
+ *  InvalidateBlendFunc()
+ *
+ *  This method is used for forgetting the blend factors after
+ *  they were set per draw buffer, which the cache does not
+ *  track.
+ ***********************************************************/
+void GLStateCache::InvalidateBlendFunc()
+{
+	State().blendSource = UNKNOWN_NAME;
+	State().blendDestination = UNKNOWN_NAME;
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting the whole state, the
+ *  next change of every entry is issued.
+ ***********************************************************/
+void GLStateCache::Invalidate()
+{
+	g_bInitialized = true;
+
+	g_state.program = UNKNOWN_NAME;
+	g_state.vertexArray = UNKNOWN_NAME;
+	g_state.framebuffer = UNKNOWN_NAME;
+	g_state.arrayBuffer = UNKNOWN_NAME;
+	g_state.pixelPackBuffer = UNKNOWN_NAME;
+	g_state.pixelUnpackBuffer = UNKNOWN_NAME;
+	g_state.activeUnit = UNKNOWN_NAME;
+	for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		g_state.textures[i] = UNKNOWN_NAME;
+	}
+	g_state.bBlend = UNKNOWN_FLAG;
+	g_state.bDepthTest = UNKNOWN_FLAG;
+	g_state.bCullFace = UNKNOWN_FLAG;
+	g_state.blendSource = UNKNOWN_NAME;
+	g_state.blendDestination = UNKNOWN_NAME;
+	g_state.depthFunction = UNKNOWN_NAME;
+	g_state.bDepthWrite = UNKNOWN_FLAG;
+	g_state.bColorWrite = UNKNOWN_FLAG;
+	for (int i = 0; i < 4; i++)
+	{
+		g_state.viewport[i] = -1;
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for keeping the counts of the frame
+ *  that just ended and starting new ones.
+ ***********************************************************/
+void GLStateCache::BeginFrame()
+{
+	g_lastFrame = g_currentFrame;
+	g_currentFrame = FRAME_COUNTERS();
+}
+
+/***********************************************************
+ *  GetIssuedCount()
+ *
+ *  This method is used for getting the number of changes that
+ *  were sent to the driver in the last frame.
+ ***********************************************************/
+unsigned int GLStateCache::GetIssuedCount()
+{
+	unsigned int count = 0;
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		count += g_lastFrame.issued[i];
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  GetFilteredCount()
+ *
+ *  This method is used for getting the number of changes that
+ *  were dropped as redundant in the last frame.
+ ***********************************************************/
+unsigned int GLStateCache::GetFilteredCount()
+{
+	unsigned int count = 0;
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		count += g_lastFrame.filtered[i];
+	}
+	return(count);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the issued and filtered
+ *  changes of the last frame by category.
+ ***********************************************************/
+void GLStateCache::PrintReport()
+{
+	std::cout << "  state changes        issued " << GetIssuedCount()
+		<< "  filtered " << GetFilteredCount() << std::endl;
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		std::cout << "    " << std::left << std::setw(18) << g_CategoryNames[i]
+			<< " issued " << std::setw(6) << g_lastFrame.issued[i]
+			<< " filtered " << g_lastFrame.filtered[i] << std::endl;
+	}
+}
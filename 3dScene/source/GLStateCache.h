@@ -0,0 +1,86 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.h
+// ============
+// shadow copy of the OpenGL binding and render state that drops
+// redundant state changes and counts them per frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  GLStateCache
+ *
+ *  This class keeps a copy of the state that the renderer
+ *  changes most often: the bound program, vertex array,
+ *  framebuffer, buffers, the 2D texture of each unit, the
+ *  enabled capabilities, blend and depth settings and the
+ *  viewport.  A change that matches the copy is not sent to
+ *  the driver.  Every change is counted as issued or filtered,
+ *  and the counts of the last frame can be reported.
+ *
+ *  There is one OpenGL context, so the state is shared by all
+ *  callers through static methods.  Code that changes state
+ *  behind the cache, such as the ShapeMeshes draw calls, must
+ *  invalidate the affected entries afterwards.
+ ***********************************************************/
+class GLStateCache
+{
+public:
+	// texture unit used for creating and updating textures, so
+	// the units that hold the scene textures stay untouched
+	static const GLuint UPDATE_TEXTURE_UNIT = 31;
+
+	// bind a shader program
+	static void UseProgram(GLuint program);
+	// bind a vertex array
+	static void BindVertexArray(GLuint vertexArray);
+	// bind a framebuffer to GL_FRAMEBUFFER
+	static void BindFramebuffer(GLuint framebuffer);
+	// bind a buffer, the element array binding belongs to the
+	// vertex array and is always passed through
+	static void BindBuffer(GLenum target, GLuint buffer);
+	// bind a 2D texture to a texture unit
+	static void BindTexture(GLuint unit, GLuint texture);
+	// bind a 2D texture to the update unit for creating it
+	static void BindTextureForUpdate(GLuint texture);
+
+	// enable or disable GL_BLEND, GL_DEPTH_TEST or GL_CULL_FACE
+	static void SetEnabled(GLenum capability, bool bEnabled);
+	// set the blend factors
+	static void BlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+	// set the depth comparison
+	static void DepthFunc(GLenum function);
+	// turn depth writes on or off
+	static void DepthMask(bool bWrite);
+	// turn color writes on or off for all channels
+	static void ColorMask(bool bWrite);
+	// set the viewport
+	static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+	// delete objects and forget them in the cache, so a reused
+	// name is not mistaken for a bound object
+	static void DeleteTextures(GLsizei count, const GLuint* textures);
+	static void DeleteFramebuffers(GLsizei count, const GLuint* framebuffers);
+	static void DeleteVertexArrays(GLsizei count, const GLuint* vertexArrays);
+	static void DeleteBuffers(GLsizei count, const GLuint* buffers);
+
+	// forget the bound vertex array after external draw code
+	static void InvalidateVertexArray();
+	// forget the bound program after external shader code
+	static void InvalidateProgram();
+	// forget the blend factors after glBlendFunci() calls
+	static void InvalidateBlendFunc();
+	// forget the whole state
+	static void Invalidate();
+
+	// start counting the changes of a new frame
+	static void BeginFrame();
+	// changes sent to the driver during the last frame
+	static unsigned int GetIssuedCount();
+	// changes dropped as redundant during the last frame
+	static unsigned int GetFilteredCount();
+	// print the counts of the last frame to the console
+	static void PrintReport();
+};
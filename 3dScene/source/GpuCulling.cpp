@@ -0,0 +1,720 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.cpp
+// ============
+// cull the objects of the scene in a compute shader against the frustum
+// and a Hi-Z pyramid, and draw the visible ones with indirect draws
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCulling.h"
+#include "GLStateCache.h"
+#include "CameraBlock.h"
+#include "ResourceRegistry.h"
+#include "SoftwareRenderer.h"
+#include "WeightedTransparency.h"
+
+#include <iostream>
+#include <cmath>
+#include <cstddef>
+
+// declaration of global variables
+namespace
+{
+	// work group sizes, they match the compute shaders
+	const int CULL_GROUP_SIZE = 64;
+	const int HIZ_GROUP_SIZE = 8;
+
+	// name of the object settings block in the scene programs
+	const char* g_DrawBufferName = "DrawBuffer";
+
+	// layout of one draw of glMultiDrawElementsIndirect()
+	struct INDIRECT_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	/***********************************************************
+	 *  CreateBuffer()
+	 *
+	 *  This function is used for creating a buffer with the
+	 *  passed in contents and tracking it in the registry.  The
+	 *  copy target is used so no binding of the draws changes.
+	 ***********************************************************/
+	GLuint CreateBuffer(
+		GLsizeiptr size,
+		const void* pData,
+		GLenum usage,
+		ResourceRegistry::RESOURCE_CATEGORY category,
+		const char* label)
+	{
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, size, pData, usage);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		ResourceRegistry::Track(GL_BUFFER, buffer, category, (size_t)size, label);
+		return(buffer);
+	}
+
+	/***********************************************************
+	 *  DestroyBuffer()
+	 *
+	 *  This function is used for freeing a buffer created by
+	 *  CreateBuffer() and clearing its name.
+	 ***********************************************************/
+	void DestroyBuffer(GLuint& buffer)
+	{
+		if (0 != buffer)
+		{
+			ResourceRegistry::Release(GL_BUFFER, 1, &buffer);
+			GLStateCache::DeleteBuffers(1, &buffer);
+			buffer = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  GpuCulling()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCulling::GpuCulling()
+{
+	m_pCullShader = new ShaderManager();
+	m_pCullShader->m_programID = 0;
+	m_pHiZShader = new ShaderManager();
+	m_pHiZShader->m_programID = 0;
+	m_bDrawCount = false;
+
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_meshBuffer = 0;
+	m_vertexArray = 0;
+
+	m_objectBuffer = 0;
+	m_drawBuffer = 0;
+	m_batchBuffer = 0;
+	m_commandBuffer = 0;
+	m_countBuffer = 0;
+	m_drawIndexBuffer = 0;
+	m_objectCount = 0;
+
+	m_depthFBO = 0;
+	m_depthTexture = 0;
+	m_depthFormat = GL_NONE;
+	m_hiZTexture = 0;
+	m_hiZWidth = 0;
+	m_hiZHeight = 0;
+	m_hiZLevels = 0;
+	m_bHiZValid = false;
+	m_hiZViewProjection = glm::mat4(1.0f);
+
+	m_targetFramebuffer = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_queriedFramebuffer = 0xFFFFFFFF;
+	m_targetDepthFormat = GL_NONE;
+
+	m_readbackBuffer = 0;
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		m_readbackFences[i] = NULL;
+	}
+	m_currentReadback = 0;
+	m_visibleCount = 0;
+}
+
+/***********************************************************
+ *  ~GpuCulling()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCulling::~GpuCulling()
+{
+	for (int i = 0; i < READBACK_LATENCY; i++)
+	{
+		if (NULL != m_readbackFences[i])
+		{
+			glDeleteSync(m_readbackFences[i]);
+			m_readbackFences[i] = NULL;
+		}
+	}
+	DestroyHiZ();
+	DestroyObjectBuffers();
+	DestroyBuffer(m_readbackBuffer);
+	DestroyBuffer(m_vertexBuffer);
+	DestroyBuffer(m_indexBuffer);
+	DestroyBuffer(m_meshBuffer);
+	if (0 != m_vertexArray)
+	{
+		GLStateCache::DeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (NULL != m_pCullShader)
+	{
+		delete m_pCullShader;
+		m_pCullShader = NULL;
+	}
+	if (NULL != m_pHiZShader)
+	{
+		delete m_pHiZShader;
+		m_pHiZShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the driver offers
+ *  compute shaders, storage buffers and multi draw indirect,
+ *  which OpenGL 4.3 brings together.
+ ***********************************************************/
+bool GpuCulling::IsSupported()
+{
+	return(GLEW_VERSION_4_3 ? true : false);
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for building the culling and the
+ *  pyramid programs and packing the basic meshes into the
+ *  mesh pool.  The draw count is read from a buffer when the
+ *  driver offers indirect parameters.
+ ***********************************************************/
+bool GpuCulling::LoadShaders(
+	ShaderCache* pShaderCache,
+	const char* cullComputeShaderPath,
+	const char* hiZComputeShaderPath)
+{
+	if (!IsSupported())
+	{
+		std::cout << "GPU culling needs OpenGL 4.3, the draws are culled on the CPU" << std::endl;
+		return(false);
+	}
+
+	if (!pShaderCache->LoadComputeShader(m_pCullShader, cullComputeShaderPath))
+	{
+		m_pCullShader->m_programID = 0;
+		return(false);
+	}
+	CameraBlock::BindProgramBlock(m_pCullShader->m_programID);
+
+	if (!pShaderCache->LoadComputeShader(m_pHiZShader, hiZComputeShaderPath))
+	{
+		m_pHiZShader->m_programID = 0;
+		return(false);
+	}
+
+	m_bDrawCount = (GLEW_VERSION_4_6 || GLEW_ARB_indirect_parameters) ? true : false;
+	GLStateCache::UseProgram(m_pCullShader->m_programID);
+	m_pCullShader->setSampler2DValue("hiZ", HIZ_TEXTURE_UNIT);
+	m_pCullShader->setBoolValue("bCompact", m_bDrawCount);
+	GLStateCache::UseProgram(m_pHiZShader->m_programID);
+	m_pHiZShader->setSampler2DValue("sourceDepth", HIZ_TEXTURE_UNIT);
+
+	m_readbackBuffer = CreateBuffer(READBACK_LATENCY * sizeof(GLuint), NULL, GL_STREAM_READ,
+		ResourceRegistry::CATEGORY_BUFFER, "GPU culling visible counts");
+
+	return(CreateMeshPool());
+}
+
+/***********************************************************
+ *  IsReady()
+ *
+ *  This method is used for checking whether both programs and
+ *  the mesh pool were created.
+ ***********************************************************/
+bool GpuCulling::IsReady() const
+{
+	return((0 != m_pCullShader->m_programID) &&
+		(0 != m_pHiZShader->m_programID) &&
+		(0 != m_vertexArray));
+}
+
+/***********************************************************
+ *  CreateMeshPool()
+ *
+ *  This method is used for packing the basic meshes into one
+ *  vertex and one index buffer, and recording the range of
+ *  each mesh for the commands of the culling pass.
+ ***********************************************************/
+bool GpuCulling::CreateMeshPool()
+{
+	std::vector<MeshImporter::MESH_VERTEX> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<MESH_RANGE> ranges;
+
+	for (int mesh = SceneManager::BOX_MESH; mesh <= SceneManager::TORUS_MESH; mesh++)
+	{
+		std::vector<MeshImporter::MESH_VERTEX> meshVertices;
+		std::vector<unsigned int> meshIndices;
+		SoftwareRenderer::BuildBasicMesh((SceneManager::MESH_TYPE)mesh, meshVertices, meshIndices);
+
+		MESH_RANGE range;
+		range.indexCount = (GLuint)meshIndices.size();
+		range.firstIndex = (GLuint)indices.size();
+		range.baseVertex = (GLint)vertices.size();
+		range.padding = 0;
+		ranges.push_back(range);
+
+		vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+		indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+	}
+	if (vertices.empty() || indices.empty())
+	{
+		std::cout << "GPU culling mesh pool is empty" << std::endl;
+		return(false);
+	}
+
+	m_vertexBuffer = CreateBuffer(vertices.size() * sizeof(MeshImporter::MESH_VERTEX), vertices.data(),
+		GL_STATIC_DRAW, ResourceRegistry::CATEGORY_MESH, "GPU culling mesh pool vertices");
+	m_indexBuffer = CreateBuffer(indices.size() * sizeof(unsigned int), indices.data(),
+		GL_STATIC_DRAW, ResourceRegistry::CATEGORY_MESH, "GPU culling mesh pool indices");
+	m_meshBuffer = CreateBuffer(ranges.size() * sizeof(MESH_RANGE), ranges.data(),
+		GL_STATIC_DRAW, ResourceRegistry::CATEGORY_BUFFER, "GPU culling mesh ranges");
+
+	// the attributes follow the locations of the scene shaders,
+	// the object index is attached once the objects are uploaded
+	glGenVertexArrays(1, &m_vertexArray);
+	GLStateCache::BindVertexArray(m_vertexArray);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshImporter::MESH_VERTEX),
+		(const void*)offsetof(MeshImporter::MESH_VERTEX, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MeshImporter::MESH_VERTEX),
+		(const void*)offsetof(MeshImporter::MESH_VERTEX, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MeshImporter::MESH_VERTEX),
+		(const void*)offsetof(MeshImporter::MESH_VERTEX, uv));
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	GLStateCache::BindVertexArray(0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyObjectBuffers()
+ *
+ *  This method is used for freeing the buffers of the
+ *  uploaded objects.
+ ***********************************************************/
+void GpuCulling::DestroyObjectBuffers()
+{
+	DestroyBuffer(m_objectBuffer);
+	DestroyBuffer(m_drawBuffer);
+	DestroyBuffer(m_batchBuffer);
+	DestroyBuffer(m_commandBuffer);
+	DestroyBuffer(m_countBuffer);
+	DestroyBuffer(m_drawIndexBuffer);
+	m_objectCount = 0;
+	m_batchFirstCommands.clear();
+	m_batchSizes.clear();
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method is used for uploading the objects, their draw
+ *  settings and the first command of every batch.  The objects
+ *  of a batch are consecutive, so a batch owns as many
+ *  commands as it has objects, starting at its first object.
+ *  The upload only happens when the recorded scene changes.
+ ***********************************************************/
+bool GpuCulling::SetObjects(
+	const std::vector<GPU_OBJECT>& objects,
+	const std::vector<FrameRingBuffer::DRAW_DATA>& draws,
+	int batchCount)
+{
+	DestroyObjectBuffers();
+	if (!IsReady() || objects.empty() || (objects.size() != draws.size()) || (batchCount <= 0))
+	{
+		return(false);
+	}
+
+	m_batchSizes.assign(batchCount, 0);
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		if ((objects[i].batch >= (GLuint)batchCount) || (objects[i].mesh > (GLuint)SceneManager::TORUS_MESH))
+		{
+			std::cout << "GPU culling object " << i << " is out of range" << std::endl;
+			m_batchSizes.clear();
+			return(false);
+		}
+		m_batchSizes[objects[i].batch]++;
+	}
+	GLuint firstCommand = 0;
+	m_batchFirstCommands.resize(batchCount);
+	for (int batch = 0; batch < batchCount; batch++)
+	{
+		m_batchFirstCommands[batch] = firstCommand;
+		firstCommand += (GLuint)m_batchSizes[batch];
+	}
+
+	// the object index of every instance, the base instance of a
+	// command picks the entry of its object
+	std::vector<GLuint> drawIndices(objects.size());
+	for (size_t i = 0; i < drawIndices.size(); i++)
+	{
+		drawIndices[i] = (GLuint)i;
+	}
+
+	m_objectBuffer = CreateBuffer(objects.size() * sizeof(GPU_OBJECT), objects.data(),
+		GL_STATIC_DRAW, ResourceRegistry::CATEGORY_BUFFER, "GPU culling objects");
+	m_drawBuffer = CreateBuffer(draws.size() * sizeof(FrameRingBuffer::DRAW_DATA), draws.data(),
+		GL_STATIC_DRAW, ResourceRegistry::CATEGORY_BUFFER, "GPU culling draw settings");
+	m_batchBuffer = CreateBuffer(m_batchFirstCommands.size() * sizeof(GLuint), m_batchFirstCommands.data(),
+		GL_STATIC_DRAW, ResourceRegistry::CATEGORY_BUFFER, "GPU culling batches");
+	m_commandBuffer = CreateBuffer(objects.size() * sizeof(INDIRECT_COMMAND), NULL,
+		GL_DYNAMIC_COPY, ResourceRegistry::CATEGORY_BUFFER, "GPU culling commands");
+	m_countBuffer = CreateBuffer((batchCount + 1) * sizeof(GLuint), NULL,
+		GL_DYNAMIC_COPY, ResourceRegistry::CATEGORY_BUFFER, "GPU culling draw counts");
+	m_drawIndexBuffer = CreateBuffer(drawIndices.size() * sizeof(GLuint), drawIndices.data(),
+		GL_STATIC_DRAW, ResourceRegistry::CATEGORY_MESH, "GPU culling object indices");
+
+	GLStateCache::BindVertexArray(m_vertexArray);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, m_drawIndexBuffer);
+	glEnableVertexAttribArray(DRAW_INDEX_ATTRIBUTE);
+	glVertexAttribIPointer(DRAW_INDEX_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), NULL);
+	glVertexAttribDivisor(DRAW_INDEX_ATTRIBUTE, 1);
+	GLStateCache::BindVertexArray(0);
+
+	m_objectCount = (int)objects.size();
+	return(true);
+}
+
+/***********************************************************
+ *  SetTarget()
+ *
+ *  This method is used for setting the framebuffer that the
+ *  scene is rendered into and the rendered size.  A new size
+ *  leaves the pyramid of the old size unusable.
+ ***********************************************************/
+void GpuCulling::SetTarget(GLuint framebuffer, int width, int height)
+{
+	if ((width != m_targetWidth) || (height != m_targetHeight) || (framebuffer != m_targetFramebuffer))
+	{
+		m_bHiZValid = false;
+	}
+	m_targetFramebuffer = framebuffer;
+	m_targetWidth = width;
+	m_targetHeight = height;
+}
+
+/***********************************************************
+ *  ResolveReadback()
+ *
+ *  This method is used for reading a visible count that was
+ *  copied READBACK_LATENCY frames ago.  When the GPU has
+ *  fallen even further behind, the count is dropped instead
+ *  of waiting.
+ ***********************************************************/
+void GpuCulling::ResolveReadback(int readback)
+{
+	GLsync fence = m_readbackFences[readback];
+	if (NULL == fence)
+	{
+		return;
+	}
+	m_readbackFences[readback] = NULL;
+
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	glDeleteSync(fence);
+	if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+	{
+		return;
+	}
+
+	GLuint visibleCount = 0;
+	glBindBuffer(GL_COPY_READ_BUFFER, m_readbackBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, readback * sizeof(GLuint), sizeof(GLuint), &visibleCount);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	m_visibleCount = (int)visibleCount;
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for testing every object in one
+ *  dispatch.  The counts are cleared on the GPU, the pyramid
+ *  of the previous frame is used when it matches the target,
+ *  and the total count is copied aside to be read a few
+ *  frames later without stalling.
+ ***********************************************************/
+void GpuCulling::Cull()
+{
+	if (!IsReady() || (m_objectCount <= 0))
+	{
+		return;
+	}
+
+	GLuint zero = 0;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_countBuffer);
+	glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	GLStateCache::UseProgram(m_pCullShader->m_programID);
+	m_pCullShader->setIntValue("objectCount", m_objectCount);
+	m_pCullShader->setIntValue("batchCount", GetBatchCount());
+	m_pCullShader->setBoolValue("bUseHiZ", m_bHiZValid);
+	if (m_bHiZValid)
+	{
+		m_pCullShader->setMat4Value("previousViewProjection", m_hiZViewProjection);
+		GLStateCache::BindTexture(HIZ_TEXTURE_UNIT, m_hiZTexture);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECT_BUFFER_BINDING, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MESH_BUFFER_BINDING, m_meshBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BATCH_BUFFER_BINDING, m_batchBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BUFFER_BINDING, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNT_BUFFER_BINDING, m_countBuffer);
+
+	glDispatchCompute((m_objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	// the draws read the commands and counts as indirect
+	// arguments, and the copy below reads the total
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	ResolveReadback(m_currentReadback);
+	glBindBuffer(GL_COPY_READ_BUFFER, m_countBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_readbackBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+		GetBatchCount() * sizeof(GLuint), m_currentReadback * sizeof(GLuint), sizeof(GLuint));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	m_readbackFences[m_currentReadback] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_currentReadback = (m_currentReadback + 1) % READBACK_LATENCY;
+}
+
+/***********************************************************
+ *  BeginDraws()
+ *
+ *  This method is used for binding the mesh pool, the
+ *  commands, the counts and the object settings that the
+ *  batch draws read.
+ ***********************************************************/
+void GpuCulling::BeginDraws()
+{
+	GLStateCache::BindVertexArray(m_vertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	if (m_bDrawCount)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER, m_countBuffer);
+	}
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BUFFER_BINDING, m_drawBuffer);
+}
+
+/***********************************************************
+ *  DrawBatch()
+ *
+ *  This method is used for drawing the visible objects of a
+ *  batch with the bound program.  The count of the batch is
+ *  read from the count buffer, and the commands of the batch
+ *  are its upper bound.
+ ***********************************************************/
+void GpuCulling::DrawBatch(int batch)
+{
+	if ((batch < 0) || (batch >= GetBatchCount()) || (m_batchSizes[batch] <= 0))
+	{
+		return;
+	}
+
+	const void* pFirstCommand = (const void*)(m_batchFirstCommands[batch] * sizeof(INDIRECT_COMMAND));
+	if (!m_bDrawCount)
+	{
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, pFirstCommand,
+			m_batchSizes[batch], sizeof(INDIRECT_COMMAND));
+	}
+	else if (GLEW_VERSION_4_6)
+	{
+		glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, pFirstCommand,
+			(GLintptr)(batch * sizeof(GLuint)), m_batchSizes[batch], sizeof(INDIRECT_COMMAND));
+	}
+	else
+	{
+		glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, pFirstCommand,
+			(GLintptr)(batch * sizeof(GLuint)), m_batchSizes[batch], sizeof(INDIRECT_COMMAND));
+	}
+}
+
+/***********************************************************
+ *  CreateHiZ()
+ *
+ *  This method is used for allocating the depth copy in the
+ *  format of the target and the pyramid, whose levels go down
+ *  to a single texel.
+ ***********************************************************/
+bool GpuCulling::CreateHiZ(int width, int height, GLenum depthFormat)
+{
+	DestroyHiZ();
+
+	glGenFramebuffers(1, &m_depthFBO);
+	GLStateCache::BindFramebuffer(m_depthFBO);
+
+	glGenTextures(1, &m_depthTexture);
+	GLStateCache::BindTextureForUpdate(m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, depthFormat, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	bool bStencil = (GL_DEPTH24_STENCIL8 == depthFormat) || (GL_DEPTH32F_STENCIL8 == depthFormat);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, bStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+		GL_TEXTURE_2D, m_depthTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Hi-Z depth framebuffer is not complete" << std::endl;
+		GLStateCache::BindFramebuffer(m_targetFramebuffer);
+		DestroyHiZ();
+		return(false);
+	}
+	GLStateCache::BindFramebuffer(m_targetFramebuffer);
+
+	int largest = (width > height) ? width : height;
+	m_hiZLevels = 1 + (int)std::floor(std::log2((double)largest));
+
+	// a mipmapped filter keeps every level inside the range that
+	// texelFetch() may read
+	glGenTextures(1, &m_hiZTexture);
+	GLStateCache::BindTextureForUpdate(m_hiZTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_hiZLevels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	m_hiZWidth = width;
+	m_hiZHeight = height;
+	m_depthFormat = depthFormat;
+
+	ResourceRegistry::Track(GL_TEXTURE, m_depthTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(depthFormat, width, height, false), "Hi-Z depth copy");
+	ResourceRegistry::Track(GL_TEXTURE, m_hiZTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_R32F, width, height, true), "Hi-Z pyramid");
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyHiZ()
+ *
+ *  This method is used for freeing the depth copy and the
+ *  pyramid.
+ ***********************************************************/
+void GpuCulling::DestroyHiZ()
+{
+	if (0 != m_depthTexture)
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_depthTexture);
+		GLStateCache::DeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+	}
+	if (0 != m_hiZTexture)
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_hiZTexture);
+		GLStateCache::DeleteTextures(1, &m_hiZTexture);
+		m_hiZTexture = 0;
+	}
+	if (0 != m_depthFBO)
+	{
+		GLStateCache::DeleteFramebuffers(1, &m_depthFBO);
+		m_depthFBO = 0;
+	}
+	m_depthFormat = GL_NONE;
+	m_hiZWidth = 0;
+	m_hiZHeight = 0;
+	m_hiZLevels = 0;
+	m_bHiZValid = false;
+}
+
+/***********************************************************
+ *  BuildHiZ()
+ *
+ *  This method is used for copying the depth of the drawn
+ *  frame and reducing it level by level into the pyramid.
+ *  The camera of the frame is kept with the pyramid, as the
+ *  next frame tests its objects from where this one was seen.
+ ***********************************************************/
+void GpuCulling::BuildHiZ(const glm::mat4& viewProjection)
+{
+	if (!IsReady() || (m_targetWidth <= 0) || (m_targetHeight <= 0))
+	{
+		return;
+	}
+
+	if (m_queriedFramebuffer != m_targetFramebuffer)
+	{
+		m_targetDepthFormat = WeightedTransparency::QueryDepthFormat(m_targetFramebuffer);
+		m_queriedFramebuffer = m_targetFramebuffer;
+	}
+	if ((m_targetWidth != m_hiZWidth) || (m_targetHeight != m_hiZHeight) ||
+		(m_targetDepthFormat != m_depthFormat))
+	{
+		if (!CreateHiZ(m_targetWidth, m_targetHeight, m_targetDepthFormat))
+		{
+			return;
+		}
+	}
+
+	// the copy binds the read and draw framebuffers separately,
+	// so the cached binding is replaced right after it
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_targetFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_depthFBO);
+	glBlitFramebuffer(
+		0, 0, m_targetWidth, m_targetHeight,
+		0, 0, m_targetWidth, m_targetHeight,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	GLStateCache::BindFramebuffer(m_depthFBO);
+	GLStateCache::BindFramebuffer(m_targetFramebuffer);
+
+	GLStateCache::UseProgram(m_pHiZShader->m_programID);
+	for (int level = 0; level < m_hiZLevels; level++)
+	{
+		int width = (m_hiZWidth >> level) > 1 ? (m_hiZWidth >> level) : 1;
+		int height = (m_hiZHeight >> level) > 1 ? (m_hiZHeight >> level) : 1;
+		if (0 == level)
+		{
+			GLStateCache::BindTexture(HIZ_TEXTURE_UNIT, m_depthTexture);
+			m_pHiZShader->setBoolValue("bCopyDepth", true);
+		}
+		else
+		{
+			GLStateCache::BindTexture(HIZ_TEXTURE_UNIT, m_hiZTexture);
+			m_pHiZShader->setBoolValue("bCopyDepth", false);
+			m_pHiZShader->setIntValue("sourceLevel", level - 1);
+		}
+		glBindImageTexture(0, m_hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE,
+			(height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+		// the next level and the culling fetch what was written
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+
+	m_hiZViewProjection = viewProjection;
+	m_bHiZValid = true;
+}
+
+/***********************************************************
+ *  BindProgramBlocks()
+ *
+ *  This method is used for attaching the object settings
+ *  block of a linked scene program to its binding point.  A
+ *  program built without the block is left untouched.
+ ***********************************************************/
+void GpuCulling::BindProgramBlocks(GLuint program)
+{
+	if ((0 == program) || !IsSupported())
+	{
+		return;
+	}
+
+	GLuint drawBuffer = glGetProgramResourceIndex(program, GL_SHADER_STORAGE_BLOCK, g_DrawBufferName);
+	if (GL_INVALID_INDEX != drawBuffer)
+	{
+		glShaderStorageBlockBinding(program, drawBuffer, DRAW_BUFFER_BINDING);
+	}
+}
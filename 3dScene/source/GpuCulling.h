@@ -0,0 +1,201 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculling.h
+// ============
+// cull the objects of the scene in a compute shader against the frustum
+// and a Hi-Z pyramid, and draw the visible ones with indirect draws
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderCache.h"
+#include "FrameRingBuffer.h"
+
+#include <GL/glew.h>
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  GpuCulling
+ *
+ *  This class keeps the opaque basic mesh draws of the scene on
+ *  the GPU.  Their bounding spheres and draw settings are
+ *  uploaded once, and every frame a compute shader tests each
+ *  object against the frustum and against a Hi-Z pyramid of the
+ *  previous frame's depth.  The visible objects append their
+ *  indirect draw commands through an atomic count per batch,
+ *  and each batch - the objects that share a program, texture
+ *  and material - is drawn with one
+ *  glMultiDrawElementsIndirectCount() call.  The CPU work of a
+ *  frame is one dispatch and one draw per batch, however many
+ *  objects the scene holds.
+ *
+ *  The basic meshes are packed into one vertex and index buffer
+ *  so a single vertex array serves every draw.  The base
+ *  instance of a draw is the index of its object, which an
+ *  instanced attribute passes to the shaders to read the object
+ *  settings from a storage buffer.
+ *
+ *  The pyramid is built after the scene is drawn and tested in
+ *  the next frame with the camera it was built with, so an
+ *  object that was hidden by the previous frame's depth can
+ *  appear one frame late while the camera moves.  Without
+ *  GL_ARB_indirect_parameters every object keeps its own
+ *  command and the hidden ones draw no instance.
+ ***********************************************************/
+class GpuCulling
+{
+public:
+	// storage buffer binding points of the culling pass, they
+	// match the layout qualifiers of the compute shader
+	static const GLuint OBJECT_BUFFER_BINDING = 0;
+	static const GLuint MESH_BUFFER_BINDING = 1;
+	static const GLuint BATCH_BUFFER_BINDING = 2;
+	static const GLuint COMMAND_BUFFER_BINDING = 3;
+	static const GLuint COUNT_BUFFER_BINDING = 4;
+	// storage buffer binding point of the object settings in the
+	// scene programs
+	static const GLuint DRAW_BUFFER_BINDING = 5;
+	// vertex attribute that carries the index of the object
+	static const GLuint DRAW_INDEX_ATTRIBUTE = 3;
+	// texture unit of the pyramid, above the lightmap unit
+	static const GLuint HIZ_TEXTURE_UNIT = 25;
+
+	// std430 layout of one object of the culling pass
+	struct GPU_OBJECT
+	{
+		// bounding sphere in world space, the radius in w
+		glm::vec4 sphere;
+		// basic mesh the object is drawn with
+		GLuint mesh;
+		// batch the object belongs to
+		GLuint batch;
+		GLuint padding[2];
+	};
+
+	// constructor
+	GpuCulling();
+	// destructor
+	~GpuCulling();
+
+	// true when the driver has compute shaders, storage buffers
+	// and indirect draws
+	static bool IsSupported();
+
+	// build the culling and the pyramid programs and upload the
+	// basic meshes into the mesh pool
+	bool LoadShaders(
+		ShaderCache* pShaderCache,
+		const char* cullComputeShaderPath,
+		const char* hiZComputeShaderPath);
+	// true once the programs and the mesh pool were created
+	bool IsReady() const;
+
+	// upload the objects and their draw settings, the objects of
+	// a batch must be consecutive and the batches in order
+	bool SetObjects(
+		const std::vector<GPU_OBJECT>& objects,
+		const std::vector<FrameRingBuffer::DRAW_DATA>& draws,
+		int batchCount);
+	int GetObjectCount() const { return(m_objectCount); }
+	int GetBatchCount() const { return((int)m_batchFirstCommands.size()); }
+
+	// set the framebuffer the objects are drawn into and its
+	// size, its depth is copied into the pyramid
+	void SetTarget(GLuint framebuffer, int width, int height);
+
+	// test every object and write the draws of the visible ones
+	void Cull();
+	// bind the mesh pool and the buffers the draws read
+	void BeginDraws();
+	// draw the visible objects of a batch with the bound program
+	void DrawBatch(int batch);
+	// build the pyramid from the depth of the target, for the
+	// culling of the next frame
+	void BuildHiZ(const glm::mat4& viewProjection);
+
+	// objects found visible a few frames ago
+	int GetVisibleCount() const { return(m_visibleCount); }
+
+	// attach the object settings of a linked scene program to
+	// their binding point
+	static void BindProgramBlocks(GLuint program);
+
+private:
+	// number of frames in flight before a visible count is read
+	static const int READBACK_LATENCY = 4;
+
+	// range of a basic mesh in the mesh pool, std430 layout
+	struct MESH_RANGE
+	{
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint padding;
+	};
+
+	// programs of the culling and of the pyramid levels
+	ShaderManager* m_pCullShader;
+	ShaderManager* m_pHiZShader;
+	// true when the draw count is read from a buffer
+	bool m_bDrawCount;
+
+	// vertices, indices and ranges of the basic meshes
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	GLuint m_meshBuffer;
+	GLuint m_vertexArray;
+
+	// objects, their settings, commands and counts
+	GLuint m_objectBuffer;
+	GLuint m_drawBuffer;
+	GLuint m_batchBuffer;
+	GLuint m_commandBuffer;
+	GLuint m_countBuffer;
+	// object index of every instance, read from the base instance
+	GLuint m_drawIndexBuffer;
+	int m_objectCount;
+	// first command and number of objects of every batch
+	std::vector<GLuint> m_batchFirstCommands;
+	std::vector<int> m_batchSizes;
+
+	// copy of the target depth, the pyramid and the camera the
+	// pyramid was built with
+	GLuint m_depthFBO;
+	GLuint m_depthTexture;
+	GLenum m_depthFormat;
+	GLuint m_hiZTexture;
+	int m_hiZWidth;
+	int m_hiZHeight;
+	int m_hiZLevels;
+	bool m_bHiZValid;
+	glm::mat4 m_hiZViewProjection;
+
+	// framebuffer the objects are drawn into and its size
+	GLuint m_targetFramebuffer;
+	int m_targetWidth;
+	int m_targetHeight;
+	GLuint m_queriedFramebuffer;
+	GLenum m_targetDepthFormat;
+
+	// copies of the visible count and the fences that tell when
+	// they can be read
+	GLuint m_readbackBuffer;
+	GLsync m_readbackFences[READBACK_LATENCY];
+	int m_currentReadback;
+	int m_visibleCount;
+
+	// pack the basic meshes into the mesh pool
+	bool CreateMeshPool();
+	// free the buffers of the objects
+	void DestroyObjectBuffers();
+	// allocate the depth copy and the pyramid for the target size
+	bool CreateHiZ(int width, int height, GLenum depthFormat);
+	// free the depth copy and the pyramid
+	void DestroyHiZ();
+	// read a visible count once its copy has arrived
+	void ResolveReadback(int readback);
+};
@@ -0,0 +1,408 @@
+///////////////////////////////////////////////////////////////////////////////
+// hotreload.cpp
+// ============
+// reload the textures, shaders and materials of the running scene when
+// their files change on disk
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HotReload.h"
+#include "ShaderPermutations.h"
+#include "DeferredRenderer.h"
+#include "LightmapBaker.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// how long the watch thread waits before it checks the stop
+	// flag again, in milliseconds
+	const int WATCH_TIMEOUT = 100;
+}
+
+/***********************************************************
+ *  HotReload()
+ *
+ *  The constructor for the class.  The deferred renderer and
+ *  the lightmap baker are optional and may be NULL.
+ ***********************************************************/
+HotReload::HotReload(
+	SceneManager* pSceneManager,
+	ShaderPermutations* pShaderPermutations,
+	DeferredRenderer* pDeferredRenderer,
+	LightmapBaker* pLightmapBaker)
+{
+	m_pSceneManager = pSceneManager;
+	m_pShaderPermutations = pShaderPermutations;
+	m_pDeferredRenderer = pDeferredRenderer;
+	m_pLightmapBaker = pLightmapBaker;
+	m_bStop = false;
+	m_reloadCount = 0;
+	m_shaderChangeTime = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  ~HotReload()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+HotReload::~HotReload()
+{
+	Stop();
+}
+
+/***********************************************************
+ *  SetChangeCallback()
+ *
+ *  This method is used for setting the function that is
+ *  called after a change was queued.  It runs on the watch
+ *  thread.
+ ***********************************************************/
+void HotReload::SetChangeCallback(std::function<void()> callback)
+{
+	m_changeCallback = callback;
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for collecting the files the scene was
+ *  built from and starting the watch thread.  It is called on
+ *  the main thread once the scene is prepared, before the
+ *  render thread starts.  The watch thread opens the watches
+ *  itself, as it is the one that waits on them.  The material
+ *  file is optional, when it exists its materials are applied
+ *  right away, so the file, the scene and the lightmap baked
+ *  during the startup agree from the first frame.
+ ***********************************************************/
+bool HotReload::Start(const char* materialFile)
+{
+	Stop();
+
+	m_pSceneManager->GetTextureFiles(m_textureFiles);
+	m_shaderFiles.clear();
+	if (NULL != m_pShaderPermutations)
+	{
+		m_pShaderPermutations->GetShaderFiles(m_shaderFiles);
+	}
+	if (NULL != m_pDeferredRenderer)
+	{
+		std::vector<std::string> deferredFiles;
+		m_pDeferredRenderer->GetShaderFiles(deferredFiles);
+		m_shaderFiles.insert(m_shaderFiles.end(), deferredFiles.begin(), deferredFiles.end());
+	}
+	m_materialFile = (NULL != materialFile) ? materialFile : "";
+
+	for (size_t i = 0; i < m_textureFiles.size(); i++)
+	{
+		if (!m_textureFiles[i].empty())
+		{
+			m_watcher.AddFile(m_textureFiles[i]);
+		}
+	}
+	for (size_t i = 0; i < m_shaderFiles.size(); i++)
+	{
+		if (!m_shaderFiles[i].empty())
+		{
+			m_watcher.AddFile(m_shaderFiles[i]);
+		}
+	}
+	if (!m_materialFile.empty())
+	{
+		m_watcher.AddFile(m_materialFile);
+		std::error_code error;
+		if (std::filesystem::exists(m_materialFile, error))
+		{
+			PrepareReload(m_materialFile);
+		}
+	}
+
+	m_bStop = false;
+	m_thread = std::thread(&HotReload::WatchMain, this);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the watch thread.  The
+ *  changes it queued and that were not applied are dropped.
+ ***********************************************************/
+void HotReload::Stop()
+{
+	if (m_thread.joinable())
+	{
+		m_bStop = true;
+		m_thread.join();
+	}
+	ClearPending();
+}
+
+/***********************************************************
+ *  WatchMain()
+ *
+ *  This method is the body of the watch thread.  It opens the
+ *  watches, waits for changed files and prepares their reload,
+ *  and closes the watches again when it is stopped.
+ ***********************************************************/
+void HotReload::WatchMain()
+{
+	m_watcher.Open();
+	std::cout << "Hot reload watching " << m_textureFiles.size() << " textures and "
+		<< m_shaderFiles.size() << " shader files"
+		<< (m_watcher.IsUsingNotifications() ? "" : " by polling") << std::endl;
+
+	std::vector<std::string> changedFiles;
+	while (!m_bStop)
+	{
+		if (!m_watcher.WaitForChanges(changedFiles, WATCH_TIMEOUT))
+		{
+			continue;
+		}
+
+		for (size_t i = 0; i < changedFiles.size(); i++)
+		{
+			PrepareReload(changedFiles[i]);
+		}
+		if (m_changeCallback)
+		{
+			m_changeCallback();
+		}
+	}
+
+	m_watcher.Close();
+}
+
+/***********************************************************
+ *  PrepareReload()
+ *
+ *  This method is used for doing the part of a reload that
+ *  does not need OpenGL: a changed image is decoded and the
+ *  material file is read.  A file that can not be read is
+ *  reported and dropped, the scene keeps the last version.
+ ***********************************************************/
+void HotReload::PrepareReload(const std::string& filename)
+{
+	PENDING_RELOAD reload;
+	reload.filename = filename;
+	reload.textureSlot = -1;
+	reload.decode.pixels = NULL;
+	reload.changeTime = std::chrono::steady_clock::now();
+
+	if (filename == m_materialFile)
+	{
+		reload.type = RELOAD_MATERIALS;
+		if (!SceneManager::ReadMaterialFile(filename.c_str(), reload.materials))
+		{
+			std::cout << "Could not reload materials from " << filename << std::endl;
+			return;
+		}
+	}
+	else if (std::find(m_shaderFiles.begin(), m_shaderFiles.end(), filename) != m_shaderFiles.end())
+	{
+		reload.type = RELOAD_SHADER;
+	}
+	else
+	{
+		std::vector<std::string>::const_iterator it =
+			std::find(m_textureFiles.begin(), m_textureFiles.end(), filename);
+		if (it == m_textureFiles.end())
+		{
+			return;
+		}
+		reload.type = RELOAD_TEXTURE;
+		reload.textureSlot = (int)(it - m_textureFiles.begin());
+		reload.decode.filename = filename;
+		if (!SceneManager::DecodeTexture(reload.decode))
+		{
+			std::cout << "Could not reload image " << filename << std::endl;
+			return;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_pending.push_back(reload);
+}
+
+/***********************************************************
+ *  ClearPending()
+ *
+ *  This method is used for dropping the queued changes.
+ ***********************************************************/
+void HotReload::ClearPending()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (size_t i = 0; i < m_pending.size(); i++)
+	{
+		SceneManager::FreeTextureDecode(m_pending[i].decode);
+	}
+	m_pending.clear();
+}
+
+/***********************************************************
+ *  ApplyPending()
+ *
+ *  This method is used for swapping the prepared changes into
+ *  the scene.  It runs on the render thread between frames,
+ *  after the shader cache collected the finished compiles, so
+ *  a frame always draws with one consistent set of resources.
+ ***********************************************************/
+bool HotReload::ApplyPending()
+{
+	std::vector<PENDING_RELOAD> pending;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		pending.swap(m_pending);
+	}
+
+	bool bChanged = false;
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		PENDING_RELOAD& reload = pending[i];
+		switch (reload.type)
+		{
+		case RELOAD_TEXTURE:
+			if (m_pSceneManager->ReloadTexture(reload.textureSlot, reload.decode))
+			{
+				ReportReload(reload.filename, reload.changeTime);
+				bChanged = true;
+			}
+			break;
+		case RELOAD_MATERIALS:
+		{
+			// the baked surfaces keep the old materials until the
+			// lightmap is baked again on its own thread
+			bool bRebake = (NULL != m_pLightmapBaker) &&
+				(m_pLightmapBaker->IsReady() || m_pLightmapBaker->IsBaking()) &&
+				ChangesLightmap(reload.materials);
+			m_pSceneManager->UpdateObjectMaterials(reload.materials);
+			if (NULL != m_pDeferredRenderer)
+			{
+				m_pDeferredRenderer->SetSceneMaterials(m_pSceneManager->GetObjectMaterials());
+			}
+			if (bRebake)
+			{
+				m_pLightmapBaker->StartBake(
+					m_pSceneManager->GetDrawList(),
+					m_pSceneManager->GetObjectMaterials(),
+					m_pSceneManager->GetLightSources(),
+					(int)std::thread::hardware_concurrency(),
+					true);
+			}
+			ReportReload(reload.filename, reload.changeTime);
+			bChanged = true;
+			break;
+		}
+		case RELOAD_SHADER:
+		{
+			bool bQueued = false;
+			if (NULL != m_pShaderPermutations)
+			{
+				bQueued = m_pShaderPermutations->ReloadShaders(reload.filename);
+			}
+			if (NULL != m_pDeferredRenderer)
+			{
+				bQueued = m_pDeferredRenderer->ReloadShaders(reload.filename) || bQueued;
+			}
+			if (bQueued)
+			{
+				if (m_rebuildingShaders.empty())
+				{
+					m_shaderChangeTime = reload.changeTime;
+				}
+				if (std::find(m_rebuildingShaders.begin(), m_rebuildingShaders.end(),
+					reload.filename) == m_rebuildingShaders.end())
+				{
+					m_rebuildingShaders.push_back(reload.filename);
+				}
+			}
+			break;
+		}
+		}
+	}
+
+	// the rebuilt programs are swapped in once they are ready,
+	// which can take a few frames
+	bool bProgramChanged = false;
+	if ((NULL != m_pShaderPermutations) && m_pShaderPermutations->UpdateReloads())
+	{
+		// the generic program lost the lights set by the scene
+		m_pSceneManager->UploadSceneLights();
+		bProgramChanged = true;
+	}
+	if ((NULL != m_pDeferredRenderer) && m_pDeferredRenderer->UpdateReloads())
+	{
+		bProgramChanged = true;
+	}
+	if (bProgramChanged && !m_rebuildingShaders.empty())
+	{
+		for (size_t i = 0; i < m_rebuildingShaders.size(); i++)
+		{
+			ReportReload(m_rebuildingShaders[i], m_shaderChangeTime);
+		}
+		m_rebuildingShaders.clear();
+	}
+	if (bProgramChanged)
+	{
+		m_pSceneManager->MarkDirty();
+		bChanged = true;
+	}
+
+	return(bChanged);
+}
+
+/***********************************************************
+ *  ChangesLightmap()
+ *
+ *  This method is used for finding out whether reloaded
+ *  materials change the baked lighting, which holds the
+ *  ambient and diffuse factors of the materials used by the
+ *  static surfaces of the recorded draw list.  It is called
+ *  before the materials replace the ones of the scene.
+ ***********************************************************/
+bool HotReload::ChangesLightmap(const std::vector<SceneManager::OBJECT_MATERIAL>& materials) const
+{
+	const std::vector<SceneManager::DRAW_COMMAND>& draws = m_pSceneManager->GetDrawList();
+	const std::vector<SceneManager::OBJECT_MATERIAL>& current = m_pSceneManager->GetObjectMaterials();
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		int index = draws[i].materialIndex;
+		if ((draws[i].lightmapSurface < 0) || (index < 0) || (index >= (int)current.size()))
+		{
+			continue;
+		}
+
+		const SceneManager::OBJECT_MATERIAL& material = current[index];
+		for (size_t j = 0; j < materials.size(); j++)
+		{
+			if ((materials[j].tag == material.tag) &&
+				((materials[j].ambientColor * materials[j].ambientStrength !=
+					material.ambientColor * material.ambientStrength) ||
+				(materials[j].diffuseColor != material.diffuseColor)))
+			{
+				return(true);
+			}
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  ReportReload()
+ *
+ *  This method is used for printing a reloaded file with the
+ *  time from the change on disk to its swap into the scene.
+ ***********************************************************/
+void HotReload::ReportReload(
+	const std::string& filename,
+	std::chrono::steady_clock::time_point changeTime)
+{
+	double elapsed = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - changeTime).count();
+	std::cout << "Reloaded " << filename << " in " << elapsed << " ms" << std::endl;
+	m_reloadCount++;
+}
@@ -0,0 +1,132 @@
+///////////////////////////////////////////////////////////////////////////////
+// hotreload.h
+// ============
+// reload the textures, shaders and materials of the running scene when
+// their files change on disk
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FileWatcher.h"
+#include "SceneManager.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ShaderPermutations;
+class DeferredRenderer;
+class LightmapBaker;
+
+/***********************************************************
+ *  HotReload
+ *
+ *  This class watches the files the scene was built from and
+ *  reloads only what changed.  A thread of its own waits for
+ *  the changes and does the work that does not need OpenGL:
+ *  it decodes a changed image or reads the material file.  The
+ *  results are queued, and ApplyPending(), called by the
+ *  render thread between two frames, swaps them in:
+ *
+ *    - a texture is uploaded into the slot of the old one
+ *    - the materials replace the ones with the same tag, and
+ *      the lightmap is baked again when they change the baked
+ *      surfaces, which use the Phong loop until it is ready
+ *    - a GLSL file queues a background rebuild of the programs
+ *      that use it, the old programs draw until it is ready
+ *
+ *  Nothing that still draws is freed before its replacement
+ *  exists, so a file with an error leaves the last working
+ *  version on screen.
+ ***********************************************************/
+class HotReload
+{
+public:
+	// constructor
+	HotReload(
+		SceneManager* pSceneManager,
+		ShaderPermutations* pShaderPermutations,
+		DeferredRenderer* pDeferredRenderer,
+		LightmapBaker* pLightmapBaker);
+	// destructor
+	~HotReload();
+
+	// called from the watch thread after a change was queued,
+	// so a sleeping render thread wakes up for it
+	void SetChangeCallback(std::function<void()> callback);
+
+	// start watching the scene files and the material file
+	bool Start(const char* materialFile);
+	// stop watching and drop the queued changes
+	void Stop();
+
+	// swap in the queued changes and the rebuilt programs, called
+	// on the render thread between frames, returns true when the
+	// scene looks different
+	bool ApplyPending();
+
+	// number of files reloaded since the start
+	unsigned int GetReloadCount() const { return(m_reloadCount); }
+
+private:
+	// kind of a changed file
+	enum RELOAD_TYPE
+	{
+		RELOAD_TEXTURE,
+		RELOAD_MATERIALS,
+		RELOAD_SHADER
+	};
+
+	// a change prepared by the watch thread
+	struct PENDING_RELOAD
+	{
+		RELOAD_TYPE type;
+		std::string filename;
+		int textureSlot;
+		SceneManager::TEXTURE_DECODE decode;
+		std::vector<SceneManager::OBJECT_MATERIAL> materials;
+		std::chrono::steady_clock::time_point changeTime;
+	};
+
+	SceneManager* m_pSceneManager;
+	ShaderPermutations* m_pShaderPermutations;
+	DeferredRenderer* m_pDeferredRenderer;
+	LightmapBaker* m_pLightmapBaker;
+
+	FileWatcher m_watcher;
+	std::thread m_thread;
+	std::atomic<bool> m_bStop;
+	std::function<void()> m_changeCallback;
+
+	// watched files, the texture files in slot order
+	std::vector<std::string> m_textureFiles;
+	std::vector<std::string> m_shaderFiles;
+	std::string m_materialFile;
+
+	// changes waiting for the render thread
+	std::mutex m_mutex;
+	std::vector<PENDING_RELOAD> m_pending;
+
+	// shader files whose rebuilt programs are not swapped in yet,
+	// with the time of their change
+	std::vector<std::string> m_rebuildingShaders;
+	std::chrono::steady_clock::time_point m_shaderChangeTime;
+	unsigned int m_reloadCount;
+
+	// body of the watch thread
+	void WatchMain();
+	// prepare the reload of one changed file on the watch thread
+	void PrepareReload(const std::string& filename);
+	// drop the queued changes and free their decoded images
+	void ClearPending();
+	// true when reloaded materials change the baked lighting
+	bool ChangesLightmap(const std::vector<SceneManager::OBJECT_MATERIAL>& materials) const;
+	// print how long a change took to reach the screen
+	void ReportReload(
+		const std::string& filename,
+		std::chrono::steady_clock::time_point changeTime);
+};
@@ -0,0 +1,755 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.cpp
+// ============
+// bake the lighting of the static surfaces into a lightmap atlas on
+// every core, so they are shaded with one texture read
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightmapBaker.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// width of the atlas in texels
+	const int ATLAS_WIDTH = 1024;
+	// texels per world unit along the sides of a face, and the
+	// limits of a cell
+	const float TEXEL_DENSITY = 4.0f;
+	const int MIN_CELL_SIZE = 4;
+	const int MAX_CELL_SIZE = 128;
+	// the cells of a box: one column per axis, the face on the
+	// positive side in the first row
+	const int CELL_COLUMNS = 3;
+	const int CELL_ROWS = 2;
+	// rays per texel for the occlusion and the bounce
+	const int HEMISPHERE_SAMPLE_COUNT = 32;
+	// surfaces closer than this darken the ambient light
+	const float OCCLUSION_DISTANCE = 2.0f;
+	// longest ray of the bounce
+	const float BOUNCE_DISTANCE = 50.0f;
+	// distance the rays start off the surface
+	const float RAY_OFFSET = 0.01f;
+	// rows of the atlas a worker bakes at a time
+	const int ROWS_PER_JOB = 8;
+	// color of the textured surfaces for the bounce, the images
+	// are only in memory without an OpenGL context
+	const glm::vec3 TEXTURED_ALBEDO = glm::vec3(0.5f);
+	const float PI = 3.14159265f;
+
+	/***********************************************************
+	 *  RunRows()
+	 *
+	 *  Split the rows of the atlas into small jobs that the
+	 *  threads take one after another, so a thread that drew the
+	 *  empty rows helps with the others.
+	 ***********************************************************/
+	void RunRows(int threadCount, int rowCount, const std::function<void(int, int)>& work)
+	{
+		std::atomic<int> nextRow(0);
+		auto worker = [&]()
+		{
+			for (;;)
+			{
+				int first = nextRow.fetch_add(ROWS_PER_JOB);
+				if (first >= rowCount)
+				{
+					return;
+				}
+				work(first, glm::min(first + ROWS_PER_JOB, rowCount));
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.push_back(std::thread(worker));
+		}
+		worker();
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			threads[i].join();
+		}
+	}
+
+	/***********************************************************
+	 *  RadicalInverse()
+	 *
+	 *  Mirror the bits of a number behind the binary point, the
+	 *  second coordinate of the Hammersley points.
+	 ***********************************************************/
+	float RadicalInverse(unsigned int bits)
+	{
+		bits = (bits << 16u) | (bits >> 16u);
+		bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+		bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+		bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+		bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+		return((float)bits * 2.3283064365386963e-10f);
+	}
+
+	/***********************************************************
+	 *  HashTexel()
+	 *
+	 *  Turn a texel position into a number in [0, 1), which
+	 *  turns the ray pattern of each texel differently, so the
+	 *  few rays show up as noise rather than as bands.
+	 ***********************************************************/
+	float HashTexel(int x, int y)
+	{
+		unsigned int hash = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u;
+		hash = (hash ^ (hash >> 13u)) * 0x5bd1e995u;
+		hash ^= hash >> 15u;
+		return((float)(hash & 0xFFFFFFu) / 16777216.0f);
+	}
+
+	/***********************************************************
+	 *  GetHemisphereDirection()
+	 *
+	 *  Get a ray direction of the cosine weighted hemisphere
+	 *  around a normal, so the average of the rays is the
+	 *  irradiance without weighting each ray.
+	 ***********************************************************/
+	glm::vec3 GetHemisphereDirection(const glm::vec3& normal, int sample, float rotation)
+	{
+		float u = ((float)sample + 0.5f) / (float)HEMISPHERE_SAMPLE_COUNT;
+		float v = RadicalInverse((unsigned int)sample) + rotation;
+		float radius = sqrt(u);
+		float angle = 2.0f * PI * v;
+		glm::vec3 local(radius * cos(angle), radius * sin(angle), sqrt(glm::max(0.0f, 1.0f - u)));
+
+		glm::vec3 helper = (fabs(normal.x) < 0.9f) ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 tangent = glm::normalize(glm::cross(helper, normal));
+		glm::vec3 bitangent = glm::cross(normal, tangent);
+		return(tangent * local.x + bitangent * local.y + normal * local.z);
+	}
+}
+
+/***********************************************************
+ *  LightmapBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightmapBaker::LightmapBaker()
+{
+	m_width = 0;
+	m_height = 0;
+	m_texture = 0;
+	m_bakeTime = 0.0;
+	m_bBakeDone = false;
+	m_bBakeSucceeded = false;
+	m_bBaking = false;
+	m_bBakeStarted = false;
+	m_bBakeQueued = false;
+	m_queuedThreadCount = 1;
+	m_bQueuedIndirect = false;
+}
+
+/***********************************************************
+ *  ~LightmapBaker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightmapBaker::~LightmapBaker()
+{
+	if (m_bakeThread.joinable())
+	{
+		m_bakeThread.join();
+	}
+	if (0 != m_texture)
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_texture);
+		GLStateCache::DeleteTextures(1, &m_texture);
+		m_texture = 0;
+	}
+	if (!m_texels.empty())
+	{
+		ResourceRegistry::ReleaseHost(m_texels.data());
+	}
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for baking the lighting of the static
+ *  boxes in a recorded draw list.  The direct lighting of
+ *  every texel is baked first, because the bounce reads it
+ *  where its rays hit, and each pass splits the rows of the
+ *  atlas between the threads.
+ ***********************************************************/
+bool LightmapBaker::Bake(
+	const std::vector<SceneManager::DRAW_COMMAND>& draws,
+	const std::vector<SceneManager::OBJECT_MATERIAL>& materials,
+	const std::vector<SceneManager::LIGHT_SOURCE>& lights,
+	int threadCount,
+	bool bIndirect)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	if (!m_texels.empty())
+	{
+		ResourceRegistry::ReleaseHost(m_texels.data());
+	}
+	m_surfaces.clear();
+	m_lights = lights;
+
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		const SceneManager::DRAW_COMMAND& draw = draws[i];
+		if (draw.lightmapSurface < 0)
+		{
+			continue;
+		}
+		if (draw.lightmapSurface >= (int)m_surfaces.size())
+		{
+			m_surfaces.resize(draw.lightmapSurface + 1);
+		}
+
+		LIGHTMAP_SURFACE& surface = m_surfaces[draw.lightmapSurface];
+		surface.model = draw.model;
+		surface.inverseModel = glm::inverse(draw.model);
+		surface.normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.model)));
+		surface.ambient = glm::vec3(0.0f);
+		surface.diffuse = glm::vec3(1.0f);
+		if ((draw.materialIndex >= 0) && (draw.materialIndex < (int)materials.size()))
+		{
+			const SceneManager::OBJECT_MATERIAL& material = materials[draw.materialIndex];
+			surface.ambient = material.ambientColor * material.ambientStrength;
+			surface.diffuse = material.diffuseColor;
+		}
+		surface.albedo = draw.bUseTexture ? TEXTURED_ALBEDO : glm::vec3(draw.color);
+
+		// a cell is as wide and as high as the largest face of
+		// the box, measured in world units
+		glm::vec3 extent(
+			glm::length(glm::vec3(draw.model[0])),
+			glm::length(glm::vec3(draw.model[1])),
+			glm::length(glm::vec3(draw.model[2])));
+		surface.cellWidth = glm::clamp((int)ceil(glm::max(extent.z, extent.x) * TEXEL_DENSITY), MIN_CELL_SIZE, MAX_CELL_SIZE);
+		surface.cellHeight = glm::clamp((int)ceil(glm::max(extent.y, extent.z) * TEXEL_DENSITY), MIN_CELL_SIZE, MAX_CELL_SIZE);
+	}
+	if (m_surfaces.empty())
+	{
+		std::cout << "No static surfaces to bake into the lightmap" << std::endl;
+		return(false);
+	}
+
+	PackSurfaces();
+	m_direct.assign((size_t)m_width * m_height, glm::vec3(0.0f));
+	m_texels.assign((size_t)m_width * m_height, glm::vec3(0.0f));
+
+	threadCount = glm::max(threadCount, 1);
+	RunRows(threadCount, m_height, [this](int first, int last) { BakeDirect(first, last); });
+	RunRows(threadCount, m_height, [this, bIndirect](int first, int last) { BakeIndirect(first, last, bIndirect); });
+	FillBorders();
+
+	std::vector<glm::vec3>().swap(m_direct);
+	ResourceRegistry::TrackHost(m_texels.data(), m_texels.size() * sizeof(glm::vec3), "lightmap texels");
+
+	m_bakeTime = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+	std::cout << "Baked the lightmap of " << m_surfaces.size() << " static surfaces into "
+		<< m_width << "x" << m_height << " texels on " << threadCount << " threads in "
+		<< (int)m_bakeTime << " ms" << (bIndirect ? " with one bounce" : "") << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StartBake()
+ *
+ *  This method is used for baking the lightmap while the
+ *  scene keeps drawing.  The draws, materials and lights are
+ *  copied, so the caller can change them, and the surfaces
+ *  fall back to the Phong loop until the new atlas is
+ *  uploaded.  A bake started while another one runs waits
+ *  for it with the latest copies.
+ ***********************************************************/
+void LightmapBaker::StartBake(
+	const std::vector<SceneManager::DRAW_COMMAND>& draws,
+	const std::vector<SceneManager::OBJECT_MATERIAL>& materials,
+	const std::vector<SceneManager::LIGHT_SOURCE>& lights,
+	int threadCount,
+	bool bIndirect)
+{
+	m_queuedDraws = draws;
+	m_queuedMaterials = materials;
+	m_queuedLights = lights;
+	m_queuedThreadCount = threadCount;
+	m_bQueuedIndirect = bIndirect;
+	m_bBakeQueued = true;
+	m_bBaking = true;
+	m_bBakeStarted = true;
+
+	if (!m_bakeThread.joinable())
+	{
+		LaunchBake();
+	}
+}
+
+/***********************************************************
+ *  LaunchBake()
+ *
+ *  This method is used for starting the bake thread on the
+ *  queued copies.  The thread only touches the copies and
+ *  the texels, which the render thread does not read while
+ *  the lightmap is not ready.
+ ***********************************************************/
+void LightmapBaker::LaunchBake()
+{
+	m_bakeDraws.swap(m_queuedDraws);
+	m_bakeMaterials.swap(m_queuedMaterials);
+	m_bakeLights.swap(m_queuedLights);
+	int threadCount = m_queuedThreadCount;
+	bool bIndirect = m_bQueuedIndirect;
+	m_bBakeQueued = false;
+	m_bBakeDone = false;
+
+	m_bakeThread = std::thread([this, threadCount, bIndirect]()
+		{
+			m_bBakeSucceeded = Bake(m_bakeDraws, m_bakeMaterials, m_bakeLights, threadCount, bIndirect);
+			m_bBakeDone = true;
+		});
+}
+
+/***********************************************************
+ *  FinishBake()
+ *
+ *  This method is used for collecting a finished bake on the
+ *  thread that owns the context.  The atlas is uploaded when
+ *  no newer bake was queued meanwhile, otherwise that bake
+ *  starts and the lightmap stays off.
+ ***********************************************************/
+bool LightmapBaker::FinishBake()
+{
+	if (!m_bakeThread.joinable() || !m_bBakeDone)
+	{
+		return(false);
+	}
+	m_bakeThread.join();
+
+	if (m_bBakeQueued)
+	{
+		LaunchBake();
+		return(false);
+	}
+
+	m_bBaking = false;
+	return(m_bBakeSucceeded && Upload());
+}
+
+/***********************************************************
+ *  PackSurfaces()
+ *
+ *  This method is used for placing the cells of the surfaces
+ *  in rows of the atlas, the tallest first.  Every cell has a
+ *  border of one texel, which keeps the filtering of its edge
+ *  from reading the cell next to it.
+ ***********************************************************/
+void LightmapBaker::PackSurfaces()
+{
+	std::vector<int> order(m_surfaces.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = (int)i;
+	}
+	std::sort(order.begin(), order.end(), [this](int a, int b)
+		{
+			return(m_surfaces[a].cellHeight > m_surfaces[b].cellHeight);
+		});
+
+	int x = 0;
+	int y = 0;
+	int rowHeight = 0;
+	m_width = ATLAS_WIDTH;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		LIGHTMAP_SURFACE& surface = m_surfaces[order[i]];
+		int width = CELL_COLUMNS * (surface.cellWidth + 2);
+		int height = CELL_ROWS * (surface.cellHeight + 2);
+		if (x + width > m_width)
+		{
+			x = 0;
+			y += rowHeight;
+			rowHeight = 0;
+		}
+		surface.x = x;
+		surface.y = y;
+		x += width;
+		rowHeight = glm::max(rowHeight, height);
+	}
+	m_height = ((y + rowHeight + 3) / 4) * 4;
+}
+
+/***********************************************************
+ *  GetTexelPoint()
+ *
+ *  This method is used for finding the point of a box that a
+ *  texel of its cells stands for.  A cell covers one face of
+ *  the unit box, the texel centers are spread evenly over it.
+ ***********************************************************/
+bool LightmapBaker::GetTexelPoint(int surface, int x, int y, glm::vec3& position, glm::vec3& normal) const
+{
+	const LIGHTMAP_SURFACE& box = m_surfaces[surface];
+	int localX = x - box.x;
+	int localY = y - box.y;
+	int column = localX / (box.cellWidth + 2);
+	int row = localY / (box.cellHeight + 2);
+	int cellX = localX % (box.cellWidth + 2) - 1;
+	int cellY = localY % (box.cellHeight + 2) - 1;
+	if ((column >= CELL_COLUMNS) || (row >= CELL_ROWS) ||
+		(cellX < 0) || (cellX >= box.cellWidth) || (cellY < 0) || (cellY >= box.cellHeight))
+	{
+		return(false);
+	}
+
+	// the same projection as the scene vertex shader: the X
+	// faces use z and y, the Y faces x and z, the Z faces x and y
+	float u = ((float)cellX + 0.5f) / (float)box.cellWidth - 0.5f;
+	float v = ((float)cellY + 0.5f) / (float)box.cellHeight - 0.5f;
+	float side = (row == 0) ? 0.5f : -0.5f;
+	glm::vec3 objectPosition;
+	glm::vec3 objectNormal(0.0f);
+	switch (column)
+	{
+	case 0:
+		objectPosition = glm::vec3(side, v, u);
+		break;
+	case 1:
+		objectPosition = glm::vec3(u, side, v);
+		break;
+	default:
+		objectPosition = glm::vec3(u, v, side);
+		break;
+	}
+	objectNormal[column] = (row == 0) ? 1.0f : -1.0f;
+
+	position = glm::vec3(box.model * glm::vec4(objectPosition, 1.0f));
+	normal = glm::normalize(box.normalMatrix * objectNormal);
+	return(true);
+}
+
+/***********************************************************
+ *  TraceRay()
+ *
+ *  This method is used for finding the nearest static box a
+ *  ray hits.  The ray is moved into the space of each box,
+ *  where the box is the unit cube, and tested against its
+ *  slabs.  The direction is not normalized in box space, so
+ *  the distance along the ray stays the world distance.
+ ***********************************************************/
+bool LightmapBaker::TraceRay(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float maxDistance,
+	float& distance,
+	int& surface) const
+{
+	distance = maxDistance;
+	surface = -1;
+
+	for (int i = 0; i < (int)m_surfaces.size(); i++)
+	{
+		const glm::mat4& inverseModel = m_surfaces[i].inverseModel;
+		glm::vec3 boxOrigin = glm::vec3(inverseModel * glm::vec4(origin, 1.0f));
+		glm::vec3 boxDirection = glm::vec3(inverseModel * glm::vec4(direction, 0.0f));
+
+		float nearest = 0.0f;
+		float farthest = distance;
+		bool bMissed = false;
+		for (int axis = 0; (axis < 3) && !bMissed; axis++)
+		{
+			if (fabs(boxDirection[axis]) < 1e-8f)
+			{
+				bMissed = (boxOrigin[axis] < -0.5f) || (boxOrigin[axis] > 0.5f);
+				continue;
+			}
+			float inverse = 1.0f / boxDirection[axis];
+			float t0 = (-0.5f - boxOrigin[axis]) * inverse;
+			float t1 = (0.5f - boxOrigin[axis]) * inverse;
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			nearest = glm::max(nearest, t0);
+			farthest = glm::min(farthest, t1);
+			bMissed = (nearest > farthest);
+		}
+
+		if (!bMissed && (nearest < distance))
+		{
+			distance = nearest;
+			surface = i;
+		}
+	}
+
+	return(surface >= 0);
+}
+
+/***********************************************************
+ *  GetHitRadiance()
+ *
+ *  This method is used for reading the light that leaves the
+ *  point of a box a bounce ray hit: the direct lighting of the
+ *  nearest texel, tinted by the color of the surface.
+ ***********************************************************/
+glm::vec3 LightmapBaker::GetHitRadiance(int surface, const glm::vec3& position) const
+{
+	const LIGHTMAP_SURFACE& box = m_surfaces[surface];
+	glm::vec3 point = glm::vec3(box.inverseModel * glm::vec4(position, 1.0f));
+	glm::vec3 size = glm::abs(point);
+
+	int column = 2;
+	if ((size.x >= size.y) && (size.x >= size.z))
+	{
+		column = 0;
+	}
+	else if (size.y >= size.z)
+	{
+		column = 1;
+	}
+	int row = (point[column] > 0.0f) ? 0 : 1;
+
+	glm::vec2 planar;
+	switch (column)
+	{
+	case 0:
+		planar = glm::vec2(point.z, point.y);
+		break;
+	case 1:
+		planar = glm::vec2(point.x, point.z);
+		break;
+	default:
+		planar = glm::vec2(point.x, point.y);
+		break;
+	}
+	int cellX = glm::clamp((int)((planar.x + 0.5f) * box.cellWidth), 0, box.cellWidth - 1);
+	int cellY = glm::clamp((int)((planar.y + 0.5f) * box.cellHeight), 0, box.cellHeight - 1);
+	int x = box.x + column * (box.cellWidth + 2) + 1 + cellX;
+	int y = box.y + row * (box.cellHeight + 2) + 1 + cellY;
+
+	return(m_direct[(size_t)y * m_width + x] * box.albedo);
+}
+
+/***********************************************************
+ *  BakeDirect()
+ *
+ *  This method is used for baking the diffuse light of every
+ *  light source that reaches the texels of a range of rows,
+ *  with a shadow ray towards each light.
+ ***********************************************************/
+void LightmapBaker::BakeDirect(int firstRow, int lastRow)
+{
+	for (int i = 0; i < (int)m_surfaces.size(); i++)
+	{
+		const LIGHTMAP_SURFACE& box = m_surfaces[i];
+		int top = glm::max(firstRow, box.y);
+		int bottom = glm::min(lastRow, box.y + CELL_ROWS * (box.cellHeight + 2));
+		for (int y = top; y < bottom; y++)
+		{
+			for (int x = box.x; x < box.x + CELL_COLUMNS * (box.cellWidth + 2); x++)
+			{
+				glm::vec3 position;
+				glm::vec3 normal;
+				if (!GetTexelPoint(i, x, y, position, normal))
+				{
+					continue;
+				}
+
+				glm::vec3 origin = position + normal * RAY_OFFSET;
+				glm::vec3 direct(0.0f);
+				for (size_t light = 0; light < m_lights.size(); light++)
+				{
+					glm::vec3 toLight = m_lights[light].position - position;
+					float lightDistance = glm::length(toLight);
+					glm::vec3 lightDirection = toLight / glm::max(lightDistance, 1e-6f);
+					float impact = glm::dot(normal, lightDirection);
+					float hitDistance = 0.0f;
+					int hitSurface = -1;
+					if ((impact <= 0.0f) ||
+						TraceRay(origin, lightDirection, lightDistance, hitDistance, hitSurface))
+					{
+						continue;
+					}
+					direct += impact * m_lights[light].diffuseColor * box.diffuse;
+				}
+				m_direct[(size_t)y * m_width + x] = direct;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BakeIndirect()
+ *
+ *  This method is used for finishing the texels of a range of
+ *  rows: the ambient light of the lights is scaled by the
+ *  share of short rays that escape, and the bounce adds the
+ *  light the rays pick up from the surfaces they hit.
+ ***********************************************************/
+void LightmapBaker::BakeIndirect(int firstRow, int lastRow, bool bIndirect)
+{
+	glm::vec3 ambientLight(0.0f);
+	for (size_t light = 0; light < m_lights.size(); light++)
+	{
+		ambientLight += m_lights[light].ambientColor;
+	}
+	float maxDistance = bIndirect ? BOUNCE_DISTANCE : OCCLUSION_DISTANCE;
+
+	for (int i = 0; i < (int)m_surfaces.size(); i++)
+	{
+		const LIGHTMAP_SURFACE& box = m_surfaces[i];
+		int top = glm::max(firstRow, box.y);
+		int bottom = glm::min(lastRow, box.y + CELL_ROWS * (box.cellHeight + 2));
+		for (int y = top; y < bottom; y++)
+		{
+			for (int x = box.x; x < box.x + CELL_COLUMNS * (box.cellWidth + 2); x++)
+			{
+				glm::vec3 position;
+				glm::vec3 normal;
+				if (!GetTexelPoint(i, x, y, position, normal))
+				{
+					continue;
+				}
+
+				glm::vec3 origin = position + normal * RAY_OFFSET;
+				float rotation = HashTexel(x, y);
+				int openCount = 0;
+				glm::vec3 bounce(0.0f);
+				for (int sample = 0; sample < HEMISPHERE_SAMPLE_COUNT; sample++)
+				{
+					glm::vec3 direction = GetHemisphereDirection(normal, sample, rotation);
+					float hitDistance = 0.0f;
+					int hitSurface = -1;
+					if (!TraceRay(origin, direction, maxDistance, hitDistance, hitSurface))
+					{
+						openCount++;
+						continue;
+					}
+					if (hitDistance >= OCCLUSION_DISTANCE)
+					{
+						openCount++;
+					}
+					if (bIndirect)
+					{
+						bounce += GetHitRadiance(hitSurface, origin + direction * hitDistance);
+					}
+				}
+
+				float occlusion = (float)openCount / (float)HEMISPHERE_SAMPLE_COUNT;
+				size_t texel = (size_t)y * m_width + x;
+				m_texels[texel] = ambientLight * box.ambient * occlusion +
+					m_direct[texel] +
+					bounce * box.diffuse / (float)HEMISPHERE_SAMPLE_COUNT;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  FillBorders()
+ *
+ *  This method is used for copying the nearest texel of each
+ *  cell into the border around it, so the filtering at the
+ *  edge of a face blends with its own lighting.
+ ***********************************************************/
+void LightmapBaker::FillBorders()
+{
+	for (size_t i = 0; i < m_surfaces.size(); i++)
+	{
+		const LIGHTMAP_SURFACE& box = m_surfaces[i];
+		for (int row = 0; row < CELL_ROWS; row++)
+		{
+			for (int column = 0; column < CELL_COLUMNS; column++)
+			{
+				int left = box.x + column * (box.cellWidth + 2);
+				int bottom = box.y + row * (box.cellHeight + 2);
+				for (int y = 0; y < box.cellHeight + 2; y++)
+				{
+					for (int x = 0; x < box.cellWidth + 2; x++)
+					{
+						if ((x > 0) && (x <= box.cellWidth) && (y > 0) && (y <= box.cellHeight))
+						{
+							continue;
+						}
+						int sourceX = glm::clamp(x, 1, box.cellWidth);
+						int sourceY = glm::clamp(y, 1, box.cellHeight);
+						m_texels[(size_t)(bottom + y) * m_width + left + x] =
+							m_texels[(size_t)(bottom + sourceY) * m_width + left + sourceX];
+					}
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for creating the atlas texture from
+ *  the baked texels.  The lighting can go above one, so it is
+ *  kept in half floats.
+ ***********************************************************/
+bool LightmapBaker::Upload()
+{
+	if (m_texels.empty())
+	{
+		return(false);
+	}
+
+	if (0 == m_texture)
+	{
+		glGenTextures(1, &m_texture);
+	}
+	else
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_texture);
+	}
+	GLStateCache::BindTextureForUpdate(m_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, m_width, m_height, 0, GL_RGB, GL_FLOAT, m_texels.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	ResourceRegistry::Track(GL_TEXTURE, m_texture, ResourceRegistry::CATEGORY_TEXTURE,
+		ResourceRegistry::GetTextureSize(GL_RGB16F, m_width, m_height, false), "lightmap");
+
+	// the texels are not needed once they are on the GPU
+	ResourceRegistry::ReleaseHost(m_texels.data());
+	std::vector<glm::vec3>().swap(m_texels);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetSurfaceRect()
+ *
+ *  This method is used for getting where the cells of a
+ *  surface are in the atlas, in texture coordinates.  The
+ *  vertex shader adds the border of two texels between the
+ *  cells with the size of the texture.
+ ***********************************************************/
+glm::vec4 LightmapBaker::GetSurfaceRect(int surface) const
+{
+	if ((surface < 0) || (surface >= (int)m_surfaces.size()) || (0 == m_width) || (0 == m_height))
+	{
+		return(glm::vec4(0.0f));
+	}
+
+	const LIGHTMAP_SURFACE& box = m_surfaces[surface];
+	return(glm::vec4(
+		(float)(box.x + 1) / (float)m_width,
+		(float)(box.y + 1) / (float)m_height,
+		(float)box.cellWidth / (float)m_width,
+		(float)box.cellHeight / (float)m_height));
+}
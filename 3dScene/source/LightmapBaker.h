@@ -0,0 +1,164 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.h
+// ============
+// bake the lighting of the static surfaces into a lightmap atlas on
+// every core, so they are shaded with one texture read
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <GL/glew.h>
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  LightmapBaker
+ *
+ *  This class computes the lighting of the static boxes of the
+ *  scene - the walls, the floor, the table and the stools -
+ *  once, and stores it in an atlas texture.  Those surfaces
+ *  then read their lighting from the atlas instead of running
+ *  the Phong loop over every light for every pixel.
+ *
+ *  The basic meshes have one set of texture coordinates, which
+ *  repeat the texture on every face, so the lightmap gets its
+ *  own coordinates: each box gets a grid of six cells in the
+ *  atlas, one per face, and a point of a face is projected
+ *  onto its cell along the face normal.  The vertex shader
+ *  repeats that projection from the position and normal of
+ *  the vertex, so the mesh does not need a second UV set.
+ *
+ *  Every texel stores the ambient and diffuse terms of the
+ *  scene shader for the material of its surface.  The light
+ *  sources are shadowed by the static boxes, the ambient term
+ *  is darkened by ambient occlusion, and an optional bounce
+ *  adds the direct light reflected by the other surfaces.  The
+ *  specular term depends on the camera and is left out.
+ ***********************************************************/
+class LightmapBaker
+{
+public:
+	// texture unit the lightmap is bound to while drawing
+	static const GLuint LIGHTMAP_TEXTURE_UNIT = 24;
+
+	// constructor
+	LightmapBaker();
+	// destructor
+	~LightmapBaker();
+
+	// bake the static boxes of a recorded draw list, does not
+	// use OpenGL, so it can run on any thread
+	bool Bake(
+		const std::vector<SceneManager::DRAW_COMMAND>& draws,
+		const std::vector<SceneManager::OBJECT_MATERIAL>& materials,
+		const std::vector<SceneManager::LIGHT_SOURCE>& lights,
+		int threadCount,
+		bool bIndirect);
+	// bake copies of a draw list, materials and lights on a
+	// thread of its own
+	void StartBake(
+		const std::vector<SceneManager::DRAW_COMMAND>& draws,
+		const std::vector<SceneManager::OBJECT_MATERIAL>& materials,
+		const std::vector<SceneManager::LIGHT_SOURCE>& lights,
+		int threadCount,
+		bool bIndirect);
+	// upload the atlas of a finished bake, true when it changed
+	bool FinishBake();
+	// true while a started bake has not been uploaded
+	bool IsBaking() const { return(m_bBaking); }
+	// true once a bake was started on its own thread
+	bool IsBakeStarted() const { return(m_bBakeStarted); }
+	// create the atlas texture from the baked texels
+	bool Upload();
+	// true once the atlas texture was created, and not while
+	// a bake rewrites the surfaces
+	bool IsReady() const { return((0 != m_texture) && !m_bBaking); }
+
+	// texture of the atlas
+	GLuint GetTexture() const { return(m_texture); }
+	// number of baked surfaces
+	int GetSurfaceCount() const { return((int)m_surfaces.size()); }
+	// atlas rectangle of a surface in texture coordinates, the
+	// first cell in xy and the size of a cell in zw
+	glm::vec4 GetSurfaceRect(int surface) const;
+	// milliseconds the last bake took
+	double GetBakeTime() const { return(m_bakeTime); }
+
+private:
+	// one static box and its cells in the atlas
+	struct LIGHTMAP_SURFACE
+	{
+		glm::mat4 model;
+		glm::mat4 inverseModel;
+		glm::mat3 normalMatrix;
+		// ambient and diffuse factors of the material
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		// approximate color of the surface for the bounce
+		glm::vec3 albedo;
+		// texel position of the first cell and texels per cell
+		int x;
+		int y;
+		int cellWidth;
+		int cellHeight;
+	};
+
+	std::vector<LIGHTMAP_SURFACE> m_surfaces;
+	std::vector<SceneManager::LIGHT_SOURCE> m_lights;
+	// direct lighting and final lighting of every texel
+	std::vector<glm::vec3> m_direct;
+	std::vector<glm::vec3> m_texels;
+	int m_width;
+	int m_height;
+	GLuint m_texture;
+	double m_bakeTime;
+
+	// the bake thread, the copies it bakes and the copies of
+	// the bake started while it runs
+	std::thread m_bakeThread;
+	std::atomic<bool> m_bBakeDone;
+	bool m_bBakeSucceeded;
+	bool m_bBaking;
+	bool m_bBakeStarted;
+	bool m_bBakeQueued;
+	std::vector<SceneManager::DRAW_COMMAND> m_bakeDraws;
+	std::vector<SceneManager::OBJECT_MATERIAL> m_bakeMaterials;
+	std::vector<SceneManager::LIGHT_SOURCE> m_bakeLights;
+	std::vector<SceneManager::DRAW_COMMAND> m_queuedDraws;
+	std::vector<SceneManager::OBJECT_MATERIAL> m_queuedMaterials;
+	std::vector<SceneManager::LIGHT_SOURCE> m_queuedLights;
+	int m_queuedThreadCount;
+	bool m_bQueuedIndirect;
+
+	// start the bake thread on the queued copies
+	void LaunchBake();
+
+	// give every surface its cells in the atlas
+	void PackSurfaces();
+	// find the world position and normal of a texel, false for
+	// the border texels between the cells
+	bool GetTexelPoint(int surface, int x, int y, glm::vec3& position, glm::vec3& normal) const;
+	// distance to the nearest static box along a ray, returns
+	// false when nothing is hit before the maximum distance
+	bool TraceRay(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float maxDistance,
+		float& distance,
+		int& surface) const;
+	// direct lighting of the surface point a ray hit
+	glm::vec3 GetHitRadiance(int surface, const glm::vec3& position) const;
+	// bake the direct lighting of a range of atlas rows
+	void BakeDirect(int firstRow, int lastRow);
+	// bake the occlusion and the bounce of a range of atlas rows
+	void BakeIndirect(int firstRow, int lastRow, bool bIndirect);
+	// copy the edge texels of every cell into its border
+	void FillBorders();
+};
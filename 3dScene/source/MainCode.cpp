@@ -1,5 +1,11 @@
 #include <iostream>         // error handling and output
-#include <cstdlib>          // EXIT_FAILURE
+#include <cstdlib>          // EXIT_FAILURE, atof, atoi
+#include <cstring>          // strcmp
+#include <atomic>           // render thread stop flag
+#include <thread>           // render thread
+#include <mutex>            // render thread wake up
+#include <condition_variable>
+#include <chrono>           // pick timing
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -13,6 +19,30 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "ShaderCache.h"
+#include "ShaderPermutations.h"
+#include "DeferredRenderer.h"
+#include "DynamicResolution.h"
+#include "WeightedTransparency.h"
+#include "DepthPrepass.h"
+#include "OverdrawMeter.h"
+#include "MultiView.h"
+#include "LightmapBaker.h"
+#include "GpuCulling.h"
+#include "AntiAliasing.h"
+#include "FrameGraph.h"
+#include "ScenePicker.h"
+#include "FrameProfiler.h"
+#include "FrameRingBuffer.h"
+#include "CameraBlock.h"
+#include "GLStateCache.h"
+#include "SoftwareRenderer.h"
+#include "BatchRenderer.h"
+#include "FrameCapture.h"
+#include "ResourceRegistry.h"
+#include "FrameArena.h"
+#include "StartupGraph.h"
+#include "HotReload.h"
 
 // Namespace for declaring global variables
 namespace
@@ -27,14 +57,134 @@ namespace
 	SceneManager* g_SceneManager = nullptr;
 	// shader manager object for dynamic interaction with the shader code
 	ShaderManager* g_ShaderManager = nullptr;
+	// shader cache object for building the shader programs
+	ShaderCache* g_ShaderCache = nullptr;
+	// specialized forward shading programs by feature bits
+	ShaderPermutations* g_ShaderPermutations = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// deferred renderer object for the optional deferred shading path
+	DeferredRenderer* g_DeferredRenderer = nullptr;
+	// dynamic resolution object for holding the frame time budget
+	DynamicResolution* g_DynamicResolution = nullptr;
+	// weighted blended transparency for the transparent draws
+	WeightedTransparency* g_WeightedTransparency = nullptr;
+	// optional depth pre-pass of the opaque draws
+	DepthPrepass* g_DepthPrepass = nullptr;
+	// fragments shaded per pixel and the overdraw heatmap
+	OverdrawMeter* g_OverdrawMeter = nullptr;
+	// layout of the views that share the window
+	MultiView* g_MultiView = nullptr;
+	// baked lighting of the static surfaces
+	LightmapBaker* g_LightmapBaker = nullptr;
+	// culling and indirect drawing of the opaque draws on the GPU
+	GpuCulling* g_GpuCulling = nullptr;
+	// MSAA, FXAA or TAA of the rendered frame
+	AntiAliasing* g_AntiAliasing = nullptr;
+	// passes of the frame and the pool of their transient targets
+	FrameGraph* g_FrameGraph = nullptr;
+	// settings, resources and passes of the frame graph of the
+	// current frame, the passes read them from here instead of
+	// capturing them
+	struct FRAME_PASSES
+	{
+		bool bMultiView;
+		bool bDynamicResolution;
+		bool bAntiAliasing;
+		// size of the window and of the region the scene
+		// passes render into
+		int windowWidth;
+		int windowHeight;
+		int width;
+		int height;
+		// transient textures, -1 when the frame has none
+		int sceneColor;
+		int sceneDepth;
+		int scaledColor;
+		// passes that the work of other passes refers to
+		int scenePass;
+		int resolvePass;
+		// profiler scope of the anti-aliasing mode, from the
+		// scene pass to the resolve pass
+		int antiAliasingScope;
+	};
+	FRAME_PASSES g_FramePasses;
+	// ray casts against the recorded draws for picking objects
+	ScenePicker* g_ScenePicker = nullptr;
+	// scene version the picking hierarchy was built from
+	unsigned int g_PickedSceneVersion = 0;
+	// frame profiler object for measuring the render passes
+	FrameProfiler* g_FrameProfiler = nullptr;
+	// ring buffer object for the per-draw shader data
+	FrameRingBuffer* g_FrameRingBuffer = nullptr;
+	// camera uniform block shared by every shader program
+	CameraBlock* g_CameraBlock = nullptr;
+	// frame capture object for recording the window
+	FrameCapture* g_FrameCapture = nullptr;
+	// per-frame allocator for the transient render data
+	FrameArena* g_FrameArena = nullptr;
+	// reloads the changed scene files while running, if enabled
+	HotReload* g_HotReload = nullptr;
+	// material table that is watched by the hot reload
+	const char* const SCENE_MATERIAL_FILE = "scene_materials.txt";
+	// initial size of each block of the frame arena in bytes
+	const size_t FRAME_ARENA_SIZE = 64 * 1024;
+	// frames drawn before the heap check starts, the first frames
+	// load the shader variants and grow the containers
+	const int HEAP_CHECK_WARMUP_FRAMES = 120;
+	// size of one frame region of the ring buffer in bytes
+	const GLsizeiptr FRAME_REGION_SIZE = 256 * 1024;
+
+	// frame rate written into a recorded Y4M stream
+	const int DEFAULT_RECORD_FRAME_RATE = 60;
+
+	// default frame time budget of the dynamic resolution, 60 Hz
+	const float DEFAULT_FRAME_BUDGET = 16.6f;
+	// file that receives the dynamic resolution history at exit
+	const char* const RESOLUTION_HISTORY_FILE = "dynamic_resolution_history.csv";
+	// seconds between the profiler reports on the console
+	const double PROFILE_REPORT_INTERVAL = 2.0;
+	// true when the profiler reports are printed
+	bool g_bProfile = false;
+	// time the application started, for the time to the first frame
+	double g_StartupTime = 0.0;
+
+	// length of the fixed simulation tick, 120 Hz
+	const double SIMULATION_TICK = 1.0 / 120.0;
+	// most ticks run at once after a stall, the rest is dropped
+	const int MAX_TICKS_PER_UPDATE = 8;
+	// set by the main thread to stop the render thread
+	std::atomic<bool> g_bStopRendering(false);
+
+	// true when frames are only rendered after something changed
+	bool g_bRenderOnDemand = false;
+	// how often the idle render thread checks the shaders that
+	// are compiling in the background, in milliseconds
+	const int PENDING_SHADER_POLL_INTERVAL = 50;
+	// wakes the idle render thread when a frame is needed
+	std::mutex g_redrawMutex;
+	std::condition_variable g_redrawCondition;
+	bool g_bRedrawRequested = false;
+
+	// default size of the image written by the software renderer
+	const int SOFTWARE_IMAGE_WIDTH = 1000;
+	const int SOFTWARE_IMAGE_HEIGHT = 800;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
 bool InitializeGLFW();
 bool InitializeGLEW();
+void RenderFrame();
+bool RecordFramePasses();
+void RenderScenePass();
+void RenderMultiView(int width, int height);
+void PickObject();
+void RenderThreadMain();
+void RequestRedraw();
+void WaitForRedraw(bool bPollShaders);
+int RenderSoftwareImage(int argc, char* argv[]);
+int RenderBatchImages(int argc, char* argv[]);
 
 
 /***********************************************************
@@ -45,11 +195,25 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the software renderer runs without a window or a GPU
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--software") == 0)
+		{
+			return(RenderSoftwareImage(argc, argv));
+		}
+		if (strcmp(argv[i], "--batch") == 0)
+		{
+			return(RenderBatchImages(argc, argv));
+		}
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
+	g_StartupTime = glfwGetTime();
 
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
@@ -66,47 +230,464 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
+	// load the shader code from the external GLSL files, the
+	// linked program is reused from the shader cache when the
+	// sources and the driver have not changed.  The generic
+	// program selects texturing and lighting with uniforms and
+	// draws until the specialized variants have been compiled.
+	g_ShaderCache = new ShaderCache("shadercache");
 
-	// try to create a new scene manager object and prepare the 3D scene
+	// the draw settings are written into a mapped ring buffer when
+	// the driver supports persistent mappings, the shaders are then
+	// built to read them from there
+	g_FrameRingBuffer = new FrameRingBuffer();
+	g_FrameRingBuffer->Create(FRAME_REGION_SIZE);
+	// every program reads the camera from one uniform block
+	g_CameraBlock = new CameraBlock();
+	g_CameraBlock->Create();
+
+	g_ShaderPermutations = new ShaderPermutations(
+		g_ShaderCache,
+		"shaders/sceneVertexShader.glsl",
+		"shaders/sceneFragmentShader.glsl");
+	g_ShaderPermutations->SetCommonDefines(g_FrameRingBuffer->GetShaderDefines());
+
+	// try to create a new scene manager object for the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	g_SceneManager->SetShaderPermutations(g_ShaderPermutations);
+	g_SceneManager->SetFrameRingBuffer(g_FrameRingBuffer);
+	g_FrameArena = new FrameArena(FRAME_ARENA_SIZE);
+	g_SceneManager->SetFrameArena(g_FrameArena);
+
+	// the deferred shading path, and the dynamic resolution that
+	// renders into an offscreen target and upscales it, driven by
+	// the GPU timings of the profiler
+	g_DeferredRenderer = new DeferredRenderer();
+	g_FrameProfiler = new FrameProfiler();
+	g_DynamicResolution = new DynamicResolution(DEFAULT_FRAME_BUDGET);
+	g_WeightedTransparency = new WeightedTransparency();
+	g_DepthPrepass = new DepthPrepass();
+	g_OverdrawMeter = new OverdrawMeter();
+	g_SceneManager->SetOverdrawMeter(g_OverdrawMeter);
+	g_MultiView = new MultiView();
+	g_MultiView->SetSideBySide(false);
+	g_LightmapBaker = new LightmapBaker();
+	g_GpuCulling = new GpuCulling();
+	g_ScenePicker = new ScenePicker();
+	g_AntiAliasing = new AntiAliasing();
+	g_FrameGraph = new FrameGraph();
+
+	// the shading path, the dynamic resolution, the transparency,
+	// the depth pre-pass, the overdraw heatmap, the lightmap, the
+	// GPU culling, the multi-view layout and the anti-aliasing can
+	// be selected on the command line, F1 to F4, F6 to F11, K and
+	// L, G and H, N and M, and 1 to 6 switch them while running
+	const char* recordOutput = NULL;
+	int recordFrameRate = DEFAULT_RECORD_FRAME_RATE;
+	bool bHotReload = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--deferred") == 0)
+		{
+			g_ViewManager->SetDeferredShading(true);
+		}
+		else if (strcmp(argv[i], "--dynamic-resolution") == 0)
+		{
+			g_ViewManager->SetDynamicResolution(true);
+		}
+		else if (strcmp(argv[i], "--weighted-oit") == 0)
+		{
+			g_ViewManager->SetWeightedTransparency(true);
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			g_ViewManager->SetDepthPrepass(true);
+		}
+		else if (strcmp(argv[i], "--overdraw") == 0)
+		{
+			g_ViewManager->SetOverdrawView(true);
+		}
+		else if (strcmp(argv[i], "--no-lightmap") == 0)
+		{
+			g_ViewManager->SetLightmap(false);
+		}
+		else if (strcmp(argv[i], "--gpu-culling") == 0)
+		{
+			g_ViewManager->SetGpuCulling(true);
+		}
+		else if (strcmp(argv[i], "--multi-view") == 0)
+		{
+			g_ViewManager->SetMultiView(true);
+		}
+		else if ((strcmp(argv[i], "--aa") == 0) && (i + 1 < argc))
+		{
+			AntiAliasing::MODE mode = AntiAliasing::ParseMode(argv[++i]);
+			if (AntiAliasing::MODE_COUNT == mode)
+			{
+				std::cout << "Unknown anti-aliasing mode " << argv[i]
+					<< ", use off, msaa2, msaa4, msaa8, fxaa or taa" << std::endl;
+			}
+			else
+			{
+				g_ViewManager->SetAntiAliasingMode(mode);
+			}
+		}
+		else if (strcmp(argv[i], "--inset") == 0)
+		{
+			g_MultiView->SetSideBySide(true);
+		}
+		else if ((strcmp(argv[i], "--frame-budget") == 0) && (i + 1 < argc))
+		{
+			g_DynamicResolution->SetFrameBudget((float)atof(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--profile") == 0)
+		{
+			g_bProfile = true;
+		}
+		else if (strcmp(argv[i], "--on-demand") == 0)
+		{
+			g_bRenderOnDemand = true;
+		}
+		else if ((strcmp(argv[i], "--record") == 0) && (i + 1 < argc))
+		{
+			recordOutput = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--record-fps") == 0) && (i + 1 < argc))
+		{
+			recordFrameRate = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--hot-reload") == 0)
+		{
+			bHotReload = true;
+		}
+	}
+
+	// the startup runs as a task graph: the images are decoded and
+	// the materials and lights defined on worker threads, while
+	// this thread, which owns the context, builds the shaders and
+	// uploads the data as soon as each part is ready
+	StartupGraph startup;
+	// every draw falls back to the generic program, so the startup
+	// can not go on without it, the other shaders are optional
+	int shaderTask = startup.AddTask("generic shader", StartupGraph::CONTEXT_THREAD, []()
+		{
+			if (!g_ShaderPermutations->LoadGenericShader(g_ShaderManager))
+			{
+				return(false);
+			}
+			GLStateCache::UseProgram(g_ShaderManager->m_programID);
+			return(true);
+		});
+	int sceneTask = g_SceneManager->AddPrepareTasks(startup, shaderTask);
+	// queue the deferred shading programs
+	startup.AddTask("deferred shaders", StartupGraph::CONTEXT_THREAD, []()
+		{
+			g_DeferredRenderer->RequestShaders(
+				g_ShaderCache,
+				"shaders/gBufferVertexShader.glsl",
+				"shaders/gBufferFragmentShader.glsl",
+				"shaders/fullscreenVertexShader.glsl",
+				"shaders/deferredLightingFragmentShader.glsl",
+				g_FrameRingBuffer->GetShaderDefines());
+			return(true);
+		});
+	// the static surfaces are baked on every core once the
+	// materials and lights are defined, from a copy of a draw
+	// list recorded on this thread, so the bake does not touch
+	// the draw list of the scene manager.  Without the lightmap
+	// the bake is left out, and switching it on bakes it then.
+	std::vector<SceneManager::DRAW_COMMAND> bakeDraws;
+	if (g_ViewManager->IsLightmap())
+	{
+		int recordTask = startup.AddTask("record lightmap surfaces", StartupGraph::CONTEXT_THREAD, [&bakeDraws]()
+			{
+				g_SceneManager->RecordScene();
+				bakeDraws = g_SceneManager->GetDrawList();
+				return(true);
+			}, { sceneTask });
+		int bakeTask = startup.AddTask("bake lightmap", StartupGraph::WORKER_THREAD, [&bakeDraws]()
+			{
+				g_LightmapBaker->Bake(
+					bakeDraws,
+					g_SceneManager->GetObjectMaterials(),
+					g_SceneManager->GetLightSources(),
+					(int)std::thread::hardware_concurrency(),
+					true);
+				return(true);
+			}, { recordTask });
+		startup.AddTask("upload lightmap", StartupGraph::CONTEXT_THREAD, []()
+			{
+				g_LightmapBaker->Upload();
+				return(true);
+			}, { bakeTask });
+	}
+	// the variants and the lighting pass only read the materials
+	// and lights, so they do not wait for the bake
+	startup.AddTask("variant lights", StartupGraph::WORKER_THREAD, []()
+		{
+			g_ShaderPermutations->SetLightSources(g_SceneManager->GetLightSources());
+			return(true);
+		}, { sceneTask });
+	// pass the scene materials and lights into the lighting pass
+	startup.AddTask("deferred scene", StartupGraph::WORKER_THREAD, []()
+		{
+			g_DeferredRenderer->SetSceneMaterials(g_SceneManager->GetObjectMaterials());
+			g_DeferredRenderer->SetSceneLights(g_SceneManager->GetLightSources());
+			return(true);
+		}, { sceneTask });
+	startup.AddTask("culling shaders", StartupGraph::CONTEXT_THREAD, []()
+		{
+			g_GpuCulling->LoadShaders(
+				g_ShaderCache,
+				"shaders/cullComputeShader.glsl",
+				"shaders/hiZComputeShader.glsl");
+			return(true);
+		});
+	startup.AddTask("upscale shaders", StartupGraph::CONTEXT_THREAD, []()
+		{
+			g_DynamicResolution->LoadShaders(
+				g_ShaderCache,
+				"shaders/fullscreenVertexShader.glsl",
+				"shaders/upscaleFragmentShader.glsl");
+			return(true);
+		});
+	startup.AddTask("transparency shaders", StartupGraph::CONTEXT_THREAD, []()
+		{
+			g_WeightedTransparency->LoadShaders(
+				g_ShaderCache,
+				"shaders/fullscreenVertexShader.glsl",
+				"shaders/transparencyCompositeFragmentShader.glsl");
+			return(true);
+		});
+	startup.AddTask("anti-aliasing shaders", StartupGraph::CONTEXT_THREAD, []()
+		{
+			g_AntiAliasing->LoadShaders(
+				g_ShaderCache,
+				"shaders/fullscreenVertexShader.glsl",
+				"shaders/fxaaFragmentShader.glsl",
+				"shaders/taaResolveFragmentShader.glsl");
+			return(true);
+		});
+	startup.AddTask("depth pre-pass shaders", StartupGraph::CONTEXT_THREAD, []()
+		{
+			g_DepthPrepass->LoadShaders(
+				g_ShaderCache,
+				"shaders/depthPrepassVertexShader.glsl",
+				"shaders/depthPrepassFragmentShader.glsl",
+				g_FrameRingBuffer->GetShaderDefines());
+			g_OverdrawMeter->LoadShaders(
+				g_ShaderCache,
+				"shaders/depthPrepassVertexShader.glsl",
+				"shaders/overdrawFragmentShader.glsl",
+				"shaders/fullscreenVertexShader.glsl",
+				"shaders/overdrawHeatmapFragmentShader.glsl",
+				g_FrameRingBuffer->GetShaderDefines());
+			return(true);
+		});
+
+	// this thread is busy with the context tasks, so it leaves
+	// one hardware thread for itself
+	int workerCount = (int)std::thread::hardware_concurrency() - 1;
+	bool bStarted = startup.Run((workerCount > 0) ? workerCount : 1);
+	startup.PrintReport();
+	if (!bStarted)
+	{
+		if (NULL != startup.GetFailedTask())
+		{
+			std::cout << "Startup failed in the " << startup.GetFailedTask() << " task" << std::endl;
+		}
+		return(EXIT_FAILURE);
+	}
+
+	// the textures, shaders and materials are reloaded while the
+	// scene runs when their files are saved
+	if (bHotReload)
+	{
+		g_HotReload = new HotReload(g_SceneManager, g_ShaderPermutations, g_DeferredRenderer, g_LightmapBaker);
+		g_HotReload->SetChangeCallback(RequestRedraw);
+		g_HotReload->Start(SCENE_MATERIAL_FILE);
+	}
+
+	// the presented frames are read back and encoded on their
+	// own thread, a Y4M file or an image sequence pattern
+	g_FrameCapture = new FrameCapture();
+	if (NULL != recordOutput)
+	{
+		g_FrameCapture->Start(recordOutput, recordFrameRate);
+	}
+
+	// the render thread owns the OpenGL context from here on,
+	// while this thread handles the window events and runs the
+	// simulation at a fixed tick.  GLFW only allows the main
+	// thread to process events, so the roles cannot be swapped.
+	g_ViewManager->PublishSnapshot(SIMULATION_TICK);
+	glfwMakeContextCurrent(NULL);
+	std::thread renderThread(RenderThreadMain);
 
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
+	double previousTime = glfwGetTime();
+	double accumulator = 0.0;
+	bool bIdle = false;
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		if (bIdle)
+		{
+			// nothing moves, so sleep until the next window event
+			// and start ticking again from that moment
+			glfwWaitEvents();
+			previousTime = glfwGetTime();
+			accumulator = 0.0;
+			bIdle = false;
+		}
+		else
+		{
+			// sleep until the next tick is due, waking early for events
+			glfwWaitEventsTimeout(glm::max(SIMULATION_TICK - accumulator, 0.0));
+		}
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		double currentTime = glfwGetTime();
+		accumulator += currentTime - previousTime;
+		previousTime = currentTime;
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		// catch up with whole ticks, a slow frame on the render
+		// thread no longer changes the length of a tick
+		int ticks = 0;
+		while ((accumulator >= SIMULATION_TICK) && (ticks < MAX_TICKS_PER_UPDATE))
+		{
+			g_ViewManager->UpdateSimulation((float)SIMULATION_TICK);
+			accumulator -= SIMULATION_TICK;
+			ticks++;
+		}
+		if (ticks == MAX_TICKS_PER_UPDATE)
+		{
+			accumulator = 0.0;
+		}
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		if (ticks > 0)
+		{
+			if (g_ViewManager->PublishSnapshot(SIMULATION_TICK))
+			{
+				RequestRedraw();
+			}
+			else if (g_bRenderOnDemand)
+			{
+				// a tick without any change means the input is idle
+				bIdle = true;
+			}
+		}
+	}
 
+	// take the OpenGL context back for releasing the resources
+	g_bStopRendering = true;
+	RequestRedraw();
+	renderThread.join();
+	glfwMakeContextCurrent(g_Window);
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+	if (NULL != g_HotReload)
+	{
+		delete g_HotReload;
+		g_HotReload = NULL;
+	}
 
-		// query the latest GLFW events
-		glfwPollEvents();
+	// keep the scale history of the dynamic resolution, if it ran
+	if (g_DynamicResolution->GetRenderWidth() > 0)
+	{
+		g_DynamicResolution->ExportHistory(RESOLUTION_HISTORY_FILE);
+	}
+
+	if (g_FrameCapture->GetCapturedCount() > 0)
+	{
+		std::cout << "Recording finished:" << std::endl;
+		g_FrameCapture->PrintReport();
 	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_FrameCapture)
+	{
+		delete g_FrameCapture;
+		g_FrameCapture = NULL;
+	}
+	if (NULL != g_AntiAliasing)
+	{
+		delete g_AntiAliasing;
+		g_AntiAliasing = NULL;
+	}
+	if (NULL != g_FrameGraph)
+	{
+		delete g_FrameGraph;
+		g_FrameGraph = NULL;
+	}
+	if (NULL != g_ScenePicker)
+	{
+		delete g_ScenePicker;
+		g_ScenePicker = NULL;
+	}
+	if (NULL != g_GpuCulling)
+	{
+		delete g_GpuCulling;
+		g_GpuCulling = NULL;
+	}
+	if (NULL != g_LightmapBaker)
+	{
+		delete g_LightmapBaker;
+		g_LightmapBaker = NULL;
+	}
+	if (NULL != g_MultiView)
+	{
+		delete g_MultiView;
+		g_MultiView = NULL;
+	}
+	if (NULL != g_OverdrawMeter)
+	{
+		delete g_OverdrawMeter;
+		g_OverdrawMeter = NULL;
+	}
+	if (NULL != g_DepthPrepass)
+	{
+		delete g_DepthPrepass;
+		g_DepthPrepass = NULL;
+	}
+	if (NULL != g_WeightedTransparency)
+	{
+		delete g_WeightedTransparency;
+		g_WeightedTransparency = NULL;
+	}
+	if (NULL != g_DynamicResolution)
+	{
+		delete g_DynamicResolution;
+		g_DynamicResolution = NULL;
+	}
+	if (NULL != g_FrameProfiler)
+	{
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
+	if (NULL != g_DeferredRenderer)
+	{
+		delete g_DeferredRenderer;
+		g_DeferredRenderer = NULL;
+	}
+	if (NULL != g_FrameRingBuffer)
+	{
+		delete g_FrameRingBuffer;
+		g_FrameRingBuffer = NULL;
+	}
+	if (NULL != g_CameraBlock)
+	{
+		delete g_CameraBlock;
+		g_CameraBlock = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
 		g_SceneManager = NULL;
 	}
+	if (NULL != g_FrameArena)
+	{
+		delete g_FrameArena;
+		g_FrameArena = NULL;
+	}
 	if (NULL != g_ViewManager)
 	{
 		delete g_ViewManager;
@@ -117,6 +698,20 @@ int main(int argc, char* argv[])
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_ShaderPermutations)
+	{
+		delete g_ShaderPermutations;
+		g_ShaderPermutations = NULL;
+	}
+	if (NULL != g_ShaderCache)
+	{
+		delete g_ShaderCache;
+		g_ShaderCache = NULL;
+	}
+
+	// everything was released, so any object still tracked leaked
+	ResourceRegistry::PrintReport();
+	ResourceRegistry::ReportLeaks();
 
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
@@ -174,4 +769,734 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
+}
+
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to render one frame of the 3D scene
+ *  with the selected shading path.  The passes of the frame
+ *  are recorded into the frame graph, which gives them their
+ *  transient targets and runs them.  With dynamic resolution
+ *  the scene is rendered into the scaled target and upscaled
+ *  to the window afterwards.  In the multi-view layout the
+ *  views share the target, each in its region.  An
+ *  anti-aliasing mode renders the scene into a target of its
+ *  own and resolves it into the frame target.
+ ***********************************************************/
+void RenderFrame()
+{
+	FRAME_PASSES& frame = g_FramePasses;
+	frame.bMultiView = g_ViewManager->IsMultiView();
+
+	// TAA moves the projection by a sub-pixel offset every frame,
+	// the views of the multi-view layout have cameras of their
+	// own, so they fall back to FXAA
+	AntiAliasing::MODE antiAliasingMode = (AntiAliasing::MODE)g_ViewManager->GetAntiAliasingMode();
+	if (frame.bMultiView && (AntiAliasing::MODE_TAA == antiAliasingMode))
+	{
+		antiAliasingMode = AntiAliasing::MODE_FXAA;
+	}
+	g_AntiAliasing->SetMode(antiAliasingMode);
+	g_ViewManager->SetProjectionJitter(g_AntiAliasing->NextJitter());
+
+	// convert from 3D object space to 2D view, using the latest
+	// snapshot published by the simulation
+	g_ViewManager->PrepareSceneView();
+
+	// the camera block is only written when the camera moved, and
+	// the draws are culled and sorted for the same camera, then
+	// take the next region of the ring buffer for the draws
+	if (!frame.bMultiView)
+	{
+		g_CameraBlock->Update(
+			g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix(),
+			g_ViewManager->GetCameraPosition());
+		g_SceneManager->SetView(
+			0,
+			g_ViewManager->GetProjectionMatrix() * g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetCameraPosition());
+		g_SceneManager->SetViewCount(1);
+	}
+	g_FrameRingBuffer->BeginFrame();
+
+	// the size of the window and of the region that the scene
+	// passes render into
+	g_ViewManager->GetFramebufferSize(frame.windowWidth, frame.windowHeight);
+	frame.width = frame.windowWidth;
+	frame.height = frame.windowHeight;
+	frame.bDynamicResolution = g_ViewManager->IsDynamicResolution();
+	if (frame.bDynamicResolution)
+	{
+		g_DynamicResolution->BeginFrame(frame.windowWidth, frame.windowHeight);
+		frame.width = g_DynamicResolution->GetRenderWidth();
+		frame.height = g_DynamicResolution->GetRenderHeight();
+	}
+	frame.bAntiAliasing = g_AntiAliasing->BeginFrame(frame.width, frame.height);
+
+	// when a transient target cannot be allocated, the frame is
+	// recorded again straight into the window
+	if (!RecordFramePasses())
+	{
+		if (frame.bAntiAliasing)
+		{
+			g_AntiAliasing->DisableTarget();
+		}
+		frame.bAntiAliasing = false;
+		frame.bDynamicResolution = false;
+		frame.width = frame.windowWidth;
+		frame.height = frame.windowHeight;
+		RecordFramePasses();
+	}
+	g_FrameGraph->Execute();
+
+	// the region of this frame is free again once the GPU has
+	// passed this point
+	g_FrameRingBuffer->EndFrame();
+}
+
+/***********************************************************
+ *	RecordFramePasses()
+ *
+ *  This function is used to record the passes of the frame
+ *  into the frame graph.  The scene renders into the window
+ *  unless a later pass reads it: the anti-aliasing resolve
+ *  reads its own target, and the upscale reads the scaled
+ *  target, which the resolve writes when both are on.  The
+ *  passes only capture the globals, so recording them does
+ *  not touch the heap.
+ ***********************************************************/
+bool RecordFramePasses()
+{
+	FRAME_PASSES& frame = g_FramePasses;
+	g_FrameGraph->BeginFrame();
+	int window = g_FrameGraph->ImportFramebuffer("window", 0);
+
+	// the targets cover the window, the scene renders into
+	// their lower left region
+	FrameGraph::TEXTURE_DESC desc;
+	desc.width = frame.windowWidth;
+	desc.height = frame.windowHeight;
+	desc.samples = 0;
+
+	frame.scaledColor = -1;
+	if (frame.bDynamicResolution)
+	{
+		desc.format = GL_RGBA8;
+		frame.scaledColor = g_FrameGraph->CreateTexture("scaled color", desc);
+	}
+	frame.sceneColor = frame.scaledColor;
+	frame.sceneDepth = -1;
+	if (frame.bAntiAliasing)
+	{
+		desc.samples = g_AntiAliasing->GetSampleCount();
+		desc.format = GL_RGBA8;
+		frame.sceneColor = g_FrameGraph->CreateTexture("anti-aliasing color", desc);
+		desc.format = GL_DEPTH_COMPONENT24;
+		frame.sceneDepth = g_FrameGraph->CreateTexture("anti-aliasing depth", desc);
+	}
+	else if (frame.bDynamicResolution)
+	{
+		desc.format = GL_DEPTH_COMPONENT24;
+		frame.sceneDepth = g_FrameGraph->CreateTexture("scaled depth", desc);
+	}
+
+	frame.scenePass = g_FrameGraph->AddPass("scene", []()
+	{
+		RenderScenePass();
+	});
+	if (frame.sceneColor >= 0)
+	{
+		g_FrameGraph->Write(frame.scenePass, frame.sceneColor);
+		g_FrameGraph->Write(frame.scenePass, frame.sceneDepth);
+	}
+	else
+	{
+		g_FrameGraph->Write(frame.scenePass, window);
+	}
+
+	if (!frame.bAntiAliasing)
+	{
+		frame.resolvePass = -1;
+	}
+	else
+	{
+		frame.resolvePass = g_FrameGraph->AddPass(g_AntiAliasing->GetResolveName(), []()
+		{
+			FRAME_PASSES& frame = g_FramePasses;
+			AntiAliasing::SCENE_TARGET scene;
+			scene.framebuffer = g_FrameGraph->GetFramebuffer(frame.scenePass);
+			scene.colorTexture = g_FrameGraph->GetTexture(frame.sceneColor);
+			scene.depthTexture = g_FrameGraph->GetTexture(frame.sceneDepth);
+			g_FrameGraph->GetTextureSize(frame.sceneColor, scene.width, scene.height);
+
+			int resolveScope = g_FrameProfiler->BeginScope(g_AntiAliasing->GetResolveName());
+			g_AntiAliasing->EndFrame(
+				scene,
+				g_FrameGraph->GetFramebuffer(frame.resolvePass),
+				g_ViewManager->GetViewMatrix(),
+				g_ViewManager->GetProjectionMatrix());
+			g_FrameProfiler->EndScope(resolveScope);
+			g_FrameProfiler->EndScope(frame.antiAliasingScope);
+		});
+		g_FrameGraph->Read(frame.resolvePass, frame.sceneColor);
+		if (g_AntiAliasing->NeedsSceneDepth())
+		{
+			g_FrameGraph->Read(frame.resolvePass, frame.sceneDepth);
+		}
+		g_FrameGraph->Write(frame.resolvePass, frame.bDynamicResolution ? frame.scaledColor : window);
+	}
+
+	if (frame.bDynamicResolution)
+	{
+		int upscalePass = g_FrameGraph->AddPass("upscale", []()
+		{
+			FRAME_PASSES& frame = g_FramePasses;
+			int textureWidth = 0;
+			int textureHeight = 0;
+			g_FrameGraph->GetTextureSize(frame.scaledColor, textureWidth, textureHeight);
+
+			int upscaleScope = g_FrameProfiler->BeginScope("upscale");
+			g_DynamicResolution->EndFrame(
+				g_FrameGraph->GetTexture(frame.scaledColor),
+				textureWidth,
+				textureHeight,
+				g_FrameProfiler->GetGpuTime("scene"));
+			g_FrameProfiler->EndScope(upscaleScope);
+		});
+		g_FrameGraph->Read(upscalePass, frame.scaledColor);
+		g_FrameGraph->Write(upscalePass, window);
+	}
+
+	return(g_FrameGraph->Compile());
+}
+
+/***********************************************************
+ *	RenderScenePass()
+ *
+ *  This function is used to render the scene passes of the
+ *  selected shading path into the framebuffer of the scene
+ *  pass of the frame graph, which is bound when it runs.  The
+ *  scope of the anti-aliasing mode measures the scene and the
+ *  resolve, it is closed by the resolve pass.
+ ***********************************************************/
+void RenderScenePass()
+{
+	FRAME_PASSES& frame = g_FramePasses;
+	GLuint targetFramebuffer = g_FrameGraph->GetFramebuffer(frame.scenePass);
+	int width = frame.width;
+	int height = frame.height;
+	GLStateCache::Viewport(0, 0, width, height);
+
+	frame.antiAliasingScope = g_FrameProfiler->BeginScope(AntiAliasing::GetModeName(
+		frame.bAntiAliasing ? g_AntiAliasing->GetMode() : AntiAliasing::MODE_OFF));
+
+	// Enable z-depth
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+
+	// Clear the frame and z buffers
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// the weighted transparency resolves over the same target
+	g_WeightedTransparency->SetTarget(targetFramebuffer, width, height);
+	g_SceneManager->SetWeightedTransparency(
+		g_ViewManager->IsWeightedTransparency() ? g_WeightedTransparency : NULL);
+	// the opaque draws are shaded once per pixel after a depth
+	// pre-pass, and the meter counts the shaded fragments
+	g_SceneManager->SetDepthPrepass(
+		g_ViewManager->IsDepthPrepass() ? g_DepthPrepass : NULL);
+	// the static surfaces read their baked lighting
+	g_SceneManager->SetLightmap(
+		g_ViewManager->IsLightmap() ? g_LightmapBaker : NULL);
+	g_OverdrawMeter->SetTarget(targetFramebuffer, width, height);
+	// the opaque basic meshes are culled and drawn on the GPU,
+	// which reduces the depth of the target for the next frame
+	g_GpuCulling->SetTarget(targetFramebuffer, width, height);
+	g_SceneManager->SetGpuCulling(
+		g_ViewManager->IsGpuCulling() ? g_GpuCulling : NULL);
+
+	int sceneScope = g_FrameProfiler->BeginScope("scene");
+
+	// the views of the layout share one recorded draw list
+	if (frame.bMultiView)
+	{
+		RenderMultiView(width, height);
+	}
+	// the heatmap counts the fragments of every draw with the
+	// depth test of the selected pass, and then replaces the frame
+	else if (g_ViewManager->IsOverdrawView() && g_OverdrawMeter->BeginHeatmap())
+	{
+		g_SceneManager->SetShaderManager(g_OverdrawMeter->GetCountShader());
+		g_SceneManager->RenderScene();
+		g_SceneManager->SetShaderManager(g_ShaderManager);
+
+		g_OverdrawMeter->ResolveHeatmap();
+	}
+	// the forward path keeps drawing until the deferred
+	// programs have finished compiling, and draws an unlit scene
+	else if (g_ViewManager->IsDeferredShading() && g_DeferredRenderer->IsReady() &&
+		g_SceneManager->IsUsingLighting() &&
+		g_DeferredRenderer->BeginGeometryPass(width, height))
+	{
+		// write the opaque scene surfaces into the G-buffer
+		g_SceneManager->SetShaderManager(g_DeferredRenderer->GetGeometryShader());
+		g_SceneManager->SetDrawSubset(SceneManager::DEFERRED_DRAWS);
+		g_SceneManager->RenderScene();
+		g_SceneManager->SetShaderManager(g_ShaderManager);
+
+		// light every covered pixel once and write its depth
+		g_DeferredRenderer->RenderLightingPass(targetFramebuffer);
+
+		// the transparent draws are blended over the lit surfaces
+		// by the forward path, from the same recorded draw list
+		g_SceneManager->SetDrawSubset(SceneManager::FORWARD_DRAWS);
+		g_SceneManager->SubmitDrawList(0);
+		g_SceneManager->SetDrawSubset(SceneManager::ALL_DRAWS);
+	}
+	else
+	{
+		// refresh the 3D scene
+		g_SceneManager->RenderScene();
+	}
+
+	g_FrameProfiler->EndScope(sceneScope);
+	if (!frame.bAntiAliasing)
+	{
+		g_FrameProfiler->EndScope(frame.antiAliasingScope);
+	}
+}
+
+/***********************************************************
+ *	RenderMultiView()
+ *
+ *  This function is used to render the views of the multi-view
+ *  layout into their regions of the target.  The scene is
+ *  recorded once and culled against the frustums of all the
+ *  views in the same pass, then every view submits the draws
+ *  it can see with its own slot of the camera block.  The
+ *  views use the forward path with sorted transparency, since
+ *  the G-buffer, the weighted transparency and the heatmap
+ *  resolve over the whole target.
+ ***********************************************************/
+void RenderMultiView(int width, int height)
+{
+	g_MultiView->Prepare(g_ViewManager->GetCameraPose(), width, height);
+
+	int viewCount = g_MultiView->GetViewCount();
+	for (int i = 0; i < viewCount; i++)
+	{
+		const MultiView::VIEW_SETTINGS& view = g_MultiView->GetView(i);
+		g_CameraBlock->Update(view.view, view.projection, view.pose.position, i);
+		g_SceneManager->SetView(i, view.projection * view.view, view.pose.position);
+	}
+	g_SceneManager->SetViewCount(viewCount);
+	g_SceneManager->RecordScene();
+
+	// the fragment counter measures one target per frame
+	g_SceneManager->SetWeightedTransparency(NULL);
+	g_SceneManager->SetOverdrawMeter(NULL);
+	for (int i = 0; i < viewCount; i++)
+	{
+		const MultiView::VIEW_SETTINGS& view = g_MultiView->GetView(i);
+		GLStateCache::Viewport(view.x, view.y, view.width, view.height);
+
+		// an inset covers the views drawn before it
+		if (view.bInset)
+		{
+			GLStateCache::SetEnabled(GL_SCISSOR_TEST, true);
+			glScissor(view.x, view.y, view.width, view.height);
+			GLStateCache::DepthMask(true);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			GLStateCache::SetEnabled(GL_SCISSOR_TEST, false);
+		}
+
+		g_CameraBlock->BindView(i);
+		g_SceneManager->SubmitDrawList(i);
+	}
+	g_SceneManager->SetOverdrawMeter(g_OverdrawMeter);
+
+	// the passes after the scene cover the whole target and read
+	// the camera of the first slot
+	GLStateCache::Viewport(0, 0, width, height);
+	g_CameraBlock->BindView(0);
+}
+
+/***********************************************************
+ *	PickObject()
+ *
+ *  This function is used to find the object under the center
+ *  of the window, where the captured cursor aims the camera.
+ *  The picking hierarchy is built again from the recorded
+ *  draw list when the scene was edited since it was built.
+ ***********************************************************/
+void PickObject()
+{
+	const std::vector<SceneManager::DRAW_COMMAND>& draws = g_SceneManager->GetDrawList();
+	if ((g_SceneManager->GetSceneVersion() != g_PickedSceneVersion) ||
+		(g_ScenePicker->GetObjectCount() == 0))
+	{
+		g_ScenePicker->Build(draws, g_SceneManager->GetMeshImporter());
+		g_PickedSceneVersion = g_SceneManager->GetSceneVersion();
+	}
+
+	int width = 0;
+	int height = 0;
+	g_ViewManager->GetFramebufferSize(width, height);
+	glm::vec3 origin;
+	glm::vec3 direction;
+	ScenePicker::MakeRay(width * 0.5f, height * 0.5f, width, height,
+		g_ViewManager->GetViewMatrix(), g_ViewManager->GetProjectionMatrix(),
+		origin, direction);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ScenePicker::PICK_RESULT result;
+	bool bHit = g_ScenePicker->Pick(origin, direction, result);
+	double pickTime = std::chrono::duration<double, std::micro>(
+		std::chrono::steady_clock::now() - start).count();
+
+	if (!bHit)
+	{
+		std::cout << "Picked nothing in " << pickTime << " us" << std::endl;
+		return;
+	}
+	std::cout << "Picked draw " << result.object << " of " << draws.size()
+		<< " at (" << result.position.x << ", " << result.position.y << ", " << result.position.z
+		<< "), normal (" << result.normal.x << ", " << result.normal.y << ", " << result.normal.z
+		<< "), " << result.distance << " away in " << pickTime << " us" << std::endl;
+}
+
+/***********************************************************
+ *	RenderThreadMain()
+ *
+ *  This function is the body of the render thread.  It draws
+ *  frames from the latest view snapshot as fast as the swap
+ *  allows, independent of the simulation tick.  In the render
+ *  on demand mode a frame is only drawn when the view or the
+ *  scene changed, otherwise the last presented frame stays on
+ *  screen and the thread sleeps.
+ ***********************************************************/
+void RenderThreadMain()
+{
+	glfwMakeContextCurrent(g_Window);
+	// the startup code changed state through the helper classes
+	// that bypass the state cache
+	GLStateCache::Invalidate();
+
+	double lastReportTime = glfwGetTime();
+	bool bFirstFrame = true;
+	// frames drawn, and the checked frames that used the heap
+	int frameCount = 0;
+	int heapCheckedFrames = 0;
+	int heapAllocatingFrames = 0;
+	unsigned int heapAllocations = 0;
+	while (!g_bStopRendering)
+	{
+		// collect the shader variants compiled in the background,
+		// a finished program can change the image
+		bool bShaderReady = g_ShaderCache->Update();
+		bool bViewChanged = g_ViewManager->AcquireSnapshot();
+		// swap in the reloaded files between two frames
+		bool bReloaded = (NULL != g_HotReload) && g_HotReload->ApplyPending();
+		// the lightmap is baked the first time it is switched on
+		// when the startup left it out, and swapped in when done
+		if (g_ViewManager->IsLightmap() && !g_LightmapBaker->IsReady() && !g_LightmapBaker->IsBakeStarted())
+		{
+			g_SceneManager->RecordScene();
+			g_LightmapBaker->StartBake(
+				g_SceneManager->GetDrawList(),
+				g_SceneManager->GetObjectMaterials(),
+				g_SceneManager->GetLightSources(),
+				(int)std::thread::hardware_concurrency(),
+				true);
+		}
+		bool bLightmapBaked = g_LightmapBaker->FinishBake();
+
+		if (g_bRenderOnDemand && !bViewChanged && !bShaderReady && !bReloaded && !bLightmapBaked && !g_SceneManager->IsDirty())
+		{
+			WaitForRedraw(g_ShaderCache->HasPendingPrograms() || g_LightmapBaker->IsBaking());
+			continue;
+		}
+
+		// in steady state the frame must not touch the heap, the
+		// debug builds count the allocations made while drawing
+		bool bHeapCheck = FrameArena::IsHeapCheckAvailable() &&
+			(frameCount >= HEAP_CHECK_WARMUP_FRAMES);
+		if (bHeapCheck)
+		{
+			FrameArena::BeginHeapCheck();
+		}
+
+		g_FrameArena->BeginFrame();
+		g_FrameProfiler->BeginFrame();
+		GLStateCache::BeginFrame();
+
+		// render the 3D scene into the back buffer
+		RenderFrame();
+		g_SceneManager->ClearDirty();
+
+		if (bHeapCheck)
+		{
+			unsigned int allocationCount = FrameArena::EndHeapCheck();
+			heapCheckedFrames++;
+			if (allocationCount > 0)
+			{
+				heapAllocatingFrames++;
+				heapAllocations += allocationCount;
+			}
+		}
+		frameCount++;
+
+		// a click picks from the draws and the camera of the
+		// frame that was just drawn
+		if (g_ViewManager->TakePickRequest())
+		{
+			PickObject();
+		}
+
+		// queue the readback of the finished frame, the pixels
+		// arrive a few frames later without a stall
+		if (g_FrameCapture->IsRecording())
+		{
+			int captureScope = g_FrameProfiler->BeginScope("capture");
+			int width = 0;
+			int height = 0;
+			g_ViewManager->GetFramebufferSize(width, height);
+			g_FrameCapture->Capture(width, height);
+			g_FrameProfiler->EndScope(captureScope);
+		}
+
+		g_FrameProfiler->EndFrame();
+		if (g_bProfile && (glfwGetTime() - lastReportTime > PROFILE_REPORT_INTERVAL))
+		{
+			g_FrameProfiler->PrintReport();
+			std::cout << "  resolution scale     " << g_DynamicResolution->GetScale() << std::endl;
+			std::cout << "  ring buffer stalls   " << g_FrameRingBuffer->GetStallCount() << std::endl;
+			std::cout << "  fragments per pixel  " << g_OverdrawMeter->GetFragmentsPerPixel()
+				<< (g_ViewManager->IsDepthPrepass() ? " with" : " without")
+				<< " depth pre-pass" << std::endl;
+			std::cout << "  visible draws       ";
+			int viewCount = g_ViewManager->IsMultiView() ? g_MultiView->GetViewCount() : 1;
+			for (int i = 0; i < viewCount; i++)
+			{
+				std::cout << " " << g_SceneManager->GetVisibleDrawCount(i);
+			}
+			std::cout << " of " << g_SceneManager->GetDrawList().size() << std::endl;
+			if (g_ViewManager->IsGpuCulling() && g_GpuCulling->IsReady())
+			{
+				std::cout << "  GPU culled objects   " << g_GpuCulling->GetVisibleCount()
+					<< " of " << g_GpuCulling->GetObjectCount() << " visible, "
+					<< g_GpuCulling->GetBatchCount() << " batches" << std::endl;
+			}
+			std::cout << "  anti-aliasing        " << AntiAliasing::GetModeName(g_AntiAliasing->GetMode())
+				<< std::endl;
+			std::cout << "  frame graph          " << g_FrameGraph->GetPassCount() << " passes, "
+				<< g_FrameGraph->GetCulledPassCount() << " culled, "
+				<< g_FrameGraph->GetAssignedBytes() / 1024 << " of "
+				<< g_FrameGraph->GetRequestedBytes() / 1024 << " KB assigned, "
+				<< g_FrameGraph->GetPooledBytes() / 1024 << " KB pooled, "
+				<< g_FrameGraph->GetAllocationCount() << " allocations" << std::endl;
+			std::cout << "  camera block         " << g_CameraBlock->GetUpdateCount()
+				<< " uploads, " << g_CameraBlock->GetSkippedCount() << " skipped" << std::endl;
+			std::cout << "  frame arena          " << g_FrameArena->GetUsedBytes()
+				<< " of " << g_FrameArena->GetCapacity() << " bytes, "
+				<< g_FrameArena->GetOverflowCount() << " overflows" << std::endl;
+			if (heapCheckedFrames > 0)
+			{
+				std::cout << "  heap check           " << heapAllocatingFrames
+					<< " of " << heapCheckedFrames << " frames allocated, "
+					<< heapAllocations << " allocations" << std::endl;
+			}
+			GLStateCache::PrintReport();
+			ResourceRegistry::PrintReport();
+			if (g_FrameCapture->IsRecording())
+			{
+				g_FrameCapture->PrintReport();
+			}
+			lastReportTime = glfwGetTime();
+		}
+
+		// Flips the the back buffer with the front buffer every frame.
+		glfwSwapBuffers(g_Window);
+
+		if (bFirstFrame)
+		{
+			std::cout << "First frame presented " << (glfwGetTime() - g_StartupTime) * 1000.0
+				<< " ms after the start" << std::endl;
+			bFirstFrame = false;
+		}
+	}
+
+	// write the frames still in flight while the context is current
+	g_FrameCapture->Stop();
+
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *	RequestRedraw()
+ *
+ *  This function is used to wake the render thread when it
+ *  is waiting for a change in the render on demand mode.
+ ***********************************************************/
+void RequestRedraw()
+{
+	{
+		std::lock_guard<std::mutex> lock(g_redrawMutex);
+		g_bRedrawRequested = true;
+	}
+	g_redrawCondition.notify_one();
+}
+
+/***********************************************************
+ *	WaitForRedraw()
+ *
+ *  This function is used to put the render thread to sleep
+ *  until RequestRedraw() is called.  While shaders are still
+ *  compiling or the lightmap is baking it wakes up
+ *  periodically to collect them.
+ ***********************************************************/
+void WaitForRedraw(bool bPollShaders)
+{
+	std::unique_lock<std::mutex> lock(g_redrawMutex);
+	if (bPollShaders)
+	{
+		g_redrawCondition.wait_for(
+			lock,
+			std::chrono::milliseconds(PENDING_SHADER_POLL_INTERVAL),
+			[] { return(g_bRedrawRequested); });
+	}
+	else
+	{
+		g_redrawCondition.wait(lock, [] { return(g_bRedrawRequested); });
+	}
+	g_bRedrawRequested = false;
+}
+
+/***********************************************************
+ *	RenderSoftwareImage()
+ *
+ *  This function is used to render one image of the scene
+ *  with the software renderer, without creating a window or
+ *  an OpenGL context:
+ *
+ *    --software file.ppm|file.tga  output image
+ *    --size width height           image size
+ *    --threads count               worker threads, 0 for all cores
+ ***********************************************************/
+int RenderSoftwareImage(int argc, char* argv[])
+{
+	const char* filename = NULL;
+	int width = SOFTWARE_IMAGE_WIDTH;
+	int height = SOFTWARE_IMAGE_HEIGHT;
+	int threadCount = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--software") == 0) && (i + 1 < argc))
+		{
+			filename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--size") == 0) && (i + 2 < argc))
+		{
+			width = atoi(argv[++i]);
+			height = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc))
+		{
+			threadCount = atoi(argv[++i]);
+		}
+	}
+	if ((NULL == filename) || (width <= 0) || (height <= 0))
+	{
+		std::cout << "Usage: --software file.ppm|file.tga [--size width height] [--threads count]" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	// without a shader manager the scene keeps its textures in
+	// memory and only records the draws
+	SceneManager* pSceneManager = new SceneManager(NULL);
+	pSceneManager->PrepareScene();
+	pSceneManager->RenderScene();
+
+	ViewManager* pViewManager = new ViewManager(NULL);
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+	pViewManager->CalculateCameraView((float)width / (float)height, view, projection, viewPosition);
+
+	SoftwareRenderer* pRenderer = new SoftwareRenderer(width, height, threadCount);
+	bool bRendered = pRenderer->Render(*pSceneManager, view, projection, viewPosition);
+	std::cout << "Software renderer: " << width << "x" << height << ", "
+		<< pRenderer->GetTriangleCount() << " triangles, "
+		<< pRenderer->GetThreadCount() << " threads, "
+		<< pRenderer->GetRenderTime() << " ms" << std::endl;
+	bool bWritten = bRendered && pRenderer->WriteImage(filename);
+	ResourceRegistry::PrintReport();
+
+	delete pRenderer;
+	delete pViewManager;
+	delete pSceneManager;
+
+	return(bWritten ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *  RenderBatchImages()
+ *
+ *  This function is used to render the views of a list with
+ *  the software renderer, several at the same time, without
+ *  creating a window or an OpenGL context:
+ *
+ *    --batch views.txt   view list, see BatchRenderer::LoadViews()
+ *    --size width height image size
+ *    --threads count     views rendered at once, 0 for all cores
+ ***********************************************************/
+int RenderBatchImages(int argc, char* argv[])
+{
+	const char* filename = NULL;
+	int width = SOFTWARE_IMAGE_WIDTH;
+	int height = SOFTWARE_IMAGE_HEIGHT;
+	int threadCount = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "--batch") == 0) && (i + 1 < argc))
+		{
+			filename = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--size") == 0) && (i + 2 < argc))
+		{
+			width = atoi(argv[++i]);
+			height = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--threads") == 0) && (i + 1 < argc))
+		{
+			threadCount = atoi(argv[++i]);
+		}
+	}
+	if ((NULL == filename) || (width <= 0) || (height <= 0))
+	{
+		std::cout << "Usage: --batch views.txt [--size width height] [--threads count]" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	// the scene, its meshes and its textures are prepared once
+	// and shared by every view
+	SceneManager* pSceneManager = new SceneManager(NULL);
+	pSceneManager->PrepareScene();
+	pSceneManager->RenderScene();
+
+	BatchRenderer* pBatchRenderer = new BatchRenderer(pSceneManager, width, height, threadCount);
+	bool bSuccess = pBatchRenderer->LoadViews(filename);
+	if (bSuccess)
+	{
+		bSuccess = pBatchRenderer->Run();
+		pBatchRenderer->PrintReport();
+		ResourceRegistry::PrintReport();
+	}
+
+	delete pBatchRenderer;
+	delete pSceneManager;
+
+	return(bSuccess ? EXIT_SUCCESS : EXIT_FAILURE);
 }
\ No newline at end of file
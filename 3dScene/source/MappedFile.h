@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// read only memory mapping of a whole file
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a file into the address space, so it can
+ *  be read in place without copying it into a buffer first.
+ *  The pages are loaded by the operating system as they are
+ *  touched, and stay valid until Close() or the destructor.
+ *  The Windows style paths of the scene work on every
+ *  platform.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+	// map the whole file, returns false when it cannot be opened
+	// or is empty, a hint for reading it from front to back
+	bool Open(const std::string& filename, bool bSequential);
+	// unmap the file
+	void Close();
+
+	// first byte of the mapped file, NULL when not open
+	const unsigned char* GetData() const { return(m_pData); }
+	// size of the mapped file in bytes
+	size_t GetSize() const { return(m_size); }
+	bool IsOpen() const { return(NULL != m_pData); }
+
+private:
+	const unsigned char* m_pData;
+	size_t m_size;
+	// handles of the open file and of its mapping, by platform
+	void* m_fileHandle;
+	void* m_mappingHandle;
+	int m_fileDescriptor;
+
+	// a mapping cannot be shared by two owners
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};
@@ -0,0 +1,1623 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.cpp
+// ============
+// load OBJ and binary glTF meshes from memory mapped files into vertex
+// buffers that draw like the basic shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshImporter.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// OBJ files below this size are parsed on one thread
+	const size_t MIN_PARALLEL_OBJ_SIZE = 1024 * 1024;
+	// deepest nesting of the JSON of a glTF file
+	const int MAX_JSON_DEPTH = 64;
+
+	// identifiers of a binary glTF file, little endian
+	const unsigned int GLB_MAGIC = 0x46546C67;
+	const unsigned int GLB_CHUNK_JSON = 0x4E4F534A;
+	const unsigned int GLB_CHUNK_BIN = 0x004E4942;
+	const size_t GLB_HEADER_SIZE = 12;
+	const size_t GLB_CHUNK_HEADER_SIZE = 8;
+	// primitive mode of triangle lists
+	const int GLTF_TRIANGLES = 4;
+
+	// value of the JSON of a glTF file
+	enum JSON_TYPE
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	struct JSON_VALUE
+	{
+		JSON_TYPE type;
+		double number;
+		std::string text;
+		// names of the members of an object
+		std::vector<std::string> keys;
+		// elements of an array, or the values of the members
+		std::vector<JSON_VALUE> elements;
+	};
+
+	// counts and places of one chunk of an OBJ file
+	struct OBJ_CHUNK
+	{
+		const char* pStart;
+		const char* pEnd;
+		// elements of the chunk, found by the first pass
+		size_t positionCount;
+		size_t uvCount;
+		size_t normalCount;
+		size_t triangleCount;
+		// elements of the chunks before this one
+		size_t positionStart;
+		size_t uvStart;
+		size_t normalStart;
+		size_t triangleStart;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		unsigned int invalidCount;
+	};
+
+	// corner of a face, with 0 based attribute numbers, -1 when
+	// the face does not give the attribute
+	struct OBJ_CORNER
+	{
+		long long position;
+		long long uv;
+		long long normal;
+	};
+
+	/***********************************************************
+	 *  RunParallel()
+	 *
+	 *  Run a function for every number below the count, each on
+	 *  its own thread, the calling thread takes the first one.
+	 ***********************************************************/
+	void RunParallel(int count, const std::function<void(int)>& work)
+	{
+		std::vector<std::thread> threads;
+		for (int i = 1; i < count; i++)
+		{
+			threads.push_back(std::thread(work, i));
+		}
+		if (count > 0)
+		{
+			work(0);
+		}
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			threads[i].join();
+		}
+	}
+
+	/***********************************************************
+	 *  SkipSpaces()
+	 *
+	 *  Move past the spaces and tabs within a line.
+	 ***********************************************************/
+	const char* SkipSpaces(const char* p, const char* pEnd)
+	{
+		while ((p < pEnd) && ((*p == ' ') || (*p == '\t')))
+		{
+			p++;
+		}
+		return(p);
+	}
+
+	/***********************************************************
+	 *  NextLine()
+	 *
+	 *  Find the start of the line after the one at p.
+	 ***********************************************************/
+	const char* NextLine(const char* p, const char* pEnd)
+	{
+		const char* pBreak = (const char*)memchr(p, '\n', pEnd - p);
+		return((NULL != pBreak) ? pBreak + 1 : pEnd);
+	}
+
+	/***********************************************************
+	 *  IsTokenEnd()
+	 *
+	 *  Check whether a character ends a token of an OBJ line,
+	 *  the comments count as the end of the line.
+	 ***********************************************************/
+	bool IsTokenEnd(char c)
+	{
+		return((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n') || (c == '#'));
+	}
+
+	/***********************************************************
+	 *  ParseFloat()
+	 *
+	 *  Read a number of an OBJ line without the locale, which
+	 *  keeps the parser independent of the system settings.
+	 ***********************************************************/
+	bool ParseFloat(const char*& p, const char* pEnd, float& value)
+	{
+		p = SkipSpaces(p, pEnd);
+		if ((p < pEnd) && (*p == '+'))
+		{
+			p++;
+		}
+		std::from_chars_result result = std::from_chars(p, pEnd, value);
+		if (result.ec != std::errc())
+		{
+			return(false);
+		}
+		p = result.ptr;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ResolveIndex()
+	 *
+	 *  Turn an OBJ index into a 0 based one.  Positive indices
+	 *  count from the first element of the file, negative ones
+	 *  back from the last element defined before the face.
+	 ***********************************************************/
+	long long ResolveIndex(long long index, size_t definedCount)
+	{
+		if (index > 0)
+		{
+			return(index - 1);
+		}
+		if (index < 0)
+		{
+			return((long long)definedCount + index);
+		}
+		return(-1);
+	}
+
+	/***********************************************************
+	 *  ParseCorner()
+	 *
+	 *  Read one corner of a face, "v", "v/t", "v//n" or "v/t/n",
+	 *  the attributes that are not given stay -1.
+	 ***********************************************************/
+	OBJ_CORNER ParseCorner(
+		const char* p,
+		const char* pEnd,
+		size_t positionCount,
+		size_t uvCount,
+		size_t normalCount)
+	{
+		OBJ_CORNER corner;
+		corner.position = -1;
+		corner.uv = -1;
+		corner.normal = -1;
+
+		long long index = 0;
+		std::from_chars_result result = std::from_chars(p, pEnd, index);
+		if (result.ec != std::errc())
+		{
+			return(corner);
+		}
+		corner.position = ResolveIndex(index, positionCount);
+		p = result.ptr;
+
+		if ((p < pEnd) && (*p == '/'))
+		{
+			p++;
+			result = std::from_chars(p, pEnd, index);
+			if (result.ec == std::errc())
+			{
+				corner.uv = ResolveIndex(index, uvCount);
+				p = result.ptr;
+			}
+			if ((p < pEnd) && (*p == '/'))
+			{
+				p++;
+				result = std::from_chars(p, pEnd, index);
+				if (result.ec == std::errc())
+				{
+					corner.normal = ResolveIndex(index, normalCount);
+				}
+			}
+		}
+
+		return(corner);
+	}
+
+	/***********************************************************
+	 *  NextToken()
+	 *
+	 *  Find the next token of a line, returns false at the end
+	 *  of the line.  The counting and the parsing pass both use
+	 *  it, so they see the same corners.
+	 ***********************************************************/
+	bool NextToken(const char*& p, const char* pEnd, const char*& pToken, const char*& pTokenEnd)
+	{
+		p = SkipSpaces(p, pEnd);
+		if ((p >= pEnd) || IsTokenEnd(*p))
+		{
+			return(false);
+		}
+		pToken = p;
+		while ((p < pEnd) && !IsTokenEnd(*p))
+		{
+			p++;
+		}
+		pTokenEnd = p;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  GetLineType()
+	 *
+	 *  Find the kind of an OBJ line, 'v' for a position, 't' for
+	 *  a texture coordinate, 'n' for a normal, 'f' for a face and
+	 *  0 for everything else.  p is moved past the keyword.
+	 ***********************************************************/
+	char GetLineType(const char*& p, const char* pEnd)
+	{
+		p = SkipSpaces(p, pEnd);
+		if (pEnd - p < 2)
+		{
+			return(0);
+		}
+
+		char type = 0;
+		if (p[0] == 'v')
+		{
+			if ((p[1] == ' ') || (p[1] == '\t'))
+			{
+				type = 'v';
+				p += 1;
+			}
+			else if (((p[1] == 't') || (p[1] == 'n')) && (pEnd - p > 2) &&
+				((p[2] == ' ') || (p[2] == '\t')))
+			{
+				type = p[1];
+				p += 2;
+			}
+		}
+		else if ((p[0] == 'f') && ((p[1] == ' ') || (p[1] == '\t')))
+		{
+			type = 'f';
+			p += 1;
+		}
+
+		return(type);
+	}
+
+	/***********************************************************
+	 *  CountChunk()
+	 *
+	 *  First pass over a chunk of an OBJ file: count its
+	 *  positions, texture coordinates, normals and triangles.
+	 ***********************************************************/
+	void CountChunk(OBJ_CHUNK& chunk)
+	{
+		const char* p = chunk.pStart;
+		while (p < chunk.pEnd)
+		{
+			const char* pLine = p;
+			switch (GetLineType(pLine, chunk.pEnd))
+			{
+			case 'v':
+				chunk.positionCount++;
+				break;
+			case 't':
+				chunk.uvCount++;
+				break;
+			case 'n':
+				chunk.normalCount++;
+				break;
+			case 'f':
+			{
+				size_t corners = 0;
+				const char* pToken = NULL;
+				const char* pTokenEnd = NULL;
+				while (NextToken(pLine, chunk.pEnd, pToken, pTokenEnd))
+				{
+					corners++;
+				}
+				if (corners > 2)
+				{
+					chunk.triangleCount += corners - 2;
+				}
+				break;
+			}
+			}
+			p = NextLine(p, chunk.pEnd);
+		}
+	}
+
+	/***********************************************************
+	 *  ParseChunk()
+	 *
+	 *  Second pass over a chunk of an OBJ file: parse its
+	 *  elements into their places in the shared arrays, the
+	 *  faces are split into triangle fans.
+	 ***********************************************************/
+	void ParseChunk(
+		OBJ_CHUNK& chunk,
+		std::vector<glm::vec3>& positions,
+		std::vector<glm::vec2>& uvs,
+		std::vector<glm::vec3>& normals,
+		std::vector<OBJ_CORNER>& corners)
+	{
+		size_t position = chunk.positionStart;
+		size_t uv = chunk.uvStart;
+		size_t normal = chunk.normalStart;
+		size_t corner = chunk.triangleStart * 3;
+		chunk.boundsMin = glm::vec3(FLT_MAX);
+		chunk.boundsMax = glm::vec3(-FLT_MAX);
+
+		const char* p = chunk.pStart;
+		while (p < chunk.pEnd)
+		{
+			const char* pLine = p;
+			switch (GetLineType(pLine, chunk.pEnd))
+			{
+			case 'v':
+			{
+				glm::vec3 value(0.0f);
+				if (!ParseFloat(pLine, chunk.pEnd, value.x) ||
+					!ParseFloat(pLine, chunk.pEnd, value.y) ||
+					!ParseFloat(pLine, chunk.pEnd, value.z))
+				{
+					chunk.invalidCount++;
+				}
+				positions[position++] = value;
+				chunk.boundsMin = glm::min(chunk.boundsMin, value);
+				chunk.boundsMax = glm::max(chunk.boundsMax, value);
+				break;
+			}
+			case 't':
+			{
+				glm::vec2 value(0.0f);
+				if (!ParseFloat(pLine, chunk.pEnd, value.x) ||
+					!ParseFloat(pLine, chunk.pEnd, value.y))
+				{
+					chunk.invalidCount++;
+				}
+				uvs[uv++] = value;
+				break;
+			}
+			case 'n':
+			{
+				glm::vec3 value(0.0f);
+				if (!ParseFloat(pLine, chunk.pEnd, value.x) ||
+					!ParseFloat(pLine, chunk.pEnd, value.y) ||
+					!ParseFloat(pLine, chunk.pEnd, value.z))
+				{
+					chunk.invalidCount++;
+				}
+				normals[normal++] = value;
+				break;
+			}
+			case 'f':
+			{
+				// the negative indices count back from the elements
+				// defined so far, including the earlier chunks
+				OBJ_CORNER first;
+				OBJ_CORNER previous;
+				int count = 0;
+				const char* pToken = NULL;
+				const char* pTokenEnd = NULL;
+				while (NextToken(pLine, chunk.pEnd, pToken, pTokenEnd))
+				{
+					OBJ_CORNER current = ParseCorner(pToken, pTokenEnd, position, uv, normal);
+					if (count == 0)
+					{
+						first = current;
+					}
+					else if (count >= 2)
+					{
+						corners[corner++] = first;
+						corners[corner++] = previous;
+						corners[corner++] = current;
+					}
+					previous = current;
+					count++;
+				}
+				break;
+			}
+			}
+			p = NextLine(p, chunk.pEnd);
+		}
+	}
+
+	/***********************************************************
+	 *  ExpandChunk()
+	 *
+	 *  Third pass over a chunk of an OBJ file: turn the corners
+	 *  of its triangles into vertices.  A triangle without
+	 *  normals gets the normal of its face.
+	 ***********************************************************/
+	void ExpandChunk(
+		OBJ_CHUNK& chunk,
+		const std::vector<glm::vec3>& positions,
+		const std::vector<glm::vec2>& uvs,
+		const std::vector<glm::vec3>& normals,
+		const std::vector<OBJ_CORNER>& corners,
+		std::vector<MeshImporter::MESH_VERTEX>& vertices)
+	{
+		size_t first = chunk.triangleStart * 3;
+		size_t last = first + chunk.triangleCount * 3;
+		for (size_t i = first; i < last; i += 3)
+		{
+			bool bHasNormals = true;
+			for (size_t j = i; j < i + 3; j++)
+			{
+				const OBJ_CORNER& corner = corners[j];
+				MeshImporter::MESH_VERTEX& vertex = vertices[j];
+
+				if ((corner.position >= 0) && (corner.position < (long long)positions.size()))
+				{
+					vertex.position = positions[(size_t)corner.position];
+				}
+				else
+				{
+					vertex.position = glm::vec3(0.0f);
+					chunk.invalidCount++;
+				}
+				if ((corner.uv >= 0) && (corner.uv < (long long)uvs.size()))
+				{
+					vertex.uv = uvs[(size_t)corner.uv];
+				}
+				else
+				{
+					vertex.uv = glm::vec2(0.0f);
+				}
+				if ((corner.normal >= 0) && (corner.normal < (long long)normals.size()))
+				{
+					vertex.normal = normals[(size_t)corner.normal];
+				}
+				else
+				{
+					bHasNormals = false;
+				}
+			}
+
+			if (!bHasNormals)
+			{
+				glm::vec3 faceNormal = glm::cross(
+					vertices[i + 1].position - vertices[i].position,
+					vertices[i + 2].position - vertices[i].position);
+				float length = glm::length(faceNormal);
+				faceNormal = (length > 0.0f) ? faceNormal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+				for (size_t j = i; j < i + 3; j++)
+				{
+					vertices[j].normal = faceNormal;
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  ParseJsonString()
+	 *
+	 *  Read a quoted JSON string, p points at the opening quote.
+	 ***********************************************************/
+	bool ParseJsonString(const char*& p, const char* pEnd, std::string& text)
+	{
+		p++;
+		text.clear();
+		while (p < pEnd)
+		{
+			char c = *p++;
+			if (c == '"')
+			{
+				return(true);
+			}
+			if (c != '\\')
+			{
+				text.push_back(c);
+				continue;
+			}
+			if (p >= pEnd)
+			{
+				return(false);
+			}
+			c = *p++;
+			switch (c)
+			{
+			case 'b': text.push_back('\b'); break;
+			case 'f': text.push_back('\f'); break;
+			case 'n': text.push_back('\n'); break;
+			case 'r': text.push_back('\r'); break;
+			case 't': text.push_back('\t'); break;
+			case 'u':
+			{
+				// the names of a glTF file are kept as UTF-8
+				unsigned int code = 0;
+				if ((pEnd - p < 4) || (std::from_chars(p, p + 4, code, 16).ec != std::errc()))
+				{
+					return(false);
+				}
+				p += 4;
+				if (code < 0x80)
+				{
+					text.push_back((char)code);
+				}
+				else if (code < 0x800)
+				{
+					text.push_back((char)(0xC0 | (code >> 6)));
+					text.push_back((char)(0x80 | (code & 0x3F)));
+				}
+				else
+				{
+					text.push_back((char)(0xE0 | (code >> 12)));
+					text.push_back((char)(0x80 | ((code >> 6) & 0x3F)));
+					text.push_back((char)(0x80 | (code & 0x3F)));
+				}
+				break;
+			}
+			default:
+				text.push_back(c);
+				break;
+			}
+		}
+
+		return(false);
+	}
+
+	/***********************************************************
+	 *  ParseJson()
+	 *
+	 *  Read one JSON value and everything it contains.
+	 ***********************************************************/
+	bool ParseJson(const char*& p, const char* pEnd, JSON_VALUE& value, int depth)
+	{
+		while ((p < pEnd) && ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n')))
+		{
+			p++;
+		}
+		if ((p >= pEnd) || (depth > MAX_JSON_DEPTH))
+		{
+			return(false);
+		}
+
+		value.type = JSON_NULL;
+		value.number = 0.0;
+		if (*p == '{' || *p == '[')
+		{
+			bool bObject = (*p == '{');
+			char close = bObject ? '}' : ']';
+			value.type = bObject ? JSON_OBJECT : JSON_ARRAY;
+			p++;
+			for (;;)
+			{
+				while ((p < pEnd) && ((*p == ' ') || (*p == '\t') || (*p == '\r') || (*p == '\n') || (*p == ',')))
+				{
+					p++;
+				}
+				if (p >= pEnd)
+				{
+					return(false);
+				}
+				if (*p == close)
+				{
+					p++;
+					return(true);
+				}
+				if (bObject)
+				{
+					std::string key;
+					if ((*p != '"') || !ParseJsonString(p, pEnd, key))
+					{
+						return(false);
+					}
+					while ((p < pEnd) && (*p != ':'))
+					{
+						p++;
+					}
+					if (p >= pEnd)
+					{
+						return(false);
+					}
+					p++;
+					value.keys.push_back(key);
+				}
+				value.elements.push_back(JSON_VALUE());
+				if (!ParseJson(p, pEnd, value.elements.back(), depth + 1))
+				{
+					return(false);
+				}
+			}
+		}
+		if (*p == '"')
+		{
+			value.type = JSON_STRING;
+			return(ParseJsonString(p, pEnd, value.text));
+		}
+		if ((pEnd - p >= 4) && (strncmp(p, "true", 4) == 0))
+		{
+			value.type = JSON_BOOL;
+			value.number = 1.0;
+			p += 4;
+			return(true);
+		}
+		if ((pEnd - p >= 5) && (strncmp(p, "false", 5) == 0))
+		{
+			value.type = JSON_BOOL;
+			p += 5;
+			return(true);
+		}
+		if ((pEnd - p >= 4) && (strncmp(p, "null", 4) == 0))
+		{
+			p += 4;
+			return(true);
+		}
+
+		value.type = JSON_NUMBER;
+		std::from_chars_result result = std::from_chars(p, pEnd, value.number);
+		if (result.ec != std::errc())
+		{
+			return(false);
+		}
+		p = result.ptr;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  FindMember()
+	 *
+	 *  Find a member of a JSON object, NULL when it is missing.
+	 ***********************************************************/
+	const JSON_VALUE* FindMember(const JSON_VALUE& object, const char* key)
+	{
+		for (size_t i = 0; i < object.keys.size(); i++)
+		{
+			if (object.keys[i] == key)
+			{
+				return(&object.elements[i]);
+			}
+		}
+		return(NULL);
+	}
+
+	/***********************************************************
+	 *  GetNumber()
+	 *
+	 *  Get a number member of a JSON object, or the default.
+	 ***********************************************************/
+	double GetNumber(const JSON_VALUE& object, const char* key, double fallback)
+	{
+		const JSON_VALUE* pMember = FindMember(object, key);
+		return(((NULL != pMember) && (pMember->type == JSON_NUMBER)) ? pMember->number : fallback);
+	}
+
+	/***********************************************************
+	 *  GetElement()
+	 *
+	 *  Get an element of an array member of a JSON object, NULL
+	 *  when the member or the element does not exist.
+	 ***********************************************************/
+	const JSON_VALUE* GetElement(const JSON_VALUE& object, const char* key, double index)
+	{
+		const JSON_VALUE* pArray = FindMember(object, key);
+		if ((NULL == pArray) || (pArray->type != JSON_ARRAY) ||
+			(index < 0.0) || (index >= (double)pArray->elements.size()))
+		{
+			return(NULL);
+		}
+		return(&pArray->elements[(size_t)index]);
+	}
+
+	/***********************************************************
+	 *  GetComponentSize()
+	 *
+	 *  Get the bytes of a glTF component type, which uses the
+	 *  OpenGL type numbers, 0 for an unknown type.
+	 ***********************************************************/
+	size_t GetComponentSize(GLenum componentType)
+	{
+		switch (componentType)
+		{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return(1);
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return(2);
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return(4);
+		default:
+			return(0);
+		}
+	}
+
+	/***********************************************************
+	 *  GetComponentCount()
+	 *
+	 *  Get the components of a glTF accessor type, 0 for the
+	 *  matrix types, which a vertex attribute cannot use.
+	 ***********************************************************/
+	GLint GetComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return(1);
+		if (type == "VEC2") return(2);
+		if (type == "VEC3") return(3);
+		if (type == "VEC4") return(4);
+		return(0);
+	}
+
+	/***********************************************************
+	 *  GetSize()
+	 *
+	 *  Get a byte offset, length or count of a JSON object.  The
+	 *  numbers come from the file, so anything that is negative,
+	 *  not whole or too large for a size is rejected.
+	 ***********************************************************/
+	bool GetSize(const JSON_VALUE& object, const char* key, size_t& size)
+	{
+		double number = GetNumber(object, key, 0.0);
+		if (!(number >= 0.0) || (number >= (double)SIZE_MAX) || (number != std::floor(number)))
+		{
+			return(false);
+		}
+		size = (size_t)number;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ReadAccessor()
+	 *
+	 *  Find where the elements of a glTF accessor are in the
+	 *  binary chunk, and check that all of them are inside it.
+	 *  The ranges are compared by subtracting from the sizes,
+	 *  so crafted offsets cannot wrap around and pass.
+	 ***********************************************************/
+	bool ReadAccessor(
+		const JSON_VALUE& root,
+		double accessorIndex,
+		size_t binarySize,
+		MeshImporter::MESH_ATTRIBUTE& attribute,
+		size_t& count,
+		const JSON_VALUE*& pAccessor)
+	{
+		attribute.bPresent = false;
+		pAccessor = GetElement(root, "accessors", accessorIndex);
+		if ((NULL == pAccessor) || (NULL != FindMember(*pAccessor, "sparse")))
+		{
+			return(false);
+		}
+		const JSON_VALUE* pView = GetElement(root, "bufferViews", GetNumber(*pAccessor, "bufferView", -1.0));
+		if ((NULL == pView) || (GetNumber(*pView, "buffer", -1.0) != 0.0))
+		{
+			return(false);
+		}
+
+		const JSON_VALUE* pType = FindMember(*pAccessor, "type");
+		attribute.components = (NULL != pType) ? GetComponentCount(pType->text) : 0;
+		attribute.componentType = (GLenum)GetNumber(*pAccessor, "componentType", 0.0);
+		const JSON_VALUE* pNormalized = FindMember(*pAccessor, "normalized");
+		attribute.bNormalized = (NULL != pNormalized) && (pNormalized->number != 0.0);
+
+		size_t stride = 0;
+		size_t viewOffset = 0;
+		size_t viewLength = 0;
+		size_t accessorOffset = 0;
+		if (!GetSize(*pAccessor, "count", count) ||
+			!GetSize(*pView, "byteStride", stride) ||
+			!GetSize(*pView, "byteOffset", viewOffset) ||
+			!GetSize(*pView, "byteLength", viewLength) ||
+			!GetSize(*pAccessor, "byteOffset", accessorOffset))
+		{
+			return(false);
+		}
+
+		// the counts and strides end up in GLsizei
+		size_t elementSize = attribute.components * GetComponentSize(attribute.componentType);
+		if (0 == stride)
+		{
+			stride = elementSize;
+		}
+		if ((0 == elementSize) || (0 == count) || (count > (size_t)INT_MAX) || (stride > (size_t)INT_MAX) ||
+			(count - 1 > (SIZE_MAX - elementSize) / stride))
+		{
+			return(false);
+		}
+		size_t span = (count - 1) * stride + elementSize;
+		if ((viewOffset > binarySize) || (viewLength > binarySize - viewOffset) ||
+			(accessorOffset > viewLength) || (span > viewLength - accessorOffset))
+		{
+			return(false);
+		}
+
+		attribute.offset = viewOffset + accessorOffset;
+		attribute.stride = (GLsizei)stride;
+		attribute.bPresent = true;
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ReadComponent()
+	 *
+	 *  Read one component of a vertex attribute as a float, the
+	 *  normalized integers are scaled like the GPU does.
+	 ***********************************************************/
+	float ReadComponent(const unsigned char* p, GLenum componentType, bool bNormalized)
+	{
+		switch (componentType)
+		{
+		case GL_FLOAT:
+		{
+			float value = 0.0f;
+			memcpy(&value, p, sizeof(value));
+			return(value);
+		}
+		case GL_UNSIGNED_BYTE:
+			return(bNormalized ? p[0] / 255.0f : (float)p[0]);
+		case GL_BYTE:
+			return(bNormalized ? glm::max((signed char)p[0] / 127.0f, -1.0f) : (float)(signed char)p[0]);
+		case GL_UNSIGNED_SHORT:
+		{
+			unsigned short value = 0;
+			memcpy(&value, p, sizeof(value));
+			return(bNormalized ? value / 65535.0f : (float)value);
+		}
+		case GL_SHORT:
+		{
+			short value = 0;
+			memcpy(&value, p, sizeof(value));
+			return(bNormalized ? glm::max(value / 32767.0f, -1.0f) : (float)value);
+		}
+		default:
+			return(0.0f);
+		}
+	}
+
+	/***********************************************************
+	 *  ReadIndex()
+	 *
+	 *  Read one index of an index accessor.
+	 ***********************************************************/
+	unsigned int ReadIndex(const unsigned char* p, GLenum indexType)
+	{
+		switch (indexType)
+		{
+		case GL_UNSIGNED_BYTE:
+			return(p[0]);
+		case GL_UNSIGNED_SHORT:
+		{
+			unsigned short value = 0;
+			memcpy(&value, p, sizeof(value));
+			return(value);
+		}
+		default:
+		{
+			unsigned int value = 0;
+			memcpy(&value, p, sizeof(value));
+			return(value);
+		}
+		}
+	}
+
+	/***********************************************************
+	 *  ReadVector()
+	 *
+	 *  Read up to three components of a vertex attribute.
+	 ***********************************************************/
+	glm::vec3 ReadVector(
+		const unsigned char* pBinary,
+		const MeshImporter::MESH_ATTRIBUTE& attribute,
+		size_t vertex)
+	{
+		glm::vec3 value(0.0f);
+		const unsigned char* p = pBinary + attribute.offset + vertex * attribute.stride;
+		size_t componentSize = GetComponentSize(attribute.componentType);
+		for (int i = 0; (i < attribute.components) && (i < 3); i++)
+		{
+			value[i] = ReadComponent(p + i * componentSize, attribute.componentType, attribute.bNormalized);
+		}
+		return(value);
+	}
+}
+
+/***********************************************************
+ *  MeshImporter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshImporter::MeshImporter(bool bHeadless)
+{
+	m_bHeadless = bHeadless;
+}
+
+/***********************************************************
+ *  ~MeshImporter()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshImporter::~MeshImporter()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  DecodeMesh()
+ *
+ *  This method is used for reading a mesh file through a
+ *  memory mapping.  An OBJ file is parsed into triangles, a
+ *  .glb file only has its JSON read, its binary chunk stays
+ *  mapped until the upload.
+ ***********************************************************/
+bool MeshImporter::DecodeMesh(MESH_DECODE& decode, int threadCount)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	decode.pFile = NULL;
+	decode.pBinary = NULL;
+	decode.binarySize = 0;
+	decode.vertices.clear();
+	decode.primitives.clear();
+	decode.boundsMin = glm::vec3(FLT_MAX);
+	decode.boundsMax = glm::vec3(-FLT_MAX);
+	decode.triangleCount = 0;
+	decode.fileSize = 0;
+	decode.decodeTime = 0.0;
+
+	std::string extension;
+	size_t dot = decode.filename.find_last_of('.');
+	if (dot != std::string::npos)
+	{
+		extension = decode.filename.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(),
+			[](unsigned char c) { return((char)tolower(c)); });
+	}
+
+	bool bDecoded = false;
+	if (extension == "glb")
+	{
+		bDecoded = DecodeGLB(decode);
+	}
+	else if (extension == "obj")
+	{
+		MappedFile file;
+		if (file.Open(decode.filename, true))
+		{
+			decode.fileSize = file.GetSize();
+			bDecoded = DecodeOBJ(decode, file, threadCount);
+		}
+		else
+		{
+			std::cout << "Could not open mesh file " << decode.filename << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << "Unknown mesh file type " << decode.filename << std::endl;
+	}
+
+	if (!bDecoded)
+	{
+		FreeMeshDecode(decode);
+	}
+	decode.decodeTime = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+
+	return(bDecoded);
+}
+
+/***********************************************************
+ *  DecodeOBJ()
+ *
+ *  This method is used for parsing a mapped OBJ file in
+ *  chunks on several threads.  The chunks end at line breaks,
+ *  and every pass writes to its own range of the shared
+ *  arrays, so the threads never wait for each other within a
+ *  pass.  The faces are expanded into separate triangles.
+ ***********************************************************/
+bool MeshImporter::DecodeOBJ(MESH_DECODE& decode, const MappedFile& file, int threadCount)
+{
+	const char* pData = (const char*)file.GetData();
+	const char* pEnd = pData + file.GetSize();
+
+	int chunkCount = (file.GetSize() < MIN_PARALLEL_OBJ_SIZE) ? 1 : glm::max(threadCount, 1);
+	std::vector<OBJ_CHUNK> chunks(chunkCount);
+	const char* pStart = pData;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		OBJ_CHUNK& chunk = chunks[i];
+		chunk = OBJ_CHUNK();
+		chunk.pStart = pStart;
+		chunk.pEnd = pEnd;
+		if (i + 1 < chunkCount)
+		{
+			const char* pSplit = pData + file.GetSize() * (i + 1) / chunkCount;
+			chunk.pEnd = (pSplit > pStart) ? NextLine(pSplit, pEnd) : pStart;
+		}
+		pStart = chunk.pEnd;
+	}
+
+	RunParallel(chunkCount, [&chunks](int i) { CountChunk(chunks[i]); });
+
+	size_t positionCount = 0;
+	size_t uvCount = 0;
+	size_t normalCount = 0;
+	size_t triangleCount = 0;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		chunks[i].positionStart = positionCount;
+		chunks[i].uvStart = uvCount;
+		chunks[i].normalStart = normalCount;
+		chunks[i].triangleStart = triangleCount;
+		positionCount += chunks[i].positionCount;
+		uvCount += chunks[i].uvCount;
+		normalCount += chunks[i].normalCount;
+		triangleCount += chunks[i].triangleCount;
+	}
+	if (0 == triangleCount)
+	{
+		std::cout << "No faces in mesh file " << decode.filename << std::endl;
+		return(false);
+	}
+
+	std::vector<glm::vec3> positions(positionCount);
+	std::vector<glm::vec2> uvs(uvCount);
+	std::vector<glm::vec3> normals(normalCount);
+	std::vector<OBJ_CORNER> corners(triangleCount * 3);
+	RunParallel(chunkCount, [&](int i) { ParseChunk(chunks[i], positions, uvs, normals, corners); });
+
+	decode.vertices.resize(triangleCount * 3);
+	RunParallel(chunkCount, [&](int i) { ExpandChunk(chunks[i], positions, uvs, normals, corners, decode.vertices); });
+
+	unsigned int invalidCount = 0;
+	for (int i = 0; i < chunkCount; i++)
+	{
+		if (chunks[i].positionCount > 0)
+		{
+			decode.boundsMin = glm::min(decode.boundsMin, chunks[i].boundsMin);
+			decode.boundsMax = glm::max(decode.boundsMax, chunks[i].boundsMax);
+		}
+		invalidCount += chunks[i].invalidCount;
+	}
+	if (invalidCount > 0)
+	{
+		std::cout << "Mesh file " << decode.filename << " has " << invalidCount
+			<< " invalid values or indices" << std::endl;
+	}
+
+	// the triangles are drawn in order from one interleaved array
+	MESH_PRIMITIVE primitive;
+	primitive.vertexCount = (GLsizei)decode.vertices.size();
+	primitive.indexType = GL_NONE;
+	primitive.indexOffset = 0;
+	primitive.indexCount = 0;
+	primitive.vertexArray = 0;
+	const size_t offsets[ATTRIBUTE_COUNT] =
+	{
+		offsetof(MESH_VERTEX, position),
+		offsetof(MESH_VERTEX, normal),
+		offsetof(MESH_VERTEX, uv)
+	};
+	const GLint components[ATTRIBUTE_COUNT] = { 3, 3, 2 };
+	for (int i = 0; i < ATTRIBUTE_COUNT; i++)
+	{
+		primitive.attributes[i].bPresent = true;
+		primitive.attributes[i].offset = offsets[i];
+		primitive.attributes[i].components = components[i];
+		primitive.attributes[i].componentType = GL_FLOAT;
+		primitive.attributes[i].bNormalized = false;
+		primitive.attributes[i].stride = sizeof(MESH_VERTEX);
+	}
+	decode.primitives.push_back(primitive);
+	decode.triangleCount = (unsigned int)triangleCount;
+
+	return(true);
+}
+
+/***********************************************************
+ *  DecodeGLB()
+ *
+ *  This method is used for reading the JSON chunk of a binary
+ *  glTF file and turning the triangle primitives of its
+ *  meshes into attribute and index ranges of the binary
+ *  chunk.  The vertex data itself is not touched.
+ ***********************************************************/
+bool MeshImporter::DecodeGLB(MESH_DECODE& decode)
+{
+	decode.pFile = new MappedFile();
+	if (!decode.pFile->Open(decode.filename, false))
+	{
+		std::cout << "Could not open mesh file " << decode.filename << std::endl;
+		return(false);
+	}
+	const unsigned char* pData = decode.pFile->GetData();
+	size_t size = decode.pFile->GetSize();
+	decode.fileSize = size;
+
+	unsigned int header[3] = { 0, 0, 0 };
+	if (size >= GLB_HEADER_SIZE)
+	{
+		memcpy(header, pData, sizeof(header));
+	}
+	if ((header[0] != GLB_MAGIC) || (header[1] != 2) || (header[2] > size))
+	{
+		std::cout << "Mesh file " << decode.filename << " is not a binary glTF 2.0 file" << std::endl;
+		return(false);
+	}
+
+	// the JSON chunk comes first, the binary chunk is optional
+	const char* pJson = NULL;
+	size_t jsonSize = 0;
+	size_t offset = GLB_HEADER_SIZE;
+	while (offset + GLB_CHUNK_HEADER_SIZE <= header[2])
+	{
+		unsigned int chunk[2] = { 0, 0 };
+		memcpy(chunk, pData + offset, sizeof(chunk));
+		offset += GLB_CHUNK_HEADER_SIZE;
+		if (offset + chunk[0] > header[2])
+		{
+			break;
+		}
+		if ((chunk[1] == GLB_CHUNK_JSON) && (NULL == pJson))
+		{
+			pJson = (const char*)pData + offset;
+			jsonSize = chunk[0];
+		}
+		else if ((chunk[1] == GLB_CHUNK_BIN) && (NULL == decode.pBinary))
+		{
+			decode.pBinary = pData + offset;
+			decode.binarySize = chunk[0];
+		}
+		offset += chunk[0];
+	}
+
+	JSON_VALUE root;
+	const char* p = pJson;
+	if ((NULL == pJson) || !ParseJson(p, pJson + jsonSize, root, 0) || (root.type != JSON_OBJECT))
+	{
+		std::cout << "Could not read the JSON of mesh file " << decode.filename << std::endl;
+		return(false);
+	}
+	if (NULL == decode.pBinary)
+	{
+		std::cout << "Mesh file " << decode.filename << " has no binary chunk, external buffers are not supported" << std::endl;
+		return(false);
+	}
+
+	const JSON_VALUE* pMeshes = FindMember(root, "meshes");
+	if ((NULL == pMeshes) || (pMeshes->type != JSON_ARRAY))
+	{
+		std::cout << "No meshes in mesh file " << decode.filename << std::endl;
+		return(false);
+	}
+
+	unsigned int skippedCount = 0;
+	unsigned int invalidCount = 0;
+	const char* attributeNames[ATTRIBUTE_COUNT] = { "POSITION", "NORMAL", "TEXCOORD_0" };
+	for (size_t i = 0; i < pMeshes->elements.size(); i++)
+	{
+		const JSON_VALUE* pPrimitives = FindMember(pMeshes->elements[i], "primitives");
+		if ((NULL == pPrimitives) || (pPrimitives->type != JSON_ARRAY))
+		{
+			continue;
+		}
+
+		for (size_t j = 0; j < pPrimitives->elements.size(); j++)
+		{
+			const JSON_VALUE& source = pPrimitives->elements[j];
+			const JSON_VALUE* pAttributes = FindMember(source, "attributes");
+			if ((NULL == pAttributes) || (GetNumber(source, "mode", GLTF_TRIANGLES) != GLTF_TRIANGLES))
+			{
+				skippedCount++;
+				continue;
+			}
+
+			MESH_PRIMITIVE primitive;
+			primitive.vertexArray = 0;
+			size_t vertexCount = 0;
+			bool bValid = true;
+			for (int k = 0; k < ATTRIBUTE_COUNT; k++)
+			{
+				size_t count = 0;
+				const JSON_VALUE* pAccessor = NULL;
+				primitive.attributes[k].bPresent = false;
+				double accessor = GetNumber(*pAttributes, attributeNames[k], -1.0);
+				if (accessor < 0.0)
+				{
+					continue;
+				}
+				if (!ReadAccessor(root, accessor, decode.binarySize, primitive.attributes[k], count, pAccessor))
+				{
+					invalidCount++;
+					bValid = false;
+					break;
+				}
+				if (k == POSITION_ATTRIBUTE)
+				{
+					vertexCount = count;
+					// glTF requires the bounds of the positions, so
+					// they are taken without reading the vertices
+					const JSON_VALUE* pMin = FindMember(*pAccessor, "min");
+					const JSON_VALUE* pMax = FindMember(*pAccessor, "max");
+					if ((NULL != pMin) && (NULL != pMax) &&
+						(pMin->elements.size() >= 3) && (pMax->elements.size() >= 3))
+					{
+						for (int c = 0; c < 3; c++)
+						{
+							decode.boundsMin[c] = glm::min(decode.boundsMin[c], (float)pMin->elements[c].number);
+							decode.boundsMax[c] = glm::max(decode.boundsMax[c], (float)pMax->elements[c].number);
+						}
+					}
+					else
+					{
+						for (size_t v = 0; v < count; v++)
+						{
+							glm::vec3 position = ReadVector(decode.pBinary, primitive.attributes[k], v);
+							decode.boundsMin = glm::min(decode.boundsMin, position);
+							decode.boundsMax = glm::max(decode.boundsMax, position);
+						}
+					}
+				}
+				else if (count != vertexCount)
+				{
+					bValid = false;
+				}
+			}
+			if (!bValid || !primitive.attributes[POSITION_ATTRIBUTE].bPresent)
+			{
+				skippedCount++;
+				continue;
+			}
+			primitive.vertexCount = (GLsizei)vertexCount;
+
+			// the indices are read by the GPU from the same buffer,
+			// which requires them to be tightly packed
+			primitive.indexType = GL_NONE;
+			primitive.indexOffset = 0;
+			primitive.indexCount = 0;
+			double indices = GetNumber(source, "indices", -1.0);
+			if (indices >= 0.0)
+			{
+				MESH_ATTRIBUTE indexRange;
+				size_t count = 0;
+				const JSON_VALUE* pAccessor = NULL;
+				if (!ReadAccessor(root, indices, decode.binarySize, indexRange, count, pAccessor))
+				{
+					invalidCount++;
+					skippedCount++;
+					continue;
+				}
+				if ((indexRange.components != 1) ||
+					(indexRange.stride != (GLsizei)GetComponentSize(indexRange.componentType)) ||
+					((indexRange.componentType != GL_UNSIGNED_BYTE) &&
+					 (indexRange.componentType != GL_UNSIGNED_SHORT) &&
+					 (indexRange.componentType != GL_UNSIGNED_INT)))
+				{
+					skippedCount++;
+					continue;
+				}
+				primitive.indexType = indexRange.componentType;
+				primitive.indexOffset = indexRange.offset;
+				primitive.indexCount = (GLsizei)count;
+			}
+
+			decode.triangleCount += (unsigned int)(((primitive.indexType != GL_NONE) ?
+				primitive.indexCount : primitive.vertexCount) / 3);
+			decode.primitives.push_back(primitive);
+		}
+	}
+
+	if (invalidCount > 0)
+	{
+		std::cout << "Mesh file " << decode.filename << " has " << invalidCount
+			<< " invalid values or indices" << std::endl;
+	}
+	if (skippedCount > 0)
+	{
+		std::cout << "Mesh file " << decode.filename << ": " << skippedCount
+			<< " primitives are not indexed triangle lists with valid accessors and were skipped" << std::endl;
+	}
+	if (decode.primitives.empty())
+	{
+		std::cout << "No triangle primitives in mesh file " << decode.filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  FreeMeshDecode()
+ *
+ *  This method is used for unmapping the file and releasing
+ *  the triangles of a decoded mesh.
+ ***********************************************************/
+void MeshImporter::FreeMeshDecode(MESH_DECODE& decode)
+{
+	if (NULL != decode.pFile)
+	{
+		delete decode.pFile;
+		decode.pFile = NULL;
+	}
+	decode.pBinary = NULL;
+	decode.binarySize = 0;
+	std::vector<MESH_VERTEX>().swap(decode.vertices);
+}
+
+/***********************************************************
+ *  UploadMesh()
+ *
+ *  This method is used for creating the buffer of a decoded
+ *  mesh and a vertex array for each of its primitives.  The
+ *  binary chunk of a .glb file is passed to the driver right
+ *  from the mapped pages.  Without an OpenGL context the
+ *  triangles are kept for the software renderer instead.
+ ***********************************************************/
+int MeshImporter::UploadMesh(MESH_DECODE& decode)
+{
+	if (decode.primitives.empty())
+	{
+		FreeMeshDecode(decode);
+		return(-1);
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	IMPORTED_MESH mesh;
+	mesh.tag = decode.tag;
+	mesh.buffer = 0;
+	mesh.primitives = decode.primitives;
+	mesh.boundsMin = decode.boundsMin;
+	mesh.boundsMax = decode.boundsMax;
+	mesh.boundsCenter = (decode.boundsMin + decode.boundsMax) * 0.5f;
+	mesh.boundsRadius = glm::length(decode.boundsMax - decode.boundsMin) * 0.5f;
+	mesh.triangleCount = decode.triangleCount;
+
+	const void* pData = (NULL != decode.pBinary) ? (const void*)decode.pBinary : (const void*)decode.vertices.data();
+	mesh.bufferSize = (NULL != decode.pBinary) ? decode.binarySize : decode.vertices.size() * sizeof(MESH_VERTEX);
+
+	if (m_bHeadless)
+	{
+		BuildSoftwareMesh(decode, mesh);
+		ResourceRegistry::TrackHost(mesh.vertices.data(),
+			mesh.vertices.size() * sizeof(MESH_VERTEX) + mesh.indices.size() * sizeof(unsigned int),
+			mesh.tag.c_str());
+	}
+	else
+	{
+		glGenBuffers(1, &mesh.buffer);
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, mesh.buffer);
+		if (GLEW_ARB_buffer_storage)
+		{
+			glBufferStorage(GL_ARRAY_BUFFER, mesh.bufferSize, pData, 0);
+		}
+		else
+		{
+			glBufferData(GL_ARRAY_BUFFER, mesh.bufferSize, pData, GL_STATIC_DRAW);
+		}
+		ResourceRegistry::Track(GL_BUFFER, mesh.buffer, ResourceRegistry::CATEGORY_MESH,
+			mesh.bufferSize, mesh.tag.c_str());
+
+		for (size_t i = 0; i < mesh.primitives.size(); i++)
+		{
+			MESH_PRIMITIVE& primitive = mesh.primitives[i];
+			glGenVertexArrays(1, &primitive.vertexArray);
+			GLStateCache::BindVertexArray(primitive.vertexArray);
+			for (GLuint k = 0; k < ATTRIBUTE_COUNT; k++)
+			{
+				const MESH_ATTRIBUTE& attribute = primitive.attributes[k];
+				if (!attribute.bPresent)
+				{
+					glDisableVertexAttribArray(k);
+					continue;
+				}
+				glEnableVertexAttribArray(k);
+				glVertexAttribPointer(
+					k,
+					attribute.components,
+					attribute.componentType,
+					attribute.bNormalized ? GL_TRUE : GL_FALSE,
+					attribute.stride,
+					(const void*)attribute.offset);
+			}
+			// the element binding is part of the vertex array
+			if (primitive.indexType != GL_NONE)
+			{
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.buffer);
+			}
+		}
+		GLStateCache::BindVertexArray(0);
+	}
+
+	double uploadTime = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+	std::cout << "Imported " << mesh.tag << ": " << mesh.triangleCount << " triangles in "
+		<< mesh.primitives.size() << " primitives, " << std::fixed << std::setprecision(2)
+		<< decode.fileSize / (1024.0 * 1024.0) << " MB read in " << decode.decodeTime
+		<< " ms, uploaded in " << uploadTime << " ms" << std::defaultfloat << std::endl;
+
+	FreeMeshDecode(decode);
+	m_meshes.push_back(mesh);
+
+	return((int)m_meshes.size() - 1);
+}
+
+/***********************************************************
+ *  LoadMesh()
+ *
+ *  This method is used for reading and uploading a mesh on
+ *  the calling thread, which has to own the OpenGL context.
+ ***********************************************************/
+int MeshImporter::LoadMesh(const char* filename, const char* tag)
+{
+	MESH_DECODE decode;
+	decode.filename = filename;
+	decode.tag = tag;
+	decode.pFile = NULL;
+
+	if (!DecodeMesh(decode, (int)std::thread::hardware_concurrency()))
+	{
+		return(-1);
+	}
+
+	return(UploadMesh(decode));
+}
+
+/***********************************************************
+ *  BuildSoftwareMesh()
+ *
+ *  This method is used for copying the triangles of a decoded
+ *  mesh into one indexed list, which the software renderer
+ *  reads like its basic shapes.
+ ***********************************************************/
+void MeshImporter::BuildSoftwareMesh(const MESH_DECODE& decode, IMPORTED_MESH& mesh)
+{
+	if (NULL == decode.pBinary)
+	{
+		mesh.vertices = decode.vertices;
+		mesh.indices.resize(mesh.vertices.size());
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+		{
+			mesh.indices[i] = (unsigned int)i;
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < decode.primitives.size(); i++)
+	{
+		const MESH_PRIMITIVE& primitive = decode.primitives[i];
+		unsigned int first = (unsigned int)mesh.vertices.size();
+		for (GLsizei v = 0; v < primitive.vertexCount; v++)
+		{
+			MESH_VERTEX vertex;
+			vertex.position = ReadVector(decode.pBinary, primitive.attributes[POSITION_ATTRIBUTE], v);
+			vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+			if (primitive.attributes[NORMAL_ATTRIBUTE].bPresent)
+			{
+				vertex.normal = ReadVector(decode.pBinary, primitive.attributes[NORMAL_ATTRIBUTE], v);
+			}
+			vertex.uv = glm::vec2(0.0f);
+			if (primitive.attributes[TEXCOORD_ATTRIBUTE].bPresent)
+			{
+				glm::vec3 uv = ReadVector(decode.pBinary, primitive.attributes[TEXCOORD_ATTRIBUTE], v);
+				vertex.uv = glm::vec2(uv.x, uv.y);
+			}
+			mesh.vertices.push_back(vertex);
+		}
+
+		if (primitive.indexType == GL_NONE)
+		{
+			for (GLsizei v = 0; v < primitive.vertexCount; v++)
+			{
+				mesh.indices.push_back(first + (unsigned int)v);
+			}
+			continue;
+		}
+		size_t indexSize = GetComponentSize(primitive.indexType);
+		for (GLsizei k = 0; k < primitive.indexCount; k++)
+		{
+			unsigned int index = ReadIndex(decode.pBinary + primitive.indexOffset + k * indexSize, primitive.indexType);
+			mesh.indices.push_back(first + glm::min(index, (unsigned int)primitive.vertexCount - 1));
+		}
+	}
+}
+
+/***********************************************************
+ *  FindMesh()
+ *
+ *  This method is used for finding a loaded mesh by its tag.
+ ***********************************************************/
+int MeshImporter::FindMesh(const std::string& tag) const
+{
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		if (m_meshes[i].tag == tag)
+		{
+			return((int)i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing the primitives of a mesh
+ *  with the bound program.  An attribute the file does not
+ *  have is read from the constant value of its location.
+ ***********************************************************/
+void MeshImporter::DrawMesh(int mesh) const
+{
+	if ((mesh < 0) || (mesh >= (int)m_meshes.size()) || m_bHeadless)
+	{
+		return;
+	}
+
+	const IMPORTED_MESH& importedMesh = m_meshes[mesh];
+	for (size_t i = 0; i < importedMesh.primitives.size(); i++)
+	{
+		const MESH_PRIMITIVE& primitive = importedMesh.primitives[i];
+		GLStateCache::BindVertexArray(primitive.vertexArray);
+		if (!primitive.attributes[NORMAL_ATTRIBUTE].bPresent)
+		{
+			glVertexAttrib3f(NORMAL_ATTRIBUTE, 0.0f, 1.0f, 0.0f);
+		}
+		if (!primitive.attributes[TEXCOORD_ATTRIBUTE].bPresent)
+		{
+			glVertexAttrib2f(TEXCOORD_ATTRIBUTE, 0.0f, 0.0f);
+		}
+
+		if (primitive.indexType != GL_NONE)
+		{
+			glDrawElements(GL_TRIANGLES, primitive.indexCount, primitive.indexType,
+				(const void*)primitive.indexOffset);
+		}
+		else
+		{
+			glDrawArrays(GL_TRIANGLES, 0, primitive.vertexCount);
+		}
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for deleting the buffers and vertex
+ *  arrays of every loaded mesh.
+ ***********************************************************/
+void MeshImporter::Destroy()
+{
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		IMPORTED_MESH& mesh = m_meshes[i];
+		for (size_t j = 0; j < mesh.primitives.size(); j++)
+		{
+			if (0 != mesh.primitives[j].vertexArray)
+			{
+				GLStateCache::DeleteVertexArrays(1, &mesh.primitives[j].vertexArray);
+			}
+		}
+		if (0 != mesh.buffer)
+		{
+			ResourceRegistry::Release(GL_BUFFER, 1, &mesh.buffer);
+			GLStateCache::DeleteBuffers(1, &mesh.buffer);
+		}
+		if (!mesh.vertices.empty())
+		{
+			ResourceRegistry::ReleaseHost(mesh.vertices.data());
+		}
+	}
+	m_meshes.clear();
+}
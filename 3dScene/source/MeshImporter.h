@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.h
+// ============
+// load OBJ and binary glTF meshes from memory mapped files into vertex
+// buffers that draw like the basic shapes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "MappedFile.h"
+
+#include <GL/glew.h>
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  MeshImporter
+ *
+ *  This class loads meshes from Wavefront OBJ files and from
+ *  binary glTF 2.0 files (.glb).  Both are read through a
+ *  memory mapping of the file.
+ *
+ *  A .glb file already holds its vertex and index data in the
+ *  layout the GPU reads, so its binary chunk goes from the
+ *  mapped pages straight into one buffer, and the accessors
+ *  become vertex attribute pointers and index offsets into it.
+ *  An OBJ file is text, so it is split into chunks at line
+ *  breaks and the chunks are parsed on several threads: a
+ *  first pass counts the elements of every chunk, which gives
+ *  each chunk its place in the shared arrays, a second pass
+ *  parses them in place, and a third one expands the faces
+ *  into triangles.
+ *
+ *  Like the scene textures, a mesh is decoded on any thread
+ *  and uploaded on the thread that owns the OpenGL context.
+ *  The attributes use the locations of the basic shapes:
+ *  position, normal and texture coordinate.  The meshes are
+ *  read in their own coordinates, the node hierarchy of a
+ *  glTF scene is not applied.
+ ***********************************************************/
+class MeshImporter
+{
+public:
+	// attribute locations of the scene shaders
+	enum ATTRIBUTE_SLOT
+	{
+		POSITION_ATTRIBUTE,
+		NORMAL_ATTRIBUTE,
+		TEXCOORD_ATTRIBUTE,
+		ATTRIBUTE_COUNT
+	};
+
+	// vertex with the layout of the basic shapes
+	struct MESH_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// where one vertex attribute is found in the vertex buffer
+	struct MESH_ATTRIBUTE
+	{
+		// false when the primitive does not have the attribute
+		bool bPresent;
+		size_t offset;
+		GLint components;
+		GLenum componentType;
+		bool bNormalized;
+		GLsizei stride;
+	};
+
+	// one draw of an imported mesh
+	struct MESH_PRIMITIVE
+	{
+		MESH_ATTRIBUTE attributes[ATTRIBUTE_COUNT];
+		GLsizei vertexCount;
+		// type of the indices, GL_NONE when the vertices are
+		// drawn in order
+		GLenum indexType;
+		size_t indexOffset;
+		GLsizei indexCount;
+		GLuint vertexArray;
+	};
+
+	// mesh read from its file and waiting for its upload on the
+	// OpenGL context thread
+	struct MESH_DECODE
+	{
+		std::string filename;
+		std::string tag;
+		// mapping of a .glb file and its binary chunk, which is
+		// uploaded as it is
+		MappedFile* pFile;
+		const unsigned char* pBinary;
+		size_t binarySize;
+		// triangles expanded from an OBJ file
+		std::vector<MESH_VERTEX> vertices;
+		std::vector<MESH_PRIMITIVE> primitives;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		unsigned int triangleCount;
+		size_t fileSize;
+		// milliseconds spent reading the file
+		double decodeTime;
+	};
+
+	// mesh ready to be drawn
+	struct IMPORTED_MESH
+	{
+		std::string tag;
+		// one buffer holds the vertices and the indices
+		GLuint buffer;
+		size_t bufferSize;
+		std::vector<MESH_PRIMITIVE> primitives;
+		// box and sphere around the mesh in its own coordinates
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		glm::vec3 boundsCenter;
+		float boundsRadius;
+		unsigned int triangleCount;
+		// indexed triangles for the software renderer, only
+		// kept without an OpenGL context
+		std::vector<MESH_VERTEX> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	// constructor, without an OpenGL context the meshes are only
+	// kept in memory for the software renderer
+	MeshImporter(bool bHeadless);
+	// destructor
+	~MeshImporter();
+
+	// read a mesh file, the type comes from the extension, does
+	// not use OpenGL, so it can run on any thread
+	static bool DecodeMesh(MESH_DECODE& decode, int threadCount);
+	// release what a decoded mesh holds when it is not uploaded
+	static void FreeMeshDecode(MESH_DECODE& decode);
+	// create the buffer and vertex arrays of a decoded mesh,
+	// returns the number of the mesh or -1
+	int UploadMesh(MESH_DECODE& decode);
+	// decode and upload a mesh on the calling thread
+	int LoadMesh(const char* filename, const char* tag);
+
+	// find a loaded mesh by its tag, -1 when it is not loaded
+	int FindMesh(const std::string& tag) const;
+	// number of loaded meshes
+	int GetMeshCount() const { return((int)m_meshes.size()); }
+	// get a loaded mesh
+	const IMPORTED_MESH& GetMesh(int mesh) const { return(m_meshes[mesh]); }
+	// draw every primitive of a mesh with the bound program
+	void DrawMesh(int mesh) const;
+	// delete the buffers and vertex arrays of every mesh
+	void Destroy();
+
+private:
+	// true when there is no OpenGL context
+	bool m_bHeadless;
+	std::vector<IMPORTED_MESH> m_meshes;
+
+	// parse the chunks of a mapped OBJ file on several threads
+	static bool DecodeOBJ(MESH_DECODE& decode, const MappedFile& file, int threadCount);
+	// read the JSON and locate the binary chunk of a .glb file
+	static bool DecodeGLB(MESH_DECODE& decode);
+	// copy the triangles of a decoded mesh for the software renderer
+	static void BuildSoftwareMesh(const MESH_DECODE& decode, IMPORTED_MESH& mesh);
+};
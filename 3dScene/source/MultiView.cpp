@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiview.cpp
+// ============
+// several cameras that share one window, each drawn into its own region
+// from a single recorded and culled draw list
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MultiView.h"
+#include "CameraBlock.h"
+
+// declaration of global variables
+namespace
+{
+	// fraction of the target covered by the inset view
+	const float INSET_SIZE = 0.3f;
+	// gap between the inset view and the edge of the target
+	const float INSET_MARGIN = 0.02f;
+}
+
+/***********************************************************
+ *  MultiView()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MultiView::MultiView()
+{
+	m_views.reserve(CameraBlock::MAX_VIEWS);
+}
+
+/***********************************************************
+ *  ~MultiView()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MultiView::~MultiView()
+{
+	m_views.clear();
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing every view.
+ ***********************************************************/
+void MultiView::Clear()
+{
+	m_views.clear();
+}
+
+/***********************************************************
+ *  AddView()
+ *
+ *  This method is used for adding a view to the layout.  The
+ *  camera block has a slot for each view, which limits their
+ *  number.
+ ***********************************************************/
+int MultiView::AddView(
+	const ViewManager::CAMERA_POSE& pose,
+	bool bFollowCamera,
+	const glm::vec4& region,
+	bool bInset)
+{
+	if ((int)m_views.size() >= CameraBlock::MAX_VIEWS)
+	{
+		return(-1);
+	}
+
+	VIEW_SETTINGS settings;
+	settings.pose = pose;
+	settings.bFollowCamera = bFollowCamera;
+	settings.region = region;
+	settings.bInset = bInset;
+	settings.x = 0;
+	settings.y = 0;
+	settings.width = 0;
+	settings.height = 0;
+	settings.view = glm::mat4(1.0f);
+	settings.projection = glm::mat4(1.0f);
+	m_views.push_back(settings);
+
+	return((int)m_views.size() - 1);
+}
+
+/***********************************************************
+ *  SetSideBySide()
+ *
+ *  This method is used for setting up the default layout: the
+ *  interactive camera on the left half, the orthographic front
+ *  view that the O key selects on the right half, and, when
+ *  asked for, a camera looking down at the table in the lower
+ *  right corner.
+ ***********************************************************/
+void MultiView::SetSideBySide(bool bInset)
+{
+	Clear();
+	AddView(ViewManager::GetDefaultPose(false), true, glm::vec4(0.0f, 0.0f, 0.5f, 1.0f), false);
+	AddView(ViewManager::GetDefaultPose(true), false, glm::vec4(0.5f, 0.0f, 0.5f, 1.0f), false);
+
+	if (bInset)
+	{
+		ViewManager::CAMERA_POSE pose = ViewManager::GetDefaultPose(false);
+		pose.position = glm::vec3(0.0f, 20.0f, 0.01f);
+		pose.front = glm::vec3(0.0f, -1.0f, 0.0f);
+		pose.up = glm::vec3(0.0f, 0.0f, -1.0f);
+		pose.zoom = 45.0f;
+		AddView(pose, false, glm::vec4(
+			1.0f - INSET_SIZE - INSET_MARGIN, INSET_MARGIN, INSET_SIZE, INSET_SIZE), true);
+	}
+}
+
+/***********************************************************
+ *  Prepare()
+ *
+ *  This method is used for calculating the pixel rectangle of
+ *  every view in a target of the passed in size, and its view
+ *  and projection for the aspect ratio of that rectangle.  The
+ *  views that follow the camera take the passed in pose.
+ ***********************************************************/
+void MultiView::Prepare(const ViewManager::CAMERA_POSE& cameraPose, int width, int height)
+{
+	for (size_t i = 0; i < m_views.size(); i++)
+	{
+		VIEW_SETTINGS& settings = m_views[i];
+		if (settings.bFollowCamera)
+		{
+			settings.pose = cameraPose;
+		}
+
+		settings.x = (int)(settings.region.x * width);
+		settings.y = (int)(settings.region.y * height);
+		settings.width = glm::max((int)(settings.region.z * width), 1);
+		settings.height = glm::max((int)(settings.region.w * height), 1);
+
+		ViewManager::CalculatePoseView(
+			settings.pose,
+			(float)settings.width / (float)settings.height,
+			settings.view,
+			settings.projection);
+	}
+}
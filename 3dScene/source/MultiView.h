@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiview.h
+// ============
+// several cameras that share one window, each drawn into its own region
+// from a single recorded and culled draw list
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ViewManager.h"
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  MultiView
+ *
+ *  This class holds the layout of the views that are shown
+ *  at the same time, such as the interactive camera next to
+ *  an orthographic front view, with an optional inset camera
+ *  drawn over a corner.  Each view has a region given as a
+ *  fraction of the target, so the layout follows the window
+ *  size.
+ *
+ *  Prepare() calculates the pixel rectangle and the matrices
+ *  of every view for a frame.  The scene is then recorded
+ *  once, culled against the frustums of all the views, and
+ *  submitted once per view into its region.
+ ***********************************************************/
+class MultiView
+{
+public:
+	// settings and per-frame values of one view
+	struct VIEW_SETTINGS
+	{
+		ViewManager::CAMERA_POSE pose;
+		// true when the view shows the interactive camera
+		bool bFollowCamera;
+		// left, bottom, width and height as fractions of the target
+		glm::vec4 region;
+		// true when the view is drawn over the views before it,
+		// its region is cleared first
+		bool bInset;
+		// pixel rectangle calculated by Prepare()
+		int x;
+		int y;
+		int width;
+		int height;
+		// matrices calculated by Prepare()
+		glm::mat4 view;
+		glm::mat4 projection;
+	};
+
+	// constructor
+	MultiView();
+	// destructor
+	~MultiView();
+
+	// remove every view
+	void Clear();
+	// add a view, returns its index or -1 when the layout is full
+	int AddView(
+		const ViewManager::CAMERA_POSE& pose,
+		bool bFollowCamera,
+		const glm::vec4& region,
+		bool bInset);
+	// lay out the interactive camera on the left and the
+	// orthographic front view on the right, with an optional
+	// top down inset in the lower right corner
+	void SetSideBySide(bool bInset);
+
+	// calculate the rectangles and matrices of the views for a
+	// target of the passed in size
+	void Prepare(const ViewManager::CAMERA_POSE& cameraPose, int width, int height);
+
+	// number of views in the layout
+	int GetViewCount() const { return((int)m_views.size()); }
+	// settings of a view, valid after Prepare()
+	const VIEW_SETTINGS& GetView(int view) const { return(m_views[view]); }
+
+private:
+	std::vector<VIEW_SETTINGS> m_views;
+};
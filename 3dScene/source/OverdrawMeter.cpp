@@ -0,0 +1,350 @@
+///////////////////////////////////////////////////////////////////////////////
+// overdrawmeter.cpp
+// ============
+// count the fragments shaded per pixel and show the overdraw of the
+// scene as a heatmap
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OverdrawMeter.h"
+#include "GLStateCache.h"
+#include "FrameRingBuffer.h"
+#include "CameraBlock.h"
+#include "ResourceRegistry.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texture unit of the count target in the heatmap pass,
+	// above the units of the transparency targets
+	const int OVERDRAW_UNIT = 23;
+	// weight of a new frame in the averaged count
+	const float AVERAGE_WEIGHT = 0.1f;
+}
+
+/***********************************************************
+ *  OverdrawMeter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OverdrawMeter::OverdrawMeter()
+{
+	m_pCountShader = new ShaderManager();
+	m_pCountShader->m_programID = 0;
+	m_pHeatmapShader = new ShaderManager();
+	m_pHeatmapShader->m_programID = 0;
+
+	glGenQueries(QUERY_LATENCY, m_queries);
+	for (int i = 0; i < QUERY_LATENCY; i++)
+	{
+		m_queryPixels[i] = 0;
+		m_bQueryPending[i] = false;
+	}
+	m_currentQuery = 0;
+	m_bCounting = false;
+	m_fragmentsPerPixel = 0.0f;
+
+	m_countFBO = 0;
+	m_countTexture = 0;
+	m_depthBuffer = 0;
+	m_emptyVAO = 0;
+	m_width = 0;
+	m_height = 0;
+	m_targetFramebuffer = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+}
+
+/***********************************************************
+ *  ~OverdrawMeter()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OverdrawMeter::~OverdrawMeter()
+{
+	glDeleteQueries(QUERY_LATENCY, m_queries);
+	DestroyBuffers();
+	if (0 != m_emptyVAO)
+	{
+		GLStateCache::DeleteVertexArrays(1, &m_emptyVAO);
+		m_emptyVAO = 0;
+	}
+	if (NULL != m_pCountShader)
+	{
+		delete m_pCountShader;
+		m_pCountShader = NULL;
+	}
+	if (NULL != m_pHeatmapShader)
+	{
+		delete m_pHeatmapShader;
+		m_pHeatmapShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for building the count program, which
+ *  reads the draws like the scene programs, and the heatmap
+ *  program.  Both are small, so they are built right away.
+ ***********************************************************/
+bool OverdrawMeter::LoadShaders(
+	ShaderCache* pShaderCache,
+	const char* countVertexShaderPath,
+	const char* countFragmentShaderPath,
+	const char* heatmapVertexShaderPath,
+	const char* heatmapFragmentShaderPath,
+	const std::string& defines)
+{
+	if (!pShaderCache->LoadShaders(m_pCountShader, countVertexShaderPath, countFragmentShaderPath, defines))
+	{
+		m_pCountShader->m_programID = 0;
+		return(false);
+	}
+	FrameRingBuffer::BindProgramBlocks(m_pCountShader->m_programID);
+	CameraBlock::BindProgramBlock(m_pCountShader->m_programID);
+
+	if (!pShaderCache->LoadShaders(m_pHeatmapShader, heatmapVertexShaderPath, heatmapFragmentShaderPath))
+	{
+		m_pHeatmapShader->m_programID = 0;
+		return(false);
+	}
+	GLStateCache::UseProgram(m_pHeatmapShader->m_programID);
+	m_pHeatmapShader->setSampler2DValue("overdrawTexture", OVERDRAW_UNIT);
+
+	// the full screen triangle is generated in the vertex shader
+	// but core profile still requires a bound vertex array
+	glGenVertexArrays(1, &m_emptyVAO);
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsReady()
+ *
+ *  This method is used for checking whether both programs of
+ *  the heatmap view are built.
+ ***********************************************************/
+bool OverdrawMeter::IsReady() const
+{
+	return((0 != m_pCountShader->m_programID) && (0 != m_pHeatmapShader->m_programID));
+}
+
+/***********************************************************
+ *  SetTarget()
+ *
+ *  This method is used for setting the framebuffer that the
+ *  scene is rendered into and the rendered size, which is the
+ *  number of pixels the fragment count is divided by.
+ ***********************************************************/
+void OverdrawMeter::SetTarget(GLuint framebuffer, int width, int height)
+{
+	m_targetFramebuffer = framebuffer;
+	m_targetWidth = width;
+	m_targetHeight = height;
+}
+
+/***********************************************************
+ *  ResolveQuery()
+ *
+ *  This method is used for reading a query that was issued
+ *  QUERY_LATENCY frames ago.  When the GPU has fallen even
+ *  further behind, the result is dropped instead of waiting.
+ ***********************************************************/
+void OverdrawMeter::ResolveQuery(int query)
+{
+	if (!m_bQueryPending[query])
+	{
+		return;
+	}
+	m_bQueryPending[query] = false;
+
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+	if ((available != GL_TRUE) || (m_queryPixels[query] <= 0))
+	{
+		return;
+	}
+
+	GLuint64 samples = 0;
+	glGetQueryObjectui64v(m_queries[query], GL_QUERY_RESULT, &samples);
+	float fragmentsPerPixel = (float)((double)samples / (double)m_queryPixels[query]);
+	m_fragmentsPerPixel += (fragmentsPerPixel - m_fragmentsPerPixel) * AVERAGE_WEIGHT;
+}
+
+/***********************************************************
+ *  BeginCount()
+ *
+ *  This method is used for starting to count the fragments
+ *  that pass the depth test.  Only one count can run at a
+ *  time, a nested call is ignored.
+ ***********************************************************/
+void OverdrawMeter::BeginCount()
+{
+	if (m_bCounting || (m_targetWidth <= 0) || (m_targetHeight <= 0))
+	{
+		return;
+	}
+
+	ResolveQuery(m_currentQuery);
+	glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_currentQuery]);
+	m_queryPixels[m_currentQuery] = m_targetWidth * m_targetHeight;
+	m_bCounting = true;
+}
+
+/***********************************************************
+ *  EndCount()
+ *
+ *  This method is used for stopping the count started by
+ *  BeginCount() and moving on to the next query.
+ ***********************************************************/
+void OverdrawMeter::EndCount()
+{
+	if (!m_bCounting)
+	{
+		return;
+	}
+
+	glEndQuery(GL_SAMPLES_PASSED);
+	m_bQueryPending[m_currentQuery] = true;
+	m_currentQuery = (m_currentQuery + 1) % QUERY_LATENCY;
+	m_bCounting = false;
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for allocating the count target.  A
+ *  half float channel counts far beyond any real overdraw.
+ ***********************************************************/
+bool OverdrawMeter::CreateBuffers(int width, int height)
+{
+	DestroyBuffers();
+
+	glGenFramebuffers(1, &m_countFBO);
+	GLStateCache::BindFramebuffer(m_countFBO);
+
+	glGenTextures(1, &m_countTexture);
+	GLStateCache::BindTextureForUpdate(m_countTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_HALF_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_countTexture, 0);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Overdraw framebuffer is not complete" << std::endl;
+		GLStateCache::BindFramebuffer(0);
+		DestroyBuffers();
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+
+	ResourceRegistry::Track(GL_TEXTURE, m_countTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_R16F, width, height, false), "overdraw count");
+	ResourceRegistry::Track(GL_RENDERBUFFER, m_depthBuffer, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_DEPTH_COMPONENT24, width, height, false), "overdraw depth");
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyBuffers()
+ *
+ *  This method is used for freeing the count target.
+ ***********************************************************/
+void OverdrawMeter::DestroyBuffers()
+{
+	if (0 != m_countTexture)
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_countTexture);
+		GLStateCache::DeleteTextures(1, &m_countTexture);
+		m_countTexture = 0;
+	}
+	if (0 != m_depthBuffer)
+	{
+		ResourceRegistry::Release(GL_RENDERBUFFER, 1, &m_depthBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	if (0 != m_countFBO)
+	{
+		GLStateCache::DeleteFramebuffers(1, &m_countFBO);
+		m_countFBO = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  BeginHeatmap()
+ *
+ *  This method is used for binding the cleared count target.
+ *  The draws are depth tested as in the shading pass and every
+ *  fragment that passes adds one to its pixel.
+ ***********************************************************/
+bool OverdrawMeter::BeginHeatmap()
+{
+	if (!IsReady() || (m_targetWidth <= 0) || (m_targetHeight <= 0))
+	{
+		return(false);
+	}
+
+	if ((m_targetWidth > m_width) || (m_targetHeight > m_height))
+	{
+		int width = (m_targetWidth > m_width) ? m_targetWidth : m_width;
+		int height = (m_targetHeight > m_height) ? m_targetHeight : m_height;
+		if (!CreateBuffers(width, height))
+		{
+			return(false);
+		}
+	}
+
+	GLStateCache::BindFramebuffer(m_countFBO);
+	GLStateCache::Viewport(0, 0, m_targetWidth, m_targetHeight);
+
+	const GLfloat clearCount[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLfloat clearDepth = 1.0f;
+	GLStateCache::DepthMask(true);
+	glClearBufferfv(GL_COLOR, 0, clearCount);
+	glClearBufferfv(GL_DEPTH, 0, &clearDepth);
+
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+	GLStateCache::SetEnabled(GL_BLEND, true);
+	GLStateCache::BlendFunc(GL_ONE, GL_ONE);
+	GLStateCache::UseProgram(m_pCountShader->m_programID);
+
+	return(true);
+}
+
+/***********************************************************
+ *  ResolveHeatmap()
+ *
+ *  This method is used for coloring the pixels of the target
+ *  by their counts and restoring the state of the scene draws.
+ ***********************************************************/
+void OverdrawMeter::ResolveHeatmap()
+{
+	GLStateCache::BindFramebuffer(m_targetFramebuffer);
+	GLStateCache::Viewport(0, 0, m_targetWidth, m_targetHeight);
+	GLStateCache::SetEnabled(GL_BLEND, false);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
+
+	GLStateCache::UseProgram(m_pHeatmapShader->m_programID);
+	GLStateCache::BindTexture(OVERDRAW_UNIT, m_countTexture);
+
+	GLStateCache::BindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	// restore the state that the forward path relies on
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// overdrawmeter.h
+// ============
+// count the fragments shaded per pixel and show the overdraw of the
+// scene as a heatmap
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderCache.h"
+
+#include <string>
+
+/***********************************************************
+ *  OverdrawMeter
+ *
+ *  This class measures how often the fragment shader runs for
+ *  each pixel of the scene.  A GL_SAMPLES_PASSED query around
+ *  the shading draws counts the fragments that pass the depth
+ *  test, which is divided by the pixels of the target.  The
+ *  queries are read a few frames later, so the count never
+ *  stalls the pipeline.
+ *
+ *  The heatmap view draws the scene with a program that adds
+ *  one to a count target for every fragment, and then colors
+ *  each pixel of the target by its count.  With the depth
+ *  pre-pass every covered pixel should show one fragment.
+ ***********************************************************/
+class OverdrawMeter
+{
+public:
+	// constructor
+	OverdrawMeter();
+	// destructor
+	~OverdrawMeter();
+
+	// build the count program with the defines of the scene
+	// programs, and the heatmap program
+	bool LoadShaders(
+		ShaderCache* pShaderCache,
+		const char* countVertexShaderPath,
+		const char* countFragmentShaderPath,
+		const char* heatmapVertexShaderPath,
+		const char* heatmapFragmentShaderPath,
+		const std::string& defines);
+	// true once both programs are built
+	bool IsReady() const;
+
+	// set the framebuffer and size the scene is rendered into
+	void SetTarget(GLuint framebuffer, int width, int height);
+
+	// start counting the fragments of the shading draws
+	void BeginCount();
+	// stop counting, the result is read a few frames later
+	void EndCount();
+	// averaged fragments that passed the depth test per pixel
+	float GetFragmentsPerPixel() const { return(m_fragmentsPerPixel); }
+
+	// bind the count target for the heatmap draws
+	bool BeginHeatmap();
+	// program that adds one to the count for each fragment
+	ShaderManager* GetCountShader() const { return(m_pCountShader); }
+	// color the target by the counts of the heatmap draws
+	void ResolveHeatmap();
+
+private:
+	// number of frames in flight before a query is read
+	static const int QUERY_LATENCY = 4;
+
+	// programs of the count and of the heatmap
+	ShaderManager* m_pCountShader;
+	ShaderManager* m_pHeatmapShader;
+	// samples passed queries with the pixels of their target
+	GLuint m_queries[QUERY_LATENCY];
+	int m_queryPixels[QUERY_LATENCY];
+	bool m_bQueryPending[QUERY_LATENCY];
+	int m_currentQuery;
+	bool m_bCounting;
+	float m_fragmentsPerPixel;
+
+	// count framebuffer and its attachments
+	GLuint m_countFBO;
+	GLuint m_countTexture;
+	GLuint m_depthBuffer;
+	// empty vertex array for the full screen triangle
+	GLuint m_emptyVAO;
+	// allocated size of the attachments
+	int m_width;
+	int m_height;
+
+	// framebuffer the scene is rendered into and its size
+	GLuint m_targetFramebuffer;
+	int m_targetWidth;
+	int m_targetHeight;
+
+	// read a finished query if its result is available
+	void ResolveQuery(int query);
+	// allocate the count target for the passed in size
+	bool CreateBuffers(int width, int height);
+	// free the count target
+	void DestroyBuffers();
+};
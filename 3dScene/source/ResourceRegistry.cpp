@@ -0,0 +1,406 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourceregistry.cpp
+// ============
+// account for the memory of the OpenGL objects and the larger CPU
+// allocations of the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ResourceRegistry.h"
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdint.h>
+#include <string>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	const char* g_CategoryNames[ResourceRegistry::CATEGORY_COUNT] =
+	{
+		"textures",
+		"render targets",
+		"meshes",
+		"buffers",
+		"host memory"
+	};
+
+	// object type of the CPU allocations in the record keys
+	const GLenum HOST_OBJECT = 0;
+
+	// one tracked object
+	struct RESOURCE_ENTRY
+	{
+		ResourceRegistry::RESOURCE_CATEGORY category;
+		size_t bytes;
+		std::string label;
+	};
+
+	// records by object type and name, or by address for the CPU
+	typedef std::pair<GLenum, uintptr_t> RESOURCE_KEY;
+
+	std::mutex g_registryMutex;
+	std::map<RESOURCE_KEY, RESOURCE_ENTRY> g_resources;
+	size_t g_currentBytes[ResourceRegistry::CATEGORY_COUNT] = {};
+	size_t g_peakBytes[ResourceRegistry::CATEGORY_COUNT] = {};
+	size_t g_currentTotal = 0;
+	size_t g_peakTotal = 0;
+
+	/***********************************************************
+	 *  AddRecord()
+	 *
+	 *  Add or resize a record and update the usage, the caller
+	 *  holds the registry mutex.
+	 ***********************************************************/
+	void AddRecord(
+		const RESOURCE_KEY& key,
+		ResourceRegistry::RESOURCE_CATEGORY category,
+		size_t bytes,
+		const char* label)
+	{
+		std::map<RESOURCE_KEY, RESOURCE_ENTRY>::iterator found = g_resources.find(key);
+		if (found != g_resources.end())
+		{
+			g_currentBytes[found->second.category] -= found->second.bytes;
+			g_currentTotal -= found->second.bytes;
+		}
+
+		RESOURCE_ENTRY& entry = g_resources[key];
+		entry.category = category;
+		entry.bytes = bytes;
+		entry.label = (NULL != label) ? label : "";
+
+		g_currentBytes[category] += bytes;
+		g_currentTotal += bytes;
+		if (g_currentBytes[category] > g_peakBytes[category])
+		{
+			g_peakBytes[category] = g_currentBytes[category];
+		}
+		if (g_currentTotal > g_peakTotal)
+		{
+			g_peakTotal = g_currentTotal;
+		}
+	}
+
+	/***********************************************************
+	 *  RemoveRecord()
+	 *
+	 *  Remove a record if it exists, the caller holds the
+	 *  registry mutex.
+	 ***********************************************************/
+	void RemoveRecord(const RESOURCE_KEY& key)
+	{
+		std::map<RESOURCE_KEY, RESOURCE_ENTRY>::iterator found = g_resources.find(key);
+		if (found == g_resources.end())
+		{
+			return;
+		}
+		g_currentBytes[found->second.category] -= found->second.bytes;
+		g_currentTotal -= found->second.bytes;
+		g_resources.erase(found);
+	}
+
+	/***********************************************************
+	 *  FormatBytes()
+	 *
+	 *  Format a byte count in the unit that suits its size.
+	 ***********************************************************/
+	std::string FormatBytes(size_t bytes)
+	{
+		std::ostringstream text;
+		text << std::fixed << std::setprecision(2);
+		if (bytes >= 1024 * 1024)
+		{
+			text << bytes / (1024.0 * 1024.0) << " MB";
+		}
+		else if (bytes >= 1024)
+		{
+			text << bytes / 1024.0 << " KB";
+		}
+		else
+		{
+			text << bytes << " B";
+		}
+		return(text.str());
+	}
+
+	/***********************************************************
+	 *  ObjectTypeName()
+	 *
+	 *  Get the name of the type of a record key.
+	 ***********************************************************/
+	const char* ObjectTypeName(GLenum objectType)
+	{
+		switch (objectType)
+		{
+		case GL_TEXTURE:
+			return("texture");
+		case GL_BUFFER:
+			return("buffer");
+		case GL_RENDERBUFFER:
+			return("renderbuffer");
+		default:
+			return("host");
+		}
+	}
+
+	/***********************************************************
+	 *  PrintEntries()
+	 *
+	 *  Print every record, the caller holds the mutex.
+	 ***********************************************************/
+	void PrintEntries()
+	{
+		std::map<RESOURCE_KEY, RESOURCE_ENTRY>::const_iterator it;
+		for (it = g_resources.begin(); it != g_resources.end(); ++it)
+		{
+			std::cout << "  " << std::left << std::setw(14) << g_CategoryNames[it->second.category]
+				<< std::setw(14) << ObjectTypeName(it->first.first);
+			if (it->first.first == HOST_OBJECT)
+			{
+				std::cout << std::setw(8) << "-";
+			}
+			else
+			{
+				std::cout << std::setw(8) << it->first.second;
+			}
+			std::cout << std::right << std::setw(12) << FormatBytes(it->second.bytes)
+				<< "  " << it->second.label << std::endl;
+		}
+	}
+}
+
+/***********************************************************
+ *  Track()
+ *
+ *  This method is used for recording an OpenGL object after
+ *  its storage was allocated.  Tracking it again, such as after
+ *  a render target was resized, replaces its size.
+ ***********************************************************/
+void ResourceRegistry::Track(
+	GLenum objectType,
+	GLuint name,
+	RESOURCE_CATEGORY category,
+	size_t bytes,
+	const char* label)
+{
+	if (0 == name)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	AddRecord(RESOURCE_KEY(objectType, name), category, bytes, label);
+}
+
+/***********************************************************
+ *  Release()
+ *
+ *  This method is used for forgetting OpenGL objects when they
+ *  are deleted.
+ ***********************************************************/
+void ResourceRegistry::Release(GLenum objectType, GLsizei count, const GLuint* names)
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	for (GLsizei i = 0; i < count; i++)
+	{
+		RemoveRecord(RESOURCE_KEY(objectType, names[i]));
+	}
+}
+
+/***********************************************************
+ *  TrackHost()
+ *
+ *  This method is used for recording a CPU allocation by its
+ *  address.
+ ***********************************************************/
+void ResourceRegistry::TrackHost(const void* pMemory, size_t bytes, const char* label)
+{
+	if (NULL == pMemory)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	AddRecord(RESOURCE_KEY(HOST_OBJECT, (uintptr_t)pMemory), CATEGORY_HOST, bytes, label);
+}
+
+/***********************************************************
+ *  ReleaseHost()
+ *
+ *  This method is used for forgetting a CPU allocation before
+ *  it is freed.
+ ***********************************************************/
+void ResourceRegistry::ReleaseHost(const void* pMemory)
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	RemoveRecord(RESOURCE_KEY(HOST_OBJECT, (uintptr_t)pMemory));
+}
+
+/***********************************************************
+ *  GetTextureSize()
+ *
+ *  This method is used for calculating the bytes of a 2D image
+ *  of a sized internal format.  A mipmap chain adds every
+ *  level down to 1x1.  Formats that are not listed are counted
+ *  with four bytes per pixel.
+ ***********************************************************/
+size_t ResourceRegistry::GetTextureSize(GLenum internalFormat, int width, int height, bool bMipmaps)
+{
+	size_t bytesPerPixel = 4;
+	switch (internalFormat)
+	{
+	case GL_R8:
+	case GL_R8UI:
+		bytesPerPixel = 1;
+		break;
+	case GL_RG8:
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		bytesPerPixel = 2;
+		break;
+	case GL_RGB8:
+		bytesPerPixel = 3;
+		break;
+	case GL_RGB16F:
+		bytesPerPixel = 6;
+		break;
+	case GL_RGBA16F:
+	case GL_RG32F:
+	case GL_DEPTH32F_STENCIL8:
+		bytesPerPixel = 8;
+		break;
+	case GL_RGBA32F:
+		bytesPerPixel = 16;
+		break;
+	default:
+		// RGBA8, RG16, R32F, the packed formats, and 24 bit depth,
+		// which is stored in 32 bits
+		bytesPerPixel = 4;
+		break;
+	}
+
+	size_t bytes = 0;
+	int levelWidth = (width > 0) ? width : 0;
+	int levelHeight = (height > 0) ? height : 0;
+	while (true)
+	{
+		bytes += (size_t)levelWidth * levelHeight * bytesPerPixel;
+		if (!bMipmaps || ((levelWidth <= 1) && (levelHeight <= 1)))
+		{
+			break;
+		}
+		levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+		levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+	}
+
+	return(bytes);
+}
+
+/***********************************************************
+ *  GetCurrentBytes()
+ *
+ *  This method is used for getting the bytes that are tracked
+ *  right now in a category.
+ ***********************************************************/
+size_t ResourceRegistry::GetCurrentBytes(RESOURCE_CATEGORY category)
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	return(g_currentBytes[category]);
+}
+
+/***********************************************************
+ *  GetPeakBytes()
+ *
+ *  This method is used for getting the most bytes that were
+ *  tracked at once in a category.
+ ***********************************************************/
+size_t ResourceRegistry::GetPeakBytes(RESOURCE_CATEGORY category)
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	return(g_peakBytes[category]);
+}
+
+/***********************************************************
+ *  GetCurrentBytes()
+ *
+ *  This method is used for getting the bytes that are tracked
+ *  right now over all categories.
+ ***********************************************************/
+size_t ResourceRegistry::GetCurrentBytes()
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	return(g_currentTotal);
+}
+
+/***********************************************************
+ *  GetPeakBytes()
+ *
+ *  This method is used for getting the most bytes that were
+ *  tracked at once over all categories.
+ ***********************************************************/
+size_t ResourceRegistry::GetPeakBytes()
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+	return(g_peakTotal);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the current and the peak
+ *  usage of each category to the console.
+ ***********************************************************/
+void ResourceRegistry::PrintReport()
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+
+	std::cout << "Memory                   current        peak" << std::endl;
+	for (int i = 0; i < CATEGORY_COUNT; i++)
+	{
+		std::cout << "  " << std::left << std::setw(18) << g_CategoryNames[i] << std::right
+			<< std::setw(12) << FormatBytes(g_currentBytes[i])
+			<< std::setw(12) << FormatBytes(g_peakBytes[i]) << std::endl;
+	}
+	std::cout << "  " << std::left << std::setw(18) << "total" << std::right
+		<< std::setw(12) << FormatBytes(g_currentTotal)
+		<< std::setw(12) << FormatBytes(g_peakTotal) << std::endl;
+}
+
+/***********************************************************
+ *  Dump()
+ *
+ *  This method is used for printing every tracked object with
+ *  its size and label to the console.
+ ***********************************************************/
+void ResourceRegistry::Dump()
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+
+	std::cout << "Tracked resources: " << g_resources.size()
+		<< ", " << FormatBytes(g_currentTotal) << std::endl;
+	PrintEntries();
+}
+
+/***********************************************************
+ *  ReportLeaks()
+ *
+ *  This method is used for printing the objects that were not
+ *  released.  It is called after every manager object has been
+ *  deleted, so anything left over was never freed.
+ ***********************************************************/
+int ResourceRegistry::ReportLeaks()
+{
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+
+	if (!g_resources.empty())
+	{
+		std::cout << "WARNING: " << g_resources.size() << " resources with "
+			<< FormatBytes(g_currentTotal) << " were not released" << std::endl;
+		PrintEntries();
+	}
+	return((int)g_resources.size());
+}
@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// resourceregistry.h
+// ============
+// account for the memory of the OpenGL objects and the larger CPU
+// allocations of the renderer
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  ResourceRegistry
+ *
+ *  This class keeps a record of every live OpenGL object that
+ *  holds memory, with its category, its size in bytes and a
+ *  label, and of the larger CPU allocations.  The code that
+ *  creates or resizes an object tracks it and the code that
+ *  deletes it releases it, so the registry knows the current
+ *  and the peak usage per category.  Objects still tracked at
+ *  shutdown are reported as leaks.
+ *
+ *  The sizes are calculated from the formats, so they are the
+ *  memory the objects need, not what a driver may add for
+ *  alignment.  The records are guarded by a mutex, because the
+ *  software renderers track their buffers from several threads.
+ ***********************************************************/
+class ResourceRegistry
+{
+public:
+	// kinds of memory that are accounted separately
+	enum RESOURCE_CATEGORY
+	{
+		// textures of the scene materials
+		CATEGORY_TEXTURE,
+		// color and depth targets of the render passes
+		CATEGORY_RENDER_TARGET,
+		// vertex and index buffers
+		CATEGORY_MESH,
+		// uniform, readback and other buffers
+		CATEGORY_BUFFER,
+		// CPU memory
+		CATEGORY_HOST,
+		CATEGORY_COUNT
+	};
+
+	// record an OpenGL object, or its new size when it is already
+	// tracked, the type is GL_TEXTURE, GL_BUFFER or GL_RENDERBUFFER
+	static void Track(
+		GLenum objectType,
+		GLuint name,
+		RESOURCE_CATEGORY category,
+		size_t bytes,
+		const char* label);
+	// forget OpenGL objects that are deleted, names that are not
+	// tracked are ignored
+	static void Release(GLenum objectType, GLsizei count, const GLuint* names);
+
+	// record or forget a CPU allocation
+	static void TrackHost(const void* pMemory, size_t bytes, const char* label);
+	static void ReleaseHost(const void* pMemory);
+
+	// size of a 2D texture or renderbuffer of a sized internal
+	// format, optionally with its full mipmap chain
+	static size_t GetTextureSize(GLenum internalFormat, int width, int height, bool bMipmaps);
+
+	// current and peak bytes of a category or of all of them
+	static size_t GetCurrentBytes(RESOURCE_CATEGORY category);
+	static size_t GetPeakBytes(RESOURCE_CATEGORY category);
+	static size_t GetCurrentBytes();
+	static size_t GetPeakBytes();
+
+	// print the current and peak usage by category
+	static void PrintReport();
+	// print every tracked object
+	static void Dump();
+	// print the objects that are still tracked, called at shutdown
+	// after everything was released, returns their number
+	static int ReportLeaks();
+};
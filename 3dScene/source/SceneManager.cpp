@@ -8,6 +8,18 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "ShaderPermutations.h"
+#include "FrameRingBuffer.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+#include "FrameArena.h"
+#include "StartupGraph.h"
+#include "WeightedTransparency.h"
+#include "DepthPrepass.h"
+#include "OverdrawMeter.h"
+#include "CameraBlock.h"
+#include "LightmapBaker.h"
+#include "GpuCulling.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,32 +28,180 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	// the uniform names are kept as strings, because the shader
+	// manager takes them by reference and would otherwise build
+	// a temporary string for every call
+	const std::string g_ModelName = "model";
+	const std::string g_ColorValueName = "objectColor";
+	const std::string g_TextureValueName = "objectTexture";
+	const std::string g_UVScaleName = "UVscale";
+	const std::string g_UseTextureName = "bUseTexture";
+	const std::string g_UseLightingName = "bUseLighting";
+	const std::string g_MaterialIndexName = "materialIndex";
+	const std::string g_DrawIndexName = "drawIndex";
+	const std::string g_MaterialAmbientColorName = "material.ambientColor";
+	const std::string g_MaterialAmbientStrengthName = "material.ambientStrength";
+	const std::string g_MaterialDiffuseColorName = "material.diffuseColor";
+	const std::string g_MaterialSpecularColorName = "material.specularColor";
+	const std::string g_MaterialShininessName = "material.shininess";
+	const std::string g_MaterialOpacityName = "materialOpacity";
+	const std::string g_LightmapName = "lightmap";
+	const std::string g_LightmapRectName = "lightmapRect";
+
+	// image file and tag of a scene texture
+	struct SCENE_TEXTURE
+	{
+		const char* filename;
+		const char* tag;
+	};
+
+	// the scene textures in the order of their texture slots
+	const SCENE_TEXTURE g_SceneTextures[] =
+	{
+		{ "debug\\textures\\wood.jpg", "wood" },
+		{ "debug\\textures\\ceramic.jpg", "ceramic" },
+		{ "debug\\textures\\fabric.jpg", "fabric" },
+		{ "debug\\textures\\glass.jpg", "glass" },
+		{ "debug\\textures\\wall.jpg", "wall" }
+	};
+	const int SCENE_TEXTURE_COUNT = sizeof(g_SceneTextures) / sizeof(g_SceneTextures[0]);
+
+	// mesh file and tag of a scene prop, a prop whose file is
+	// missing is left out of the scene
+	struct SCENE_MESH
+	{
+		const char* filename;
+		const char* tag;
+	};
+
+	const SCENE_MESH g_SceneMeshes[] =
+	{
+		{ "debug\\meshes\\wine_bottle.glb", "wine bottle" },
+		{ "debug\\meshes\\bread_loaf.obj", "bread loaf" }
+	};
+	const int SCENE_MESH_COUNT = sizeof(g_SceneMeshes) / sizeof(g_SceneMeshes[0]);
+
+	// passes of the forward path, the opaque draws come first
+	enum DRAW_PASS
+	{
+		OPAQUE_PASS,
+		TRANSPARENT_PASS
+	};
+
+	// distance range of the camera that the opaque draws are
+	// grouped into, so draws in one range still share state
+	const float OPAQUE_DEPTH_RANGE = 2.0f;
+
+	// the sort order of a recorded draw
+	struct DRAW_SORT_ENTRY
+	{
+		int pass;
+		// squared distance from the camera for the transparent
+		// pass, distance range for the opaque pass
+		float depth;
+		unsigned int shaderKey;
+		int textureSlot;
+		int materialIndex;
+		int mesh;
+		int draw;
+	};
+
+	// sphere around a basic mesh in its own coordinates
+	struct MESH_BOUNDS
+	{
+		glm::vec3 center;
+		float radius;
+	};
+
+	// the bounds of the basic meshes in the order of MESH_TYPE:
+	// the unit box, the cone and cylinder standing on y = 0, the
+	// 2 by 2 plane, the unit sphere and the torus
+	const MESH_BOUNDS g_MeshBounds[] =
+	{
+		{ glm::vec3(0.0f, 0.0f, 0.0f), 0.867f },
+		{ glm::vec3(0.0f, 0.5f, 0.0f), 1.119f },
+		{ glm::vec3(0.0f, 0.5f, 0.0f), 1.119f },
+		{ glm::vec3(0.0f, 0.0f, 0.0f), 1.415f },
+		{ glm::vec3(0.0f, 0.0f, 0.0f), 1.0f },
+		{ glm::vec3(0.0f, 0.0f, 0.0f), 1.3f }
+	};
 }
 
 /***********************************************************
  *  SceneManager()
  *
- *  The constructor for the class
+ *  The constructor for the class.  Without a shader manager
+ *  there is no OpenGL context: the textures are only decoded
+ *  into memory and RenderScene() only records the draw list,
+ *  which the software renderer reads.
  ***********************************************************/
 SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
+	m_pDefaultShaderManager = pShaderManager;
+	m_drawSubset = ALL_DRAWS;
+	m_bHeadless = (NULL == pShaderManager);
+	m_pShaderPermutations = NULL;
+	m_pFrameRingBuffer = NULL;
+	m_pFrameArena = NULL;
+	m_pWeightedTransparency = NULL;
+	m_pDepthPrepass = NULL;
+	m_pOverdrawMeter = NULL;
+	m_pLightmap = NULL;
+	m_lightmapSurfaceCount = 0;
+	m_pGpuCulling = NULL;
+	m_bGpuObjectsDirty = true;
+	m_bGpuLightmap = false;
+	m_bGpuBatchesReady = false;
+	m_bHostDrawsOnly = false;
+	m_viewCount = 0;
+	for (int i = 0; i < MAX_VIEWS; i++)
+	{
+		CameraBlock::CalculateFrustumPlanes(glm::mat4(1.0f), m_views[i].frustumPlanes);
+		m_views[i].position = glm::vec3(0.0f);
+		m_views[i].viewProjection = glm::mat4(1.0f);
+		m_views[i].visibleCount = 0;
+	}
 	m_basicMeshes = new ShapeMeshes();
+	m_pMeshImporter = new MeshImporter(m_bHeadless);
 	// initialize the texture collection
 	for (int i = 0; i < 16; i++)
 	{
 		m_textureIDs[i].tag = "/0";
+		m_textureIDs[i].filename.clear();
 		m_textureIDs[i].ID = -1;
+		m_textureIDs[i].bHasAlpha = false;
+		m_textureImages[i].width = 0;
+		m_textureImages[i].height = 0;
+		m_textureImages[i].channels = 0;
 	}
 	m_loadedTextures = 0;
+	m_bUseLighting = false;
+	m_bSceneDirty = true;
+	m_sceneVersion = 0;
+
+	// initialize the settings for the first recorded draw
+	m_currentDraw.mesh = BOX_MESH;
+	m_currentDraw.importedMesh = -1;
+	m_currentDraw.model = glm::mat4(1.0f);
+	m_currentDraw.color = glm::vec4(1.0f);
+	m_currentDraw.bUseTexture = false;
+	m_currentDraw.textureSlot = 0;
+	m_currentDraw.UVscale = glm::vec2(1.0f, 1.0f);
+	m_currentDraw.materialIndex = -1;
+	m_currentDraw.shaderKey = 0;
+	m_currentDraw.bTransparent = false;
+	m_currentDraw.viewMask = ~0u;
+	m_currentDraw.bStatic = false;
+	m_currentDraw.lightmapSurface = -1;
 }
 
 /***********************************************************
@@ -58,9 +218,24 @@ SceneManager::~SceneManager()
 		delete m_basicMeshes;
 		m_basicMeshes = NULL;
 	}
+	if (NULL != m_pMeshImporter)
+	{
+		delete m_pMeshImporter;
+		m_pMeshImporter = NULL;
+	}
 
 	// free the allocated OpenGL textures
-	DestroyGLTextures();
+	if (!m_bHeadless)
+	{
+		DestroyGLTextures();
+	}
+	else
+	{
+		for (int i = 0; i < m_loadedTextures; i++)
+		{
+			ResourceRegistry::ReleaseHost(m_textureImages[i].pixels.data());
+		}
+	}
 }
 
 /***********************************************************
@@ -73,68 +248,176 @@ SceneManager::~SceneManager()
  ***********************************************************/
 bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
+	TEXTURE_DECODE decode;
+	decode.filename = filename;
+	decode.tag = tag;
 
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
 
+	DecodeTexture(decode);
+	return(UploadTexture(decode));
+}
+
+/***********************************************************
+ *  DecodeTexture()
+ *
+ *  This method is used for parsing the image data from the
+ *  image file of a texture.  The vertical flip is a global
+ *  setting of stb_image, so it has to be set by the caller
+ *  before the images are decoded.
+ ***********************************************************/
+bool SceneManager::DecodeTexture(TEXTURE_DECODE& decode)
+{
+	decode.width = 0;
+	decode.height = 0;
+	decode.channels = 0;
+
 	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
+	decode.pixels = stbi_load(
+		decode.filename.c_str(),
+		&decode.width,
+		&decode.height,
+		&decode.channels,
 		0);
 
-	// if the image was successfully read from the image file
-	if (image)
+	return(NULL != decode.pixels);
+}
+
+/***********************************************************
+ *  FreeTextureDecode()
+ *
+ *  This method is used for freeing the pixels of a decoded
+ *  image that is dropped without being uploaded.
+ ***********************************************************/
+void SceneManager::FreeTextureDecode(TEXTURE_DECODE& decode)
+{
+	if (NULL != decode.pixels)
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+		stbi_image_free(decode.pixels);
+		decode.pixels = NULL;
+	}
+}
 
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
+/***********************************************************
+ *  UploadTexture()
+ *
+ *  This method is used for configuring the texture mapping
+ *  parameters of a decoded image in OpenGL, generating the
+ *  mipmaps and registering it in the next texture slot.  With
+ *  the slot of a loaded texture, the new texture takes its
+ *  place and the old one is freed, so the draws that use the
+ *  slot pick up the new image without any other change.
+ ***********************************************************/
+bool SceneManager::UploadTexture(TEXTURE_DECODE& decode, int textureSlot)
+{
+	const char* filename = decode.filename.c_str();
+	int width = decode.width;
+	int height = decode.height;
+	int colorChannels = decode.channels;
+	unsigned char* image = decode.pixels;
+	GLuint textureID = 0;
 
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	// if the image was not read from the image file
+	if (NULL == image)
+	{
+		std::cout << "Could not load image:" << filename << std::endl;
+		return false;
+	}
+	decode.pixels = NULL;
 
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
+	std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		stbi_image_free(image);
+		return false;
+	}
 
-		// free the image data from local memory
+	bool bReplace = (textureSlot >= 0) && (textureSlot < m_loadedTextures);
+	int slot = bReplace ? textureSlot : m_loadedTextures;
+	if (slot >= 16)
+	{
+		std::cout << "No free texture slot for image:" << filename << std::endl;
 		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+		return false;
+	}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	// without an OpenGL context the decoded image is kept
+	// in memory for the software renderer
+	if (m_bHeadless)
+	{
+		TEXTURE_IMAGE& textureImage = m_textureImages[slot];
+		if (bReplace)
+		{
+			ResourceRegistry::ReleaseHost(textureImage.pixels.data());
+		}
+		textureImage.width = width;
+		textureImage.height = height;
+		textureImage.channels = colorChannels;
+		textureImage.pixels.assign(image, image + width * height * colorChannels);
+		stbi_image_free(image);
+		ResourceRegistry::TrackHost(textureImage.pixels.data(), textureImage.pixels.size(), filename);
+
+		m_textureIDs[slot].ID = 0;
+		m_textureIDs[slot].tag = decode.tag;
+		m_textureIDs[slot].filename = decode.filename;
+		m_textureIDs[slot].bHasAlpha = (colorChannels == 4);
+		if (!bReplace)
+		{
+			m_loadedTextures++;
+		}
 
 		return true;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	glGenTextures(1, &textureID);
+	GLStateCache::BindTextureForUpdate(textureID);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// if the loaded image is in RGB format
+	if (colorChannels == 3)
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
+	// if the loaded image is in RGBA format - it supports transparency
+	else
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	ResourceRegistry::Track(GL_TEXTURE, textureID, ResourceRegistry::CATEGORY_TEXTURE,
+		ResourceRegistry::GetTextureSize((colorChannels == 4) ? GL_RGBA8 : GL_RGB8, width, height, true),
+		filename);
+
+	// free the image data from local memory
+	stbi_image_free(image);
+
+	// the replaced texture is only deleted once its successor
+	// exists, so a failed upload leaves the old image in place
+	if (bReplace)
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_textureIDs[slot].ID);
+		GLStateCache::DeleteTextures(1, &m_textureIDs[slot].ID);
+	}
+
+	// register the loaded texture and associate it with the special tag string
+	m_textureIDs[slot].ID = textureID;
+	m_textureIDs[slot].tag = decode.tag;
+	m_textureIDs[slot].filename = decode.filename;
+	m_textureIDs[slot].bHasAlpha = (colorChannels == 4);
+	if (!bReplace)
+	{
+		m_loadedTextures++;
+	}
 
-	// Error loading the image
-	return false;
+	return true;
 }
 
 /***********************************************************
@@ -145,11 +428,15 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
+	if (m_bHeadless)
+	{
+		return;
+	}
+
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
 		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		GLStateCache::BindTexture(i, m_textureIDs[i].ID);
 	}
 }
 
@@ -163,17 +450,80 @@ void SceneManager::DestroyGLTextures()
 {
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_textureIDs[i].ID);
+		GLStateCache::DeleteTextures(1, &m_textureIDs[i].ID);
+		m_textureIDs[i].ID = 0;
+	}
+}
+
+/***********************************************************
+ *  GetTextureImage()
+ *
+ *  This method is used for getting the decoded image of a
+ *  loaded texture.  The images are only kept when the scene
+ *  is prepared without an OpenGL context.
+ ***********************************************************/
+const SceneManager::TEXTURE_IMAGE* SceneManager::GetTextureImage(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= m_loadedTextures) ||
+		m_textureImages[textureSlot].pixels.empty())
+	{
+		return(NULL);
+	}
+
+	return(&m_textureImages[textureSlot]);
+}
+
+/***********************************************************
+ *  GetTextureFiles()
+ *
+ *  This method is used for getting the image files the
+ *  loaded textures were read from, indexed by texture slot.
+ ***********************************************************/
+void SceneManager::GetTextureFiles(std::vector<std::string>& files) const
+{
+	files.clear();
+	for (int i = 0; i < m_loadedTextures; i++)
+	{
+		files.push_back(m_textureIDs[i].filename);
 	}
 }
 
+/***********************************************************
+ *  ReloadTexture()
+ *
+ *  This method is used for replacing the image of a loaded
+ *  texture with an image decoded from its changed file.  The
+ *  texture keeps its slot and tag, and the textures are bound
+ *  again, so the next frame samples the new image.
+ ***********************************************************/
+bool SceneManager::ReloadTexture(int textureSlot, TEXTURE_DECODE& decode)
+{
+	if ((textureSlot < 0) || (textureSlot >= m_loadedTextures))
+	{
+		FreeTextureDecode(decode);
+		return(false);
+	}
+
+	decode.tag = m_textureIDs[textureSlot].tag;
+	if (!UploadTexture(decode, textureSlot))
+	{
+		return(false);
+	}
+
+	BindGLTextures();
+	MarkDirty();
+
+	return(true);
+}
+
 /***********************************************************
  *  FindTextureID()
  *
  *  This method is used for getting an ID for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::FindTextureID(const std::string& tag)
 {
 	int textureID = -1;
 	int index = 0;
@@ -199,7 +549,7 @@ int SceneManager::FindTextureID(std::string tag)
  *  This method is used for getting a slot index for the previously
  *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+int SceneManager::FindTextureSlot(const std::string& tag)
 {
 	int textureSlot = -1;
 	int index = 0;
@@ -225,7 +575,7 @@ int SceneManager::FindTextureSlot(std::string tag)
  *  This method is used for getting a material from the previously
  *  defined materials list that is associated with the passed in tag.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
 {
 	if (m_objectMaterials.size() == 0)
 	{
@@ -244,6 +594,7 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 			material.diffuseColor = m_objectMaterials[index].diffuseColor;
 			material.specularColor = m_objectMaterials[index].specularColor;
 			material.shininess = m_objectMaterials[index].shininess;
+			material.opacity = m_objectMaterials[index].opacity;
 		}
 		else
 		{
@@ -254,6 +605,155 @@ bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
 	return(true);
 }
 
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a material
+ *  in the defined materials list that is associated with the
+ *  passed in tag, or -1 if there is no such material.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const std::string& tag)
+{
+	int index = 0;
+	while (index < (int)m_objectMaterials.size())
+	{
+		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		{
+			return(index);
+		}
+		index++;
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  SetShaderManager()
+ *
+ *  This method is used for redirecting the draw settings to
+ *  another shader program, such as the G-buffer program of
+ *  the deferred shading path.
+ ***********************************************************/
+void SceneManager::SetShaderManager(ShaderManager* pShaderManager)
+{
+	m_pShaderManager = pShaderManager;
+}
+
+/***********************************************************
+ *  SetDrawSubset()
+ *
+ *  This method is used for selecting the recorded draws that
+ *  the next submissions send.  The G-buffer only holds the
+ *  opaque lit draws, the others are drawn by the forward path
+ *  over the lit result.
+ ***********************************************************/
+void SceneManager::SetDrawSubset(DRAW_SUBSET subset)
+{
+	m_drawSubset = subset;
+}
+
+/***********************************************************
+ *  SetShaderPermutations()
+ *
+ *  This method is used for setting the specialized program
+ *  variants.  They are only used while the draw settings go
+ *  to the shader manager passed to the constructor.
+ ***********************************************************/
+void SceneManager::SetShaderPermutations(ShaderPermutations* pShaderPermutations)
+{
+	m_pShaderPermutations = pShaderPermutations;
+}
+
+/***********************************************************
+ *  SetFrameRingBuffer()
+ *
+ *  This method is used for setting the ring buffer that the
+ *  settings of the recorded draws are written into.  The scene
+ *  programs must be built with its shader defines.
+ ***********************************************************/
+void SceneManager::SetFrameRingBuffer(FrameRingBuffer* pFrameRingBuffer)
+{
+	m_pFrameRingBuffer = pFrameRingBuffer;
+}
+
+/***********************************************************
+ *  SetFrameArena()
+ *
+ *  This method is used for setting the allocator that the
+ *  temporary containers of SubmitDrawList() use.  Without one
+ *  they use the default heap resource.
+ ***********************************************************/
+void SceneManager::SetFrameArena(FrameArena* pFrameArena)
+{
+	m_pFrameArena = pFrameArena;
+}
+
+/***********************************************************
+ *  SetWeightedTransparency()
+ *
+ *  This method is used for drawing the transparent draws of
+ *  the forward path with weighted blended transparency, which
+ *  needs no sorting.  Without it they are sorted back to front
+ *  and blended one after another.
+ ***********************************************************/
+void SceneManager::SetWeightedTransparency(WeightedTransparency* pWeightedTransparency)
+{
+	m_pWeightedTransparency = pWeightedTransparency;
+}
+
+/***********************************************************
+ *  SetDepthPrepass()
+ *
+ *  This method is used for drawing the depth of the opaque
+ *  draws before they are shaded, so each covered pixel runs
+ *  the fragment shader once.  This applies to the forward
+ *  path and to the deferred geometry pass.
+ ***********************************************************/
+void SceneManager::SetDepthPrepass(DepthPrepass* pDepthPrepass)
+{
+	m_pDepthPrepass = pDepthPrepass;
+}
+
+/***********************************************************
+ *  SetOverdrawMeter()
+ *
+ *  This method is used for setting the counter that measures
+ *  the fragments of the shading draws, without the depth of
+ *  the pre-pass and the full screen passes.
+ ***********************************************************/
+void SceneManager::SetOverdrawMeter(OverdrawMeter* pOverdrawMeter)
+{
+	m_pOverdrawMeter = pOverdrawMeter;
+}
+
+/***********************************************************
+ *  SetLightmap()
+ *
+ *  This method is used for setting the baked lighting of the
+ *  static surfaces.  Until it is uploaded, or without it, the
+ *  static surfaces are lit per pixel like the others.
+ ***********************************************************/
+void SceneManager::SetLightmap(LightmapBaker* pLightmap)
+{
+	m_pLightmap = pLightmap;
+}
+
+/***********************************************************
+ *  SetGpuCulling()
+ *
+ *  This method is used for culling and drawing the opaque
+ *  basic meshes of the forward path on the GPU.  The other
+ *  draws, and every draw of the other paths, stay on the CPU.
+ ***********************************************************/
+void SceneManager::SetGpuCulling(GpuCulling* pGpuCulling)
+{
+	if (pGpuCulling != m_pGpuCulling)
+	{
+		m_bGpuObjectsDirty = true;
+	}
+	m_pGpuCulling = pGpuCulling;
+}
+
 /***********************************************************
  *  SetTransformations()
  *
@@ -286,10 +786,7 @@ void SceneManager::SetTransformations(
 
 	modelView = translation * rotationX * rotationY * rotationZ * scale;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	m_currentDraw.model = modelView;
 }
 
 /***********************************************************
@@ -312,11 +809,8 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
+	m_currentDraw.bUseTexture = false;
+	m_currentDraw.color = currentColor;
 }
 
 /***********************************************************
@@ -326,16 +820,13 @@ void SceneManager::SetShaderColor(
  *  associated with the passed in ID into the shader.
  ***********************************************************/
 void SceneManager::SetShaderTexture(
-	std::string textureTag)
+	const std::string& textureTag)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+	int textureID = -1;
+	textureID = FindTextureSlot(textureTag);
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
+	m_currentDraw.bUseTexture = true;
+	m_currentDraw.textureSlot = textureID;
 }
 
 /***********************************************************
@@ -346,10 +837,7 @@ void SceneManager::SetShaderTexture(
  ***********************************************************/
 void SceneManager::SetTextureUVScale(float u, float v)
 {
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
+	m_currentDraw.UVscale = glm::vec2(u, v);
 }
 
 /***********************************************************
@@ -359,72 +847,652 @@ void SceneManager::SetTextureUVScale(float u, float v)
  *  into the shader.
  ***********************************************************/
 void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+	const std::string& materialTag)
 {
-	if (m_objectMaterials.size() > 0)
+	int materialIndex = FindMaterialIndex(materialTag);
+	if (materialIndex >= 0)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
+		m_currentDraw.materialIndex = materialIndex;
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
+/***********************************************************
+ *  SetStatic()
+ *
+ *  This method is used for marking the next draws as surfaces
+ *  that never move, whose lighting can be baked.
+ ***********************************************************/
+void SceneManager::SetStatic(bool bStatic)
+{
+	m_currentDraw.bStatic = bStatic;
+}
 
- /***********************************************************
-  *  LoadSceneTextures()
-  *
-  *  This method is used for preparing the 3D scene by loading
-  *  the shapes, textures in memory to support the 3D scene
-  *  rendering
-  ***********************************************************/
-void SceneManager::LoadSceneTextures()
+/***********************************************************
+ *  ApplyMaterial()
+ *
+ *  This method is used for passing the values of a defined
+ *  material into the passed in shader.
+ ***********************************************************/
+void SceneManager::ApplyMaterial(ShaderManager* pShader, int materialIndex)
 {
-	
-	bool loaded = false;
-	loaded = CreateGLTexture("debug\\textures\\wood.jpg", "wood");
-	if (!loaded) {
-		std::cout << "Failed to load wood texture" << std::endl;
+	if ((materialIndex < 0) || (materialIndex >= (int)m_objectMaterials.size()))
+	{
+		// a draw without a material is not faded by the one before
+		pShader->setFloatValue(g_MaterialOpacityName, 1.0f);
+		return;
 	}
-	
-	loaded = CreateGLTexture("debug\\textures\\ceramic.jpg", "ceramic");
-	if (!loaded) {
-		std::cout << "Failed to load ceramic texture" << std::endl;
+
+	OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
+	pShader->setVec3Value(g_MaterialAmbientColorName, material.ambientColor);
+	pShader->setFloatValue(g_MaterialAmbientStrengthName, material.ambientStrength);
+	pShader->setVec3Value(g_MaterialDiffuseColorName, material.diffuseColor);
+	pShader->setVec3Value(g_MaterialSpecularColorName, material.specularColor);
+	pShader->setFloatValue(g_MaterialShininessName, material.shininess);
+	pShader->setFloatValue(g_MaterialOpacityName, material.opacity);
+	// the deferred path looks the material up by index
+	pShader->setIntValue(g_MaterialIndexName, materialIndex);
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for recording a draw of a basic mesh
+ *  with the transformation, color, texture and material that
+ *  were set before it.  The draws are sent to the shaders by
+ *  SubmitDrawList() after RecordScene().
+ ***********************************************************/
+void SceneManager::DrawMesh(MESH_TYPE mesh)
+{
+	m_currentDraw.mesh = mesh;
+	m_currentDraw.importedMesh = -1;
+	m_currentDraw.bTransparent = IsTransparentDraw(m_currentDraw);
+	// the lightmap projects each face of a box onto its own
+	// cell, which the other meshes do not fit
+	m_currentDraw.lightmapSurface = -1;
+	if (m_currentDraw.bStatic && (mesh == BOX_MESH) && !m_currentDraw.bTransparent)
+	{
+		m_currentDraw.lightmapSurface = m_lightmapSurfaceCount++;
 	}
-	loaded = CreateGLTexture("debug\\textures\\fabric.jpg", "fabric");
-	if (!loaded) {
-		std::cout << "Failed to load fabric texture" << std::endl;
+	m_drawList.push_back(m_currentDraw);
+}
+
+/***********************************************************
+ *  DrawImportedMesh()
+ *
+ *  This method is used for recording a draw of a mesh loaded
+ *  by the mesh importer, which is sorted, culled and shaded
+ *  like the basic meshes.
+ ***********************************************************/
+void SceneManager::DrawImportedMesh(int importedMesh)
+{
+	if ((importedMesh < 0) || (importedMesh >= m_pMeshImporter->GetMeshCount()))
+	{
+		return;
 	}
-	loaded = CreateGLTexture("debug\\textures\\glass.jpg", "glass");
-	if (!loaded) {
-		std::cout << "Failed to load glass texture" << std::endl;
+
+	m_currentDraw.mesh = IMPORTED_MESH;
+	m_currentDraw.importedMesh = importedMesh;
+	m_currentDraw.lightmapSurface = -1;
+	m_currentDraw.bTransparent = IsTransparentDraw(m_currentDraw);
+	m_drawList.push_back(m_currentDraw);
+}
+
+/***********************************************************
+ *  IsTransparentDraw()
+ *
+ *  This method is used for checking whether a draw lets the
+ *  surfaces behind it show through: a texture with an alpha
+ *  channel, a color with an alpha below one, or a material
+ *  that is not fully opaque.
+ ***********************************************************/
+bool SceneManager::IsTransparentDraw(const DRAW_COMMAND& draw) const
+{
+	if (draw.bUseTexture)
+	{
+		if ((draw.textureSlot >= 0) && m_textureIDs[draw.textureSlot].bHasAlpha)
+		{
+			return(true);
+		}
 	}
-	loaded = CreateGLTexture("debug\\textures\\wall.jpg", "wall");
-	if (!loaded) {
-		std::cout << "Failed to load glass2 texture" << std::endl;
+	else if (draw.color.a < 1.0f)
+	{
+		return(true);
 	}
 
+	return((draw.materialIndex >= 0) &&
+		(draw.materialIndex < (int)m_objectMaterials.size()) &&
+		(m_objectMaterials[draw.materialIndex].opacity < 1.0f));
+}
 
-
-	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
+/***********************************************************
+ *  DrawBasicMesh()
+ *
+ *  This method is used for drawing the mesh of a recorded
+ *  draw with the currently bound shader program.
+ ***********************************************************/
+void SceneManager::DrawBasicMesh(const DRAW_COMMAND& draw)
+{
+	switch (draw.mesh)
+	{
+	case BOX_MESH:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case CONE_MESH:
+		m_basicMeshes->DrawConeMesh();
+		break;
+	case CYLINDER_MESH:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case PLANE_MESH:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case SPHERE_MESH:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case TORUS_MESH:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	case IMPORTED_MESH:
+		// drawn through the state cache, which keeps track of
+		// the vertex arrays of the imported meshes
+		m_pMeshImporter->DrawMesh(draw.importedMesh);
+		return;
+	}
+
+	// the meshes bind their own vertex arrays
+	GLStateCache::InvalidateVertexArray();
+}
+
+/***********************************************************
+ *  SubmitDrawList()
+ *
+ *  This method is used for sending the recorded draws that
+ *  the passed in view can see to the shaders.  Every draw is
+ *  assigned the program variant that matches its features.
+ *  The opaque draws come first, without blending, sorted by
+ *  variant and then front to back, so the depth test rejects
+ *  the hidden pixels before they are shaded.  Within a
+ *  distance range they are sorted by texture and material so
+ *  each change is only made once.  The transparent draws
+ *  follow, sorted back to front and blended without writing
+ *  the depth, or summed by the weighted transparency in any
+ *  order.
+ *  With the depth pre-pass the opaque draws are first drawn
+ *  with a depth only program and then shaded with GL_EQUAL.
+ *  When another shader manager has been set, such as for the
+ *  deferred geometry pass, every draw goes to that program as
+ *  an opaque draw.  The draw subset limits the draws to the
+ *  ones of a pass of the deferred path.
+ ***********************************************************/
+void SceneManager::SubmitDrawList(int view)
+{
+	// without an OpenGL context the recorded draws are read by
+	// the software renderer instead
+	if (m_bHeadless || (view < 0) || (view >= MAX_VIEWS))
+	{
+		return;
+	}
+	unsigned int viewBit = 1u << view;
+	const glm::vec3& viewPosition = m_views[view].position;
+
+	bool bUsePermutations = (NULL != m_pShaderPermutations) &&
+		(m_pShaderManager == m_pDefaultShaderManager);
+	// the G-buffer holds one surface per pixel, so only the
+	// forward path has a transparent pass
+	bool bForwardPath = (m_pShaderManager == m_pDefaultShaderManager);
+	// the weighted transparency writes two targets, which only
+	// the specialized variants do
+	bool bWeightedOIT = bForwardPath && bUsePermutations &&
+		(NULL != m_pWeightedTransparency) && m_pWeightedTransparency->IsReady();
+
+	// the draws are sorted through a small entry per draw, taken
+	// from the frame arena, and the draw list keeps the order in
+	// which the draws were recorded
+	std::pmr::memory_resource* pMemory = (NULL != m_pFrameArena) ?
+		(std::pmr::memory_resource*)m_pFrameArena : std::pmr::get_default_resource();
+	std::pmr::vector<DRAW_SORT_ENTRY> sortEntries(pMemory);
+	std::pmr::vector<int> drawOrder(pMemory);
+	sortEntries.reserve(m_drawList.size());
+	drawOrder.reserve(m_drawList.size());
+
+	// while the GPU culling draws the others, only the host
+	// draws are sorted
+	int listSize = m_bHostDrawsOnly ? (int)m_hostDraws.size() : (int)m_drawList.size();
+	for (int n = 0; n < listSize; n++)
+	{
+		int i = m_bHostDrawsOnly ? m_hostDraws[n] : n;
+		DRAW_COMMAND& draw = m_drawList[i];
+		if (0 == (draw.viewMask & viewBit))
+		{
+			continue;
+		}
+		if (((m_drawSubset == DEFERRED_DRAWS) && !IsDeferredDraw(draw)) ||
+			((m_drawSubset == FORWARD_DRAWS) && IsDeferredDraw(draw)))
+		{
+			continue;
+		}
+		bool bTransparent = bForwardPath && draw.bTransparent;
+		draw.shaderKey = 0;
+		if (bUsePermutations)
+		{
+			// a static surface with baked lighting skips the loop
+			// over the lights
+			bool bLightmap = IsLightmapDraw(draw);
+			draw.shaderKey = ShaderPermutations::MakeKey(
+				draw.bUseTexture,
+				m_bUseLighting && !bLightmap,
+				(int)m_lightSources.size(),
+				bTransparent,
+				bTransparent && bWeightedOIT,
+				bLightmap);
+		}
+
+		glm::vec3 offset = glm::vec3(draw.model[3]) - viewPosition;
+		float distanceSquared = glm::dot(offset, offset);
+
+		DRAW_SORT_ENTRY entry;
+		entry.pass = bTransparent ? TRANSPARENT_PASS : OPAQUE_PASS;
+		if (bTransparent)
+		{
+			entry.depth = distanceSquared;
+		}
+		else
+		{
+			entry.depth = floor(sqrt(distanceSquared) / OPAQUE_DEPTH_RANGE);
+		}
+		entry.shaderKey = draw.shaderKey;
+		entry.textureSlot = draw.textureSlot;
+		entry.materialIndex = draw.materialIndex;
+		entry.mesh = draw.mesh + glm::max(draw.importedMesh, 0);
+		entry.draw = i;
+		sortEntries.push_back(entry);
+	}
+
+	std::sort(sortEntries.begin(), sortEntries.end(),
+		[](const DRAW_SORT_ENTRY& a, const DRAW_SORT_ENTRY& b)
+		{
+			if (a.pass != b.pass)
+				return(a.pass < b.pass);
+			// blending needs the farthest transparent draw first
+			if ((a.pass == TRANSPARENT_PASS) && (a.depth != b.depth))
+				return(a.depth > b.depth);
+			if (a.shaderKey != b.shaderKey)
+				return(a.shaderKey < b.shaderKey);
+			if (a.depth != b.depth)
+				return(a.depth < b.depth);
+			if (a.textureSlot != b.textureSlot)
+				return(a.textureSlot < b.textureSlot);
+			if (a.materialIndex != b.materialIndex)
+				return(a.materialIndex < b.materialIndex);
+			if (a.mesh != b.mesh)
+				return(a.mesh < b.mesh);
+			return(a.draw < b.draw);
+		});
+	int transparentStart = (int)sortEntries.size();
+	for (size_t i = 0; i < sortEntries.size(); i++)
+	{
+		if ((sortEntries[i].pass == TRANSPARENT_PASS) && (transparentStart == (int)sortEntries.size()))
+		{
+			transparentStart = (int)i;
+		}
+		drawOrder.push_back(sortEntries[i].draw);
+	}
+
+	ShaderManager* pShader = m_pShaderManager;
+	bool bSpecialized = false;
+	bool bProgramChanged = true;
+	unsigned int boundKey = 0;
+	int boundTexture = -1;
+	// -2 so that the first draw sets its material, even without one
+	int boundMaterial = -2;
+	bool bAccumulating = false;
+
+	// with the ring buffer the settings of the draws are written
+	// in blocks and each draw only selects its entry
+	bool bUseDrawBuffer = (NULL != m_pFrameRingBuffer) && m_pFrameRingBuffer->IsSupported();
+	int blockStart = 0;
+	int blockEnd = 0;
+
+	// the other passes set up their own blend state
+	if (bForwardPath)
+	{
+		GLStateCache::SetEnabled(GL_BLEND, false);
+	}
+	if (bUsePermutations && (NULL != m_pLightmap) && m_pLightmap->IsReady())
+	{
+		GLStateCache::BindTexture(LightmapBaker::LIGHTMAP_TEXTURE_UNIT, m_pLightmap->GetTexture());
+	}
+
+	bool bPrepass = (NULL != m_pDepthPrepass) && m_pDepthPrepass->IsReady() && (transparentStart > 0);
+	if (bPrepass)
+	{
+		bPrepass = DrawDepthPrepass(&drawOrder[0], transparentStart);
+		// the pre-pass replaced the program of the passed in
+		// shader manager, the variants are bound below
+		if (!bUsePermutations)
+		{
+			GLStateCache::UseProgram(m_pShaderManager->m_programID);
+		}
+	}
+	if (NULL != m_pOverdrawMeter)
+	{
+		m_pOverdrawMeter->BeginCount();
+	}
+
+	for (int i = 0; i < (int)drawOrder.size(); i++)
+	{
+		const DRAW_COMMAND& draw = m_drawList[drawOrder[i]];
+
+		if (i == transparentStart)
+		{
+			if (bPrepass)
+			{
+				m_pDepthPrepass->EndShadingPass();
+				bPrepass = false;
+			}
+			if (bWeightedOIT)
+			{
+				bAccumulating = m_pWeightedTransparency->BeginAccumulation();
+			}
+			if (!bAccumulating)
+			{
+				GLStateCache::SetEnabled(GL_BLEND, true);
+				GLStateCache::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				GLStateCache::DepthMask(false);
+			}
+		}
+
+		if (bUseDrawBuffer && (i >= blockEnd))
+		{
+			int drawCount = glm::min(
+				(int)drawOrder.size() - i,
+				m_pFrameRingBuffer->GetMaxDrawsPerBlock());
+			if (!WriteDrawBlock(&drawOrder[i], drawCount))
+			{
+				// the regions were grown for the recorded draws,
+				// so this only happens when the ring could not grow
+				break;
+			}
+			blockStart = i;
+			blockEnd = i + drawCount;
+		}
+
+		if (bUsePermutations && (bProgramChanged || (draw.shaderKey != boundKey)))
+		{
+			pShader = m_pShaderPermutations->Bind(draw.shaderKey, bSpecialized);
+			boundKey = draw.shaderKey;
+			bProgramChanged = true;
+		}
+		if (bProgramChanged)
+		{
+			boundTexture = -1;
+			boundMaterial = -2;
+			bProgramChanged = false;
+			if (bSpecialized && (boundKey & ShaderPermutations::FEATURE_LIGHTMAP))
+			{
+				pShader->setSampler2DValue(g_LightmapName, LightmapBaker::LIGHTMAP_TEXTURE_UNIT);
+			}
+		}
+		// the generic program only writes one target, so it skips
+		// the accumulation until the variant is built
+		if (bAccumulating && !bSpecialized)
+		{
+			continue;
+		}
+
+		if (bUseDrawBuffer)
+		{
+			pShader->setIntValue(g_DrawIndexName, i - blockStart);
+		}
+		else
+		{
+			pShader->setMat4Value(g_ModelName, draw.model);
+			if (!bSpecialized)
+			{
+				pShader->setIntValue(g_UseTextureName, draw.bUseTexture);
+			}
+			if (draw.bUseTexture)
+			{
+				pShader->setVec2Value(g_UVScaleName, draw.UVscale);
+			}
+			else
+			{
+				pShader->setVec4Value(g_ColorValueName, draw.color);
+			}
+			if (bSpecialized && (draw.shaderKey & ShaderPermutations::FEATURE_LIGHTMAP))
+			{
+				pShader->setVec4Value(g_LightmapRectName, GetLightmapRect(draw));
+			}
+		}
+		if (draw.bUseTexture && (draw.textureSlot != boundTexture))
+		{
+			pShader->setSampler2DValue(g_TextureValueName, draw.textureSlot);
+			boundTexture = draw.textureSlot;
+		}
+		if (draw.materialIndex != boundMaterial)
+		{
+			ApplyMaterial(pShader, draw.materialIndex);
+			boundMaterial = draw.materialIndex;
+		}
+
+		DrawBasicMesh(draw);
+	}
+
+	if (NULL != m_pOverdrawMeter)
+	{
+		m_pOverdrawMeter->EndCount();
+	}
+	if (bPrepass)
+	{
+		m_pDepthPrepass->EndShadingPass();
+	}
+
+	// the opaque state is restored for the next pass
+	if (bAccumulating)
+	{
+		m_pWeightedTransparency->Composite();
+	}
+	else if (transparentStart < (int)drawOrder.size())
+	{
+		GLStateCache::DepthMask(true);
+		GLStateCache::SetEnabled(GL_BLEND, false);
+	}
+}
+
+/***********************************************************
+ *  DrawDepthPrepass()
+ *
+ *  This method is used for drawing the depth of the first
+ *  sorted draws with the depth only program, front to back
+ *  like the shading pass.  On success the state is left for
+ *  the shading pass to match the depth, otherwise the depth
+ *  test is restored, since the pre-pass depth is incomplete.
+ ***********************************************************/
+bool SceneManager::DrawDepthPrepass(const int* pDrawOrder, int drawCount)
+{
+	ShaderManager* pDepthShader = m_pDepthPrepass->GetShader();
+	bool bUseDrawBuffer = (NULL != m_pFrameRingBuffer) && m_pFrameRingBuffer->IsSupported();
+	int blockStart = 0;
+	int blockEnd = 0;
+
+	m_pDepthPrepass->BeginDepthPass();
+
+	for (int i = 0; i < drawCount; i++)
+	{
+		if (bUseDrawBuffer && (i >= blockEnd))
+		{
+			int blockCount = glm::min(drawCount - i, m_pFrameRingBuffer->GetMaxDrawsPerBlock());
+			if (!WriteDrawBlock(&pDrawOrder[i], blockCount))
+			{
+				m_pDepthPrepass->BeginShadingPass();
+				m_pDepthPrepass->EndShadingPass();
+				return(false);
+			}
+			blockStart = i;
+			blockEnd = i + blockCount;
+		}
+
+		if (bUseDrawBuffer)
+		{
+			pDepthShader->setIntValue(g_DrawIndexName, i - blockStart);
+		}
+		else
+		{
+			pDepthShader->setMat4Value(g_ModelName, m_drawList[pDrawOrder[i]].model);
+		}
+
+		DrawBasicMesh(m_drawList[pDrawOrder[i]]);
+	}
+
+	m_pDepthPrepass->BeginShadingPass();
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsLightmapDraw()
+ *
+ *  This method is used for checking whether a draw reads its
+ *  lighting from the uploaded lightmap: a static, opaque box
+ *  of the lit forward path that was baked.
+ ***********************************************************/
+bool SceneManager::IsLightmapDraw(const DRAW_COMMAND& draw) const
+{
+	return(m_bUseLighting &&
+		(NULL != m_pLightmap) && m_pLightmap->IsReady() &&
+		(m_pShaderManager == m_pDefaultShaderManager) &&
+		(draw.lightmapSurface >= 0) &&
+		(draw.lightmapSurface < m_pLightmap->GetSurfaceCount()));
+}
+
+/***********************************************************
+ *  IsDeferredDraw()
+ *
+ *  This method is used for checking whether a draw can be
+ *  shaded from the G-buffer.  It holds one opaque surface per
+ *  pixel and the lighting pass lights every one of them, so
+ *  the blended draws and an unlit scene stay forward.
+ ***********************************************************/
+bool SceneManager::IsDeferredDraw(const DRAW_COMMAND& draw) const
+{
+	return(m_bUseLighting && !draw.bTransparent);
+}
+
+/***********************************************************
+ *  GetLightmapRect()
+ *
+ *  This method is used for getting the cells of a draw in the
+ *  lightmap atlas, or zero when the draw is lit per pixel.
+ ***********************************************************/
+glm::vec4 SceneManager::GetLightmapRect(const DRAW_COMMAND& draw) const
+{
+	if (!IsLightmapDraw(draw))
+	{
+		return(glm::vec4(0.0f));
+	}
+
+	return(m_pLightmap->GetSurfaceRect(draw.lightmapSurface));
+}
+
+/***********************************************************
+ *  WriteDrawBlock()
+ *
+ *  This method is used for writing the settings of a range of
+ *  sorted draws straight into the mapped ring buffer and
+ *  binding them as the draw block.
+ ***********************************************************/
+bool SceneManager::WriteDrawBlock(const int* pDrawOrder, int drawCount)
+{
+	GLintptr offset = 0;
+	GLsizeiptr size = drawCount * sizeof(FrameRingBuffer::DRAW_DATA);
+	FrameRingBuffer::DRAW_DATA* pData =
+		(FrameRingBuffer::DRAW_DATA*)m_pFrameRingBuffer->Allocate(size, offset);
+	if (NULL == pData)
+	{
+		return(false);
+	}
+
+	for (int i = 0; i < drawCount; i++)
+	{
+		FillDrawData(m_drawList[pDrawOrder[i]], pData[i]);
+	}
+
+	m_pFrameRingBuffer->BindRange(FrameRingBuffer::DRAW_BLOCK_BINDING, offset, size);
+
+	return(true);
+}
+
+/***********************************************************
+ *  FillDrawData()
+ *
+ *  This method is used for filling the shader settings of a
+ *  recorded draw.  The normal matrix is computed once per
+ *  draw here instead of once per vertex.
+ ***********************************************************/
+void SceneManager::FillDrawData(const DRAW_COMMAND& draw, FrameRingBuffer::DRAW_DATA& data) const
+{
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.model)));
+	data.model = draw.model;
+	data.normalMatrix[0] = glm::vec4(normalMatrix[0], 0.0f);
+	data.normalMatrix[1] = glm::vec4(normalMatrix[1], 0.0f);
+	data.normalMatrix[2] = glm::vec4(normalMatrix[2], 0.0f);
+	data.color = draw.color;
+	data.parameters = glm::vec4(
+		draw.UVscale.x,
+		draw.UVscale.y,
+		draw.bUseTexture ? 1.0f : 0.0f,
+		(float)draw.materialIndex);
+	data.lightmapRect = GetLightmapRect(draw);
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+ /***********************************************************
+  *  LoadSceneTextures()
+  *
+  *  This method is used for preparing the 3D scene by loading
+  *  the shapes, textures in memory to support the 3D scene
+  *  rendering
+  ***********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+	for (int i = 0; i < SCENE_TEXTURE_COUNT; i++)
+	{
+		bool loaded = CreateGLTexture(g_SceneTextures[i].filename, g_SceneTextures[i].tag);
+		if (!loaded) {
+			std::cout << "Failed to load " << g_SceneTextures[i].tag << " texture" << std::endl;
+		}
+	}
+
+	// after the texture image data is loaded into memory, the
+	// loaded textures need to be bound to texture slots - there
+	// are a total of 16 available slots for scene textures
 	BindGLTextures();
 }
+
+/***********************************************************
+ *  LoadSceneMeshes()
+ *
+ *  This method is used for loading the meshes of the scene
+ *  props from their files.  A prop whose file cannot be read
+ *  is not drawn.
+ ***********************************************************/
+void SceneManager::LoadSceneMeshes()
+{
+	for (int i = 0; i < SCENE_MESH_COUNT; i++)
+	{
+		if (m_pMeshImporter->LoadMesh(g_SceneMeshes[i].filename, g_SceneMeshes[i].tag) < 0)
+		{
+			std::cout << "Failed to load " << g_SceneMeshes[i].tag << " mesh" << std::endl;
+		}
+	}
+}
+
 void SceneManager::DefineObjectMaterials()
 {
 // WOOD MATERIAL (for table)
@@ -434,6 +1502,7 @@ woodMaterial.ambientStrength = 0.4f;                        // Higher ambient to
 woodMaterial.diffuseColor = glm::vec3(0.5f, 0.4f, 0.3f);    // Medium brown diffuse
 woodMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);  // Low specular
 woodMaterial.shininess = 10.0f;                             // Soft highlights
+woodMaterial.opacity = 1.0f;
 woodMaterial.tag = "wood";
 m_objectMaterials.push_back(woodMaterial);
 
@@ -444,6 +1513,7 @@ creamCeramic.ambientStrength = 0.4f;                        // Slightly higher a
 creamCeramic.diffuseColor = glm::vec3(0.96f, 0.93f, 0.86f); // Soft cream diffuse 
 creamCeramic.specularColor = glm::vec3(0.9f, 0.9f, 0.88f);  // Bright but warm specular
 creamCeramic.shininess = 96.0f;                             // Glossy but not mirror-like
+creamCeramic.opacity = 1.0f;
 creamCeramic.tag = "ceramic";
 m_objectMaterials.push_back(creamCeramic);
 
@@ -454,6 +1524,7 @@ fabricMaterial.ambientStrength = 0.5f;
 fabricMaterial.diffuseColor = glm::vec3(0.6f, 0.4f, 0.3f);
 fabricMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
 fabricMaterial.shininess = 5.0f;
+fabricMaterial.opacity = 1.0f;
 fabricMaterial.tag = "fabric";
 m_objectMaterials.push_back(fabricMaterial);
 
@@ -464,6 +1535,7 @@ metalMaterial.ambientStrength = 0.3f;
 metalMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
 metalMaterial.specularColor = glm::vec3(0.8f, 0.8f, 0.8f);
 metalMaterial.shininess = 128.0f;
+metalMaterial.opacity = 1.0f;
 metalMaterial.tag = "metal";
 m_objectMaterials.push_back(metalMaterial);
 
@@ -474,10 +1546,98 @@ glassMaterial.ambientStrength = 0.5f;
 glassMaterial.diffuseColor = glm::vec3(0.9f, 0.9f, 0.9f);
 glassMaterial.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
 glassMaterial.shininess = 128.0f;
+glassMaterial.opacity = 0.35f;                              // Lets the scene behind show through
 glassMaterial.tag = "glass";
 m_objectMaterials.push_back(glassMaterial);
 }
 
+/***********************************************************
+ *  ReadMaterialFile()
+ *
+ *  This method is used for reading a material table from a
+ *  text file.  Every line holds one material as
+ *
+ *    tag  ambient r g b  ambient strength  diffuse r g b
+ *         specular r g b  shininess  [opacity]
+ *
+ *  and lines starting with # are comments.  A material without
+ *  an opacity is opaque.  A line that can not be read fails
+ *  the whole file, so a half saved file does not reach the
+ *  scene.
+ ***********************************************************/
+bool SceneManager::ReadMaterialFile(
+	const char* filename,
+	std::vector<OBJECT_MATERIAL>& materials)
+{
+	materials.clear();
+
+	std::ifstream file(filename);
+	if (!file.is_open())
+	{
+		return(false);
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t\r");
+		if ((start == std::string::npos) || (line[start] == '#'))
+		{
+			continue;
+		}
+
+		OBJECT_MATERIAL material;
+		std::istringstream values(line);
+		values >> material.tag
+			>> material.ambientColor.r >> material.ambientColor.g >> material.ambientColor.b
+			>> material.ambientStrength
+			>> material.diffuseColor.r >> material.diffuseColor.g >> material.diffuseColor.b
+			>> material.specularColor.r >> material.specularColor.g >> material.specularColor.b
+			>> material.shininess;
+		material.opacity = 1.0f;
+		if (!values.fail() && !(values >> std::ws).eof())
+		{
+			values >> material.opacity;
+		}
+		if (values.fail())
+		{
+			std::cout << "Could not read material in " << filename << " line " << lineNumber << std::endl;
+			materials.clear();
+			return(false);
+		}
+		materials.push_back(material);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateObjectMaterials()
+ *
+ *  This method is used for changing the defined materials.
+ *  A material replaces the one with the same tag, so the
+ *  draws keep their material index, and a new tag is added.
+ ***********************************************************/
+void SceneManager::UpdateObjectMaterials(const std::vector<OBJECT_MATERIAL>& materials)
+{
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		int index = FindMaterialIndex(materials[i].tag);
+		if (index >= 0)
+		{
+			m_objectMaterials[index] = materials[i];
+		}
+		else
+		{
+			m_objectMaterials.push_back(materials[i]);
+		}
+	}
+
+	MarkDirty();
+}
+
 /***********************************************************
  *  SetupSceneLights()
  *
@@ -485,47 +1645,97 @@ m_objectMaterials.push_back(glassMaterial);
  *  sources for the 3D scene.  There are up to 4 light sources.
  ***********************************************************/
 void SceneManager::SetupSceneLights()
+{
+	DefineSceneLights();
+	UploadSceneLights();
+}
+
+/***********************************************************
+ *  DefineSceneLights()
+ *
+ *  This method is used for defining the light sources of the
+ *  3D scene.  It does not call OpenGL, so the startup runs it
+ *  on a worker thread.
+ ***********************************************************/
+void SceneManager::DefineSceneLights()
 {
 	// this line of code is NEEDED for telling the shaders to render 
 	// the 3D scene with custom lighting - to use the default rendered 
 	// lighting then comment out the following line
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	m_bUseLighting = true;
 	// Main key light - bright and slightly to the right/front
 
 
+	LIGHT_SOURCE light;
+	m_lightSources.clear();
+
 	// SUN - Bright directional light simulating sunlight (coming from upper right)
-	m_pShaderManager->setVec3Value("lightSources[0].position", 0.0f, 15.0f, 0.0f); // High and to the side
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 1.0f, 0.95f, 0.9f); // Slightly warm white
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 128.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.08f);
+	light.position = glm::vec3(0.0f, 15.0f, 0.0f); // High and to the side
+	light.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	light.diffuseColor = glm::vec3(1.0f, 0.95f, 0.9f); // Slightly warm white
+	light.specularColor = glm::vec3(0.8f, 0.8f, 0.8f);
+	light.focalStrength = 128.0f;
+	light.specularIntensity = 0.08f;
+	m_lightSources.push_back(light);
 
 	// Key light - complements the sunlight (from opposite side)
-	m_pShaderManager->setVec3Value("lightSources[1].position", 0.0f, 15.0f, 4.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.6f, 0.6f, 0.6f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 128.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.4f);
+	light.position = glm::vec3(0.0f, 15.0f, 4.0f);
+	light.ambientColor = glm::vec3(0.1f, 0.1f, 0.1f);
+	light.diffuseColor = glm::vec3(0.6f, 0.6f, 0.6f);
+	light.specularColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	light.focalStrength = 128.0f;
+	light.specularIntensity = 0.4f;
+	m_lightSources.push_back(light);
 
 	// Fill light - soft ambient illumination
-	m_pShaderManager->setVec3Value("lightSources[2].position", 0.0f, 7.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.5f, 0.5f, 0.5f);
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 16.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.2f);
+	light.position = glm::vec3(0.0f, 7.0f, 0.0f);
+	light.ambientColor = glm::vec3(0.5f, 0.5f, 0.5f);
+	light.diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);
+	light.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
+	light.focalStrength = 16.0f;
+	light.specularIntensity = 0.2f;
+	m_lightSources.push_back(light);
 
 	// Back light - rim lighting
-	m_pShaderManager->setVec3Value("lightSources[3].position", 0.0f, 6.0f, -6.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].ambientColor", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setVec3Value("lightSources[3].specularColor", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 32.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.03f);
+	light.position = glm::vec3(0.0f, 6.0f, -6.0f);
+	light.ambientColor = glm::vec3(0.05f, 0.05f, 0.05f);
+	light.diffuseColor = glm::vec3(0.4f, 0.4f, 0.4f);
+	light.specularColor = glm::vec3(0.2f, 0.2f, 0.2f);
+	light.focalStrength = 32.0f;
+	light.specularIntensity = 0.03f;
+	m_lightSources.push_back(light);
+}
+
+/***********************************************************
+ *  UploadSceneLights()
+ *
+ *  This method is used for passing the lighting switch and
+ *  the defined light sources into the shader, which has to be
+ *  built already.
+ ***********************************************************/
+void SceneManager::UploadSceneLights()
+{
+	if (NULL == m_pShaderManager)
+	{
+		return;
 	}
 
+	GLStateCache::UseProgram(m_pShaderManager->m_programID);
+	m_pShaderManager->setBoolValue(g_UseLightingName, m_bUseLighting);
+
+	// pass the defined light sources into the shader
+	for (int i = 0; i < (int)m_lightSources.size(); i++)
+	{
+		std::string name = "lightSources[" + std::to_string(i) + "].";
+		m_pShaderManager->setVec3Value(name + "position", m_lightSources[i].position);
+		m_pShaderManager->setVec3Value(name + "ambientColor", m_lightSources[i].ambientColor);
+		m_pShaderManager->setVec3Value(name + "diffuseColor", m_lightSources[i].diffuseColor);
+		m_pShaderManager->setVec3Value(name + "specularColor", m_lightSources[i].specularColor);
+		m_pShaderManager->setFloatValue(name + "focalStrength", m_lightSources[i].focalStrength);
+		m_pShaderManager->setFloatValue(name + "specularIntensity", m_lightSources[i].specularIntensity);
+	}
+}
+
 /***********************************************************
  *  PrepareScene()
  *
@@ -541,29 +1751,510 @@ void SceneManager::PrepareScene()
 
 		// load the textures for the 3D scene
 	LoadSceneTextures(); 
+	// load the meshes of the props from their files
+	LoadSceneMeshes();
 	// define the materials that will be used for the objects
 // in the 3D scene
 	DefineObjectMaterials();
 	// add and define the light sources for the 3D scene
 	SetupSceneLights();
 
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();  
-	m_basicMeshes->LoadTorusMesh();    
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadBoxMesh();  // For chair seats and table legs
-	m_basicMeshes->LoadConeMesh(); // For chandelier
-	
+	// the software renderer builds its own copies of the meshes
+	if (!m_bHeadless)
+	{
+		m_basicMeshes->LoadPlaneMesh();
+		m_basicMeshes->LoadCylinderMesh();  
+		m_basicMeshes->LoadTorusMesh();    
+		m_basicMeshes->LoadSphereMesh();
+		m_basicMeshes->LoadBoxMesh();  // For chair seats and table legs
+		m_basicMeshes->LoadConeMesh(); // For chandelier
+	}
+
+	// the prepared scene has not been rendered yet
+	MarkDirty();
+}
+
+/***********************************************************
+ *  AddPrepareTasks()
+ *
+ *  This method is used for adding the steps of PrepareScene()
+ *  to a startup graph.  The images are decoded, and the
+ *  materials and lights defined, on worker threads, while the
+ *  uploads of the textures, meshes and light uniforms stay on
+ *  the context thread.  The meshes are generated and uploaded
+ *  in one step by ShapeMeshes, so each mesh is a context task.
+ *  The prop meshes are read from their files on the workers,
+ *  each OBJ file on several threads, and uploaded together.
+ ***********************************************************/
+int SceneManager::AddPrepareTasks(StartupGraph& graph, int shaderTask)
+{
+	std::vector<int> tasks;
+
+	// the flip is a global setting of stb_image, it is set once
+	// before any of the decode tasks run
+	stbi_set_flip_vertically_on_load(true);
+
+	// every image is decoded into its own entry, and the uploads
+	// keep the order of the list, so the texture slots do not
+	// depend on which image finished first
+	m_textureDecodes.resize(SCENE_TEXTURE_COUNT);
+	int textureTask = graph.AddTask("upload textures", StartupGraph::CONTEXT_THREAD, [this]()
+		{
+			for (size_t i = 0; i < m_textureDecodes.size(); i++)
+			{
+				if (!UploadTexture(m_textureDecodes[i]))
+				{
+					std::cout << "Failed to load " << m_textureDecodes[i].tag << " texture" << std::endl;
+				}
+			}
+			m_textureDecodes.clear();
+			BindGLTextures();
+			return(true);
+		});
+	tasks.push_back(textureTask);
+	for (int i = 0; i < SCENE_TEXTURE_COUNT; i++)
+	{
+		TEXTURE_DECODE& decode = m_textureDecodes[i];
+		decode.filename = g_SceneTextures[i].filename;
+		decode.tag = g_SceneTextures[i].tag;
+		decode.pixels = NULL;
+
+		std::string name = std::string("decode ") + g_SceneTextures[i].tag;
+		int decodeTask = graph.AddTask(name.c_str(), StartupGraph::WORKER_THREAD, [&decode]()
+			{
+				DecodeTexture(decode);
+				return(true);
+			});
+		graph.AddDependency(textureTask, decodeTask);
+	}
+
+	// like the textures, every mesh is decoded into its own
+	// entry and the uploads keep the order of the list
+	m_meshDecodes.resize(SCENE_MESH_COUNT);
+	int meshTask = graph.AddTask("upload meshes", StartupGraph::CONTEXT_THREAD, [this]()
+		{
+			for (size_t i = 0; i < m_meshDecodes.size(); i++)
+			{
+				if (m_pMeshImporter->UploadMesh(m_meshDecodes[i]) < 0)
+				{
+					std::cout << "Failed to load " << m_meshDecodes[i].tag << " mesh" << std::endl;
+				}
+			}
+			m_meshDecodes.clear();
+			return(true);
+		});
+	tasks.push_back(meshTask);
+	int threadCount = (int)std::thread::hardware_concurrency();
+	for (int i = 0; i < SCENE_MESH_COUNT; i++)
+	{
+		MeshImporter::MESH_DECODE& decode = m_meshDecodes[i];
+		decode.filename = g_SceneMeshes[i].filename;
+		decode.tag = g_SceneMeshes[i].tag;
+		decode.pFile = NULL;
+
+		std::string name = std::string("decode ") + g_SceneMeshes[i].tag;
+		int decodeTask = graph.AddTask(name.c_str(), StartupGraph::WORKER_THREAD, [&decode, threadCount]()
+			{
+				MeshImporter::DecodeMesh(decode, threadCount);
+				return(true);
+			});
+		graph.AddDependency(meshTask, decodeTask);
+	}
+
+	tasks.push_back(graph.AddTask("materials", StartupGraph::WORKER_THREAD, [this]()
+		{
+			DefineObjectMaterials();
+			return(true);
+		}));
+	int lightTask = graph.AddTask("lights", StartupGraph::WORKER_THREAD, [this]()
+		{
+			DefineSceneLights();
+			return(true);
+		});
+	tasks.push_back(graph.AddTask("light uniforms", StartupGraph::CONTEXT_THREAD, [this]()
+		{
+			UploadSceneLights();
+			return(true);
+		}, { lightTask, shaderTask }));
+
+	// the software renderer builds its own copies of the meshes
+	if (!m_bHeadless)
+	{
+		ShapeMeshes* pMeshes = m_basicMeshes;
+		tasks.push_back(graph.AddTask("plane mesh", StartupGraph::CONTEXT_THREAD, [pMeshes]() { pMeshes->LoadPlaneMesh(); return(true); }));
+		tasks.push_back(graph.AddTask("cylinder mesh", StartupGraph::CONTEXT_THREAD, [pMeshes]() { pMeshes->LoadCylinderMesh(); return(true); }));
+		tasks.push_back(graph.AddTask("torus mesh", StartupGraph::CONTEXT_THREAD, [pMeshes]() { pMeshes->LoadTorusMesh(); return(true); }));
+		tasks.push_back(graph.AddTask("sphere mesh", StartupGraph::CONTEXT_THREAD, [pMeshes]() { pMeshes->LoadSphereMesh(); return(true); }));
+		tasks.push_back(graph.AddTask("box mesh", StartupGraph::CONTEXT_THREAD, [pMeshes]() { pMeshes->LoadBoxMesh(); return(true); }));
+		tasks.push_back(graph.AddTask("cone mesh", StartupGraph::CONTEXT_THREAD, [pMeshes]() { pMeshes->LoadConeMesh(); return(true); }));
+	}
+
+	// the prepared scene has not been rendered yet
+	int sceneTask = graph.AddTask("scene ready", StartupGraph::CONTEXT_THREAD, [this]()
+		{
+			MarkDirty();
+			return(true);
+		});
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		graph.AddDependency(sceneTask, tasks[i]);
+	}
+
+	return(sceneTask);
+}
+
+/***********************************************************
+ *  SetView()
+ *
+ *  This method is used for setting the camera of a view, its
+ *  frustum culls the next recorded draw list and its position
+ *  orders the draws of the view.
+ ***********************************************************/
+void SceneManager::SetView(int view, const glm::mat4& viewProjection, const glm::vec3& position)
+{
+	if ((view < 0) || (view >= MAX_VIEWS))
+	{
+		return;
+	}
+
+	CameraBlock::CalculateFrustumPlanes(viewProjection, m_views[view].frustumPlanes);
+	m_views[view].position = position;
+	m_views[view].viewProjection = viewProjection;
+}
+
+/***********************************************************
+ *  SetViewCount()
+ *
+ *  This method is used for setting how many of the views the
+ *  next recorded draw list is culled for.  With no views the
+ *  draws are not culled.
+ ***********************************************************/
+void SceneManager::SetViewCount(int viewCount)
+{
+	m_viewCount = glm::clamp(viewCount, 0, MAX_VIEWS);
+}
+
+/***********************************************************
+ *  GetVisibleDrawCount()
+ *
+ *  This method is used for getting the number of draws of the
+ *  last recorded list that are inside the frustum of a view.
+ ***********************************************************/
+int SceneManager::GetVisibleDrawCount(int view) const
+{
+	if ((view < 0) || (view >= MAX_VIEWS))
+	{
+		return(0);
+	}
+	if (view >= m_viewCount)
+	{
+		return((int)m_drawList.size());
+	}
+
+	return(m_views[view].visibleCount);
+}
+
+/***********************************************************
+ *  CullDrawList()
+ *
+ *  This method is used for testing the bounding sphere of
+ *  every recorded draw against the frustums of all the views
+ *  in one pass over the list.  Each draw keeps a bit per view
+ *  it can be seen from, so the list is recorded once however
+ *  many views show it.  While the GPU culling draws the
+ *  others, only the host draws are tested.
+ ***********************************************************/
+void SceneManager::CullDrawList()
+{
+	for (int view = 0; view < MAX_VIEWS; view++)
+	{
+		m_views[view].visibleCount = 0;
+	}
+
+	int listSize = m_bHostDrawsOnly ? (int)m_hostDraws.size() : (int)m_drawList.size();
+	for (int n = 0; n < listSize; n++)
+	{
+		DRAW_COMMAND& draw = m_drawList[m_bHostDrawsOnly ? m_hostDraws[n] : n];
+		if (0 == m_viewCount)
+		{
+			draw.viewMask = ~0u;
+			continue;
+		}
+
+		glm::vec4 sphere = GetDrawSphere(draw);
+		glm::vec3 center = glm::vec3(sphere);
+		float radius = sphere.w;
+
+		draw.viewMask = 0;
+		for (int view = 0; view < m_viewCount; view++)
+		{
+			const glm::vec4* pPlanes = m_views[view].frustumPlanes;
+			bool bInside = true;
+			for (int plane = 0; (plane < CameraBlock::FRUSTUM_PLANE_COUNT) && bInside; plane++)
+			{
+				bInside = (glm::dot(glm::vec3(pPlanes[plane]), center) + pPlanes[plane].w >= -radius);
+			}
+			if (bInside)
+			{
+				draw.viewMask |= 1u << view;
+				m_views[view].visibleCount++;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetDrawSphere()
+ *
+ *  This method is used for getting the bounding sphere of a
+ *  recorded draw in world space.  The sphere of the mesh grows
+ *  with the largest scale of the model.
+ ***********************************************************/
+glm::vec4 SceneManager::GetDrawSphere(const DRAW_COMMAND& draw) const
+{
+	MESH_BOUNDS bounds;
+	if (draw.mesh == IMPORTED_MESH)
+	{
+		const MeshImporter::IMPORTED_MESH& mesh = m_pMeshImporter->GetMesh(draw.importedMesh);
+		bounds.center = mesh.boundsCenter;
+		bounds.radius = mesh.boundsRadius;
+	}
+	else
+	{
+		bounds = g_MeshBounds[draw.mesh];
+	}
+	glm::vec3 center = glm::vec3(draw.model * glm::vec4(bounds.center, 1.0f));
+	float scale = glm::max(glm::length(glm::vec3(draw.model[0])),
+		glm::max(glm::length(glm::vec3(draw.model[1])), glm::length(glm::vec3(draw.model[2]))));
+
+	return(glm::vec4(center, bounds.radius * scale));
+}
+
+/***********************************************************
+ *  IsGpuCullingActive()
+ *
+ *  This method is used for checking whether the draws of the
+ *  next frame can be culled on the GPU: the forward path with
+ *  the program variants and a single view.
+ ***********************************************************/
+bool SceneManager::IsGpuCullingActive() const
+{
+	return(!m_bHeadless &&
+		(NULL != m_pGpuCulling) && m_pGpuCulling->IsReady() &&
+		(NULL != m_pShaderPermutations) &&
+		(m_pShaderManager == m_pDefaultShaderManager) &&
+		(m_viewCount <= 1));
+}
+
+/***********************************************************
+ *  UploadGpuObjects()
+ *
+ *  This method is used for uploading the opaque basic mesh
+ *  draws of the recorded list as objects of the GPU culling.
+ *  The draws that share a program, texture and material form
+ *  a batch, and the objects are sorted by batch.  The imported
+ *  meshes and the transparent draws are kept as host draws.
+ ***********************************************************/
+bool SceneManager::UploadGpuObjects()
+{
+	m_gpuBatches.clear();
+	m_hostDraws.clear();
+	m_bGpuBatchesReady = false;
+
+	std::vector<int> objectDraws;
+	std::vector<int> objectBatches;
+	for (int i = 0; i < (int)m_drawList.size(); i++)
+	{
+		DRAW_COMMAND& draw = m_drawList[i];
+		if ((draw.mesh == IMPORTED_MESH) || draw.bTransparent)
+		{
+			m_hostDraws.push_back(i);
+			continue;
+		}
+
+		bool bLightmap = IsLightmapDraw(draw);
+		draw.shaderKey = ShaderPermutations::MakeKey(
+			draw.bUseTexture,
+			m_bUseLighting && !bLightmap,
+			(int)m_lightSources.size(),
+			false,
+			false,
+			bLightmap,
+			true);
+
+		GPU_BATCH batch;
+		batch.shaderKey = draw.shaderKey;
+		batch.textureSlot = draw.bUseTexture ? draw.textureSlot : -1;
+		batch.materialIndex = draw.materialIndex;
+		int batchIndex = 0;
+		while ((batchIndex < (int)m_gpuBatches.size()) &&
+			((m_gpuBatches[batchIndex].shaderKey != batch.shaderKey) ||
+			(m_gpuBatches[batchIndex].textureSlot != batch.textureSlot) ||
+			(m_gpuBatches[batchIndex].materialIndex != batch.materialIndex)))
+		{
+			batchIndex++;
+		}
+		if (batchIndex == (int)m_gpuBatches.size())
+		{
+			m_gpuBatches.push_back(batch);
+		}
+		objectDraws.push_back(i);
+		objectBatches.push_back(batchIndex);
+	}
+
+	// the objects of a batch are consecutive, in recorded order
+	std::vector<int> objectOrder(objectDraws.size());
+	for (size_t i = 0; i < objectOrder.size(); i++)
+	{
+		objectOrder[i] = (int)i;
+	}
+	std::stable_sort(objectOrder.begin(), objectOrder.end(),
+		[&objectBatches](int a, int b)
+		{
+			return(objectBatches[a] < objectBatches[b]);
+		});
+
+	std::vector<GpuCulling::GPU_OBJECT> objects(objectOrder.size());
+	std::vector<FrameRingBuffer::DRAW_DATA> draws(objectOrder.size());
+	for (size_t i = 0; i < objectOrder.size(); i++)
+	{
+		const DRAW_COMMAND& draw = m_drawList[objectDraws[objectOrder[i]]];
+		GpuCulling::GPU_OBJECT& object = objects[i];
+		object.sphere = GetDrawSphere(draw);
+		object.mesh = (GLuint)draw.mesh;
+		object.batch = (GLuint)objectBatches[objectOrder[i]];
+		object.padding[0] = 0;
+		object.padding[1] = 0;
+		FillDrawData(draw, draws[i]);
+	}
+
+	return(m_pGpuCulling->SetObjects(objects, draws, (int)m_gpuBatches.size()));
+}
+
+/***********************************************************
+ *  RenderGpuCulledScene()
+ *
+ *  This method is used for rendering the first view with the
+ *  GPU culling.  The scene is only recorded and uploaded when
+ *  it changed, then one dispatch culls the objects and every
+ *  batch is drawn with one indirect draw.  The host draws are
+ *  culled and submitted as before, after the opaque objects,
+ *  and the depth of the frame is reduced into the pyramid for
+ *  the next one.  Until every batch has its specialized
+ *  program the frame is drawn on the CPU.
+ ***********************************************************/
+bool SceneManager::RenderGpuCulledScene()
+{
+	bool bLightmap = (NULL != m_pLightmap) && m_pLightmap->IsReady();
+	if (m_bGpuObjectsDirty || (bLightmap != m_bGpuLightmap))
+	{
+		RecordScene();
+		if (!UploadGpuObjects())
+		{
+			return(false);
+		}
+		m_bGpuObjectsDirty = false;
+		m_bGpuLightmap = bLightmap;
+	}
+
+	// the generic program reads no object settings, so the batch
+	// draws wait for the variants, which binding them requests
+	if (!m_bGpuBatchesReady)
+	{
+		bool bReady = true;
+		for (size_t i = 0; i < m_gpuBatches.size(); i++)
+		{
+			bool bSpecialized = false;
+			m_pShaderPermutations->Bind(m_gpuBatches[i].shaderKey, bSpecialized);
+			bReady = bReady && bSpecialized;
+		}
+		if (!bReady)
+		{
+			return(false);
+		}
+		m_bGpuBatchesReady = true;
+	}
+
+	GLStateCache::SetEnabled(GL_BLEND, false);
+	if (bLightmap)
+	{
+		GLStateCache::BindTexture(LightmapBaker::LIGHTMAP_TEXTURE_UNIT, m_pLightmap->GetTexture());
+	}
+
+	m_pGpuCulling->Cull();
+	m_pGpuCulling->BeginDraws();
+	// the count ends with the host draws below
+	if (NULL != m_pOverdrawMeter)
+	{
+		m_pOverdrawMeter->BeginCount();
+	}
+	for (int i = 0; i < (int)m_gpuBatches.size(); i++)
+	{
+		const GPU_BATCH& batch = m_gpuBatches[i];
+		bool bSpecialized = false;
+		ShaderManager* pShader = m_pShaderPermutations->Bind(batch.shaderKey, bSpecialized);
+		if (!bSpecialized)
+		{
+			continue;
+		}
+		if (batch.shaderKey & ShaderPermutations::FEATURE_LIGHTMAP)
+		{
+			pShader->setSampler2DValue(g_LightmapName, LightmapBaker::LIGHTMAP_TEXTURE_UNIT);
+		}
+		if (batch.textureSlot >= 0)
+		{
+			pShader->setSampler2DValue(g_TextureValueName, batch.textureSlot);
+		}
+		ApplyMaterial(pShader, batch.materialIndex);
+		m_pGpuCulling->DrawBatch(i);
+	}
+
+	m_bHostDrawsOnly = true;
+	CullDrawList();
+	SubmitDrawList(0);
+	m_bHostDrawsOnly = false;
+	if (NULL != m_pOverdrawMeter)
+	{
+		m_pOverdrawMeter->EndCount();
+	}
+
+	m_pGpuCulling->BuildHiZ(m_views[0].viewProjection);
+
+	return(true);
 }
 
 /***********************************************************
  *  RenderScene()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for rendering the 3D scene for the
+ *  first view: the draws are recorded and culled, then sent
+ *  to the shaders.  With the GPU culling the opaque basic
+ *  meshes are culled and drawn on the GPU instead.
  ***********************************************************/
 void SceneManager::RenderScene()
 {
+	if (IsGpuCullingActive() && RenderGpuCulledScene())
+	{
+		return;
+	}
+
+	RecordScene();
+	SubmitDrawList(0);
+}
+
+/***********************************************************
+ *  RecordScene()
+ *
+ *  This method is used for recording the 3D scene by 
+ *  transforming and drawing the basic 3D shapes
+ ***********************************************************/
+void SceneManager::RecordScene()
+{
+	// the draws of this frame are recorded first and sent to
+	// the shaders together at the end
+	m_drawList.clear();
+	m_lightmapSurfaceCount = 0;
+
 	// Declare transformation variables
 	glm::vec3 scaleXYZ;
 	float XrotationDegrees = 0.0f;
@@ -571,6 +2262,10 @@ void SceneManager::RenderScene()
 	float ZrotationDegrees = 0.0f;
 	glm::vec3 positionXYZ;
 
+	// the table, the stools, the floor and the walls never move,
+	// so their lighting is read from the lightmap
+	SetStatic(true);
+
     // ------------------ TABLE LEGS ------------------
 
     
@@ -581,14 +2276,14 @@ void SceneManager::RenderScene()
 	SetShaderTexture("wood");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
 
     positionXYZ = glm::vec3(2.0f, 0.0f, -2.0f); // Front right
     SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
 	SetShaderTexture("wood");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
 
     // Back legs
     positionXYZ = glm::vec3(-2.0f, 0.0f, 2.0f); // Back left
@@ -596,14 +2291,14 @@ void SceneManager::RenderScene()
 	SetShaderTexture("wood");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
 
     positionXYZ = glm::vec3(2.0f, 0.0f, 2.0f); // Back right
     SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
 	SetShaderTexture("wood");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
 
     // ------------------ TABLE TOP (RESTING ON LEGS) ------------------
     scaleXYZ = glm::vec3(5.5f, 0.2f, 4.5f); // Slightly larger than leg spread
@@ -612,7 +2307,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("wood");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
 
     // ------------------ STOOLS ( ON NEAR SIDE) ------------------
 
@@ -624,7 +2319,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("fabric");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("fabric");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
 
     // Padded seat
     scaleXYZ = glm::vec3(0.9f, 0.15f, 0.9f);
@@ -634,7 +2329,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("fabric");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("fabric");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
 
     // Stool 2 (left)
     scaleXYZ = glm::vec3(0.8f, 1.2f, 0.8f);
@@ -643,7 +2338,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("fabric");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("fabric");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
 
     // Padded seat
     scaleXYZ = glm::vec3(0.9f, 0.15f, 0.9f);
@@ -652,7 +2347,9 @@ void SceneManager::RenderScene()
 	SetShaderTexture("fabric");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("fabric");
-    m_basicMeshes->DrawBoxMesh();
+    DrawMesh(BOX_MESH);
+
+	SetStatic(false);
 
     // ------------------ CUP ------------------
     
@@ -663,7 +2360,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("ceramic");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("ceramic");
-    m_basicMeshes->DrawTorusMesh();
+    DrawMesh(TORUS_MESH);
 
     // Cup body (cylinder)
     scaleXYZ = glm::vec3(0.35f, 0.5f, 0.35f);
@@ -672,7 +2369,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("ceramic");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("ceramic");
-    m_basicMeshes->DrawCylinderMesh();
+    DrawMesh(CYLINDER_MESH);
 
     // Cup handle (torus)
     scaleXYZ = glm::vec3(0.3f, 0.2f, 0.3f);
@@ -681,7 +2378,11 @@ void SceneManager::RenderScene()
 	SetShaderTexture("ceramic");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("ceramic");
-    m_basicMeshes->DrawTorusMesh();
+    DrawMesh(TORUS_MESH);
+
+	// ------------------ IMPORTED PROPS ------------------
+	RenderWineBottle();
+	RenderBreadLoaf();
 
     // ------------------ CHANDELIER ------------------
 
@@ -692,8 +2393,8 @@ void SceneManager::RenderScene()
     SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
 	SetShaderTexture("glass");
 	SetTextureUVScale(3.0f, 3.0f);
-	SetShaderMaterial("ceramic");
-    m_basicMeshes->DrawCylinderMesh();
+	SetShaderMaterial("glass");
+    DrawMesh(CYLINDER_MESH);
 
     // Light (inverted cone)
     scaleXYZ = glm::vec3(1.0f, 0.8f, 1.0f);
@@ -702,11 +2403,12 @@ void SceneManager::RenderScene()
 	SetShaderTexture("wood");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("ceramic");
-    m_basicMeshes->DrawConeMesh();
+    DrawMesh(CONE_MESH);
 
 
 
 	// ------------------ FLOOR ------------------
+	SetStatic(true);
 	SetShaderColor(0.96f, 0.93f, 0.86f, 1.0f); // Cream color
 	scaleXYZ = glm::vec3(20.0f, 0.1f, 20.0f);  // Large floor area
 	positionXYZ = glm::vec3(0.0f, -0.1f, 0.0f); // Slightly below origin
@@ -714,7 +2416,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("wall");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh(); // Using box for thickness
+	DrawMesh(BOX_MESH); // Using box for thickness
 
 	// ------------------ WALLS ------------------
 	// Back wall
@@ -725,7 +2427,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("wall");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh();
+	DrawMesh(BOX_MESH);
 
 	// Left wall
 	scaleXYZ = glm::vec3(0.1f, 10.0f, 20.0f);
@@ -734,7 +2436,7 @@ void SceneManager::RenderScene()
 	SetShaderTexture("wall");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh();
+	DrawMesh(BOX_MESH);
 
 	// Right wall
 	positionXYZ = glm::vec3(10.0f, 5.0f, 0.0f);
@@ -742,6 +2444,83 @@ void SceneManager::RenderScene()
 	SetShaderTexture("wall");
 	SetTextureUVScale(3.0f, 3.0f);
 	SetShaderMaterial("wood");
-	m_basicMeshes->DrawBoxMesh();
+	DrawMesh(BOX_MESH);
+
+	SetStatic(false);
+
+	// find the views that can see each recorded draw
+	CullDrawList();
+
+	// the draw buffer variants read every draw from the ring,
+	// so its regions hold the blocks of every view, each with
+	// a depth pre-pass and a shading pass
+	if ((NULL != m_pFrameRingBuffer) && m_pFrameRingBuffer->IsSupported())
+	{
+		m_pFrameRingBuffer->Reserve(m_pFrameRingBuffer->GetFrameSize(
+			(int)m_drawList.size(), glm::max(m_viewCount, 1) * 2));
+	}
+}
 
+/***********************************************************
+ *  RenderWineBottle()
+ *
+ *  This method is used for recording the wine bottle, which
+ *  is loaded from a glTF file.  The mesh is scaled to the
+ *  size of the bottle and stood on the table top.
+ ***********************************************************/
+void SceneManager::RenderWineBottle()
+{
+	int mesh = m_pMeshImporter->FindMesh("wine bottle");
+	if (mesh < 0)
+	{
+		return;
+	}
+
+	// the largest extent of the mesh becomes 1.2 units, and the
+	// lowest point of the mesh rests on the table at y = 1.1
+	const MeshImporter::IMPORTED_MESH& bottle = m_pMeshImporter->GetMesh(mesh);
+	glm::vec3 extent = bottle.boundsMax - bottle.boundsMin;
+	float scale = 1.2f / glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 0.001f));
+	glm::vec3 scaleXYZ = glm::vec3(scale);
+	glm::vec3 positionXYZ = glm::vec3(
+		1.6f - bottle.boundsCenter.x * scale,
+		1.1f - bottle.boundsMin.y * scale,
+		-0.8f - bottle.boundsCenter.z * scale);
+	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
+	SetShaderColor(0.2f, 0.45f, 0.25f, 0.8f); // Green glass
+	SetTextureUVScale(1.0f, 1.0f);
+	SetShaderMaterial("glass");
+	DrawImportedMesh(mesh);
+}
+
+/***********************************************************
+ *  RenderBreadLoaf()
+ *
+ *  This method is used for recording the bread loaf, which is
+ *  loaded from an OBJ file, lying on the table next to the
+ *  cup.
+ ***********************************************************/
+void SceneManager::RenderBreadLoaf()
+{
+	int mesh = m_pMeshImporter->FindMesh("bread loaf");
+	if (mesh < 0)
+	{
+		return;
+	}
+
+	// the largest extent of the mesh becomes 0.8 units, and the
+	// lowest point of the mesh rests on the table at y = 1.1
+	const MeshImporter::IMPORTED_MESH& loaf = m_pMeshImporter->GetMesh(mesh);
+	glm::vec3 extent = loaf.boundsMax - loaf.boundsMin;
+	float scale = 0.8f / glm::max(glm::max(extent.x, extent.y), glm::max(extent.z, 0.001f));
+	glm::vec3 scaleXYZ = glm::vec3(scale);
+	glm::vec3 positionXYZ = glm::vec3(
+		-1.2f - loaf.boundsCenter.x * scale,
+		1.1f - loaf.boundsMin.y * scale,
+		-0.5f - loaf.boundsCenter.z * scale);
+	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
+	SetShaderColor(0.72f, 0.5f, 0.27f, 1.0f); // Baked crust
+	SetTextureUVScale(1.0f, 1.0f);
+	SetShaderMaterial("wood");
+	DrawImportedMesh(mesh);
 }
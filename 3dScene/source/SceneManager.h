@@ -11,10 +11,21 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "MeshImporter.h"
+#include "FrameRingBuffer.h"
 
 #include <string>
 #include <vector>
 
+class ShaderPermutations;
+class FrameArena;
+class StartupGraph;
+class WeightedTransparency;
+class DepthPrepass;
+class OverdrawMeter;
+class LightmapBaker;
+class GpuCulling;
+
 /***********************************************************
  *  SceneManager
  *
@@ -33,7 +44,19 @@ public:
 	struct TEXTURE_INFO
 	{
 		std::string tag;
+		std::string filename;
 		uint32_t ID;
+		bool bHasAlpha;
+	};
+
+	// decoded texture image kept in memory for the software
+	// renderer, rows start at the bottom like OpenGL textures
+	struct TEXTURE_IMAGE
+	{
+		int width;
+		int height;
+		int channels;
+		std::vector<unsigned char> pixels;
 	};
 
 	// properties for object materials
@@ -44,32 +67,206 @@ public:
 		glm::vec3 diffuseColor;
 		glm::vec3 specularColor;
 		float shininess;
+		// 1.0 for opaque surfaces, lower values are blended
+		float opacity;
+		std::string tag;
+	};
+
+	// properties for scene light sources
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	// types of the basic meshes that can be drawn
+	enum MESH_TYPE
+	{
+		BOX_MESH,
+		CONE_MESH,
+		CYLINDER_MESH,
+		PLANE_MESH,
+		SPHERE_MESH,
+		TORUS_MESH,
+		// mesh loaded from a file by the mesh importer
+		IMPORTED_MESH
+	};
+
+	// properties of one recorded draw in the draw list
+	struct DRAW_COMMAND
+	{
+		MESH_TYPE mesh;
+		// number of the mesh in the mesh importer, -1 for the
+		// basic meshes
+		int importedMesh;
+		glm::mat4 model;
+		glm::vec4 color;
+		bool bUseTexture;
+		int textureSlot;
+		glm::vec2 UVscale;
+		int materialIndex;
+		unsigned int shaderKey;
+		// true when the draw is blended over the opaque draws
+		bool bTransparent;
+		// one bit per view whose frustum the draw is in
+		unsigned int viewMask;
+		// true for the surfaces that never move
+		bool bStatic;
+		// number of the surface in the lightmap, -1 when the draw
+		// is lit per pixel
+		int lightmapSurface;
+	};
+
+	// recorded draws that SubmitDrawList() sends to the shaders
+	enum DRAW_SUBSET
+	{
+		ALL_DRAWS,
+		// the opaque lit draws that the G-buffer can hold
+		DEFERRED_DRAWS,
+		// the draws the deferred path leaves to the forward path
+		FORWARD_DRAWS
+	};
+
+	// number of views one recorded draw list can be culled for
+	static const int MAX_VIEWS = 8;
+
+	// texture image decoded on a worker thread and waiting for
+	// its upload on the OpenGL context thread
+	struct TEXTURE_DECODE
+	{
+		std::string filename;
 		std::string tag;
+		int width;
+		int height;
+		int channels;
+		unsigned char* pixels;
 	};
 
+	// read and decode the image file of a texture, does not use
+	// OpenGL or the scene, so it can run on any thread
+	static bool DecodeTexture(TEXTURE_DECODE& decode);
+	// free the pixels of a decoded image that is not uploaded
+	static void FreeTextureDecode(TEXTURE_DECODE& decode);
+	// read a material table from a text file, does not use the
+	// scene, so it can run on any thread
+	static bool ReadMaterialFile(
+		const char* filename,
+		std::vector<OBJECT_MATERIAL>& materials);
+
 private:
+
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
+	// shader manager passed to the constructor
+	ShaderManager* m_pDefaultShaderManager;
+	// recorded draws the next submissions send
+	DRAW_SUBSET m_drawSubset;
+	// specialized program variants for the forward path
+	ShaderPermutations* m_pShaderPermutations;
+	// ring buffer that receives the per-draw settings, if supported
+	FrameRingBuffer* m_pFrameRingBuffer;
+	// per-frame allocator for the sorted draw order
+	FrameArena* m_pFrameArena;
+	// weighted blended transparency, NULL for sorted blending
+	WeightedTransparency* m_pWeightedTransparency;
+	// depth pre-pass of the opaque draws, NULL when disabled
+	DepthPrepass* m_pDepthPrepass;
+	// counter of the shaded fragments, NULL when not measured
+	OverdrawMeter* m_pOverdrawMeter;
+	// baked lighting of the static surfaces, NULL to light them
+	// per pixel
+	LightmapBaker* m_pLightmap;
+	// static boxes recorded so far, which number their surfaces
+	int m_lightmapSurfaceCount;
+	// culling and drawing of the opaque basic meshes on the GPU,
+	// NULL to cull and draw every draw on the CPU
+	GpuCulling* m_pGpuCulling;
+	// program, texture and material shared by the objects of a
+	// batch of the GPU culling
+	struct GPU_BATCH
+	{
+		unsigned int shaderKey;
+		int textureSlot;
+		int materialIndex;
+	};
+	std::vector<GPU_BATCH> m_gpuBatches;
+	// recorded draws that the GPU culling does not own, the
+	// imported meshes and the transparent draws
+	std::vector<int> m_hostDraws;
+	// true when the objects on the GPU are older than the scene
+	bool m_bGpuObjectsDirty;
+	// true when the uploaded objects read the lightmap
+	bool m_bGpuLightmap;
+	// true once every batch has its specialized program
+	bool m_bGpuBatchesReady;
+	// true while only the host draws are culled and submitted
+	bool m_bHostDrawsOnly;
+	// camera of a view the draw list is culled and sorted for
+	struct SCENE_VIEW
+	{
+		// frustum planes with the normal pointing inside
+		glm::vec4 frustumPlanes[6];
+		glm::vec3 position;
+		glm::mat4 viewProjection;
+		// draws of the last recorded list inside the frustum
+		int visibleCount;
+	};
+
+	// views of the next recorded draw list
+	SCENE_VIEW m_views[MAX_VIEWS];
+	// number of set views, 0 leaves every draw visible
+	int m_viewCount;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
+	// meshes loaded from OBJ and glTF files
+	MeshImporter* m_pMeshImporter;
+	// meshes decoded by the startup tasks, in scene mesh order
+	std::vector<MeshImporter::MESH_DECODE> m_meshDecodes;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
+	// decoded images of the loaded textures, without an OpenGL
+	// context these replace the OpenGL textures
+	TEXTURE_IMAGE m_textureImages[16];
+	// images decoded by the startup tasks, in texture slot order
+	std::vector<TEXTURE_DECODE> m_textureDecodes;
+	// true when the scene is prepared without an OpenGL context
+	bool m_bHeadless;
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// defined light sources
+	std::vector<LIGHT_SOURCE> m_lightSources;
+	// true when the scene is rendered with custom lighting
+	bool m_bUseLighting;
+	// draw settings collected for the next recorded draw
+	DRAW_COMMAND m_currentDraw;
+	// draws recorded by RenderScene() for the current frame
+	std::vector<DRAW_COMMAND> m_drawList;
+	// true when the scene was edited since it was last rendered
+	bool m_bSceneDirty;
+	// number of MarkDirty() calls
+	unsigned int m_sceneVersion;
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
+	// create the texture of a decoded image in the next slot, or
+	// in place of a loaded one, and free the decoded pixels
+	bool UploadTexture(TEXTURE_DECODE& decode, int textureSlot = -1);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const std::string& tag);
+	int FindTextureSlot(const std::string& tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const std::string& tag);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -89,7 +286,7 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const std::string& textureTag);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -97,21 +294,138 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const std::string& materialTag);
+
+	// mark the next draws as surfaces that never move
+	void SetStatic(bool bStatic);
+
+	// record a draw of a basic mesh with the current settings
+	void DrawMesh(MESH_TYPE mesh);
+	// record a draw of an imported mesh with the current settings
+	void DrawImportedMesh(int importedMesh);
+	// find the views whose frustum each recorded draw is in
+	void CullDrawList();
+	// bounding sphere of a recorded draw in world space, the
+	// radius in w
+	glm::vec4 GetDrawSphere(const DRAW_COMMAND& draw) const;
+	// true when the draws of the first view are culled on the GPU
+	bool IsGpuCullingActive() const;
+	// upload the opaque basic mesh draws as objects of the GPU
+	// culling, grouped into batches
+	bool UploadGpuObjects();
+	// cull and draw the scene on the GPU, false when it has to be
+	// drawn on the CPU this frame
+	bool RenderGpuCulledScene();
+	// pass the values of a defined material into a shader
+	void ApplyMaterial(ShaderManager* pShader, int materialIndex);
+	// true when a draw has to be blended over the opaque draws
+	bool IsTransparentDraw(const DRAW_COMMAND& draw) const;
+	// draw the depth of sorted draws with the depth only program
+	bool DrawDepthPrepass(const int* pDrawOrder, int drawCount);
+	// write the settings of a range of sorted draws into the ring buffer
+	bool WriteDrawBlock(const int* pDrawOrder, int drawCount);
+	// fill the shader settings of a recorded draw
+	void FillDrawData(const DRAW_COMMAND& draw, FrameRingBuffer::DRAW_DATA& data) const;
+	// true when a draw reads its lighting from the lightmap
+	bool IsLightmapDraw(const DRAW_COMMAND& draw) const;
+	// true when a draw can be shaded from the G-buffer
+	bool IsDeferredDraw(const DRAW_COMMAND& draw) const;
+	// atlas rectangle of the lightmap of a draw, zero without one
+	glm::vec4 GetLightmapRect(const DRAW_COMMAND& draw) const;
+	// draw the mesh of a recorded draw with the bound shader
+	void DrawBasicMesh(const DRAW_COMMAND& draw);
 
 public:
 
+	// set the shader manager that receives the draw settings
+	void SetShaderManager(ShaderManager* pShaderManager);
+	// select the recorded draws the next submissions send, the
+	// deferred path splits them between its two passes
+	void SetDrawSubset(DRAW_SUBSET subset);
+	// set the program variants used with the default shader manager
+	void SetShaderPermutations(ShaderPermutations* pShaderPermutations);
+	// set the ring buffer that receives the per-draw settings
+	void SetFrameRingBuffer(FrameRingBuffer* pFrameRingBuffer);
+	// set the allocator for the temporary data of a frame
+	void SetFrameArena(FrameArena* pFrameArena);
+	// draw the transparent draws with weighted blended transparency,
+	// NULL sorts and blends them back to front
+	void SetWeightedTransparency(WeightedTransparency* pWeightedTransparency);
+	// draw the depth of the opaque draws before shading them,
+	// NULL shades the opaque draws with a regular depth test
+	void SetDepthPrepass(DepthPrepass* pDepthPrepass);
+	// set the counter of the fragments the shading draws produce
+	void SetOverdrawMeter(OverdrawMeter* pOverdrawMeter);
+	// read the lighting of the static surfaces from a baked
+	// lightmap, NULL lights them per pixel
+	void SetLightmap(LightmapBaker* pLightmap);
+	// cull and draw the opaque basic meshes of the forward path
+	// on the GPU, NULL culls and draws them on the CPU
+	void SetGpuCulling(GpuCulling* pGpuCulling);
+	// set the camera a view culls and sorts the draws with
+	void SetView(int view, const glm::mat4& viewProjection, const glm::vec3& position);
+	// set the number of views the next draw list is culled for
+	void SetViewCount(int viewCount);
+	// number of draws of the last recorded list a view can see
+	int GetVisibleDrawCount(int view) const;
+	// get the defined object materials
+	const std::vector<OBJECT_MATERIAL>& GetObjectMaterials() const { return(m_objectMaterials); }
+	// get the defined light sources
+	const std::vector<LIGHT_SOURCE>& GetLightSources() const { return(m_lightSources); }
+	// true when the scene is rendered with custom lighting
+	bool IsUsingLighting() const { return(m_bUseLighting); }
+	// get the draws recorded by the last RenderScene() call
+	const std::vector<DRAW_COMMAND>& GetDrawList() const { return(m_drawList); }
+	// get the meshes loaded from files
+	const MeshImporter* GetMeshImporter() const { return(m_pMeshImporter); }
+	// get the decoded image of a texture slot, NULL when the
+	// scene was prepared with an OpenGL context
+	const TEXTURE_IMAGE* GetTextureImage(int textureSlot) const;
+	// get the image files of the loaded textures, in slot order
+	void GetTextureFiles(std::vector<std::string>& files) const;
+
+	// replace the image of a loaded texture with a decoded one
+	bool ReloadTexture(int textureSlot, TEXTURE_DECODE& decode);
+	// replace the materials with matching tags and add new ones
+	void UpdateObjectMaterials(const std::vector<OBJECT_MATERIAL>& materials);
+
+	// flag the scene as edited, so render on demand draws it again
+	void MarkDirty() { m_bSceneDirty = true; m_bGpuObjectsDirty = true; m_sceneVersion++; }
+	// true when the scene was edited since the last ClearDirty()
+	bool IsDirty() const { return(m_bSceneDirty); }
+	// called after the edited scene has been rendered
+	void ClearDirty() { m_bSceneDirty = false; }
+	// counts the edits of the scene, to tell when the data built
+	// from a recorded draw list is out of date
+	unsigned int GetSceneVersion() const { return(m_sceneVersion); }
+
 	// prepare the 3D scene for rendering
 	void PrepareScene();
-	// render the objects in the 3D scene
+	// add the steps of PrepareScene() to a startup graph, the light
+	// uniforms wait for the shader task, returns the task that
+	// finishes when the scene is prepared
+	int AddPrepareTasks(StartupGraph& graph, int shaderTask);
+	// render the objects in the 3D scene for the first view
 	void RenderScene();
+	// record the draws of the 3D scene and cull them for every
+	// view, without sending them to the shaders
+	void RecordScene();
+	// sort the recorded draws a view can see and send them to the
+	// shaders
+	void SubmitDrawList(int view = 0);
 
 	// load all of the needed textures before rendering
 	void LoadSceneTextures();
+	// load the meshes of the scene props from their files
+	void LoadSceneMeshes();
 	// define all the object materials before rendering
 	void DefineObjectMaterials();
 	// add and define the light sources before rendering
 	void SetupSceneLights();
+	// define the light sources without passing them to a shader
+	void DefineSceneLights();
+	// pass the defined light sources into the shader
+	void UploadSceneLights();
 
 	// methods for rendering the various objects in the 3D scene
 	void RenderTable();
@@ -0,0 +1,700 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenepicker.cpp
+// ============
+// find the object under a window position with a ray cast against a
+// bounding volume hierarchy of the recorded draws
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ScenePicker.h"
+#include "SoftwareRenderer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// maximum number of primitives in a leaf
+	const int MAX_LEAF_SIZE = 4;
+	// centroid bins the surface area heuristic compares per split
+	const int SAH_BIN_COUNT = 12;
+	// below this depth the nodes are split in the middle of their
+	// primitives, which bounds the depth of a hierarchy
+	const int MAX_SAH_DEPTH = 32;
+	// pending nodes of a traversal, a nearest child first walk
+	// holds at most one more node than the hierarchy is deep
+	const int TRAVERSAL_STACK_SIZE = 64;
+	// inverse of a direction component that is zero
+	const float HUGE_INVERSE = 1.0e30f;
+	// smallest determinant of a model matrix that can be inverted
+	const float MIN_DETERMINANT = 1.0e-12f;
+
+	// node waiting for a traversal and the distance where the ray
+	// enters it
+	struct TRAVERSAL_ENTRY
+	{
+		int node;
+		float distance;
+	};
+
+	/***********************************************************
+	 *  InverseDirection()
+	 *
+	 *  Invert every component of a ray direction for the box
+	 *  tests, a zero component becomes a huge value of the same
+	 *  sign so the slabs never multiply zero by infinity.
+	 ***********************************************************/
+	glm::vec3 InverseDirection(const glm::vec3& direction)
+	{
+		glm::vec3 inverse;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (direction[axis] != 0.0f)
+			{
+				inverse[axis] = 1.0f / direction[axis];
+			}
+			else
+			{
+				inverse[axis] = std::signbit(direction[axis]) ? -HUGE_INVERSE : HUGE_INVERSE;
+			}
+		}
+		return(inverse);
+	}
+
+	/***********************************************************
+	 *  IntersectBox()
+	 *
+	 *  Find the distance where a ray enters a box, false when it
+	 *  misses the box or enters it beyond the maximum distance.
+	 *  A ray that starts inside the box enters it at zero.
+	 ***********************************************************/
+	bool IntersectBox(
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		float maxDistance,
+		float& distance)
+	{
+		glm::vec3 slabMin = (boundsMin - origin) * inverseDirection;
+		glm::vec3 slabMax = (boundsMax - origin) * inverseDirection;
+		glm::vec3 slabNear = glm::min(slabMin, slabMax);
+		glm::vec3 slabFar = glm::max(slabMin, slabMax);
+
+		float enter = std::max(std::max(slabNear.x, slabNear.y), std::max(slabNear.z, 0.0f));
+		float leave = std::min(std::min(slabFar.x, slabFar.y), std::min(slabFar.z, maxDistance));
+		distance = enter;
+		return(enter <= leave);
+	}
+
+	/***********************************************************
+	 *  SurfaceArea()
+	 *
+	 *  Surface area of a box, the cost of a node in the surface
+	 *  area heuristic.  An empty box has no area.
+	 ***********************************************************/
+	float SurfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+		return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+	}
+
+	/***********************************************************
+	 *  TraverseBvh()
+	 *
+	 *  Visit the leaves of a hierarchy that a ray passes through
+	 *  before the closest distance, nearest child first.  The
+	 *  leaf test lowers the closest distance when it finds a
+	 *  hit, which drops every pending node behind the hit.
+	 ***********************************************************/
+	template <typename TREE, typename LEAF_TEST>
+	void TraverseBvh(
+		const TREE& bvh,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float& closest,
+		LEAF_TEST leafTest)
+	{
+		if (bvh.nodes.empty())
+		{
+			return;
+		}
+
+		TRAVERSAL_ENTRY stack[TRAVERSAL_STACK_SIZE];
+		int stackSize = 0;
+		float entry = 0.0f;
+		if (!IntersectBox(origin, inverseDirection,
+			bvh.nodes[0].boundsMin, bvh.nodes[0].boundsMax, closest, entry))
+		{
+			return;
+		}
+		stack[stackSize++] = { 0, entry };
+
+		while (stackSize > 0)
+		{
+			TRAVERSAL_ENTRY pending = stack[--stackSize];
+			if (pending.distance > closest)
+			{
+				continue;
+			}
+
+			const auto& node = bvh.nodes[pending.node];
+			if (node.count > 0)
+			{
+				for (int i = 0; i < node.count; i++)
+				{
+					leafTest(bvh.primitives[node.first + i], closest);
+				}
+				continue;
+			}
+
+			const auto& left = bvh.nodes[node.first];
+			const auto& right = bvh.nodes[node.first + 1];
+			float leftEntry = 0.0f;
+			float rightEntry = 0.0f;
+			bool bLeft = IntersectBox(origin, inverseDirection,
+				left.boundsMin, left.boundsMax, closest, leftEntry);
+			bool bRight = IntersectBox(origin, inverseDirection,
+				right.boundsMin, right.boundsMax, closest, rightEntry);
+
+			// the farther child goes on the stack first, so the
+			// nearer one is visited first
+			if (bLeft && bRight && (rightEntry < leftEntry))
+			{
+				stack[stackSize++] = { node.first, leftEntry };
+				stack[stackSize++] = { node.first + 1, rightEntry };
+			}
+			else
+			{
+				if (bRight)
+				{
+					stack[stackSize++] = { node.first + 1, rightEntry };
+				}
+				if (bLeft)
+				{
+					stack[stackSize++] = { node.first, leftEntry };
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ScenePicker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ScenePicker::ScenePicker()
+{
+	m_buildTime = 0.0;
+}
+
+/***********************************************************
+ *  ~ScenePicker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ScenePicker::~ScenePicker()
+{
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the hierarchy of the
+ *  draws in a recorded draw list.  A draw keeps the inverse
+ *  of its model matrix to move a ray into its mesh
+ *  coordinates, and its world box is the box around the eight
+ *  transformed corners of its mesh box.
+ ***********************************************************/
+bool ScenePicker::Build(
+	const std::vector<SceneManager::DRAW_COMMAND>& draws,
+	const MeshImporter* pMeshImporter)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// the basic meshes never change, they are only triangulated once
+	if (m_meshes.empty())
+	{
+		BuildMeshes();
+	}
+
+	m_objects.clear();
+	m_objects.reserve(draws.size());
+	std::vector<glm::vec3> objectMins;
+	std::vector<glm::vec3> objectMaxs;
+	objectMins.reserve(draws.size());
+	objectMaxs.reserve(draws.size());
+
+	for (size_t i = 0; i < draws.size(); i++)
+	{
+		const SceneManager::DRAW_COMMAND& draw = draws[i];
+
+		PICK_OBJECT object;
+		object.draw = (int)i;
+		if (draw.mesh == SceneManager::IMPORTED_MESH)
+		{
+			if ((NULL == pMeshImporter) ||
+				(draw.importedMesh < 0) ||
+				(draw.importedMesh >= pMeshImporter->GetMeshCount()))
+			{
+				continue;
+			}
+			const MeshImporter::IMPORTED_MESH& mesh = pMeshImporter->GetMesh(draw.importedMesh);
+			object.mesh = -1;
+			object.boundsMin = mesh.boundsMin;
+			object.boundsMax = mesh.boundsMax;
+		}
+		else
+		{
+			const PICK_MESH& mesh = m_meshes[draw.mesh];
+			object.mesh = (int)draw.mesh;
+			object.boundsMin = mesh.boundsMin;
+			object.boundsMax = mesh.boundsMax;
+		}
+
+		// a draw scaled flat along an axis cannot be hit
+		glm::mat3 linear = glm::mat3(draw.model);
+		float determinant = glm::dot(glm::cross(linear[0], linear[1]), linear[2]);
+		if (std::fabs(determinant) < MIN_DETERMINANT)
+		{
+			continue;
+		}
+		object.inverseModel = glm::inverse(draw.model);
+		object.normalMatrix = glm::transpose(glm::inverse(linear));
+
+		glm::vec3 worldMin(FLT_MAX);
+		glm::vec3 worldMax(-FLT_MAX);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 position(
+				(corner & 1) ? object.boundsMax.x : object.boundsMin.x,
+				(corner & 2) ? object.boundsMax.y : object.boundsMin.y,
+				(corner & 4) ? object.boundsMax.z : object.boundsMin.z);
+			glm::vec3 world = glm::vec3(draw.model * glm::vec4(position, 1.0f));
+			worldMin = glm::min(worldMin, world);
+			worldMax = glm::max(worldMax, world);
+		}
+
+		m_objects.push_back(object);
+		objectMins.push_back(worldMin);
+		objectMaxs.push_back(worldMax);
+	}
+
+	BuildBvh(objectMins, objectMaxs, m_bvh);
+
+	m_buildTime = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+	std::cout << "Built the picking hierarchy of " << m_objects.size() << " objects with "
+		<< m_bvh.nodes.size() << " nodes in " << m_buildTime << " ms" << std::endl;
+
+	return(!m_objects.empty());
+}
+
+/***********************************************************
+ *  BuildMeshes()
+ *
+ *  This method is used for triangulating the basic meshes the
+ *  way the software renderer draws them, and building the
+ *  hierarchy of the triangles of each one.
+ ***********************************************************/
+void ScenePicker::BuildMeshes()
+{
+	m_meshes.resize(SceneManager::TORUS_MESH + 1);
+
+	for (int type = SceneManager::BOX_MESH; type <= SceneManager::TORUS_MESH; type++)
+	{
+		std::vector<MeshImporter::MESH_VERTEX> vertices;
+		std::vector<unsigned int> indices;
+		SoftwareRenderer::BuildBasicMesh((SceneManager::MESH_TYPE)type, vertices, indices);
+
+		PICK_MESH& mesh = m_meshes[type];
+		mesh.boundsMin = glm::vec3(FLT_MAX);
+		mesh.boundsMax = glm::vec3(-FLT_MAX);
+		mesh.corners.reserve(indices.size());
+
+		std::vector<glm::vec3> triangleMins;
+		std::vector<glm::vec3> triangleMaxs;
+		triangleMins.reserve(indices.size() / 3);
+		triangleMaxs.reserve(indices.size() / 3);
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			glm::vec3 triangleMin(FLT_MAX);
+			glm::vec3 triangleMax(-FLT_MAX);
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const glm::vec3& position = vertices[indices[i + corner]].position;
+				mesh.corners.push_back(position);
+				triangleMin = glm::min(triangleMin, position);
+				triangleMax = glm::max(triangleMax, position);
+			}
+			triangleMins.push_back(triangleMin);
+			triangleMaxs.push_back(triangleMax);
+			mesh.boundsMin = glm::min(mesh.boundsMin, triangleMin);
+			mesh.boundsMax = glm::max(mesh.boundsMax, triangleMax);
+		}
+
+		BuildBvh(triangleMins, triangleMaxs, mesh.bvh);
+	}
+}
+
+/***********************************************************
+ *  BuildBvh()
+ *
+ *  This method is used for building a hierarchy over a list of
+ *  boxes.  The centroids of a node are sorted into bins along
+ *  their longest axis, and the node is split at the bin border
+ *  where the areas of the two halves times their primitive
+ *  counts are the smallest.  The nodes whose centroids all
+ *  fall together, and every node below the surface area depth
+ *  limit, are split in the middle of their primitives instead.
+ ***********************************************************/
+void ScenePicker::BuildBvh(
+	const std::vector<glm::vec3>& boundsMin,
+	const std::vector<glm::vec3>& boundsMax,
+	BVH& bvh)
+{
+	int count = (int)boundsMin.size();
+	bvh.nodes.clear();
+	bvh.primitives.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		bvh.primitives[i] = i;
+	}
+	if (0 == count)
+	{
+		return;
+	}
+
+	std::vector<glm::vec3> centers(count);
+	for (int i = 0; i < count; i++)
+	{
+		centers[i] = (boundsMin[i] + boundsMax[i]) * 0.5f;
+	}
+
+	// a hierarchy of binary splits never has more nodes than this,
+	// so the nodes are not moved while they are filled in
+	bvh.nodes.reserve(2 * count - 1);
+	bvh.nodes.push_back(BVH_NODE());
+
+	// range of primitives a node still has to be built from
+	struct BUILD_TASK
+	{
+		int node;
+		int first;
+		int count;
+		int depth;
+	};
+	std::vector<BUILD_TASK> tasks;
+	tasks.push_back({ 0, 0, count, 0 });
+
+	while (!tasks.empty())
+	{
+		BUILD_TASK task = tasks.back();
+		tasks.pop_back();
+
+		glm::vec3 nodeMin(FLT_MAX);
+		glm::vec3 nodeMax(-FLT_MAX);
+		glm::vec3 centerMin(FLT_MAX);
+		glm::vec3 centerMax(-FLT_MAX);
+		for (int i = task.first; i < task.first + task.count; i++)
+		{
+			int primitive = bvh.primitives[i];
+			nodeMin = glm::min(nodeMin, boundsMin[primitive]);
+			nodeMax = glm::max(nodeMax, boundsMax[primitive]);
+			centerMin = glm::min(centerMin, centers[primitive]);
+			centerMax = glm::max(centerMax, centers[primitive]);
+		}
+
+		BVH_NODE& node = bvh.nodes[task.node];
+		node.boundsMin = nodeMin;
+		node.boundsMax = nodeMax;
+		node.first = task.first;
+		node.count = task.count;
+		if (task.count <= MAX_LEAF_SIZE)
+		{
+			continue;
+		}
+
+		glm::vec3 extent = centerMax - centerMin;
+		int axis = 0;
+		if (extent.y > extent[axis])
+		{
+			axis = 1;
+		}
+		if (extent.z > extent[axis])
+		{
+			axis = 2;
+		}
+
+		std::vector<int>::iterator first = bvh.primitives.begin() + task.first;
+		std::vector<int>::iterator last = first + task.count;
+		std::vector<int>::iterator middle = first;
+
+		if ((extent[axis] > 0.0f) && (task.depth < MAX_SAH_DEPTH))
+		{
+			float binScale = SAH_BIN_COUNT / extent[axis];
+			auto binOf = [&](int primitive)
+			{
+				int bin = (int)((centers[primitive][axis] - centerMin[axis]) * binScale);
+				return(std::min(bin, SAH_BIN_COUNT - 1));
+			};
+
+			int binCounts[SAH_BIN_COUNT] = {};
+			glm::vec3 binMins[SAH_BIN_COUNT];
+			glm::vec3 binMaxs[SAH_BIN_COUNT];
+			for (int bin = 0; bin < SAH_BIN_COUNT; bin++)
+			{
+				binMins[bin] = glm::vec3(FLT_MAX);
+				binMaxs[bin] = glm::vec3(-FLT_MAX);
+			}
+			for (std::vector<int>::iterator it = first; it != last; ++it)
+			{
+				int bin = binOf(*it);
+				binCounts[bin]++;
+				binMins[bin] = glm::min(binMins[bin], boundsMin[*it]);
+				binMaxs[bin] = glm::max(binMaxs[bin], boundsMax[*it]);
+			}
+
+			// areas of everything right of each border, swept from
+			// the last bin, then the left side is swept against them
+			float rightCosts[SAH_BIN_COUNT];
+			glm::vec3 sweepMin(FLT_MAX);
+			glm::vec3 sweepMax(-FLT_MAX);
+			int sweepCount = 0;
+			for (int bin = SAH_BIN_COUNT - 1; bin > 0; bin--)
+			{
+				sweepMin = glm::min(sweepMin, binMins[bin]);
+				sweepMax = glm::max(sweepMax, binMaxs[bin]);
+				sweepCount += binCounts[bin];
+				rightCosts[bin] = sweepCount * SurfaceArea(sweepMin, sweepMax);
+			}
+
+			int bestBorder = -1;
+			float bestCost = FLT_MAX;
+			sweepMin = glm::vec3(FLT_MAX);
+			sweepMax = glm::vec3(-FLT_MAX);
+			sweepCount = 0;
+			for (int border = 1; border < SAH_BIN_COUNT; border++)
+			{
+				sweepMin = glm::min(sweepMin, binMins[border - 1]);
+				sweepMax = glm::max(sweepMax, binMaxs[border - 1]);
+				sweepCount += binCounts[border - 1];
+				if ((0 == sweepCount) || (task.count == sweepCount))
+				{
+					continue;
+				}
+				float cost = sweepCount * SurfaceArea(sweepMin, sweepMax) + rightCosts[border];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestBorder = border;
+				}
+			}
+
+			if (bestBorder > 0)
+			{
+				middle = std::partition(first, last,
+					[&](int primitive) { return(binOf(primitive) < bestBorder); });
+			}
+		}
+
+		if ((middle == first) || (middle == last))
+		{
+			middle = first + task.count / 2;
+			std::nth_element(first, middle, last,
+				[&](int a, int b) { return(centers[a][axis] < centers[b][axis]); });
+		}
+
+		int leftCount = (int)(middle - first);
+		int leftNode = (int)bvh.nodes.size();
+		node.first = leftNode;
+		node.count = 0;
+		bvh.nodes.push_back(BVH_NODE());
+		bvh.nodes.push_back(BVH_NODE());
+
+		tasks.push_back({ leftNode + 1, task.first + leftCount, task.count - leftCount, task.depth + 1 });
+		tasks.push_back({ leftNode, task.first, leftCount, task.depth + 1 });
+	}
+}
+
+/***********************************************************
+ *  MakeRay()
+ *
+ *  This method is used for making the ray from the camera
+ *  through a window position.  The position is moved onto the
+ *  near and the far plane with the inverse of the camera
+ *  matrices, which serves the perspective and the orthographic
+ *  projection alike.  The direction is a unit vector.
+ ***********************************************************/
+void ScenePicker::MakeRay(
+	float windowX,
+	float windowY,
+	int width,
+	int height,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	glm::vec3& origin,
+	glm::vec3& direction)
+{
+	// the window rows run down and the device coordinates up
+	float x = (width > 0) ? (2.0f * windowX / width - 1.0f) : 0.0f;
+	float y = (height > 0) ? (1.0f - 2.0f * windowY / height) : 0.0f;
+
+	glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(x, y, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(x, y, 1.0f, 1.0f);
+
+	origin = glm::vec3(nearPoint) / nearPoint.w;
+	direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+}
+
+/***********************************************************
+ *  Pick()
+ *
+ *  This method is used for finding the nearest draw that a ray
+ *  hits.  Every draw the traversal reaches moves the ray into
+ *  its mesh coordinates and tests its triangles, or its box for
+ *  the imported meshes, up to the closest hit so far.  The
+ *  normal of the hit is moved back with the normal matrix of
+ *  the draw and turned to face the ray.
+ ***********************************************************/
+bool ScenePicker::Pick(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	PICK_RESULT& result) const
+{
+	result.object = -1;
+	result.distance = FLT_MAX;
+	if (m_bvh.nodes.empty() || (glm::dot(direction, direction) <= 0.0f))
+	{
+		return(false);
+	}
+
+	glm::vec3 unitDirection = glm::normalize(direction);
+	glm::vec3 inverseDirection = InverseDirection(unitDirection);
+	float closest = FLT_MAX;
+	glm::vec3 closestNormal(0.0f);
+
+	TraverseBvh(m_bvh, origin, inverseDirection, closest,
+		[&](int primitive, float& maxDistance)
+		{
+			const PICK_OBJECT& object = m_objects[primitive];
+			glm::vec3 localOrigin = glm::vec3(object.inverseModel * glm::vec4(origin, 1.0f));
+			glm::vec3 localDirection = glm::vec3(object.inverseModel * glm::vec4(unitDirection, 0.0f));
+
+			float distance = maxDistance;
+			glm::vec3 localNormal(0.0f);
+			bool bHit = false;
+			if (object.mesh >= 0)
+			{
+				bHit = PickMesh(m_meshes[object.mesh], localOrigin, localDirection, distance, localNormal);
+			}
+			else
+			{
+				// the normal of a box hit is the axis of the side the
+				// point lies on, the one it is farthest out along
+				bHit = IntersectBox(localOrigin, InverseDirection(localDirection),
+					object.boundsMin, object.boundsMax, maxDistance, distance);
+				if (bHit)
+				{
+					glm::vec3 center = (object.boundsMin + object.boundsMax) * 0.5f;
+					glm::vec3 halfSize = glm::max((object.boundsMax - object.boundsMin) * 0.5f, glm::vec3(FLT_MIN));
+					glm::vec3 offset = (localOrigin + localDirection * distance - center) / halfSize;
+					glm::vec3 side = glm::abs(offset);
+					int axis = 0;
+					if (side.y > side[axis])
+					{
+						axis = 1;
+					}
+					if (side.z > side[axis])
+					{
+						axis = 2;
+					}
+					localNormal[axis] = (offset[axis] < 0.0f) ? -1.0f : 1.0f;
+				}
+			}
+
+			if (bHit && (distance < maxDistance))
+			{
+				maxDistance = distance;
+				result.object = object.draw;
+				closestNormal = object.normalMatrix * localNormal;
+			}
+		});
+
+	if (result.object < 0)
+	{
+		return(false);
+	}
+
+	result.distance = closest;
+	result.position = origin + unitDirection * closest;
+	result.normal = glm::normalize(closestNormal);
+	if (glm::dot(result.normal, unitDirection) > 0.0f)
+	{
+		result.normal = -result.normal;
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  PickMesh()
+ *
+ *  This method is used for finding the nearest triangle of a
+ *  basic mesh that a ray in mesh coordinates hits before the
+ *  passed in distance.  The triangles are tested from both
+ *  sides, since the planes are seen from below as well.
+ ***********************************************************/
+bool ScenePicker::PickMesh(
+	const PICK_MESH& mesh,
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float& distance,
+	glm::vec3& normal) const
+{
+	bool bHit = false;
+
+	TraverseBvh(mesh.bvh, origin, InverseDirection(direction), distance,
+		[&](int triangle, float& maxDistance)
+		{
+			const glm::vec3& a = mesh.corners[triangle * 3];
+			glm::vec3 edge1 = mesh.corners[triangle * 3 + 1] - a;
+			glm::vec3 edge2 = mesh.corners[triangle * 3 + 2] - a;
+
+			glm::vec3 p = glm::cross(direction, edge2);
+			float determinant = glm::dot(edge1, p);
+			if (determinant == 0.0f)
+			{
+				return;
+			}
+			float inverseDeterminant = 1.0f / determinant;
+
+			glm::vec3 s = origin - a;
+			float u = glm::dot(s, p) * inverseDeterminant;
+			if ((u < 0.0f) || (u > 1.0f))
+			{
+				return;
+			}
+			glm::vec3 q = glm::cross(s, edge1);
+			float v = glm::dot(direction, q) * inverseDeterminant;
+			if ((v < 0.0f) || (u + v > 1.0f))
+			{
+				return;
+			}
+
+			float t = glm::dot(edge2, q) * inverseDeterminant;
+			if ((t > 0.0f) && (t < maxDistance))
+			{
+				maxDistance = t;
+				normal = glm::cross(edge1, edge2);
+				bHit = true;
+			}
+		});
+
+	return(bHit);
+}
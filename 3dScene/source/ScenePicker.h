@@ -0,0 +1,153 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenepicker.h
+// ============
+// find the object under a window position with a ray cast against a
+// bounding volume hierarchy of the recorded draws
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "MeshImporter.h"
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  ScenePicker
+ *
+ *  This class answers which recorded draw a ray hits first,
+ *  on the CPU, so a pick never waits for the GPU.
+ *
+ *  The world space boxes of the draws are sorted into a
+ *  bounding volume hierarchy, split by the surface area
+ *  heuristic over binned centroids.  A ray only visits the
+ *  nodes it passes through, nearest child first, and skips
+ *  every node behind the closest hit so far, so a pick costs
+ *  a few dozen box tests however many draws the scene holds.
+ *
+ *  Each basic mesh has a hierarchy of its own triangles in
+ *  mesh coordinates.  A draw the ray reaches moves the ray
+ *  into its mesh coordinates, where the exact triangles are
+ *  tested.  The direction is not normalized there, so the
+ *  distance along the ray stays the world distance and the
+ *  closest hit carries over between the draws.  The imported
+ *  meshes keep no triangles in memory, they are picked by
+ *  their bounding box.
+ *
+ *  The hierarchy is built from a recorded draw list and has
+ *  to be built again when the scene is edited.
+ ***********************************************************/
+class ScenePicker
+{
+public:
+	// nearest hit of a ray
+	struct PICK_RESULT
+	{
+		// index of the draw in the recorded draw list
+		int object;
+		// world position and unit normal facing the ray
+		glm::vec3 position;
+		glm::vec3 normal;
+		// world distance from the ray origin
+		float distance;
+	};
+
+	// constructor
+	ScenePicker();
+	// destructor
+	~ScenePicker();
+
+	// build the hierarchies of the basic meshes and of the
+	// draws, does not use OpenGL, so it can run on any thread
+	bool Build(
+		const std::vector<SceneManager::DRAW_COMMAND>& draws,
+		const MeshImporter* pMeshImporter);
+	// number of draws in the hierarchy
+	int GetObjectCount() const { return((int)m_objects.size()); }
+	// milliseconds the last build took
+	double GetBuildTime() const { return(m_buildTime); }
+
+	// ray from the camera through a window position, in pixels
+	// from the upper left corner like the cursor position
+	static void MakeRay(
+		float windowX,
+		float windowY,
+		int width,
+		int height,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		glm::vec3& origin,
+		glm::vec3& direction);
+
+	// find the nearest draw a ray hits, false when it hits none
+	bool Pick(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		PICK_RESULT& result) const;
+
+private:
+	// node of a hierarchy, a leaf holds count primitives from
+	// first on, an inner node has its two children at first
+	// and first + 1
+	struct BVH_NODE
+	{
+		glm::vec3 boundsMin;
+		int first;
+		glm::vec3 boundsMax;
+		int count;
+	};
+
+	// nodes and primitive order of a hierarchy
+	struct BVH
+	{
+		std::vector<BVH_NODE> nodes;
+		std::vector<int> primitives;
+	};
+
+	// triangles of a basic mesh, three corners per triangle
+	struct PICK_MESH
+	{
+		std::vector<glm::vec3> corners;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		BVH bvh;
+	};
+
+	// a draw in the hierarchy
+	struct PICK_OBJECT
+	{
+		glm::mat4 inverseModel;
+		glm::mat3 normalMatrix;
+		// basic mesh of the draw, -1 to test the box
+		int mesh;
+		// box of the draw in mesh coordinates
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		// index of the draw in the draw list
+		int draw;
+	};
+
+	std::vector<PICK_MESH> m_meshes;
+	std::vector<PICK_OBJECT> m_objects;
+	BVH m_bvh;
+	double m_buildTime;
+
+	// triangulate the basic meshes and build their hierarchies
+	void BuildMeshes();
+	// build a hierarchy over the passed in boxes
+	static void BuildBvh(
+		const std::vector<glm::vec3>& boundsMin,
+		const std::vector<glm::vec3>& boundsMax,
+		BVH& bvh);
+	// nearest triangle of a mesh a ray in mesh coordinates hits
+	// before the passed in distance
+	bool PickMesh(
+		const PICK_MESH& mesh,
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float& distance,
+		glm::vec3& normal) const;
+};
@@ -0,0 +1,682 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercache.cpp
+// ============
+// build shader programs through an on-disk program binary cache and
+// compile uncached program variants in the background
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY(path) mkdir(path, 0755)
+#endif
+
+// declaration of global variables
+namespace
+{
+	// marker at the start of every cached program binary
+	const uint32_t CACHE_FILE_MAGIC = 0x42504C47; // "GLPB"
+
+	/***********************************************************
+	 *  HashString()
+	 *
+	 *  64 bit FNV-1a hash, chained through the seed value so
+	 *  several strings can be combined into one key.
+	 ***********************************************************/
+	uint64_t HashString(const std::string& text, uint64_t seed)
+	{
+		uint64_t hash = seed;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			hash ^= (unsigned char)text[i];
+			hash *= 1099511628211ULL;
+		}
+		return(hash);
+	}
+
+	/***********************************************************
+	 *  GetGLString()
+	 *
+	 *  glGetString() returns NULL without a current context.
+	 ***********************************************************/
+	std::string GetGLString(GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		if (NULL == value)
+		{
+			return(std::string());
+		}
+		return(std::string((const char*)value));
+	}
+}
+
+/***********************************************************
+ *  ShaderCache()
+ *
+ *  The constructor for the class.  It needs the current
+ *  OpenGL context, so it is created after GLEW is initialized.
+ ***********************************************************/
+ShaderCache::ShaderCache(const char* cacheFolder)
+{
+	m_cacheFolder = cacheFolder;
+	m_cacheHits = 0;
+	m_cacheMisses = 0;
+
+	// the cache must be invalidated whenever the driver changes
+	m_driverString = GetGLString(GL_VENDOR) + "|" + GetGLString(GL_RENDERER) + "|" + GetGLString(GL_VERSION);
+
+	GLint binaryFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+	m_bProgramBinary = (binaryFormats > 0);
+
+	m_bParallelCompile = (GLEW_KHR_parallel_shader_compile == GL_TRUE);
+	if (m_bParallelCompile)
+	{
+		// let the driver pick the number of compiler threads
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+
+	MAKE_DIRECTORY(m_cacheFolder.c_str());
+
+	std::cout << "INFO: Shader cache in " << m_cacheFolder
+		<< ", program binaries " << (m_bProgramBinary ? "on" : "off")
+		<< ", parallel compile " << (m_bParallelCompile ? "on" : "off") << std::endl;
+}
+
+/***********************************************************
+ *  ~ShaderCache()
+ *
+ *  The destructor for the class.  The cache owns every
+ *  program it built, the callers only borrow them, so the
+ *  ready programs are deleted here along with the unfinished
+ *  compiles.  The released ones were deleted already.
+ ***********************************************************/
+ShaderCache::~ShaderCache()
+{
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		if ((m_programs[i].state == PROGRAM_COMPILING) ||
+			(m_programs[i].state == PROGRAM_READY) ||
+			(m_programs[i].state == PROGRAM_FAILED))
+		{
+			glDeleteShader(m_programs[i].vertexShader);
+			glDeleteShader(m_programs[i].fragmentShader);
+			glDeleteProgram(m_programs[i].program);
+		}
+	}
+	m_programs.clear();
+}
+
+/***********************************************************
+ *  ReadSource()
+ *
+ *  This method is used for reading a GLSL file and injecting
+ *  the passed in #define lines right after the #version line.
+ ***********************************************************/
+bool ShaderCache::ReadSource(
+	const char* filePath,
+	const std::string& defines,
+	std::string& source)
+{
+	std::ifstream file(filePath, std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		std::cout << "Could not open shader file:" << filePath << std::endl;
+		return false;
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	source = stream.str();
+
+	if (!defines.empty())
+	{
+		// the directive starts a line, the comments above it may
+		// mention it as well
+		size_t versionLine = 0;
+		if (0 != source.compare(0, 8, "#version"))
+		{
+			versionLine = source.find("\n#version");
+			if (versionLine != std::string::npos)
+			{
+				versionLine++;
+			}
+		}
+		size_t insertAt = 0;
+		if (versionLine != std::string::npos)
+		{
+			insertAt = source.find('\n', versionLine);
+			insertAt = (insertAt == std::string::npos) ? source.size() : insertAt + 1;
+		}
+		source.insert(insertAt, defines);
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  MakeCacheFile()
+ *
+ *  This method is used for building the cache file name from
+ *  the hash of both sources and the driver strings.
+ ***********************************************************/
+std::string ShaderCache::MakeCacheFile(
+	const std::string& vertexSource,
+	const std::string& fragmentSource)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hash = HashString(m_driverString, hash);
+	hash = HashString(vertexSource, hash);
+	hash = HashString(fragmentSource, hash);
+
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+
+	return(m_cacheFolder + "/" + name);
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for creating a program from a cached
+ *  binary.  Zero is returned when there is no usable binary,
+ *  including when the driver rejects it after an update.
+ ***********************************************************/
+GLuint ShaderCache::LoadBinary(const std::string& cacheFile)
+{
+	if (!m_bProgramBinary)
+	{
+		return(0);
+	}
+
+	std::ifstream file(cacheFile.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+	{
+		return(0);
+	}
+
+	uint32_t magic = 0;
+	uint32_t format = 0;
+	uint32_t keyLength = 0;
+	uint32_t binaryLength = 0;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&format, sizeof(format));
+	file.read((char*)&keyLength, sizeof(keyLength));
+	if (!file || (magic != CACHE_FILE_MAGIC) || (keyLength != m_driverString.size()))
+	{
+		return(0);
+	}
+
+	// the driver string is stored to rule out hash collisions
+	std::string key(keyLength, '\0');
+	file.read(&key[0], keyLength);
+	file.read((char*)&binaryLength, sizeof(binaryLength));
+	if (!file || (key != m_driverString) || (binaryLength == 0))
+	{
+		return(0);
+	}
+
+	std::vector<char> binary(binaryLength);
+	file.read(binary.data(), binaryLength);
+	if (!file)
+	{
+		return(0);
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, (GLenum)format, binary.data(), (GLsizei)binaryLength);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked != GL_TRUE)
+	{
+		std::cout << "Cached shader binary rejected by the driver:" << cacheFile << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  SaveBinary()
+ *
+ *  This method is used for storing the binary of a linked
+ *  program in the cache folder.
+ ***********************************************************/
+void ShaderCache::SaveBinary(GLuint program, const std::string& cacheFile)
+{
+	if (!m_bProgramBinary)
+	{
+		return;
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(binaryLength);
+	GLenum format = 0;
+	glGetProgramBinary(program, binaryLength, NULL, &format, binary.data());
+
+	std::ofstream file(cacheFile.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "Could not write shader cache file:" << cacheFile << std::endl;
+		return;
+	}
+
+	uint32_t magic = CACHE_FILE_MAGIC;
+	uint32_t formatValue = format;
+	uint32_t keyLength = (uint32_t)m_driverString.size();
+	uint32_t length = (uint32_t)binaryLength;
+	file.write((const char*)&magic, sizeof(magic));
+	file.write((const char*)&formatValue, sizeof(formatValue));
+	file.write((const char*)&keyLength, sizeof(keyLength));
+	file.write(m_driverString.data(), keyLength);
+	file.write((const char*)&length, sizeof(length));
+	file.write(binary.data(), binaryLength);
+}
+
+/***********************************************************
+ *  BeginCompile()
+ *
+ *  This method is used for starting the compile and link of
+ *  a program from source.  No status is queried here, so with
+ *  parallel compile support the driver does the work on its
+ *  own threads.
+ ***********************************************************/
+void ShaderCache::BeginCompile(PROGRAM_INFO& info)
+{
+	const char* vertexSource = info.vertexSource.c_str();
+	const char* fragmentSource = info.fragmentSource.c_str();
+
+	info.vertexShader = glCreateShader(info.bCompute ? GL_COMPUTE_SHADER : GL_VERTEX_SHADER);
+	glShaderSource(info.vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(info.vertexShader);
+
+	if (!info.bCompute)
+	{
+		info.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(info.fragmentShader, 1, &fragmentSource, NULL);
+		glCompileShader(info.fragmentShader);
+	}
+
+	info.program = glCreateProgram();
+	glAttachShader(info.program, info.vertexShader);
+	if (!info.bCompute)
+	{
+		glAttachShader(info.program, info.fragmentShader);
+	}
+	if (m_bProgramBinary)
+	{
+		glProgramParameteri(info.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(info.program);
+
+	info.state = PROGRAM_COMPILING;
+	m_cacheMisses++;
+}
+
+/***********************************************************
+ *  FinishCompile()
+ *
+ *  This method is used for checking the results of a compile
+ *  and storing the linked binary for the next launch.
+ ***********************************************************/
+void ShaderCache::FinishCompile(PROGRAM_INFO& info)
+{
+	GLint linked = GL_FALSE;
+	glGetProgramiv(info.program, GL_LINK_STATUS, &linked);
+
+	if (linked != GL_TRUE)
+	{
+		char infoLog[1024];
+		GLint compiled = GL_FALSE;
+
+		glGetShaderiv(info.vertexShader, GL_COMPILE_STATUS, &compiled);
+		if (compiled != GL_TRUE)
+		{
+			glGetShaderInfoLog(info.vertexShader, sizeof(infoLog), NULL, infoLog);
+			std::cout << (info.bCompute ? "Compute" : "Vertex") << " shader compile error:"
+				<< std::endl << infoLog << std::endl;
+		}
+		compiled = GL_TRUE;
+		if (!info.bCompute)
+		{
+			glGetShaderiv(info.fragmentShader, GL_COMPILE_STATUS, &compiled);
+		}
+		if (compiled != GL_TRUE)
+		{
+			glGetShaderInfoLog(info.fragmentShader, sizeof(infoLog), NULL, infoLog);
+			std::cout << "Fragment shader compile error:" << std::endl << infoLog << std::endl;
+		}
+		glGetProgramInfoLog(info.program, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Shader program link error:" << std::endl << infoLog << std::endl;
+
+		info.state = PROGRAM_FAILED;
+		return;
+	}
+
+	// the shader objects are not needed once the program is linked
+	glDetachShader(info.program, info.vertexShader);
+	glDeleteShader(info.vertexShader);
+	if (!info.bCompute)
+	{
+		glDetachShader(info.program, info.fragmentShader);
+		glDeleteShader(info.fragmentShader);
+	}
+	info.vertexShader = 0;
+	info.fragmentShader = 0;
+
+	SaveBinary(info.program, info.cacheFile);
+
+	// the sources are only kept for the compile
+	info.vertexSource.clear();
+	info.fragmentSource.clear();
+	info.state = PROGRAM_READY;
+}
+
+/***********************************************************
+ *  RequestProgram()
+ *
+ *  This method is used for queuing a program variant.  A
+ *  cached binary is loaded right away, otherwise the variant
+ *  is compiled in the background and its handle reports ready
+ *  once the compile has finished.  -1 is returned when the
+ *  GLSL files could not be read.
+ ***********************************************************/
+int ShaderCache::RequestProgram(
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath,
+	const std::string& defines)
+{
+	PROGRAM_INFO info;
+	info.bCompute = false;
+	info.program = 0;
+	info.vertexShader = 0;
+	info.fragmentShader = 0;
+	info.state = PROGRAM_QUEUED;
+
+	if (!ReadSource(vertexShaderPath, defines, info.vertexSource) ||
+		!ReadSource(fragmentShaderPath, defines, info.fragmentSource))
+	{
+		return(-1);
+	}
+	info.cacheFile = MakeCacheFile(info.vertexSource, info.fragmentSource);
+
+	info.program = LoadBinary(info.cacheFile);
+	if (0 != info.program)
+	{
+		info.vertexSource.clear();
+		info.fragmentSource.clear();
+		info.state = PROGRAM_READY;
+		m_cacheHits++;
+	}
+	else if (m_bParallelCompile)
+	{
+		BeginCompile(info);
+	}
+
+	m_programs.push_back(info);
+
+	return((int)m_programs.size() - 1);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for advancing the background compiles.
+ *  Finished parallel compiles are collected without waiting,
+ *  and without driver support a single queued variant is built
+ *  so the cost is spread across frames.  True is returned when
+ *  a program finished building in this call.
+ ***********************************************************/
+bool ShaderCache::Update()
+{
+	bool bBuiltOne = false;
+	bool bFinished = false;
+
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		PROGRAM_INFO& info = m_programs[i];
+
+		if (info.state == PROGRAM_COMPILING)
+		{
+			GLint completed = GL_TRUE;
+			if (m_bParallelCompile)
+			{
+				glGetProgramiv(info.program, GL_COMPLETION_STATUS_KHR, &completed);
+			}
+			if (completed == GL_TRUE)
+			{
+				FinishCompile(info);
+				bFinished = true;
+			}
+		}
+		else if ((info.state == PROGRAM_QUEUED) && !bBuiltOne)
+		{
+			BeginCompile(info);
+			FinishCompile(info);
+			bBuiltOne = true;
+			bFinished = true;
+		}
+	}
+
+	return(bFinished);
+}
+
+/***********************************************************
+ *  HasPendingPrograms()
+ *
+ *  This method is used for checking whether any requested
+ *  program is still queued or compiling.
+ ***********************************************************/
+bool ShaderCache::HasPendingPrograms() const
+{
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		if ((m_programs[i].state == PROGRAM_QUEUED) ||
+			(m_programs[i].state == PROGRAM_COMPILING))
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  IsReady()
+ *
+ *  This method is used for checking whether a requested
+ *  program variant has finished building.
+ ***********************************************************/
+bool ShaderCache::IsReady(int handle) const
+{
+	if ((handle < 0) || (handle >= (int)m_programs.size()))
+	{
+		return false;
+	}
+
+	return(m_programs[handle].state == PROGRAM_READY);
+}
+
+/***********************************************************
+ *  IsFailed()
+ *
+ *  This method is used for checking whether a requested
+ *  program will never become ready, because its sources could
+ *  not be read or it did not compile or link.
+ ***********************************************************/
+bool ShaderCache::IsFailed(int handle) const
+{
+	if ((handle < 0) || (handle >= (int)m_programs.size()))
+	{
+		return true;
+	}
+
+	return(m_programs[handle].state == PROGRAM_FAILED);
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the program of a requested
+ *  variant, or the fallback program while it is not ready.
+ ***********************************************************/
+GLuint ShaderCache::GetProgram(int handle, GLuint fallbackProgram) const
+{
+	if (!IsReady(handle))
+	{
+		return(fallbackProgram);
+	}
+
+	return(m_programs[handle].program);
+}
+
+/***********************************************************
+ *  ReleaseProgram()
+ *
+ *  This method is used for deleting a program that a rebuilt
+ *  one replaced.  Only the cache deletes its programs, so the
+ *  variant that built it stops reporting a program that no
+ *  longer exists.
+ ***********************************************************/
+void ShaderCache::ReleaseProgram(GLuint program)
+{
+	if (0 == program)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		PROGRAM_INFO& info = m_programs[i];
+		if ((info.state == PROGRAM_READY) && (info.program == program))
+		{
+			glDeleteProgram(info.program);
+			info.program = 0;
+			info.state = PROGRAM_RELEASED;
+			return;
+		}
+	}
+}
+
+/***********************************************************
+ *  LoadProgram()
+ *
+ *  This method is used for building a program right away.
+ *  It goes through the same cache as the background requests
+ *  but waits for the compile when there is no cached binary.
+ ***********************************************************/
+GLuint ShaderCache::LoadProgram(
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath,
+	const std::string& defines)
+{
+	int handle = RequestProgram(vertexShaderPath, fragmentShaderPath, defines);
+	if (handle < 0)
+	{
+		return(0);
+	}
+
+	PROGRAM_INFO& info = m_programs[handle];
+	if (info.state == PROGRAM_QUEUED)
+	{
+		BeginCompile(info);
+	}
+	if (info.state == PROGRAM_COMPILING)
+	{
+		FinishCompile(info);
+	}
+
+	return(GetProgram(handle, 0));
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for building a program right away and
+ *  handing it to the passed in shader manager, in place of
+ *  ShaderManager::LoadShaders().
+ ***********************************************************/
+bool ShaderCache::LoadShaders(
+	ShaderManager* pShaderManager,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath,
+	const std::string& defines)
+{
+	GLuint program = LoadProgram(vertexShaderPath, fragmentShaderPath, defines);
+	if ((0 == program) || (NULL == pShaderManager))
+	{
+		return false;
+	}
+
+	pShaderManager->m_programID = program;
+
+	return true;
+}
+
+/***********************************************************
+ *  LoadComputeShader()
+ *
+ *  This method is used for building a compute program right
+ *  away through the same cache as the other programs and
+ *  handing it to the passed in shader manager.
+ ***********************************************************/
+bool ShaderCache::LoadComputeShader(
+	ShaderManager* pShaderManager,
+	const char* computeShaderPath,
+	const std::string& defines)
+{
+	PROGRAM_INFO info;
+	info.bCompute = true;
+	info.program = 0;
+	info.vertexShader = 0;
+	info.fragmentShader = 0;
+	info.state = PROGRAM_QUEUED;
+
+	if ((NULL == pShaderManager) || !ReadSource(computeShaderPath, defines, info.vertexSource))
+	{
+		return false;
+	}
+	info.cacheFile = MakeCacheFile(info.vertexSource, info.fragmentSource);
+
+	info.program = LoadBinary(info.cacheFile);
+	if (0 != info.program)
+	{
+		info.vertexSource.clear();
+		info.state = PROGRAM_READY;
+		m_cacheHits++;
+	}
+	else
+	{
+		BeginCompile(info);
+		FinishCompile(info);
+	}
+	m_programs.push_back(info);
+
+	if (info.state != PROGRAM_READY)
+	{
+		return false;
+	}
+
+	pShaderManager->m_programID = info.program;
+
+	return true;
+}
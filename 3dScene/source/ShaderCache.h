@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadercache.h
+// ============
+// build shader programs through an on-disk program binary cache and
+// compile uncached program variants in the background
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderCache
+ *
+ *  This class builds the shader programs for the scene.  The
+ *  linked program binaries are stored on disk, keyed by a hash
+ *  of the GLSL sources, the injected defines and the driver
+ *  vendor, renderer and version strings, and are reloaded with
+ *  glProgramBinary() on the next launch.  The GLSL sources are
+ *  only compiled when no cached binary exists or the driver
+ *  rejects it.
+ *
+ *  Program variants that are requested with RequestProgram()
+ *  do not block.  With GL_KHR_parallel_shader_compile the driver
+ *  compiles them on its own threads, otherwise one pending
+ *  variant is built per Update() call.  Until a variant is
+ *  ready the caller keeps drawing with its fallback program.
+ ***********************************************************/
+class ShaderCache
+{
+public:
+	// constructor
+	ShaderCache(const char* cacheFolder);
+	// destructor
+	~ShaderCache();
+
+	// build a program right away, from the cache when possible
+	GLuint LoadProgram(
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath,
+		const std::string& defines = "");
+
+	// build a program right away and hand it to the shader manager
+	bool LoadShaders(
+		ShaderManager* pShaderManager,
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath,
+		const std::string& defines = "");
+
+	// build a compute program right away and hand it to the shader
+	// manager, from the cache when possible
+	bool LoadComputeShader(
+		ShaderManager* pShaderManager,
+		const char* computeShaderPath,
+		const std::string& defines = "");
+
+	// queue a program variant without blocking, returns its handle
+	int RequestProgram(
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath,
+		const std::string& defines = "");
+
+	// advance the pending background compiles, called once per frame,
+	// returns true when a program finished building
+	bool Update();
+	// true while any requested program is queued or compiling
+	bool HasPendingPrograms() const;
+
+	// true when the requested program variant can be used
+	bool IsReady(int handle) const;
+	// true when the program could not be built or was never queued
+	bool IsFailed(int handle) const;
+	// the program of a requested variant, or the fallback while pending
+	GLuint GetProgram(int handle, GLuint fallbackProgram) const;
+	// delete a ready program that was replaced, its variant is no
+	// longer ready afterwards
+	void ReleaseProgram(GLuint program);
+
+	// number of programs that were loaded from cached binaries
+	int GetCacheHits() const { return(m_cacheHits); }
+	// number of programs that had to be compiled from source
+	int GetCacheMisses() const { return(m_cacheMisses); }
+
+private:
+	// states of a requested program variant
+	enum PROGRAM_STATE
+	{
+		PROGRAM_QUEUED,
+		PROGRAM_COMPILING,
+		PROGRAM_READY,
+		PROGRAM_FAILED,
+		PROGRAM_RELEASED
+	};
+
+	// properties of a requested program variant, a compute
+	// program keeps its source and shader in the vertex fields
+	struct PROGRAM_INFO
+	{
+		bool bCompute;
+		std::string vertexSource;
+		std::string fragmentSource;
+		std::string cacheFile;
+		GLuint program;
+		GLuint vertexShader;
+		GLuint fragmentShader;
+		PROGRAM_STATE state;
+	};
+
+	// folder that holds the program binaries
+	std::string m_cacheFolder;
+	// driver vendor, renderer and version, part of every cache key
+	std::string m_driverString;
+	// true when the driver compiles on its own threads
+	bool m_bParallelCompile;
+	// true when the driver supports program binaries
+	bool m_bProgramBinary;
+	// requested program variants
+	std::vector<PROGRAM_INFO> m_programs;
+	// cache statistics
+	int m_cacheHits;
+	int m_cacheMisses;
+
+	// read a GLSL file and inject the defines after the #version line
+	bool ReadSource(const char* filePath, const std::string& defines, std::string& source);
+	// build the cache file name for the passed in sources
+	std::string MakeCacheFile(const std::string& vertexSource, const std::string& fragmentSource);
+
+	// try to create the program from a cached binary
+	GLuint LoadBinary(const std::string& cacheFile);
+	// store the binary of a linked program
+	void SaveBinary(GLuint program, const std::string& cacheFile);
+
+	// start compiling and linking the program from source
+	void BeginCompile(PROGRAM_INFO& info);
+	// check the compile and link results and cache the binary
+	void FinishCompile(PROGRAM_INFO& info);
+};
@@ -0,0 +1,412 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.cpp
+// ============
+// build specialized forward shading programs from #define feature bits
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderPermutations.h"
+#include "GLStateCache.h"
+#include "CameraBlock.h"
+#include "GpuCulling.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  ShaderPermutations()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderPermutations::ShaderPermutations(
+	ShaderCache* pShaderCache,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath)
+{
+	m_pShaderCache = pShaderCache;
+	m_vertexShaderPath = vertexShaderPath;
+	m_fragmentShaderPath = fragmentShaderPath;
+
+	m_generic.handle = -1;
+	m_generic.reloadHandle = -1;
+	m_generic.pShaderManager = NULL;
+	m_generic.lightsVersion = 0;
+	m_generic.bBlocksBound = false;
+
+	// start at 1 so every variant receives the first values
+	m_lightsVersion = 1;
+}
+
+/***********************************************************
+ *  ~ShaderPermutations()
+ *
+ *  The destructor for the class.  The generic shader manager
+ *  belongs to the caller of LoadGenericShader().
+ ***********************************************************/
+ShaderPermutations::~ShaderPermutations()
+{
+	std::map<unsigned int, PROGRAM_VARIANT>::iterator it;
+	for (it = m_variants.begin(); it != m_variants.end(); ++it)
+	{
+		if (NULL != it->second.pShaderManager)
+		{
+			delete it->second.pShaderManager;
+			it->second.pShaderManager = NULL;
+		}
+	}
+	m_variants.clear();
+	m_generic.pShaderManager = NULL;
+}
+
+/***********************************************************
+ *  LoadGenericShader()
+ *
+ *  This method is used for building the program without any
+ *  feature defines.  It selects the features with uniforms,
+ *  so it can draw everything while the variants compile.
+ ***********************************************************/
+bool ShaderPermutations::LoadGenericShader(ShaderManager* pShaderManager)
+{
+	m_generic.pShaderManager = pShaderManager;
+
+	bool bLoaded = m_pShaderCache->LoadShaders(
+		pShaderManager,
+		m_vertexShaderPath.c_str(),
+		m_fragmentShaderPath.c_str(),
+		m_commonDefines);
+	if (bLoaded)
+	{
+		FrameRingBuffer::BindProgramBlocks(pShaderManager->m_programID);
+		CameraBlock::BindProgramBlock(pShaderManager->m_programID);
+		m_generic.bBlocksBound = true;
+	}
+
+	return(bLoaded);
+}
+
+/***********************************************************
+ *  SetCommonDefines()
+ *
+ *  This method is used for setting the #define lines that are
+ *  added to the generic program and to every variant, such as
+ *  the switch to the frame ring buffer blocks.
+ ***********************************************************/
+void ShaderPermutations::SetCommonDefines(const std::string& defines)
+{
+	m_commonDefines = defines;
+}
+
+/***********************************************************
+ *  MakeKey()
+ *
+ *  This method is used for combining the features of a draw
+ *  into the key of its program variant.
+ ***********************************************************/
+unsigned int ShaderPermutations::MakeKey(
+	bool bTexture,
+	bool bLighting,
+	int lightCount,
+	bool bAlpha,
+	bool bWeightedOIT,
+	bool bLightmap,
+	bool bGpuCulling)
+{
+	unsigned int key = 0;
+
+	if (bTexture)
+	{
+		key |= FEATURE_TEXTURE;
+	}
+	if (bLighting)
+	{
+		if (lightCount > MAX_LIGHT_COUNT)
+		{
+			lightCount = MAX_LIGHT_COUNT;
+		}
+		key |= FEATURE_LIGHTING;
+		key |= ((unsigned int)lightCount << LIGHT_COUNT_SHIFT);
+	}
+	if (bAlpha)
+	{
+		key |= FEATURE_ALPHA;
+	}
+	if (bWeightedOIT)
+	{
+		key |= FEATURE_WEIGHTED_OIT;
+	}
+	if (bLightmap)
+	{
+		key |= FEATURE_LIGHTMAP;
+	}
+	if (bGpuCulling)
+	{
+		key |= FEATURE_GPU_CULLING;
+	}
+
+	return(key);
+}
+
+/***********************************************************
+ *  MakeDefines()
+ *
+ *  This method is used for building the #define lines that
+ *  select the features of a program variant.
+ ***********************************************************/
+std::string ShaderPermutations::MakeDefines(unsigned int key)
+{
+	std::string defines = "#define PERMUTATION\n";
+	int lightCount = 0;
+
+	if (key & FEATURE_TEXTURE)
+	{
+		defines += "#define USE_TEXTURE\n";
+	}
+	if (key & FEATURE_LIGHTING)
+	{
+		defines += "#define USE_LIGHTING\n";
+		lightCount = (int)(key >> LIGHT_COUNT_SHIFT);
+	}
+	if (key & FEATURE_ALPHA)
+	{
+		defines += "#define USE_ALPHA\n";
+	}
+	if (key & FEATURE_WEIGHTED_OIT)
+	{
+		defines += "#define USE_WEIGHTED_OIT\n";
+	}
+	if (key & FEATURE_LIGHTMAP)
+	{
+		defines += "#define USE_LIGHTMAP\n";
+	}
+	if (key & FEATURE_GPU_CULLING)
+	{
+		// the scene shaders are GLSL 3.30, which has no storage
+		// buffers of its own
+		defines += "#extension GL_ARB_shader_storage_buffer_object : require\n";
+		defines += "#define USE_GPU_CULLING\n";
+	}
+	defines += "#define LIGHT_COUNT " + std::to_string(lightCount) + "\n";
+
+	return(defines);
+}
+
+/***********************************************************
+ *  SetLightSources()
+ *
+ *  This method is used for setting the light sources that
+ *  are uploaded into each program variant the next time it
+ *  is bound.
+ ***********************************************************/
+void ShaderPermutations::SetLightSources(
+	const std::vector<SceneManager::LIGHT_SOURCE>& lights)
+{
+	m_lights = lights;
+	m_lightsVersion++;
+}
+
+/***********************************************************
+ *  UpdateVariant()
+ *
+ *  This method is used for uploading the light sources into
+ *  the bound variant when they have changed since it was last
+ *  used.  The camera is read from the shared camera block.
+ ***********************************************************/
+void ShaderPermutations::UpdateVariant(
+	PROGRAM_VARIANT& variant,
+	int lightCount)
+{
+	ShaderManager* pShader = variant.pShaderManager;
+
+	if (variant.lightsVersion != m_lightsVersion)
+	{
+		if (lightCount > (int)m_lights.size())
+		{
+			lightCount = (int)m_lights.size();
+		}
+		for (int i = 0; i < lightCount; i++)
+		{
+			std::string name = "lightSources[" + std::to_string(i) + "].";
+			pShader->setVec3Value(name + "position", m_lights[i].position);
+			pShader->setVec3Value(name + "ambientColor", m_lights[i].ambientColor);
+			pShader->setVec3Value(name + "diffuseColor", m_lights[i].diffuseColor);
+			pShader->setVec3Value(name + "specularColor", m_lights[i].specularColor);
+			pShader->setFloatValue(name + "focalStrength", m_lights[i].focalStrength);
+			pShader->setFloatValue(name + "specularIntensity", m_lights[i].specularIntensity);
+		}
+		variant.lightsVersion = m_lightsVersion;
+	}
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the program variant of
+ *  the passed in key.  The first request for a key queues its
+ *  compile, and the generic program is bound until the variant
+ *  is ready.  bSpecialized tells the caller whether the bound
+ *  program still needs the feature uniforms.
+ ***********************************************************/
+ShaderManager* ShaderPermutations::Bind(unsigned int key, bool& bSpecialized)
+{
+	std::map<unsigned int, PROGRAM_VARIANT>::iterator it = m_variants.find(key);
+	if (it == m_variants.end())
+	{
+		PROGRAM_VARIANT variant;
+		variant.pShaderManager = new ShaderManager();
+		variant.pShaderManager->m_programID = 0;
+		variant.lightsVersion = 0;
+		variant.bBlocksBound = false;
+		variant.reloadHandle = -1;
+		variant.handle = m_pShaderCache->RequestProgram(
+			m_vertexShaderPath.c_str(),
+			m_fragmentShaderPath.c_str(),
+			m_commonDefines + MakeDefines(key));
+		it = m_variants.insert(std::make_pair(key, variant)).first;
+	}
+
+	PROGRAM_VARIANT& variant = it->second;
+	if (m_pShaderCache->IsReady(variant.handle))
+	{
+		variant.pShaderManager->m_programID = m_pShaderCache->GetProgram(variant.handle, 0);
+		if (!variant.bBlocksBound)
+		{
+			FrameRingBuffer::BindProgramBlocks(variant.pShaderManager->m_programID);
+			CameraBlock::BindProgramBlock(variant.pShaderManager->m_programID);
+			GpuCulling::BindProgramBlocks(variant.pShaderManager->m_programID);
+			variant.bBlocksBound = true;
+		}
+		GLStateCache::UseProgram(variant.pShaderManager->m_programID);
+		UpdateVariant(variant, (int)(key >> LIGHT_COUNT_SHIFT));
+		bSpecialized = true;
+
+		return(variant.pShaderManager);
+	}
+
+	GLStateCache::UseProgram(m_generic.pShaderManager->m_programID);
+	UpdateVariant(m_generic, MAX_LIGHT_COUNT);
+	bSpecialized = false;
+
+	return(m_generic.pShaderManager);
+}
+
+/***********************************************************
+ *  GetShaderFiles()
+ *
+ *  This method is used for getting the GLSL files that the
+ *  generic program and the variants are built from.
+ ***********************************************************/
+void ShaderPermutations::GetShaderFiles(std::vector<std::string>& files) const
+{
+	files.clear();
+	files.push_back(m_vertexShaderPath);
+	files.push_back(m_fragmentShaderPath);
+}
+
+/***********************************************************
+ *  ReloadShaders()
+ *
+ *  This method is used for queuing a rebuild of the generic
+ *  program and of every requested variant after one of the
+ *  scene GLSL files changed.  The rebuilds compile in the
+ *  background like the first builds, and the old programs keep
+ *  drawing until UpdateReloads() swaps them.
+ ***********************************************************/
+bool ShaderPermutations::ReloadShaders(const std::string& changedFile)
+{
+	if ((changedFile != m_vertexShaderPath) && (changedFile != m_fragmentShaderPath))
+	{
+		return(false);
+	}
+
+	if (NULL != m_generic.pShaderManager)
+	{
+		m_generic.reloadHandle = m_pShaderCache->RequestProgram(
+			m_vertexShaderPath.c_str(),
+			m_fragmentShaderPath.c_str(),
+			m_commonDefines);
+	}
+
+	std::map<unsigned int, PROGRAM_VARIANT>::iterator it;
+	for (it = m_variants.begin(); it != m_variants.end(); ++it)
+	{
+		it->second.reloadHandle = m_pShaderCache->RequestProgram(
+			m_vertexShaderPath.c_str(),
+			m_fragmentShaderPath.c_str(),
+			m_commonDefines + MakeDefines(it->first));
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SwapReloadedProgram()
+ *
+ *  This method is used for handing the rebuilt program of a
+ *  variant to its shader manager once it is ready.  The cache
+ *  deletes the old program, and the new one has its uniform
+ *  blocks attached and receives the lights on its next bind.
+ *  A rebuild that failed is dropped, so a typo in a shader
+ *  leaves the last working program in use.
+ ***********************************************************/
+bool ShaderPermutations::SwapReloadedProgram(PROGRAM_VARIANT& variant)
+{
+	if (variant.reloadHandle < 0)
+	{
+		return(false);
+	}
+	if (m_pShaderCache->IsFailed(variant.reloadHandle))
+	{
+		std::cout << "Rebuilt scene shader failed, the previous program is kept" << std::endl;
+		variant.reloadHandle = -1;
+		return(false);
+	}
+	if (!m_pShaderCache->IsReady(variant.reloadHandle))
+	{
+		return(false);
+	}
+
+	GLuint oldProgram = variant.pShaderManager->m_programID;
+	variant.handle = variant.reloadHandle;
+	variant.reloadHandle = -1;
+	variant.pShaderManager->m_programID = m_pShaderCache->GetProgram(variant.handle, 0);
+	if (oldProgram != variant.pShaderManager->m_programID)
+	{
+		m_pShaderCache->ReleaseProgram(oldProgram);
+	}
+	GLStateCache::InvalidateProgram();
+
+	FrameRingBuffer::BindProgramBlocks(variant.pShaderManager->m_programID);
+	CameraBlock::BindProgramBlock(variant.pShaderManager->m_programID);
+	GpuCulling::BindProgramBlocks(variant.pShaderManager->m_programID);
+	variant.bBlocksBound = true;
+	variant.lightsVersion = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateReloads()
+ *
+ *  This method is used for swapping in the rebuilt programs
+ *  that are ready.  It is called between frames, so a frame
+ *  never mixes old and new programs.  The generic program also
+ *  holds uniforms set by the scene, so the caller has to pass
+ *  those again when true is returned.
+ ***********************************************************/
+bool ShaderPermutations::UpdateReloads()
+{
+	bool bChanged = false;
+	if (NULL != m_generic.pShaderManager)
+	{
+		bChanged = SwapReloadedProgram(m_generic);
+	}
+
+	std::map<unsigned int, PROGRAM_VARIANT>::iterator it;
+	for (it = m_variants.begin(); it != m_variants.end(); ++it)
+	{
+		if (SwapReloadedProgram(it->second))
+		{
+			bChanged = true;
+		}
+	}
+
+	return(bChanged);
+}
@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.h
+// ============
+// build specialized forward shading programs from #define feature bits
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderCache.h"
+#include "SceneManager.h"
+#include "FrameRingBuffer.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderPermutations
+ *
+ *  This class maps a set of shader feature bits - textured,
+ *  lit, light count, alpha, weighted transparency, baked
+ *  lighting and the draws of the GPU culling - to a
+ *  specialized program built from the scene GLSL files with
+ *  matching #define lines.  The variants are compiled in the
+ *  background the first time they are bound, and the generic
+ *  program with uniform branches is used until they are ready.
+ ***********************************************************/
+class ShaderPermutations
+{
+public:
+	// feature bits of a program variant
+	enum SHADER_FEATURE
+	{
+		FEATURE_TEXTURE = 0x01,
+		FEATURE_LIGHTING = 0x02,
+		FEATURE_ALPHA = 0x04,
+		FEATURE_WEIGHTED_OIT = 0x08,
+		FEATURE_LIGHTMAP = 0x10,
+		FEATURE_GPU_CULLING = 0x20
+	};
+	// the light count is stored above the feature bits
+	static const unsigned int LIGHT_COUNT_SHIFT = 6;
+	static const int MAX_LIGHT_COUNT = 4;
+
+	// constructor
+	ShaderPermutations(
+		ShaderCache* pShaderCache,
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath);
+	// destructor
+	~ShaderPermutations();
+
+	// set defines that are added to the generic program and every
+	// variant, must be called before LoadGenericShader()
+	void SetCommonDefines(const std::string& defines);
+	// build the generic program that draws while variants compile
+	bool LoadGenericShader(ShaderManager* pShaderManager);
+
+	// combine the features of a draw into a variant key
+	static unsigned int MakeKey(
+		bool bTexture,
+		bool bLighting,
+		int lightCount,
+		bool bAlpha,
+		bool bWeightedOIT = false,
+		bool bLightmap = false,
+		bool bGpuCulling = false);
+
+	// set the light sources, uploaded to each variant when bound
+	void SetLightSources(const std::vector<SceneManager::LIGHT_SOURCE>& lights);
+
+	// bind the variant for the key, or the generic program while it
+	// is still compiling, and return the bound shader manager
+	ShaderManager* Bind(unsigned int key, bool& bSpecialized);
+
+	// number of variants that have been requested
+	int GetVariantCount() const { return((int)m_variants.size()); }
+
+	// get the GLSL files the programs are built from
+	void GetShaderFiles(std::vector<std::string>& files) const;
+	// queue a rebuild of the generic program and every variant when
+	// a GLSL file of theirs changed, returns false otherwise
+	bool ReloadShaders(const std::string& changedFile);
+	// swap in the rebuilt programs that are ready, returns true
+	// when a program was replaced
+	bool UpdateReloads();
+
+private:
+	// properties of one program variant
+	struct PROGRAM_VARIANT
+	{
+		int handle;
+		// request handle of a rebuilt program, -1 when none
+		int reloadHandle;
+		ShaderManager* pShaderManager;
+		unsigned int lightsVersion;
+		bool bBlocksBound;
+	};
+
+	// cache that builds the programs
+	ShaderCache* m_pShaderCache;
+	// GLSL files of the scene shaders
+	std::string m_vertexShaderPath;
+	std::string m_fragmentShaderPath;
+	// defines shared by all programs
+	std::string m_commonDefines;
+	// generic program with uniform branches
+	PROGRAM_VARIANT m_generic;
+	// specialized programs by variant key
+	std::map<unsigned int, PROGRAM_VARIANT> m_variants;
+
+	// current lights with their change counter
+	std::vector<SceneManager::LIGHT_SOURCE> m_lights;
+	unsigned int m_lightsVersion;
+
+	// build the #define lines for a variant key
+	static std::string MakeDefines(unsigned int key);
+	// bring the lights of a bound variant up to date
+	void UpdateVariant(PROGRAM_VARIANT& variant, int lightCount);
+	// replace the program of a variant with its rebuilt one when
+	// it is ready, returns true when the program was replaced
+	bool SwapReloadedProgram(PROGRAM_VARIANT& variant);
+};
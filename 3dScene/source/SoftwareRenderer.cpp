@@ -0,0 +1,1594 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerenderer.cpp
+// ============
+// multithreaded tile based rasterizer that renders the recorded
+// draw list of the scene on the CPU, without an OpenGL context
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRenderer.h"
+#include "ResourceRegistry.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// SSE2 is part of every x64 target, the edge functions and the
+// depth test then run on four pixels at once
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SOFTWARE_RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// the worker index is kept in the upper bits of a triangle id,
+	// six bits are enough for the most workers
+	const int MAX_THREADS = 64;
+	const int TRIANGLE_INDEX_BITS = 26;
+	const unsigned int TRIANGLE_INDEX_MASK = (1u << TRIANGLE_INDEX_BITS) - 1;
+	static_assert(MAX_THREADS <= (1 << (32 - TRIANGLE_INDEX_BITS)), "worker index does not fit a triangle id");
+	// visibility entry of a pixel that no triangle covers
+	const unsigned int NO_TRIANGLE = 0xFFFFFFFF;
+
+	// CRC table of the PNG chunks, built once at startup
+	struct CRC_TABLE
+	{
+		unsigned int values[256];
+
+		CRC_TABLE()
+		{
+			for (unsigned int n = 0; n < 256; n++)
+			{
+				unsigned int c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				values[n] = c;
+			}
+		}
+	};
+	const CRC_TABLE g_CrcTable;
+
+	// the guard band lets triangles extend this many half screens
+	// past the edges before they are clipped, in clip space units
+	const float GUARD_BAND = 4.0f;
+	// clip planes as coefficients of the clip space position:
+	// near, far, left, right, bottom and top
+	const glm::vec4 g_ClipPlanes[6] =
+	{
+		glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+		glm::vec4(0.0f, 0.0f, -1.0f, 1.0f),
+		glm::vec4(1.0f, 0.0f, 0.0f, GUARD_BAND),
+		glm::vec4(-1.0f, 0.0f, 0.0f, GUARD_BAND),
+		glm::vec4(0.0f, 1.0f, 0.0f, GUARD_BAND),
+		glm::vec4(0.0f, -1.0f, 0.0f, GUARD_BAND)
+	};
+	// a triangle clipped by six planes has at most nine vertices
+	const int MAX_CLIPPED_VERTICES = 9;
+
+	// color of the cleared frame
+	const glm::vec4 g_ClearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// resolution of the curved shapes
+	const int CYLINDER_SLICES = 36;
+	const int SPHERE_SLICES = 36;
+	const int SPHERE_STACKS = 18;
+	const int TORUS_MAIN_SEGMENTS = 30;
+	const int TORUS_TUBE_SEGMENTS = 30;
+	const float TORUS_MAIN_RADIUS = 1.0f;
+	const float TORUS_TUBE_RADIUS = 0.1f;
+	const float PI = 3.14159265358979f;
+
+	/***********************************************************
+	 *  LerpVertex()
+	 *
+	 *  This function is used for interpolating a clip space
+	 *  vertex and its attributes along a clipped edge.
+	 ***********************************************************/
+	template <typename T>
+	T LerpVertex(const T& a, const T& b, float t)
+	{
+		T result;
+		result.position = glm::mix(a.position, b.position, t);
+		result.worldPosition = glm::mix(a.worldPosition, b.worldPosition, t);
+		result.normal = glm::mix(a.normal, b.normal, t);
+		result.uv = glm::mix(a.uv, b.uv, t);
+		return(result);
+	}
+}
+
+/***********************************************************
+ *  SoftwareRenderer()
+ *
+ *  The constructor for the class.  The worker threads are
+ *  started here and sleep until a frame is rendered.
+ ***********************************************************/
+SoftwareRenderer::SoftwareRenderer(int width, int height, int threadCount)
+{
+	m_width = glm::max(width, 1);
+	m_height = glm::max(height, 1);
+	m_tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+
+	m_threadCount = threadCount;
+	if (m_threadCount <= 0)
+	{
+		m_threadCount = (int)std::thread::hardware_concurrency();
+	}
+	m_threadCount = glm::clamp(m_threadCount, 1, MAX_THREADS);
+
+	m_pScene = NULL;
+	m_viewProjection = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_nextTile = 0;
+	m_triangleCount = 0;
+	m_renderTime = 0.0;
+	m_jobGeneration = 0;
+	m_pendingWorkers = 0;
+	m_bStopWorkers = false;
+
+	m_triangles.resize(m_threadCount);
+	m_refusedTriangles.resize(m_threadCount);
+	m_clipVertices.resize(m_threadCount);
+	m_tileBuffers.resize(m_threadCount);
+	m_bins.resize(m_threadCount);
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		m_bins[i].resize(m_tilesX * m_tilesY);
+	}
+	m_colorBuffer.assign(m_width * m_height * 4, 0);
+
+	BuildMeshes();
+
+	size_t meshBytes = 0;
+	for (int i = 0; i <= SceneManager::TORUS_MESH; i++)
+	{
+		meshBytes += m_meshes[i].vertices.size() * sizeof(MESH_VERTEX) +
+			m_meshes[i].indices.size() * sizeof(unsigned int);
+	}
+	ResourceRegistry::TrackHost(m_colorBuffer.data(), m_colorBuffer.size(), "software color buffer");
+	ResourceRegistry::TrackHost(m_tileBuffers.data(), m_tileBuffers.size() * sizeof(TILE_BUFFER), "software tile buffers");
+	ResourceRegistry::TrackHost(m_meshes, meshBytes, "software meshes");
+
+	for (int i = 1; i < m_threadCount; i++)
+	{
+		m_workers.push_back(std::thread(&SoftwareRenderer::WorkerMain, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~SoftwareRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRenderer::~SoftwareRenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_bStopWorkers = true;
+	}
+	m_jobCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	ResourceRegistry::ReleaseHost(m_colorBuffer.data());
+	ResourceRegistry::ReleaseHost(m_tileBuffers.data());
+	ResourceRegistry::ReleaseHost(m_meshes);
+}
+
+/***********************************************************
+ *  RunParallel()
+ *
+ *  This method is used for running a job on all workers.  The
+ *  calling thread works as worker 0 and returns when every
+ *  worker has finished.
+ ***********************************************************/
+void SoftwareRenderer::RunParallel(const std::function<void(int)>& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_job = job;
+		m_jobGeneration++;
+		m_pendingWorkers = m_threadCount - 1;
+	}
+	m_jobCondition.notify_all();
+
+	job(0);
+
+	std::unique_lock<std::mutex> lock(m_jobMutex);
+	m_doneCondition.wait(lock, [this]() { return(m_pendingWorkers == 0); });
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is the body of a worker thread.  It runs each
+ *  new job once and reports when it is done.
+ ***********************************************************/
+void SoftwareRenderer::WorkerMain(int worker)
+{
+	unsigned int finishedGeneration = 0;
+	while (true)
+	{
+		std::function<void(int)> job;
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_jobCondition.wait(lock, [&]()
+				{
+					return(m_bStopWorkers || (m_jobGeneration != finishedGeneration));
+				});
+			if (m_bStopWorkers)
+			{
+				return;
+			}
+			finishedGeneration = m_jobGeneration;
+			job = m_job;
+		}
+
+		job(worker);
+
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_pendingWorkers--;
+		if (m_pendingWorkers == 0)
+		{
+			m_doneCondition.notify_one();
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildMeshes()
+ *
+ *  This method is used for building the software copies of
+ *  the basic shapes that SceneManager draws.
+ ***********************************************************/
+void SoftwareRenderer::BuildMeshes()
+{
+	BuildBoxMesh(m_meshes[SceneManager::BOX_MESH]);
+	BuildConeMesh(m_meshes[SceneManager::CONE_MESH]);
+	BuildCylinderMesh(m_meshes[SceneManager::CYLINDER_MESH]);
+	BuildPlaneMesh(m_meshes[SceneManager::PLANE_MESH]);
+	BuildSphereMesh(m_meshes[SceneManager::SPHERE_MESH]);
+	BuildTorusMesh(m_meshes[SceneManager::TORUS_MESH]);
+}
+
+/***********************************************************
+ *  BuildBasicMesh()
+ *
+ *  This method is used for building one of the basic shapes
+ *  into the passed in vertex and index lists, replacing their
+ *  contents.  The imported meshes are not basic shapes, so
+ *  the lists stay empty for them.
+ ***********************************************************/
+void SoftwareRenderer::BuildBasicMesh(
+	SceneManager::MESH_TYPE mesh,
+	std::vector<MeshImporter::MESH_VERTEX>& vertices,
+	std::vector<unsigned int>& indices)
+{
+	MESH shape;
+	switch (mesh)
+	{
+	case SceneManager::BOX_MESH:
+		BuildBoxMesh(shape);
+		break;
+	case SceneManager::CONE_MESH:
+		BuildConeMesh(shape);
+		break;
+	case SceneManager::CYLINDER_MESH:
+		BuildCylinderMesh(shape);
+		break;
+	case SceneManager::PLANE_MESH:
+		BuildPlaneMesh(shape);
+		break;
+	case SceneManager::SPHERE_MESH:
+		BuildSphereMesh(shape);
+		break;
+	case SceneManager::TORUS_MESH:
+		BuildTorusMesh(shape);
+		break;
+	default:
+		break;
+	}
+
+	vertices.swap(shape.vertices);
+	indices.swap(shape.indices);
+}
+
+/***********************************************************
+ *  BuildBoxMesh()
+ *
+ *  This method is used for building a unit cube centered on
+ *  the origin, with a full texture on every face.
+ ***********************************************************/
+void SoftwareRenderer::BuildBoxMesh(MESH& mesh)
+{
+	// normal and the two axes that span each face
+	const glm::vec3 faces[6][3] =
+	{
+		{ glm::vec3(0, 0, 1), glm::vec3(1, 0, 0), glm::vec3(0, 1, 0) },
+		{ glm::vec3(0, 0, -1), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0) },
+		{ glm::vec3(1, 0, 0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0) },
+		{ glm::vec3(-1, 0, 0), glm::vec3(0, 0, 1), glm::vec3(0, 1, 0) },
+		{ glm::vec3(0, 1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, -1) },
+		{ glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), glm::vec3(0, 0, 1) }
+	};
+	const glm::vec2 corners[4] =
+	{
+		glm::vec2(0.0f, 0.0f),
+		glm::vec2(1.0f, 0.0f),
+		glm::vec2(1.0f, 1.0f),
+		glm::vec2(0.0f, 1.0f)
+	};
+
+	for (int face = 0; face < 6; face++)
+	{
+		unsigned int first = (unsigned int)mesh.vertices.size();
+		for (int i = 0; i < 4; i++)
+		{
+			MESH_VERTEX vertex;
+			vertex.position = 0.5f * faces[face][0] +
+				(corners[i].x - 0.5f) * faces[face][1] +
+				(corners[i].y - 0.5f) * faces[face][2];
+			vertex.normal = faces[face][0];
+			vertex.uv = corners[i];
+			mesh.vertices.push_back(vertex);
+		}
+		unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+		for (int i = 0; i < 6; i++)
+		{
+			mesh.indices.push_back(first + quad[i]);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildConeMesh()
+ *
+ *  This method is used for building a cone of radius 1 with
+ *  its base on y = 0 and its tip at y = 1.
+ ***********************************************************/
+void SoftwareRenderer::BuildConeMesh(MESH& mesh)
+{
+	for (int i = 0; i < CYLINDER_SLICES; i++)
+	{
+		float angle0 = 2.0f * PI * (float)i / (float)CYLINDER_SLICES;
+		float angle1 = 2.0f * PI * (float)(i + 1) / (float)CYLINDER_SLICES;
+		float angleMid = 0.5f * (angle0 + angle1);
+		unsigned int first = (unsigned int)mesh.vertices.size();
+
+		MESH_VERTEX vertex;
+		// side, the tip takes the normal of the middle of the slice
+		vertex.position = glm::vec3(cos(angle0), 0.0f, sin(angle0));
+		vertex.normal = glm::normalize(glm::vec3(cos(angle0), 1.0f, sin(angle0)));
+		vertex.uv = glm::vec2((float)i / (float)CYLINDER_SLICES, 0.0f);
+		mesh.vertices.push_back(vertex);
+		vertex.position = glm::vec3(cos(angle1), 0.0f, sin(angle1));
+		vertex.normal = glm::normalize(glm::vec3(cos(angle1), 1.0f, sin(angle1)));
+		vertex.uv = glm::vec2((float)(i + 1) / (float)CYLINDER_SLICES, 0.0f);
+		mesh.vertices.push_back(vertex);
+		vertex.position = glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.normal = glm::normalize(glm::vec3(cos(angleMid), 1.0f, sin(angleMid)));
+		vertex.uv = glm::vec2(((float)i + 0.5f) / (float)CYLINDER_SLICES, 1.0f);
+		mesh.vertices.push_back(vertex);
+
+		// bottom
+		vertex.normal = glm::vec3(0.0f, -1.0f, 0.0f);
+		vertex.position = glm::vec3(0.0f, 0.0f, 0.0f);
+		vertex.uv = glm::vec2(0.5f, 0.5f);
+		mesh.vertices.push_back(vertex);
+		vertex.position = glm::vec3(cos(angle0), 0.0f, sin(angle0));
+		vertex.uv = glm::vec2(0.5f + 0.5f * cos(angle0), 0.5f + 0.5f * sin(angle0));
+		mesh.vertices.push_back(vertex);
+		vertex.position = glm::vec3(cos(angle1), 0.0f, sin(angle1));
+		vertex.uv = glm::vec2(0.5f + 0.5f * cos(angle1), 0.5f + 0.5f * sin(angle1));
+		mesh.vertices.push_back(vertex);
+
+		for (unsigned int j = 0; j < 6; j++)
+		{
+			mesh.indices.push_back(first + j);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildCylinderMesh()
+ *
+ *  This method is used for building a closed cylinder of
+ *  radius 1 from y = 0 to y = 1.
+ ***********************************************************/
+void SoftwareRenderer::BuildCylinderMesh(MESH& mesh)
+{
+	for (int i = 0; i < CYLINDER_SLICES; i++)
+	{
+		float angle0 = 2.0f * PI * (float)i / (float)CYLINDER_SLICES;
+		float angle1 = 2.0f * PI * (float)(i + 1) / (float)CYLINDER_SLICES;
+		glm::vec3 rim0 = glm::vec3(cos(angle0), 0.0f, sin(angle0));
+		glm::vec3 rim1 = glm::vec3(cos(angle1), 0.0f, sin(angle1));
+		float u0 = (float)i / (float)CYLINDER_SLICES;
+		float u1 = (float)(i + 1) / (float)CYLINDER_SLICES;
+		unsigned int first = (unsigned int)mesh.vertices.size();
+
+		MESH_VERTEX vertex;
+		// side
+		vertex.position = rim0;
+		vertex.normal = rim0;
+		vertex.uv = glm::vec2(u0, 0.0f);
+		mesh.vertices.push_back(vertex);
+		vertex.position = rim1;
+		vertex.normal = rim1;
+		vertex.uv = glm::vec2(u1, 0.0f);
+		mesh.vertices.push_back(vertex);
+		vertex.position = rim1 + glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.uv = glm::vec2(u1, 1.0f);
+		mesh.vertices.push_back(vertex);
+		vertex.position = rim0 + glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.normal = rim0;
+		vertex.uv = glm::vec2(u0, 1.0f);
+		mesh.vertices.push_back(vertex);
+		unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+		for (int j = 0; j < 6; j++)
+		{
+			mesh.indices.push_back(first + quad[j]);
+		}
+
+		// bottom and top caps
+		for (int cap = 0; cap < 2; cap++)
+		{
+			float y = (float)cap;
+			unsigned int center = (unsigned int)mesh.vertices.size();
+			vertex.normal = glm::vec3(0.0f, (cap == 0) ? -1.0f : 1.0f, 0.0f);
+			vertex.position = glm::vec3(0.0f, y, 0.0f);
+			vertex.uv = glm::vec2(0.5f, 0.5f);
+			mesh.vertices.push_back(vertex);
+			vertex.position = rim0 + glm::vec3(0.0f, y, 0.0f);
+			vertex.uv = glm::vec2(0.5f + 0.5f * rim0.x, 0.5f + 0.5f * rim0.z);
+			mesh.vertices.push_back(vertex);
+			vertex.position = rim1 + glm::vec3(0.0f, y, 0.0f);
+			vertex.uv = glm::vec2(0.5f + 0.5f * rim1.x, 0.5f + 0.5f * rim1.z);
+			mesh.vertices.push_back(vertex);
+			mesh.indices.push_back(center);
+			mesh.indices.push_back(center + 1);
+			mesh.indices.push_back(center + 2);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildPlaneMesh()
+ *
+ *  This method is used for building a plane of 2 x 2 units on
+ *  y = 0 that faces up.
+ ***********************************************************/
+void SoftwareRenderer::BuildPlaneMesh(MESH& mesh)
+{
+	const glm::vec2 corners[4] =
+	{
+		glm::vec2(0.0f, 0.0f),
+		glm::vec2(1.0f, 0.0f),
+		glm::vec2(1.0f, 1.0f),
+		glm::vec2(0.0f, 1.0f)
+	};
+
+	for (int i = 0; i < 4; i++)
+	{
+		MESH_VERTEX vertex;
+		vertex.position = glm::vec3(corners[i].x * 2.0f - 1.0f, 0.0f, 1.0f - corners[i].y * 2.0f);
+		vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+		vertex.uv = corners[i];
+		mesh.vertices.push_back(vertex);
+	}
+	unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+	mesh.indices.assign(quad, quad + 6);
+}
+
+/***********************************************************
+ *  BuildSphereMesh()
+ *
+ *  This method is used for building a sphere of radius 1
+ *  centered on the origin.
+ ***********************************************************/
+void SoftwareRenderer::BuildSphereMesh(MESH& mesh)
+{
+	for (int stack = 0; stack <= SPHERE_STACKS; stack++)
+	{
+		float v = (float)stack / (float)SPHERE_STACKS;
+		float polar = PI * v;
+		for (int slice = 0; slice <= SPHERE_SLICES; slice++)
+		{
+			float u = (float)slice / (float)SPHERE_SLICES;
+			float azimuth = 2.0f * PI * u;
+
+			MESH_VERTEX vertex;
+			vertex.normal = glm::vec3(
+				sin(polar) * cos(azimuth),
+				-cos(polar),
+				sin(polar) * sin(azimuth));
+			vertex.position = vertex.normal;
+			vertex.uv = glm::vec2(u, v);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	unsigned int rowLength = SPHERE_SLICES + 1;
+	for (int stack = 0; stack < SPHERE_STACKS; stack++)
+	{
+		for (int slice = 0; slice < SPHERE_SLICES; slice++)
+		{
+			unsigned int a = stack * rowLength + slice;
+			unsigned int b = a + rowLength;
+			mesh.indices.push_back(a);
+			mesh.indices.push_back(b);
+			mesh.indices.push_back(a + 1);
+			mesh.indices.push_back(a + 1);
+			mesh.indices.push_back(b);
+			mesh.indices.push_back(b + 1);
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildTorusMesh()
+ *
+ *  This method is used for building a torus around the z axis
+ *  with a main radius of 1 and a thin tube.
+ ***********************************************************/
+void SoftwareRenderer::BuildTorusMesh(MESH& mesh)
+{
+	for (int i = 0; i <= TORUS_MAIN_SEGMENTS; i++)
+	{
+		float u = (float)i / (float)TORUS_MAIN_SEGMENTS;
+		float mainAngle = 2.0f * PI * u;
+		for (int j = 0; j <= TORUS_TUBE_SEGMENTS; j++)
+		{
+			float v = (float)j / (float)TORUS_TUBE_SEGMENTS;
+			float tubeAngle = 2.0f * PI * v;
+
+			MESH_VERTEX vertex;
+			vertex.normal = glm::vec3(
+				cos(tubeAngle) * cos(mainAngle),
+				cos(tubeAngle) * sin(mainAngle),
+				sin(tubeAngle));
+			float ring = TORUS_MAIN_RADIUS + TORUS_TUBE_RADIUS * cos(tubeAngle);
+			vertex.position = glm::vec3(
+				ring * cos(mainAngle),
+				ring * sin(mainAngle),
+				TORUS_TUBE_RADIUS * sin(tubeAngle));
+			vertex.uv = glm::vec2(u, v);
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	unsigned int rowLength = TORUS_TUBE_SEGMENTS + 1;
+	for (int i = 0; i < TORUS_MAIN_SEGMENTS; i++)
+	{
+		for (int j = 0; j < TORUS_TUBE_SEGMENTS; j++)
+		{
+			unsigned int a = i * rowLength + j;
+			unsigned int b = a + rowLength;
+			mesh.indices.push_back(a);
+			mesh.indices.push_back(b);
+			mesh.indices.push_back(a + 1);
+			mesh.indices.push_back(a + 1);
+			mesh.indices.push_back(b);
+			mesh.indices.push_back(b + 1);
+		}
+	}
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used for rendering the recorded draw list.
+ *  The opaque draws come first so their pixels are shaded once
+ *  after the depth test, the transparent draws follow from
+ *  back to front and are blended, as in the forward path.
+ *  A frame with more triangles than a worker can number is
+ *  refused and leaves a cleared image, returns false then.
+ ***********************************************************/
+bool SoftwareRenderer::Render(
+	const SceneManager& scene,
+	glm::mat4 view,
+	glm::mat4 projection,
+	glm::vec3 viewPosition)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	m_pScene = &scene;
+	m_viewProjection = projection * view;
+	m_viewPosition = viewPosition;
+
+	// the draws that the forward path blends in its transparent pass
+	const std::vector<SceneManager::DRAW_COMMAND>& draws = scene.GetDrawList();
+	std::vector<int> blendedDraws;
+	m_drawOrder.clear();
+	for (int i = 0; i < (int)draws.size(); i++)
+	{
+		if (draws[i].bTransparent)
+		{
+			blendedDraws.push_back(i);
+		}
+		else
+		{
+			m_drawOrder.push_back(i);
+		}
+	}
+	std::stable_sort(blendedDraws.begin(), blendedDraws.end(),
+		[&draws, viewPosition](int a, int b)
+		{
+			glm::vec3 offsetA = glm::vec3(draws[a].model[3]) - viewPosition;
+			glm::vec3 offsetB = glm::vec3(draws[b].model[3]) - viewPosition;
+			return(glm::dot(offsetA, offsetA) > glm::dot(offsetB, offsetB));
+		});
+	m_drawOrder.insert(m_drawOrder.end(), blendedDraws.begin(), blendedDraws.end());
+
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		m_triangles[i].clear();
+		m_refusedTriangles[i] = 0;
+		for (size_t tile = 0; tile < m_bins[i].size(); tile++)
+		{
+			m_bins[i][tile].clear();
+		}
+	}
+
+	// each worker takes a contiguous part of the draw order, so
+	// reading the bins worker by worker keeps that order
+	RunParallel([this](int worker) { SetupDraws(worker); });
+
+	m_triangleCount = 0;
+	unsigned int refusedCount = 0;
+	for (int i = 0; i < m_threadCount; i++)
+	{
+		m_triangleCount += (unsigned int)m_triangles[i].size();
+		refusedCount += m_refusedTriangles[i];
+	}
+
+	// a frame with triangles missing is not drawn at all
+	bool bRendered = (0 == refusedCount);
+	if (bRendered)
+	{
+		m_nextTile = 0;
+		RunParallel([this](int worker) { RasterizeTiles(worker); });
+	}
+	else
+	{
+		std::cout << "Software render refused: " << refusedCount
+			<< " triangles beyond the " << TRIANGLE_INDEX_MASK
+			<< " a worker can number" << std::endl;
+		std::fill(m_colorBuffer.begin(), m_colorBuffer.end(), (unsigned char)0);
+		m_triangleCount = 0;
+	}
+
+	m_pScene = NULL;
+	m_renderTime = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+
+	return(bRendered);
+}
+
+/***********************************************************
+ *  SetupDraws()
+ *
+ *  This method is used for transforming the vertices of the
+ *  draws that belong to a worker and turning their triangles
+ *  into binned rasterizer triangles.
+ ***********************************************************/
+void SoftwareRenderer::SetupDraws(int worker)
+{
+	const std::vector<SceneManager::DRAW_COMMAND>& draws = m_pScene->GetDrawList();
+	int drawCount = (int)m_drawOrder.size();
+	int first = drawCount * worker / m_threadCount;
+	int last = drawCount * (worker + 1) / m_threadCount;
+	std::vector<CLIP_VERTEX>& clipVertices = m_clipVertices[worker];
+
+	for (int i = first; i < last; i++)
+	{
+		int drawIndex = m_drawOrder[i];
+		const SceneManager::DRAW_COMMAND& draw = draws[drawIndex];
+		// the imported meshes keep their triangles in the importer
+		const std::vector<MESH_VERTEX>* pVertices = NULL;
+		const std::vector<unsigned int>* pIndices = NULL;
+		if (draw.mesh == SceneManager::IMPORTED_MESH)
+		{
+			const MeshImporter::IMPORTED_MESH& importedMesh = m_pScene->GetMeshImporter()->GetMesh(draw.importedMesh);
+			pVertices = &importedMesh.vertices;
+			pIndices = &importedMesh.indices;
+		}
+		else
+		{
+			pVertices = &m_meshes[draw.mesh].vertices;
+			pIndices = &m_meshes[draw.mesh].indices;
+		}
+		const std::vector<MESH_VERTEX>& vertices = *pVertices;
+		const std::vector<unsigned int>& indices = *pIndices;
+
+		bool bBlend = draw.bTransparent;
+
+		glm::mat4 modelViewProjection = m_viewProjection * draw.model;
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.model)));
+
+		clipVertices.resize(vertices.size());
+		for (size_t v = 0; v < vertices.size(); v++)
+		{
+			const MESH_VERTEX& vertex = vertices[v];
+			glm::vec4 position = glm::vec4(vertex.position, 1.0f);
+			clipVertices[v].position = modelViewProjection * position;
+			clipVertices[v].worldPosition = glm::vec3(draw.model * position);
+			clipVertices[v].normal = normalMatrix * vertex.normal;
+			clipVertices[v].uv = vertex.uv;
+		}
+
+		for (size_t index = 0; index + 2 < indices.size(); index += 3)
+		{
+			CLIP_VERTEX triangle[3] =
+			{
+				clipVertices[indices[index]],
+				clipVertices[indices[index + 1]],
+				clipVertices[indices[index + 2]]
+			};
+			ClipTriangle(worker, triangle, drawIndex, bBlend);
+		}
+	}
+}
+
+/***********************************************************
+ *  ClipTriangle()
+ *
+ *  This method is used for clipping a triangle against the
+ *  near and far planes and the guard band.  Most triangles are
+ *  fully inside and go straight to the setup.
+ ***********************************************************/
+void SoftwareRenderer::ClipTriangle(int worker, const CLIP_VERTEX* pVertices, int draw, bool bBlend)
+{
+	int outsideMask[3] = { 0, 0, 0 };
+	for (int v = 0; v < 3; v++)
+	{
+		for (int plane = 0; plane < 6; plane++)
+		{
+			if (glm::dot(g_ClipPlanes[plane], pVertices[v].position) < 0.0f)
+			{
+				outsideMask[v] |= (1 << plane);
+			}
+		}
+	}
+
+	// all vertices outside of the same plane
+	if ((outsideMask[0] & outsideMask[1] & outsideMask[2]) != 0)
+	{
+		return;
+	}
+	// all vertices inside of every plane
+	if ((outsideMask[0] | outsideMask[1] | outsideMask[2]) == 0)
+	{
+		SetupTriangle(worker, pVertices[0], pVertices[1], pVertices[2], draw, bBlend);
+		return;
+	}
+
+	CLIP_VERTEX polygon[2][MAX_CLIPPED_VERTICES + 1];
+	int count = 3;
+	int current = 0;
+	polygon[0][0] = pVertices[0];
+	polygon[0][1] = pVertices[1];
+	polygon[0][2] = pVertices[2];
+
+	int planeMask = outsideMask[0] | outsideMask[1] | outsideMask[2];
+	for (int plane = 0; (plane < 6) && (count >= 3); plane++)
+	{
+		if ((planeMask & (1 << plane)) == 0)
+		{
+			continue;
+		}
+
+		const CLIP_VERTEX* pInput = polygon[current];
+		CLIP_VERTEX* pOutput = polygon[1 - current];
+		int outputCount = 0;
+		for (int i = 0; i < count; i++)
+		{
+			const CLIP_VERTEX& a = pInput[i];
+			const CLIP_VERTEX& b = pInput[(i + 1) % count];
+			float distanceA = glm::dot(g_ClipPlanes[plane], a.position);
+			float distanceB = glm::dot(g_ClipPlanes[plane], b.position);
+
+			if (distanceA >= 0.0f)
+			{
+				pOutput[outputCount++] = a;
+			}
+			if ((distanceA >= 0.0f) != (distanceB >= 0.0f))
+			{
+				pOutput[outputCount++] = LerpVertex(a, b, distanceA / (distanceA - distanceB));
+			}
+		}
+		count = glm::min(outputCount, MAX_CLIPPED_VERTICES);
+		current = 1 - current;
+	}
+
+	for (int i = 1; i + 1 < count; i++)
+	{
+		SetupTriangle(worker, polygon[current][0], polygon[current][i], polygon[current][i + 1], draw, bBlend);
+	}
+}
+
+/***********************************************************
+ *  SetupTriangle()
+ *
+ *  This method is used for projecting a clipped triangle to
+ *  the screen, computing its edge functions and depth plane
+ *  and adding it to the bins of the tiles it overlaps.  The
+ *  shapes are drawn without face culling like in OpenGL.
+ ***********************************************************/
+void SoftwareRenderer::SetupTriangle(
+	int worker,
+	const CLIP_VERTEX& v0,
+	const CLIP_VERTEX& v1,
+	const CLIP_VERTEX& v2,
+	int draw,
+	bool bBlend)
+{
+	const CLIP_VERTEX* pVertices[3] = { &v0, &v1, &v2 };
+	float x[3];
+	float y[3];
+	float z[3];
+	float inverseW[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec4& position = pVertices[i]->position;
+		inverseW[i] = 1.0f / position.w;
+		x[i] = (position.x * inverseW[i] * 0.5f + 0.5f) * (float)m_width;
+		y[i] = (position.y * inverseW[i] * 0.5f + 0.5f) * (float)m_height;
+		z[i] = position.z * inverseW[i] * 0.5f + 0.5f;
+	}
+
+	// twice the signed area, clockwise triangles are turned around
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0.0f)
+	{
+		return;
+	}
+	if (area < 0.0f)
+	{
+		std::swap(pVertices[1], pVertices[2]);
+		std::swap(x[1], x[2]);
+		std::swap(y[1], y[2]);
+		std::swap(z[1], z[2]);
+		std::swap(inverseW[1], inverseW[2]);
+		area = -area;
+	}
+
+	// pixel centers inside the bounding box, limited to the screen
+	int minX = (int)ceil(glm::min(x[0], glm::min(x[1], x[2])) - 0.5f);
+	int maxX = (int)floor(glm::max(x[0], glm::max(x[1], x[2])) - 0.5f);
+	int minY = (int)ceil(glm::min(y[0], glm::min(y[1], y[2])) - 0.5f);
+	int maxY = (int)floor(glm::max(y[0], glm::max(y[1], y[2])) - 0.5f);
+	minX = glm::max(minX, 0);
+	minY = glm::max(minY, 0);
+	maxX = glm::min(maxX, m_width - 1);
+	maxY = glm::min(maxY, m_height - 1);
+	if ((minX > maxX) || (minY > maxY))
+	{
+		return;
+	}
+
+	// the last index of the last worker would read as NO_TRIANGLE
+	std::vector<TRIANGLE>& triangles = m_triangles[worker];
+	if (triangles.size() >= TRIANGLE_INDEX_MASK)
+	{
+		m_refusedTriangles[worker]++;
+		return;
+	}
+
+	TRIANGLE triangle;
+	triangle.tieBreakMask = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int a = (i + 1) % 3;
+		int b = (i + 2) % 3;
+		triangle.edgeA[i] = y[a] - y[b];
+		triangle.edgeB[i] = x[b] - x[a];
+		triangle.edgeC[i] = x[a] * y[b] - y[a] * x[b];
+		// a pixel center exactly on an edge that two triangles
+		// share belongs to only one of them
+		if ((triangle.edgeA[i] > 0.0f) ||
+			((triangle.edgeA[i] == 0.0f) && (triangle.edgeB[i] < 0.0f)))
+		{
+			triangle.tieBreakMask |= (1 << i);
+		}
+	}
+
+	triangle.inverseArea = 1.0f / area;
+	triangle.depthA = (triangle.edgeA[0] * z[0] + triangle.edgeA[1] * z[1] + triangle.edgeA[2] * z[2]) * triangle.inverseArea;
+	triangle.depthB = (triangle.edgeB[0] * z[0] + triangle.edgeB[1] * z[1] + triangle.edgeB[2] * z[2]) * triangle.inverseArea;
+	triangle.depthC = (triangle.edgeC[0] * z[0] + triangle.edgeC[1] * z[1] + triangle.edgeC[2] * z[2]) * triangle.inverseArea;
+	triangle.minDepth = glm::min(z[0], glm::min(z[1], z[2]));
+
+	for (int i = 0; i < 3; i++)
+	{
+		triangle.inverseW[i] = inverseW[i];
+		triangle.worldPosition[i] = pVertices[i]->worldPosition;
+		triangle.normal[i] = pVertices[i]->normal;
+		triangle.uv[i] = pVertices[i]->uv;
+	}
+	triangle.minX = minX;
+	triangle.minY = minY;
+	triangle.maxX = maxX;
+	triangle.maxY = maxY;
+	triangle.draw = draw;
+	triangle.bBlend = bBlend;
+
+	unsigned int id = ((unsigned int)worker << TRIANGLE_INDEX_BITS) | (unsigned int)triangles.size();
+	triangles.push_back(triangle);
+
+	std::vector<std::vector<unsigned int> >& bins = m_bins[worker];
+	for (int tileY = minY / TILE_SIZE; tileY <= maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = minX / TILE_SIZE; tileX <= maxX / TILE_SIZE; tileX++)
+		{
+			bins[tileY * m_tilesX + tileX].push_back(id);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetTriangle()
+ *
+ *  This method is used for finding a triangle by its id.
+ ***********************************************************/
+const SoftwareRenderer::TRIANGLE& SoftwareRenderer::GetTriangle(unsigned int id) const
+{
+	return(m_triangles[id >> TRIANGLE_INDEX_BITS][id & TRIANGLE_INDEX_MASK]);
+}
+
+/***********************************************************
+ *  RasterizeTiles()
+ *
+ *  This method is used for processing tiles until none are
+ *  left.  The bins of all workers are read in worker order,
+ *  which is the draw order.
+ ***********************************************************/
+void SoftwareRenderer::RasterizeTiles(int worker)
+{
+	TILE_BUFFER& buffer = m_tileBuffers[worker];
+	int tileCount = m_tilesX * m_tilesY;
+
+	for (int tile = m_nextTile++; tile < tileCount; tile = m_nextTile++)
+	{
+		int tileX = (tile % m_tilesX) * TILE_SIZE;
+		int tileY = (tile / m_tilesX) * TILE_SIZE;
+
+		// pixels past the edge of the screen fail every depth test
+		for (int y = 0; y < TILE_SIZE; y++)
+		{
+			for (int x = 0; x < TILE_SIZE; x++)
+			{
+				bool bInside = (tileX + x < m_width) && (tileY + y < m_height);
+				buffer.depth[y * TILE_SIZE + x] = bInside ? 1.0f : -FLT_MAX;
+				buffer.visibility[y * TILE_SIZE + x] = NO_TRIANGLE;
+				buffer.color[y * TILE_SIZE + x] = g_ClearColor;
+			}
+		}
+		for (int block = 0; block < BLOCKS_PER_TILE * BLOCKS_PER_TILE; block++)
+		{
+			int blockX = tileX + (block % BLOCKS_PER_TILE) * BLOCK_SIZE;
+			int blockY = tileY + (block / BLOCKS_PER_TILE) * BLOCK_SIZE;
+			bool bInside = (blockX < m_width) && (blockY < m_height);
+			buffer.blockMaxDepth[block] = bInside ? 1.0f : -FLT_MAX;
+		}
+		buffer.tileMaxDepth = 1.0f;
+
+		bool bResolved = false;
+		for (int w = 0; w < m_threadCount; w++)
+		{
+			const std::vector<unsigned int>& bin = m_bins[w][tile];
+			for (size_t i = 0; i < bin.size(); i++)
+			{
+				const TRIANGLE& triangle = GetTriangle(bin[i]);
+				// the opaque pixels are final once the first
+				// transparent triangle arrives
+				if (triangle.bBlend && !bResolved)
+				{
+					ResolveTile(buffer, tileX, tileY);
+					bResolved = true;
+				}
+				RasterizeTriangle(buffer, tileX, tileY, triangle, bin[i]);
+			}
+		}
+		if (!bResolved)
+		{
+			ResolveTile(buffer, tileX, tileY);
+		}
+
+		StoreTile(buffer, tileX, tileY);
+	}
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This method is used for drawing a triangle into a tile.
+ *  The tile and then each 8 x 8 block are skipped when the
+ *  nearest point of the triangle is behind everything drawn
+ *  there, or when the block is outside one of the edges.
+ *  Opaque triangles only record which triangle covers a pixel,
+ *  transparent triangles are shaded and blended right away.
+ ***********************************************************/
+void SoftwareRenderer::RasterizeTriangle(
+	TILE_BUFFER& buffer,
+	int tileX,
+	int tileY,
+	const TRIANGLE& triangle,
+	unsigned int id)
+{
+	if (triangle.minDepth >= buffer.tileMaxDepth)
+	{
+		return;
+	}
+
+	int minX = glm::max(triangle.minX, tileX);
+	int minY = glm::max(triangle.minY, tileY);
+	int maxX = glm::min(triangle.maxX, tileX + TILE_SIZE - 1);
+	int maxY = glm::min(triangle.maxY, tileY + TILE_SIZE - 1);
+	if ((minX > maxX) || (minY > maxY))
+	{
+		return;
+	}
+
+	bool bDepthChanged = false;
+	for (int blockRow = (minY - tileY) / BLOCK_SIZE; blockRow <= (maxY - tileY) / BLOCK_SIZE; blockRow++)
+	{
+		for (int blockColumn = (minX - tileX) / BLOCK_SIZE; blockColumn <= (maxX - tileX) / BLOCK_SIZE; blockColumn++)
+		{
+			int block = blockRow * BLOCKS_PER_TILE + blockColumn;
+			if (triangle.minDepth >= buffer.blockMaxDepth[block])
+			{
+				continue;
+			}
+
+			// the edge functions are linear, so a block is outside
+			// an edge when all four corner pixels are
+			int blockX = tileX + blockColumn * BLOCK_SIZE;
+			int blockY = tileY + blockRow * BLOCK_SIZE;
+			float left = (float)blockX + 0.5f;
+			float right = left + (float)(BLOCK_SIZE - 1);
+			float bottom = (float)blockY + 0.5f;
+			float top = bottom + (float)(BLOCK_SIZE - 1);
+			bool bOutside = false;
+			for (int edge = 0; (edge < 3) && !bOutside; edge++)
+			{
+				float a = triangle.edgeA[edge];
+				float b = triangle.edgeB[edge];
+				float c = triangle.edgeC[edge];
+				float maximum = glm::max(
+					glm::max(a * left + b * bottom, a * right + b * bottom),
+					glm::max(a * left + b * top, a * right + b * top)) + c;
+				bOutside = (maximum < 0.0f);
+			}
+			if (bOutside)
+			{
+				continue;
+			}
+
+			bool bBlockChanged = false;
+			for (int row = 0; row < BLOCK_SIZE; row++)
+			{
+				int y = blockY + row;
+				if ((y < minY) || (y > maxY))
+				{
+					continue;
+				}
+				for (int quad = 0; quad < BLOCK_SIZE; quad += 4)
+				{
+					int x = blockX + quad;
+					int pixel = (y - tileY) * TILE_SIZE + (x - tileX);
+					float quadDepth[4];
+					int mask = TestQuad(triangle, x, y, &buffer.depth[pixel], quadDepth);
+					for (int lane = 0; mask != 0; lane++, mask >>= 1)
+					{
+						if (((mask & 1) == 0) || (x + lane < minX) || (x + lane > maxX))
+						{
+							continue;
+						}
+
+						buffer.depth[pixel + lane] = quadDepth[lane];
+						bBlockChanged = true;
+						if (triangle.bBlend)
+						{
+							glm::vec4 source = ShadePixel(
+								triangle,
+								(float)(x + lane) + 0.5f,
+								(float)y + 0.5f);
+							glm::vec4& destination = buffer.color[pixel + lane];
+							destination = source * source.a + destination * (1.0f - source.a);
+						}
+						else
+						{
+							buffer.visibility[pixel + lane] = id;
+						}
+					}
+				}
+			}
+
+			if (bBlockChanged)
+			{
+				float maximum = -FLT_MAX;
+				for (int row = 0; row < BLOCK_SIZE; row++)
+				{
+					const float* pDepth = &buffer.depth[(blockY - tileY + row) * TILE_SIZE + (blockX - tileX)];
+					for (int column = 0; column < BLOCK_SIZE; column++)
+					{
+						maximum = glm::max(maximum, pDepth[column]);
+					}
+				}
+				buffer.blockMaxDepth[block] = maximum;
+				bDepthChanged = true;
+			}
+		}
+	}
+
+	if (bDepthChanged)
+	{
+		float maximum = -FLT_MAX;
+		for (int block = 0; block < BLOCKS_PER_TILE * BLOCKS_PER_TILE; block++)
+		{
+			maximum = glm::max(maximum, buffer.blockMaxDepth[block]);
+		}
+		buffer.tileMaxDepth = maximum;
+	}
+}
+
+/***********************************************************
+ *  TestQuad()
+ *
+ *  This method is used for testing four neighboring pixels of
+ *  a row against the edges and the depth buffer.  Bit i of
+ *  the result is set when pixel x + i is covered and nearer,
+ *  and its depth is written to pQuadDepth.
+ ***********************************************************/
+int SoftwareRenderer::TestQuad(
+	const TRIANGLE& triangle,
+	int x,
+	int y,
+	const float* pDepth,
+	float* pQuadDepth) const
+{
+#ifdef SOFTWARE_RASTER_SSE2
+	const __m128 zero = _mm_setzero_ps();
+	__m128 pixelX = _mm_add_ps(
+		_mm_set1_ps((float)x + 0.5f),
+		_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+	__m128 pixelY = _mm_set1_ps((float)y + 0.5f);
+
+	__m128 covered = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for (int edge = 0; edge < 3; edge++)
+	{
+		__m128 value = _mm_add_ps(
+			_mm_add_ps(
+				_mm_mul_ps(_mm_set1_ps(triangle.edgeA[edge]), pixelX),
+				_mm_mul_ps(_mm_set1_ps(triangle.edgeB[edge]), pixelY)),
+			_mm_set1_ps(triangle.edgeC[edge]));
+		__m128 inside = _mm_cmpgt_ps(value, zero);
+		if (triangle.tieBreakMask & (1 << edge))
+		{
+			inside = _mm_or_ps(inside, _mm_cmpeq_ps(value, zero));
+		}
+		covered = _mm_and_ps(covered, inside);
+	}
+
+	__m128 depth = _mm_add_ps(
+		_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(triangle.depthA), pixelX),
+			_mm_mul_ps(_mm_set1_ps(triangle.depthB), pixelY)),
+		_mm_set1_ps(triangle.depthC));
+	__m128 nearer = _mm_cmplt_ps(depth, _mm_loadu_ps(pDepth));
+	_mm_storeu_ps(pQuadDepth, depth);
+
+	return(_mm_movemask_ps(_mm_and_ps(covered, nearer)));
+#else
+	int mask = 0;
+	float pixelY = (float)y + 0.5f;
+	for (int lane = 0; lane < 4; lane++)
+	{
+		float pixelX = (float)(x + lane) + 0.5f;
+		bool bCovered = true;
+		for (int edge = 0; (edge < 3) && bCovered; edge++)
+		{
+			float value = (triangle.edgeA[edge] * pixelX + triangle.edgeB[edge] * pixelY) + triangle.edgeC[edge];
+			bCovered = (value > 0.0f) ||
+				((value == 0.0f) && ((triangle.tieBreakMask & (1 << edge)) != 0));
+		}
+
+		pQuadDepth[lane] = (triangle.depthA * pixelX + triangle.depthB * pixelY) + triangle.depthC;
+		if (bCovered && (pQuadDepth[lane] < pDepth[lane]))
+		{
+			mask |= (1 << lane);
+		}
+	}
+
+	return(mask);
+#endif
+}
+
+/***********************************************************
+ *  ResolveTile()
+ *
+ *  This method is used for shading the pixels of the opaque
+ *  triangles that won the depth test, each exactly once.
+ ***********************************************************/
+void SoftwareRenderer::ResolveTile(TILE_BUFFER& buffer, int tileX, int tileY)
+{
+	for (int y = 0; y < TILE_SIZE; y++)
+	{
+		for (int x = 0; x < TILE_SIZE; x++)
+		{
+			int pixel = y * TILE_SIZE + x;
+			if (buffer.visibility[pixel] == NO_TRIANGLE)
+			{
+				continue;
+			}
+
+			glm::vec4 source = ShadePixel(
+				GetTriangle(buffer.visibility[pixel]),
+				(float)(tileX + x) + 0.5f,
+				(float)(tileY + y) + 0.5f);
+			glm::vec4& destination = buffer.color[pixel];
+			destination = source * source.a + destination * (1.0f - source.a);
+			buffer.visibility[pixel] = NO_TRIANGLE;
+		}
+	}
+}
+
+/***********************************************************
+ *  StoreTile()
+ *
+ *  This method is used for converting the finished tile to
+ *  8 bit color in the frame.
+ ***********************************************************/
+void SoftwareRenderer::StoreTile(const TILE_BUFFER& buffer, int tileX, int tileY)
+{
+	int width = glm::min(TILE_SIZE, m_width - tileX);
+	int height = glm::min(TILE_SIZE, m_height - tileY);
+	for (int y = 0; y < height; y++)
+	{
+		unsigned char* pPixel = &m_colorBuffer[((tileY + y) * m_width + tileX) * 4];
+		for (int x = 0; x < width; x++)
+		{
+			glm::vec4 color = glm::clamp(buffer.color[y * TILE_SIZE + x], 0.0f, 1.0f);
+			pPixel[0] = (unsigned char)(color.r * 255.0f + 0.5f);
+			pPixel[1] = (unsigned char)(color.g * 255.0f + 0.5f);
+			pPixel[2] = (unsigned char)(color.b * 255.0f + 0.5f);
+			pPixel[3] = (unsigned char)(color.a * 255.0f + 0.5f);
+			pPixel += 4;
+		}
+	}
+}
+
+/***********************************************************
+ *  ShadePixel()
+ *
+ *  This method is used for evaluating the forward fragment
+ *  shader at a pixel: the perspective correct attributes are
+ *  interpolated, the base color comes from the texture or the
+ *  object color and the Phong lighting of all scene lights is
+ *  applied with the material of the draw.
+ ***********************************************************/
+glm::vec4 SoftwareRenderer::ShadePixel(const TRIANGLE& triangle, float x, float y) const
+{
+	float weight[3];
+	float weightSum = 0.0f;
+	for (int i = 0; i < 3; i++)
+	{
+		float barycentric = ((triangle.edgeA[i] * x + triangle.edgeB[i] * y) + triangle.edgeC[i]) * triangle.inverseArea;
+		weight[i] = glm::max(barycentric, 0.0f) * triangle.inverseW[i];
+		weightSum += weight[i];
+	}
+	if (weightSum <= 0.0f)
+	{
+		weight[0] = 1.0f;
+		weightSum = 1.0f;
+	}
+	float normalize = 1.0f / weightSum;
+
+	glm::vec3 worldPosition = glm::vec3(0.0f);
+	glm::vec3 normal = glm::vec3(0.0f);
+	glm::vec2 uv = glm::vec2(0.0f);
+	for (int i = 0; i < 3; i++)
+	{
+		float w = weight[i] * normalize;
+		worldPosition += w * triangle.worldPosition[i];
+		normal += w * triangle.normal[i];
+		uv += w * triangle.uv[i];
+	}
+
+	const SceneManager::DRAW_COMMAND& draw = m_pScene->GetDrawList()[triangle.draw];
+	glm::vec4 baseColor = draw.color;
+	if (draw.bUseTexture)
+	{
+		const SceneManager::TEXTURE_IMAGE* pImage = m_pScene->GetTextureImage(draw.textureSlot);
+		if (NULL != pImage)
+		{
+			baseColor = SampleTexture(*pImage, uv * draw.UVscale);
+		}
+	}
+
+	// draws without a defined material are not lit
+	const std::vector<SceneManager::OBJECT_MATERIAL>& materials = m_pScene->GetObjectMaterials();
+	if ((draw.materialIndex >= 0) && (draw.materialIndex < (int)materials.size()))
+	{
+		baseColor.a *= materials[draw.materialIndex].opacity;
+	}
+	if (!m_pScene->IsUsingLighting() ||
+		(draw.materialIndex < 0) || (draw.materialIndex >= (int)materials.size()))
+	{
+		return(baseColor);
+	}
+
+	const SceneManager::OBJECT_MATERIAL& material = materials[draw.materialIndex];
+	const std::vector<SceneManager::LIGHT_SOURCE>& lights = m_pScene->GetLightSources();
+	glm::vec3 lightNormal = glm::normalize(normal);
+	glm::vec3 viewDirection = glm::normalize(m_viewPosition - worldPosition);
+	glm::vec3 phongResult = glm::vec3(0.0f);
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const SceneManager::LIGHT_SOURCE& light = lights[i];
+
+		glm::vec3 ambient = light.ambientColor * material.ambientColor * material.ambientStrength;
+
+		glm::vec3 lightDirection = glm::normalize(light.position - worldPosition);
+		float impact = glm::max(glm::dot(lightNormal, lightDirection), 0.0f);
+		glm::vec3 diffuse = impact * light.diffuseColor * material.diffuseColor;
+
+		glm::vec3 reflectDirection = glm::reflect(-lightDirection, lightNormal);
+		float specularComponent = pow(glm::max(glm::dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+		glm::vec3 specular = light.specularIntensity * specularComponent * light.specularColor * material.specularColor;
+
+		phongResult += ambient + diffuse + specular;
+	}
+
+	return(glm::vec4(phongResult * glm::vec3(baseColor), baseColor.a));
+}
+
+/***********************************************************
+ *  SampleTexture()
+ *
+ *  This method is used for reading a texture with bilinear
+ *  filtering and repeat wrapping, like the scene textures.
+ ***********************************************************/
+glm::vec4 SoftwareRenderer::SampleTexture(const SceneManager::TEXTURE_IMAGE& image, glm::vec2 uv) const
+{
+	float u = uv.x * (float)image.width - 0.5f;
+	float v = uv.y * (float)image.height - 0.5f;
+	float u0 = floor(u);
+	float v0 = floor(v);
+	float fractionU = u - u0;
+	float fractionV = v - v0;
+
+	int x[2];
+	int y[2];
+	x[0] = (int)u0 % image.width;
+	y[0] = (int)v0 % image.height;
+	x[0] = (x[0] < 0) ? x[0] + image.width : x[0];
+	y[0] = (y[0] < 0) ? y[0] + image.height : y[0];
+	x[1] = (x[0] + 1) % image.width;
+	y[1] = (y[0] + 1) % image.height;
+
+	glm::vec4 texels[2][2];
+	for (int j = 0; j < 2; j++)
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			const unsigned char* pTexel = &image.pixels[(y[j] * image.width + x[i]) * image.channels];
+			texels[j][i] = glm::vec4(
+				pTexel[0] / 255.0f,
+				pTexel[1] / 255.0f,
+				pTexel[2] / 255.0f,
+				(image.channels == 4) ? pTexel[3] / 255.0f : 1.0f);
+		}
+	}
+
+	return(glm::mix(
+		glm::mix(texels[0][0], texels[0][1], fractionU),
+		glm::mix(texels[1][0], texels[1][1], fractionU),
+		fractionV));
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  This method is used for writing the last frame to a file.
+ ***********************************************************/
+bool SoftwareRenderer::WriteImage(const std::string& filename) const
+{
+	return(WriteImageFile(filename, m_width, m_height, m_colorBuffer.data()));
+}
+
+/***********************************************************
+ *  WriteImageFile()
+ *
+ *  This method is used for writing RGBA8 pixels to a file.
+ *  PPM keeps the color only, PNG and TGA also keep the alpha.
+ *  TGA stores the rows bottom up like the frame.  It does not
+ *  touch any renderer, so the batch renderer calls it from its
+ *  writer thread.
+ ***********************************************************/
+bool SoftwareRenderer::WriteImageFile(
+	const std::string& filename,
+	int width,
+	int height,
+	const unsigned char* pPixels)
+{
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Could not write the image:" << filename << std::endl;
+		return(false);
+	}
+
+	std::string extension;
+	if (filename.size() >= 4)
+	{
+		extension = filename.substr(filename.size() - 4);
+	}
+
+	if (extension == ".png")
+	{
+		WritePNG(file, width, height, pPixels);
+	}
+	else if (extension == ".tga")
+	{
+		unsigned char header[18] = { 0 };
+		// uncompressed true color, 32 bits with 8 alpha bits
+		header[2] = 2;
+		header[12] = (unsigned char)(width & 0xFF);
+		header[13] = (unsigned char)(width >> 8);
+		header[14] = (unsigned char)(height & 0xFF);
+		header[15] = (unsigned char)(height >> 8);
+		header[16] = 32;
+		header[17] = 8;
+		file.write((const char*)header, sizeof(header));
+
+		std::vector<unsigned char> row(width * 4);
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* pPixel = &pPixels[y * width * 4];
+			for (int x = 0; x < width; x++)
+			{
+				row[x * 4 + 0] = pPixel[x * 4 + 2];
+				row[x * 4 + 1] = pPixel[x * 4 + 1];
+				row[x * 4 + 2] = pPixel[x * 4 + 0];
+				row[x * 4 + 3] = pPixel[x * 4 + 3];
+			}
+			file.write((const char*)row.data(), row.size());
+		}
+	}
+	else
+	{
+		file << "P6\n" << width << " " << height << "\n255\n";
+
+		std::vector<unsigned char> row(width * 3);
+		for (int y = height - 1; y >= 0; y--)
+		{
+			const unsigned char* pPixel = &pPixels[y * width * 4];
+			for (int x = 0; x < width; x++)
+			{
+				row[x * 3 + 0] = pPixel[x * 4 + 0];
+				row[x * 3 + 1] = pPixel[x * 4 + 1];
+				row[x * 3 + 2] = pPixel[x * 4 + 2];
+			}
+			file.write((const char*)row.data(), row.size());
+		}
+	}
+
+	return((bool)file);
+}
+
+/***********************************************************
+ *  WritePNG()
+ *
+ *  This method is used for writing the pixels as a PNG.  The
+ *  image data uses stored deflate blocks, which any decoder
+ *  reads, so no compression library is needed and writing is
+ *  about as fast as copying.  The files are as large as a TGA.
+ ***********************************************************/
+void SoftwareRenderer::WritePNG(std::ofstream& file, int width, int height, const unsigned char* pPixels)
+{
+	// each chunk is length, type, data and the CRC of type and data
+	auto writeChunk = [&file](const char* type, const std::vector<unsigned char>& data)
+	{
+		unsigned int length = (unsigned int)data.size();
+		unsigned char bytes[4] = {
+			(unsigned char)(length >> 24), (unsigned char)(length >> 16),
+			(unsigned char)(length >> 8), (unsigned char)length };
+		file.write((const char*)bytes, 4);
+		file.write(type, 4);
+		if (length > 0)
+		{
+			file.write((const char*)data.data(), length);
+		}
+
+		unsigned int crc = 0xFFFFFFFF;
+		for (int i = 0; i < 4; i++)
+		{
+			crc = g_CrcTable.values[(crc ^ (unsigned char)type[i]) & 0xFF] ^ (crc >> 8);
+		}
+		for (unsigned int i = 0; i < length; i++)
+		{
+			crc = g_CrcTable.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		crc ^= 0xFFFFFFFF;
+		bytes[0] = (unsigned char)(crc >> 24);
+		bytes[1] = (unsigned char)(crc >> 16);
+		bytes[2] = (unsigned char)(crc >> 8);
+		bytes[3] = (unsigned char)crc;
+		file.write((const char*)bytes, 4);
+	};
+	auto appendBigEndian = [](std::vector<unsigned char>& data, unsigned int value)
+	{
+		data.push_back((unsigned char)(value >> 24));
+		data.push_back((unsigned char)(value >> 16));
+		data.push_back((unsigned char)(value >> 8));
+		data.push_back((unsigned char)value);
+	};
+
+	const unsigned char signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+	file.write((const char*)signature, sizeof(signature));
+
+	// 8 bit RGBA, no interlacing
+	std::vector<unsigned char> header;
+	appendBigEndian(header, (unsigned int)width);
+	appendBigEndian(header, (unsigned int)height);
+	header.push_back(8);
+	header.push_back(6);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	writeChunk("IHDR", header);
+
+	// the rows run top down, each one starts with filter type 0
+	size_t rowSize = (size_t)width * 4 + 1;
+	std::vector<unsigned char> raw(rowSize * height);
+	for (int y = 0; y < height; y++)
+	{
+		unsigned char* pRow = &raw[y * rowSize];
+		pRow[0] = 0;
+		memcpy(pRow + 1, &pPixels[(size_t)(height - 1 - y) * width * 4], width * 4);
+	}
+
+	// zlib stream of stored blocks of up to 65535 bytes
+	const size_t MAX_STORED_BLOCK = 65535;
+	std::vector<unsigned char> data;
+	data.reserve(raw.size() + (raw.size() / MAX_STORED_BLOCK + 1) * 5 + 6);
+	data.push_back(0x78);
+	data.push_back(0x01);
+	size_t offset = 0;
+	do
+	{
+		size_t blockSize = std::min(MAX_STORED_BLOCK, raw.size() - offset);
+		bool bFinal = (offset + blockSize == raw.size());
+		data.push_back(bFinal ? 1 : 0);
+		data.push_back((unsigned char)(blockSize & 0xFF));
+		data.push_back((unsigned char)(blockSize >> 8));
+		data.push_back((unsigned char)(~blockSize & 0xFF));
+		data.push_back((unsigned char)((~blockSize >> 8) & 0xFF));
+		data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < raw.size());
+
+	unsigned int adlerA = 1;
+	unsigned int adlerB = 0;
+	for (size_t i = 0; i < raw.size(); i++)
+	{
+		adlerA = (adlerA + raw[i]) % 65521;
+		adlerB = (adlerB + adlerA) % 65521;
+	}
+	appendBigEndian(data, (adlerB << 16) | adlerA);
+	writeChunk("IDAT", data);
+
+	writeChunk("IEND", std::vector<unsigned char>());
+}
@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerenderer.h
+// ============
+// multithreaded tile based rasterizer that renders the recorded
+// draw list of the scene on the CPU, without an OpenGL context
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  SoftwareRenderer
+ *
+ *  This class renders the draws recorded by SceneManager with
+ *  the same meshes, materials, lights and textures as the
+ *  forward shaders.  A frame runs in two parallel phases:
+ *
+ *  - the draws are split between the worker threads, which
+ *    transform and clip the triangles and sort them into the
+ *    bins of the screen tiles they overlap
+ *  - the workers take whole tiles, rasterize the binned
+ *    triangles with edge functions and a hierarchical depth
+ *    test, shade the visible pixels once with the Phong model
+ *    and then blend the transparent triangles on top
+ *
+ *  The triangles of a tile are processed in draw order, so the
+ *  image does not depend on the number of threads.
+ ***********************************************************/
+class SoftwareRenderer
+{
+public:
+	// constructor, a thread count of 0 uses every core
+	SoftwareRenderer(int width, int height, int threadCount = 0);
+	// destructor
+	~SoftwareRenderer();
+
+	// render the draw list recorded by the last RenderScene() call,
+	// false when the frame had too many triangles to render
+	bool Render(
+		const SceneManager& scene,
+		glm::mat4 view,
+		glm::mat4 projection,
+		glm::vec3 viewPosition);
+
+	// write the image as a binary PPM, or as a PNG or TGA with
+	// alpha when the file name ends in .png or .tga
+	bool WriteImage(const std::string& filename) const;
+	// write RGBA8 pixels stored bottom row first to an image file,
+	// the format is chosen like WriteImage() does
+	static bool WriteImageFile(
+		const std::string& filename,
+		int width,
+		int height,
+		const unsigned char* pPixels);
+	// build the triangles of a basic shape with the dimensions of
+	// ShapeMeshes, for the other renderers that draw without it
+	static void BuildBasicMesh(
+		SceneManager::MESH_TYPE mesh,
+		std::vector<MeshImporter::MESH_VERTEX>& vertices,
+		std::vector<unsigned int>& indices);
+
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	int GetThreadCount() const { return(m_threadCount); }
+	// RGBA8 pixels of the last frame, the bottom row comes first
+	const std::vector<unsigned char>& GetColorBuffer() const { return(m_colorBuffer); }
+	// triangles that reached the bins in the last frame
+	unsigned int GetTriangleCount() const { return(m_triangleCount); }
+	// duration of the last Render() call in milliseconds
+	double GetRenderTime() const { return(m_renderTime); }
+
+private:
+	// size of a screen tile and of a depth block in pixels
+	static const int TILE_SIZE = 64;
+	static const int BLOCK_SIZE = 8;
+	static const int BLOCKS_PER_TILE = TILE_SIZE / BLOCK_SIZE;
+
+	// vertex of a software mesh, the imported meshes use the
+	// same layout
+	typedef MeshImporter::MESH_VERTEX MESH_VERTEX;
+
+	// indexed triangle list of a basic shape
+	struct MESH
+	{
+		std::vector<MESH_VERTEX> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	// vertex after the transformation, in clip space
+	struct CLIP_VERTEX
+	{
+		glm::vec4 position;
+		glm::vec3 worldPosition;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	// triangle prepared for the rasterizer
+	struct TRIANGLE
+	{
+		// edge functions A * x + B * y + C, the edge opposite of
+		// vertex i is positive inside and is 2 * area at vertex i
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		// edges whose pixels on the edge belong to the triangle
+		int tieBreakMask;
+		// depth as a plane in screen space
+		float depthA;
+		float depthB;
+		float depthC;
+		float minDepth;
+		float inverseArea;
+		// perspective divide and attributes of the vertices
+		float inverseW[3];
+		glm::vec3 worldPosition[3];
+		glm::vec3 normal[3];
+		glm::vec2 uv[3];
+		// covered pixel rectangle
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		// index into the draw list
+		int draw;
+		bool bBlend;
+	};
+
+	// depth, visibility and color of the tile a worker is on
+	struct TILE_BUFFER
+	{
+		float depth[TILE_SIZE * TILE_SIZE];
+		unsigned int visibility[TILE_SIZE * TILE_SIZE];
+		glm::vec4 color[TILE_SIZE * TILE_SIZE];
+		float blockMaxDepth[BLOCKS_PER_TILE * BLOCKS_PER_TILE];
+		float tileMaxDepth;
+	};
+
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	int m_threadCount;
+
+	MESH m_meshes[SceneManager::TORUS_MESH + 1];
+
+	// frame state read by the workers
+	const SceneManager* m_pScene;
+	glm::mat4 m_viewProjection;
+	glm::vec3 m_viewPosition;
+	std::vector<int> m_drawOrder;
+
+	// per worker triangles, their tile bins and scratch space
+	std::vector<std::vector<TRIANGLE> > m_triangles;
+	// triangles a worker had no id left for in this frame
+	std::vector<unsigned int> m_refusedTriangles;
+	std::vector<std::vector<std::vector<unsigned int> > > m_bins;
+	std::vector<std::vector<CLIP_VERTEX> > m_clipVertices;
+	std::vector<TILE_BUFFER> m_tileBuffers;
+	std::atomic<int> m_nextTile;
+
+	std::vector<unsigned char> m_colorBuffer;
+	unsigned int m_triangleCount;
+	double m_renderTime;
+
+	// worker threads, the calling thread is worker 0
+	std::vector<std::thread> m_workers;
+	std::mutex m_jobMutex;
+	std::condition_variable m_jobCondition;
+	std::condition_variable m_doneCondition;
+	std::function<void(int)> m_job;
+	unsigned int m_jobGeneration;
+	int m_pendingWorkers;
+	bool m_bStopWorkers;
+
+	// run a job on every worker and wait for all of them
+	void RunParallel(const std::function<void(int)>& job);
+	void WorkerMain(int worker);
+
+	// build the basic shapes with the dimensions of ShapeMeshes
+	void BuildMeshes();
+	static void BuildBoxMesh(MESH& mesh);
+	static void BuildConeMesh(MESH& mesh);
+	static void BuildCylinderMesh(MESH& mesh);
+	static void BuildPlaneMesh(MESH& mesh);
+	static void BuildSphereMesh(MESH& mesh);
+	static void BuildTorusMesh(MESH& mesh);
+
+	// transform, clip and bin the draws of a worker
+	void SetupDraws(int worker);
+	void ClipTriangle(int worker, const CLIP_VERTEX* pVertices, int draw, bool bBlend);
+	void SetupTriangle(int worker, const CLIP_VERTEX& v0, const CLIP_VERTEX& v1, const CLIP_VERTEX& v2, int draw, bool bBlend);
+	const TRIANGLE& GetTriangle(unsigned int id) const;
+
+	// rasterize, shade and store the tiles taken by a worker
+	void RasterizeTiles(int worker);
+	void RasterizeTriangle(TILE_BUFFER& buffer, int tileX, int tileY, const TRIANGLE& triangle, unsigned int id);
+	int TestQuad(const TRIANGLE& triangle, int x, int y, const float* pDepth, float* pQuadDepth) const;
+	void ResolveTile(TILE_BUFFER& buffer, int tileX, int tileY);
+	void StoreTile(const TILE_BUFFER& buffer, int tileX, int tileY);
+
+	// evaluate the forward shading model for a pixel
+	glm::vec4 ShadePixel(const TRIANGLE& triangle, float x, float y) const;
+	glm::vec4 SampleTexture(const SceneManager::TEXTURE_IMAGE& image, glm::vec2 uv) const;
+
+	// write the pixels as an uncompressed PNG
+	static void WritePNG(std::ofstream& file, int width, int height, const unsigned char* pPixels);
+};
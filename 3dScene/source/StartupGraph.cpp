@@ -0,0 +1,369 @@
+///////////////////////////////////////////////////////////////////////////////
+// startupgraph.cpp
+// ============
+// run the startup stages as a graph of tasks on worker threads, with
+// the OpenGL stages kept on the thread that owns the context
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StartupGraph.h"
+
+#include <iomanip>
+#include <iostream>
+
+/***********************************************************
+ *  StartupGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StartupGraph::StartupGraph()
+{
+	m_finishedCount = 0;
+	m_failedTask = -1;
+	m_bSingleThread = false;
+	m_startTime = std::chrono::steady_clock::now();
+	m_runTime = 0.0;
+	m_workerCount = 0;
+}
+
+/***********************************************************
+ *  ~StartupGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StartupGraph::~StartupGraph()
+{
+	m_tasks.clear();
+}
+
+/***********************************************************
+ *  AddTask()
+ *
+ *  This method is used for adding a task that runs on the
+ *  passed in thread once all the listed tasks have finished.
+ ***********************************************************/
+int StartupGraph::AddTask(
+	const char* name,
+	TASK_THREAD thread,
+	std::function<bool()> work,
+	std::initializer_list<int> dependencies)
+{
+	STARTUP_TASK task;
+	task.name = name;
+	task.thread = thread;
+	task.work = work;
+	task.dependencyCount = 0;
+	task.remaining = 0;
+	task.startTime = 0.0;
+	task.endTime = 0.0;
+	task.bFailed = false;
+	task.bSkipped = false;
+	m_tasks.push_back(task);
+
+	int index = (int)m_tasks.size() - 1;
+	for (int dependency : dependencies)
+	{
+		AddDependency(index, dependency);
+	}
+
+	return(index);
+}
+
+/***********************************************************
+ *  AddDependency()
+ *
+ *  This method is used for making a task wait for another
+ *  one.  A negative dependency stands for a task that was not
+ *  added and is ignored.
+ ***********************************************************/
+void StartupGraph::AddDependency(int task, int dependency)
+{
+	if ((task < 0) || (task >= (int)m_tasks.size()) ||
+		(dependency < 0) || (dependency >= (int)m_tasks.size()) ||
+		(task == dependency))
+	{
+		return;
+	}
+
+	m_tasks[dependency].dependents.push_back(task);
+	m_tasks[task].dependencyCount++;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for running every task.  The calling
+ *  thread runs the context tasks as they become ready and
+ *  sleeps while only worker tasks are left.  Without worker
+ *  threads it runs all the tasks itself, in dependency order.
+ *  After a task failed the rest of the graph is skipped.
+ ***********************************************************/
+bool StartupGraph::Run(int workerCount)
+{
+	// a graph with a cycle would never finish, so the order is
+	// checked before anything runs
+	std::vector<int> remaining(m_tasks.size());
+	std::vector<int> order;
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		remaining[i] = m_tasks[i].dependencyCount;
+		if (0 == remaining[i])
+		{
+			order.push_back((int)i);
+		}
+	}
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const std::vector<int>& dependents = m_tasks[order[i]].dependents;
+		for (size_t j = 0; j < dependents.size(); j++)
+		{
+			if (0 == --remaining[dependents[j]])
+			{
+				order.push_back(dependents[j]);
+			}
+		}
+	}
+	if (order.size() != m_tasks.size())
+	{
+		std::cout << "The startup tasks depend on each other in a cycle" << std::endl;
+		return(false);
+	}
+
+	m_readyWorkerTasks.clear();
+	m_readyContextTasks.clear();
+	m_finishedCount = 0;
+	m_failedTask = -1;
+	m_workerCount = (workerCount > 0) ? workerCount : 0;
+	m_bSingleThread = (0 == m_workerCount);
+	m_startTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		m_tasks[i].remaining = m_tasks[i].dependencyCount;
+		m_tasks[i].startTime = 0.0;
+		m_tasks[i].endTime = 0.0;
+		m_tasks[i].bFailed = false;
+		m_tasks[i].bSkipped = false;
+		if (0 == m_tasks[i].remaining)
+		{
+			if (m_bSingleThread || (m_tasks[i].thread == CONTEXT_THREAD))
+			{
+				m_readyContextTasks.push_back((int)i);
+			}
+			else
+			{
+				m_readyWorkerTasks.push_back((int)i);
+			}
+		}
+	}
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < m_workerCount; i++)
+	{
+		workers.push_back(std::thread(&StartupGraph::WorkerMain, this));
+	}
+
+	int taskCount = (int)m_tasks.size();
+	for (;;)
+	{
+		int task = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_contextCondition.wait(lock, [this, taskCount]
+				{
+					return(!m_readyContextTasks.empty() || (m_finishedCount == taskCount));
+				});
+			if (m_readyContextTasks.empty())
+			{
+				break;
+			}
+			task = m_readyContextTasks.front();
+			m_readyContextTasks.pop_front();
+		}
+		RunTask(task);
+	}
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	m_runTime = GetElapsedTime();
+
+	return(m_failedTask < 0);
+}
+
+/***********************************************************
+ *  GetFailedTask()
+ *
+ *  This method is used for getting the name of the task that
+ *  failed in the last run.
+ ***********************************************************/
+const char* StartupGraph::GetFailedTask() const
+{
+	if (m_failedTask < 0)
+	{
+		return(NULL);
+	}
+
+	return(m_tasks[m_failedTask].name.c_str());
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is the body of the worker threads.  They take
+ *  the ready worker tasks until every task has finished.
+ ***********************************************************/
+void StartupGraph::WorkerMain()
+{
+	int taskCount = (int)m_tasks.size();
+	for (;;)
+	{
+		int task = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workerCondition.wait(lock, [this, taskCount]
+				{
+					return(!m_readyWorkerTasks.empty() || (m_finishedCount == taskCount));
+				});
+			if (m_readyWorkerTasks.empty())
+			{
+				return;
+			}
+			task = m_readyWorkerTasks.front();
+			m_readyWorkerTasks.pop_front();
+		}
+		RunTask(task);
+	}
+}
+
+/***********************************************************
+ *  RunTask()
+ *
+ *  This method is used for running one task and handing the
+ *  tasks that only waited for it to their threads.  Once a
+ *  task failed, the tasks still to come are only counted as
+ *  finished, so every thread returns.
+ ***********************************************************/
+void StartupGraph::RunTask(int task)
+{
+	STARTUP_TASK& startupTask = m_tasks[task];
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		startupTask.bSkipped = (m_failedTask >= 0);
+	}
+
+	startupTask.startTime = GetElapsedTime();
+	if (!startupTask.bSkipped && startupTask.work)
+	{
+		startupTask.bFailed = !startupTask.work();
+	}
+	startupTask.endTime = GetElapsedTime();
+
+	bool bWorkerReady = false;
+	bool bContextReady = false;
+	bool bFinished = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (startupTask.bFailed && (m_failedTask < 0))
+		{
+			m_failedTask = task;
+		}
+		for (size_t i = 0; i < startupTask.dependents.size(); i++)
+		{
+			int dependent = startupTask.dependents[i];
+			if (0 == --m_tasks[dependent].remaining)
+			{
+				if (m_bSingleThread || (m_tasks[dependent].thread == CONTEXT_THREAD))
+				{
+					m_readyContextTasks.push_back(dependent);
+					bContextReady = true;
+				}
+				else
+				{
+					m_readyWorkerTasks.push_back(dependent);
+					bWorkerReady = true;
+				}
+			}
+		}
+		m_finishedCount++;
+		bFinished = (m_finishedCount == (int)m_tasks.size());
+	}
+
+	// the last task wakes every thread, so they can return
+	if (bFinished)
+	{
+		m_workerCondition.notify_all();
+		m_contextCondition.notify_all();
+		return;
+	}
+	if (bWorkerReady)
+	{
+		m_workerCondition.notify_all();
+	}
+	if (bContextReady)
+	{
+		m_contextCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  GetElapsedTime()
+ *
+ *  This method is used for getting the milliseconds since the
+ *  start of the current run.
+ ***********************************************************/
+double StartupGraph::GetElapsedTime() const
+{
+	return(std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - m_startTime).count());
+}
+
+/***********************************************************
+ *  GetLongestTaskTime()
+ *
+ *  This method is used for getting the duration of the
+ *  slowest task, the lower limit of the run time.
+ ***********************************************************/
+double StartupGraph::GetLongestTaskTime() const
+{
+	double longest = 0.0;
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		double duration = m_tasks[i].endTime - m_tasks[i].startTime;
+		if (duration > longest)
+		{
+			longest = duration;
+		}
+	}
+
+	return(longest);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing when every task ran, its
+ *  duration and its thread, along with the time the tasks
+ *  would have taken one after another.
+ ***********************************************************/
+void StartupGraph::PrintReport() const
+{
+	double serialTime = 0.0;
+
+	std::cout << "Startup with " << m_workerCount << " worker threads" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		const STARTUP_TASK& task = m_tasks[i];
+		double duration = task.endTime - task.startTime;
+		serialTime += duration;
+		std::cout << "  " << std::left << std::setw(22) << task.name << std::right
+			<< std::setw(9) << task.startTime << " ms +"
+			<< std::setw(9) << duration << " ms  "
+			<< ((task.thread == CONTEXT_THREAD) ? "context" : "worker")
+			<< (task.bFailed ? ", failed" : (task.bSkipped ? ", skipped" : "")) << std::endl;
+	}
+	std::cout << "  total " << m_runTime << " ms, longest stage "
+		<< GetLongestTaskTime() << " ms, one after another "
+		<< serialTime << " ms" << std::endl;
+	std::cout << std::defaultfloat;
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// startupgraph.h
+// ============
+// run the startup stages as a graph of tasks on worker threads, with
+// the OpenGL stages kept on the thread that owns the context
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  StartupGraph
+ *
+ *  This class runs the stages of the startup as tasks with
+ *  explicit dependencies.  A task starts as soon as all the
+ *  tasks it depends on have finished.  Worker tasks, such as
+ *  decoding an image, run on a pool of threads, while context
+ *  tasks, which call OpenGL, run one after another on the
+ *  thread that calls Run() and owns the context.
+ *
+ *  A task returns false when the startup can not go on without
+ *  it.  The tasks that have not started yet are then skipped,
+ *  and Run() returns false with the failed task recorded.
+ *
+ *  The start and end time of every task are recorded, so the
+ *  report shows which stage the startup waited for.
+ ***********************************************************/
+class StartupGraph
+{
+public:
+	// thread a task has to run on
+	enum TASK_THREAD
+	{
+		WORKER_THREAD,
+		CONTEXT_THREAD
+	};
+
+	// constructor
+	StartupGraph();
+	// destructor
+	~StartupGraph();
+
+	// add a task that runs after the passed in tasks, negative
+	// task numbers are ignored, returns the number of the task
+	int AddTask(
+		const char* name,
+		TASK_THREAD thread,
+		std::function<bool()> work,
+		std::initializer_list<int> dependencies = {});
+	// make a task wait for one more task
+	void AddDependency(int task, int dependency);
+
+	// run every task, the calling thread runs the context tasks,
+	// returns false when the dependencies contain a cycle or a
+	// task failed
+	bool Run(int workerCount);
+	// name of the task that failed in the last run, NULL when
+	// none did
+	const char* GetFailedTask() const;
+
+	// print the timings of the tasks of the last run
+	void PrintReport() const;
+	// wall clock time of the last run in milliseconds
+	double GetRunTime() const { return(m_runTime); }
+	// duration of the slowest task of the last run in milliseconds
+	double GetLongestTaskTime() const;
+
+private:
+	// properties of one task
+	struct STARTUP_TASK
+	{
+		std::string name;
+		TASK_THREAD thread;
+		std::function<bool()> work;
+		// tasks that wait for this one
+		std::vector<int> dependents;
+		int dependencyCount;
+		// dependencies that have not finished in the current run
+		int remaining;
+		// times relative to the start of the run in milliseconds
+		double startTime;
+		double endTime;
+		// results of the current run
+		bool bFailed;
+		bool bSkipped;
+	};
+
+	std::vector<STARTUP_TASK> m_tasks;
+	// tasks whose dependencies have finished, by thread
+	std::deque<int> m_readyWorkerTasks;
+	std::deque<int> m_readyContextTasks;
+	std::mutex m_mutex;
+	std::condition_variable m_workerCondition;
+	std::condition_variable m_contextCondition;
+	int m_finishedCount;
+	// first task that failed in the current run, -1 when none did
+	int m_failedTask;
+	// true when the context thread also runs the worker tasks
+	bool m_bSingleThread;
+	std::chrono::steady_clock::time_point m_startTime;
+	double m_runTime;
+	int m_workerCount;
+
+	// body of the worker threads
+	void WorkerMain();
+	// run one task and release the tasks that waited for it
+	void RunTask(int task);
+	// milliseconds since the start of the run
+	double GetElapsedTime() const;
+};
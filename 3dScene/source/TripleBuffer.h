@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// lock-free triple buffer for handing the latest snapshot of a value
+// from one producer thread to one consumer thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  This template holds three copies of a value.  The producer
+ *  always owns one of them for writing and the consumer always
+ *  owns one for reading, the third is exchanged between them
+ *  with a single atomic swap.  Neither side ever waits for the
+ *  other: the producer may publish more often than the consumer
+ *  reads, in which case the older snapshots are dropped, and the
+ *  consumer keeps reading its snapshot until a newer one exists.
+ ***********************************************************/
+template <typename T>
+class TripleBuffer
+{
+public:
+	// constructor
+	TripleBuffer()
+		: m_shared(1), m_writeIndex(0), m_readIndex(2)
+	{
+	}
+
+	// the copy owned by the producer, filled before Publish()
+	T& GetWriteBuffer() { return(m_buffers[m_writeIndex]); }
+
+	/***********************************************************
+	 *  Publish()
+	 *
+	 *  This method is used by the producer for handing the
+	 *  written copy to the consumer.  The producer continues
+	 *  with the copy that was exchanged.
+	 ***********************************************************/
+	void Publish()
+	{
+		m_writeIndex = m_shared.exchange(
+			m_writeIndex | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	/***********************************************************
+	 *  Acquire()
+	 *
+	 *  This method is used by the consumer for taking the most
+	 *  recently published copy.  False is returned, and the read
+	 *  copy is kept, when nothing was published since the last
+	 *  call.
+	 ***********************************************************/
+	bool Acquire()
+	{
+		if (0 == (m_shared.load(std::memory_order_relaxed) & NEW_DATA))
+		{
+			return(false);
+		}
+		m_readIndex = m_shared.exchange(
+			m_readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+
+		return(true);
+	}
+
+	// the copy owned by the consumer, valid until the next Acquire()
+	const T& GetReadBuffer() const { return(m_buffers[m_readIndex]); }
+
+private:
+	// the shared index keeps a flag for unread data above the index
+	static const int INDEX_MASK = 0x3;
+	static const int NEW_DATA = 0x4;
+
+	// size used for keeping the indices on separate cache lines
+	static const int CACHE_LINE_SIZE = 64;
+
+	T m_buffers[3];
+	// the shared index and each side's index are padded apart,
+	// so the two threads do not contend for one cache line
+	char m_padding0[CACHE_LINE_SIZE];
+	std::atomic<int> m_shared;
+	char m_padding1[CACHE_LINE_SIZE];
+	int m_writeIndex;
+	char m_padding2[CACHE_LINE_SIZE];
+	int m_readIndex;
+};
@@ -8,6 +8,8 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
@@ -20,8 +22,6 @@ namespace
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -32,13 +32,69 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
+	// length of the current simulation tick
 	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+
+	// true when the camera jumped in the latest tick, so it is
+	// not interpolated from its previous position
+	bool gCameraCut = true;
+
+	// true when the window asked to be redrawn since the last
+	// published snapshot
+	bool gRedrawRequested = false;
+
+	// presses of the left mouse button, each one asks the render
+	// thread to pick the object under the crosshair
+	unsigned int gPickCount = 0;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
+
+	// the following variable is false when the scene is rendered
+	// with forward shading and true when the deferred shading
+	// path is used
+	bool bDeferredShading = false;
+
+	// the following variable is true when the scene is rendered
+	// at a scaled resolution that follows the frame time budget
+	bool bDynamicResolution = false;
+
+	// the following variable is false when the transparent draws
+	// are sorted back to front and true when they are drawn with
+	// weighted blended transparency
+	bool bWeightedTransparency = false;
+
+	// the following variable is true when the opaque draws are
+	// drawn into the depth buffer before they are shaded
+	bool bDepthPrepass = false;
+
+	// the following variable is true when the scene is shown as
+	// a heatmap of the fragments shaded per pixel
+	bool bOverdrawView = false;
+
+	// the following variable is true when the static surfaces
+	// are lit from the baked lightmap instead of per pixel
+	bool bLightmap = true;
+
+	// the following variable is true when the opaque draws are
+	// culled and drawn from indirect commands on the GPU
+	bool bGpuCulling = false;
+
+	// the following variable is true when the window is split
+	// into several views of the scene
+	bool bMultiView = false;
+
+	// the following variable holds the selected anti-aliasing
+	// mode, off, MSAA at 2, 4 or 8 samples, FXAA or TAA
+	int antiAliasingMode = 0;
+	// number of the anti-aliasing modes, selected by the keys
+	// 1 and up
+	const int ANTI_ALIASING_MODE_COUNT = 6;
+
+	// true while the memory dump key is held, so a press prints
+	// the dump only once
+	bool gMemoryDumpKeyDown = false;
 }
 
 /***********************************************************
@@ -52,12 +108,25 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_renderSnapshot = VIEW_SNAPSHOT();
+	m_lastSnapshot = VIEW_SNAPSHOT();
+	m_drawnChangeCount = 0;
+	m_drawnBlend = 1.0f;
+	m_pickedCount = 0;
+	m_preparedPose = GetDefaultPose(false);
+	m_bPreparedPoseValid = false;
+	m_projectionJitter = glm::vec2(0.0f);
+	m_preparedJitter = glm::vec2(0.0f);
 	g_pCamera = new Camera();
 	// default camera view parameters
-	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
-	g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
-	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-	g_pCamera->Zoom = 80;
+	CAMERA_POSE pose = GetDefaultPose(false);
+	g_pCamera->Position = pose.position;
+	g_pCamera->Front = pose.front;
+	g_pCamera->Up = pose.up;
+	g_pCamera->Zoom = pose.zoom;
 }
 
 /***********************************************************
@@ -108,9 +177,17 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 
 	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Callback);
 
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	// this callback is used to receive the mouse button presses
+	// that pick the object under the crosshair
+	glfwSetMouseButtonCallback(window, &ViewManager::Mouse_Button_Callback);
+
+	// this callback is used to redraw the window after it was
+	// uncovered or resized while no frames are being rendered
+	glfwSetWindowRefreshCallback(window, &ViewManager::Window_Refresh_Callback);
+
+	// blending stays disabled, the scene enables it only for
+	// the pass of the transparent draws
+	GLStateCache::SetEnabled(GL_BLEND, false);
 
 	m_pWindow = window;
 
@@ -161,6 +238,34 @@ void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xoffset, doub
 	}
 }
 
+/***********************************************************
+ *  Mouse_Button_Callback()
+ *
+ *  This method is automatically called from GLFW whenever a
+ *  mouse button is pressed or released within the active GLFW
+ *  display window.  The cursor is captured for the camera, so
+ *  a press of the left button picks the object under the
+ *  center of the window.
+ ***********************************************************/
+void ViewManager::Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods)
+{
+	if ((GLFW_MOUSE_BUTTON_LEFT == button) && (GLFW_PRESS == action))
+	{
+		gPickCount++;
+	}
+}
+
+/***********************************************************
+ *  Window_Refresh_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the contents of the window need to be redrawn.
+ ***********************************************************/
+void ViewManager::Window_Refresh_Callback(GLFWwindow* window)
+{
+	gRedrawRequested = true;
+}
+
 
 
 /***********************************************************
@@ -222,10 +327,232 @@ void ViewManager::ProcessKeyboardEvents()
 		bOrthographicProjection = true;
 
 		// Position camera to look directly at scene from the front
-		g_pCamera->Position = glm::vec3(0.0f, 5.0f, 15.0f); // Back from scene
-		g_pCamera->Front = glm::vec3(0.0f, 0.0f, -1.0f);    // Looking straight forward
-		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);       // Standard up vector
+		CAMERA_POSE pose = GetDefaultPose(true);
+		g_pCamera->Position = pose.position;
+		g_pCamera->Front = pose.front;
+		g_pCamera->Up = pose.up;
+		gCameraCut = true;
+	}
+
+	// Toggle shading path
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F1) == GLFW_PRESS)
+	{
+		bDeferredShading = false;
+	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F2) == GLFW_PRESS)
+	{
+		bDeferredShading = true;
+	}
+
+	// Toggle dynamic resolution
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F3) == GLFW_PRESS)
+	{
+		bDynamicResolution = false;
 	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F4) == GLFW_PRESS)
+	{
+		bDynamicResolution = true;
+	}
+
+	// Toggle sorted or weighted blended transparency
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F6) == GLFW_PRESS)
+	{
+		bWeightedTransparency = false;
+	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F7) == GLFW_PRESS)
+	{
+		bWeightedTransparency = true;
+	}
+
+	// Toggle the depth pre-pass
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F8) == GLFW_PRESS)
+	{
+		bDepthPrepass = false;
+	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F9) == GLFW_PRESS)
+	{
+		bDepthPrepass = true;
+	}
+
+	// Toggle the overdraw heatmap
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F10) == GLFW_PRESS)
+	{
+		bOverdrawView = false;
+	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_F11) == GLFW_PRESS)
+	{
+		bOverdrawView = true;
+	}
+
+	// Toggle the baked lighting of the static surfaces
+	if (glfwGetKey(m_pWindow, GLFW_KEY_K) == GLFW_PRESS)
+	{
+		bLightmap = false;
+	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_L) == GLFW_PRESS)
+	{
+		bLightmap = true;
+	}
+
+	// Toggle the GPU culling
+	if (glfwGetKey(m_pWindow, GLFW_KEY_G) == GLFW_PRESS)
+	{
+		bGpuCulling = false;
+	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_H) == GLFW_PRESS)
+	{
+		bGpuCulling = true;
+	}
+
+	// Toggle the multi-view layout
+	if (glfwGetKey(m_pWindow, GLFW_KEY_N) == GLFW_PRESS)
+	{
+		bMultiView = false;
+	}
+	if (glfwGetKey(m_pWindow, GLFW_KEY_M) == GLFW_PRESS)
+	{
+		bMultiView = true;
+	}
+
+	// Select the anti-aliasing mode
+	for (int i = 0; i < ANTI_ALIASING_MODE_COUNT; i++)
+	{
+		if (glfwGetKey(m_pWindow, GLFW_KEY_1 + i) == GLFW_PRESS)
+		{
+			antiAliasingMode = i;
+		}
+	}
+
+	// print the tracked GPU and CPU memory
+	bool bMemoryDumpKey = (glfwGetKey(m_pWindow, GLFW_KEY_F5) == GLFW_PRESS);
+	if (bMemoryDumpKey && !gMemoryDumpKeyDown)
+	{
+		ResourceRegistry::Dump();
+		ResourceRegistry::PrintReport();
+	}
+	gMemoryDumpKeyDown = bMemoryDumpKey;
+}
+
+/***********************************************************
+ *  UpdateSimulation()
+ *
+ *  This method is used for advancing the camera by one fixed
+ *  simulation tick.  It polls the keyboard, so it must run on
+ *  the main thread together with the GLFW event processing.
+ ***********************************************************/
+void ViewManager::UpdateSimulation(float deltaTime)
+{
+	gDeltaTime = deltaTime;
+
+	// process any keyboard events that may be waiting in the 
+	// event queue
+	ProcessKeyboardEvents();
+}
+
+/***********************************************************
+ *  PublishSnapshot()
+ *
+ *  This method is used for publishing the view state of the
+ *  latest simulation tick.  The camera of the previously
+ *  published tick is carried along for the interpolation,
+ *  and the change count moves on whenever anything that is
+ *  visible differs from the previous snapshot.
+ ***********************************************************/
+bool ViewManager::PublishSnapshot(double tickInterval)
+{
+	VIEW_SNAPSHOT& snapshot = m_snapshots.GetWriteBuffer();
+
+	snapshot.position = g_pCamera->Position;
+	snapshot.front = g_pCamera->Front;
+	snapshot.up = g_pCamera->Up;
+	snapshot.zoom = g_pCamera->Zoom;
+	if (gCameraCut)
+	{
+		snapshot.previousPosition = snapshot.position;
+		snapshot.previousFront = snapshot.front;
+		snapshot.previousZoom = snapshot.zoom;
+		gCameraCut = false;
+	}
+	else
+	{
+		snapshot.previousPosition = m_lastSnapshot.position;
+		snapshot.previousFront = m_lastSnapshot.front;
+		snapshot.previousZoom = m_lastSnapshot.zoom;
+	}
+
+	snapshot.tickTime = glfwGetTime();
+	snapshot.tickInterval = tickInterval;
+	snapshot.bOrthographicProjection = bOrthographicProjection;
+	snapshot.bDeferredShading = bDeferredShading;
+	snapshot.bDynamicResolution = bDynamicResolution;
+	snapshot.bWeightedTransparency = bWeightedTransparency;
+	snapshot.bDepthPrepass = bDepthPrepass;
+	snapshot.bOverdrawView = bOverdrawView;
+	snapshot.bLightmap = bLightmap;
+	snapshot.bGpuCulling = bGpuCulling;
+	snapshot.bMultiView = bMultiView;
+	snapshot.antiAliasingMode = antiAliasingMode;
+	snapshot.pickCount = gPickCount;
+	glfwGetFramebufferSize(m_pWindow, &snapshot.framebufferWidth, &snapshot.framebufferHeight);
+
+	bool bChanged = gRedrawRequested ||
+		(snapshot.position != m_lastSnapshot.position) ||
+		(snapshot.front != m_lastSnapshot.front) ||
+		(snapshot.up != m_lastSnapshot.up) ||
+		(snapshot.zoom != m_lastSnapshot.zoom) ||
+		(snapshot.bOrthographicProjection != m_lastSnapshot.bOrthographicProjection) ||
+		(snapshot.bDeferredShading != m_lastSnapshot.bDeferredShading) ||
+		(snapshot.bDynamicResolution != m_lastSnapshot.bDynamicResolution) ||
+		(snapshot.bWeightedTransparency != m_lastSnapshot.bWeightedTransparency) ||
+		(snapshot.bDepthPrepass != m_lastSnapshot.bDepthPrepass) ||
+		(snapshot.bOverdrawView != m_lastSnapshot.bOverdrawView) ||
+		(snapshot.bLightmap != m_lastSnapshot.bLightmap) ||
+		(snapshot.bGpuCulling != m_lastSnapshot.bGpuCulling) ||
+		(snapshot.bMultiView != m_lastSnapshot.bMultiView) ||
+		(snapshot.antiAliasingMode != m_lastSnapshot.antiAliasingMode) ||
+		(snapshot.pickCount != m_lastSnapshot.pickCount) ||
+		(snapshot.framebufferWidth != m_lastSnapshot.framebufferWidth) ||
+		(snapshot.framebufferHeight != m_lastSnapshot.framebufferHeight);
+	snapshot.changeCount = m_lastSnapshot.changeCount + (bChanged ? 1 : 0);
+	gRedrawRequested = false;
+
+	m_lastSnapshot = snapshot;
+	m_snapshots.Publish();
+
+	return(bChanged);
+}
+
+/***********************************************************
+ *  AcquireSnapshot()
+ *
+ *  This method is used for taking the latest published view
+ *  state before a frame is rendered.  The view needs to be
+ *  redrawn when a changed snapshot arrived since the last
+ *  drawn one, or while the camera is still interpolating
+ *  toward the latest tick.
+ ***********************************************************/
+bool ViewManager::AcquireSnapshot()
+{
+	// the previous snapshot is kept when no tick has finished
+	// since the last frame
+	if (m_snapshots.Acquire())
+	{
+		m_renderSnapshot = m_snapshots.GetReadBuffer();
+	}
+	const VIEW_SNAPSHOT& snapshot = m_renderSnapshot;
+
+	bool bRedraw = (snapshot.changeCount != m_drawnChangeCount);
+	m_drawnChangeCount = snapshot.changeCount;
+
+	bool bMoving = (snapshot.previousPosition != snapshot.position) ||
+		(snapshot.previousFront != snapshot.front) ||
+		(snapshot.previousZoom != snapshot.zoom);
+	if (bMoving && (m_drawnBlend < 1.0f))
+	{
+		bRedraw = true;
+	}
+
+	return(bRedraw);
 }
 
 /***********************************************************
@@ -233,49 +560,383 @@ void ViewManager::ProcessKeyboardEvents()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  The camera is interpolated between the two
+ *  ticks of the snapshot taken by AcquireSnapshot(), so the
+ *  motion stays smooth when the render rate and the tick rate
+ *  differ.  The matrices are only calculated again when the
+ *  interpolated camera changed.
  ***********************************************************/
 void ViewManager::PrepareSceneView()
 {
-	glm::mat4 view;
-	glm::mat4 projection;
+	const VIEW_SNAPSHOT& snapshot = m_renderSnapshot;
 
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	// blend from the previous tick to the latest one over the
+	// length of a tick, which delays the view by at most one tick
+	float blend = 1.0f;
+	if (snapshot.tickInterval > 0.0)
+	{
+		blend = (float)((glfwGetTime() - snapshot.tickTime) / snapshot.tickInterval);
+		blend = glm::clamp(blend, 0.0f, 1.0f);
+	}
+	CAMERA_POSE pose;
+	pose.position = glm::mix(snapshot.previousPosition, snapshot.position, blend);
+	pose.front = glm::normalize(glm::mix(snapshot.previousFront, snapshot.front, blend));
+	pose.up = snapshot.up;
+	pose.zoom = glm::mix(snapshot.previousZoom, snapshot.zoom, blend);
+	pose.bOrthographicProjection = snapshot.bOrthographicProjection;
+	m_drawnBlend = blend;
+
+	// a camera at rest keeps the matrices of the previous frame,
+	// unless the projection moved by another offset
+	if (m_bPreparedPoseValid &&
+		(m_projectionJitter == m_preparedJitter) &&
+		(pose.position == m_preparedPose.position) &&
+		(pose.front == m_preparedPose.front) &&
+		(pose.up == m_preparedPose.up) &&
+		(pose.zoom == m_preparedPose.zoom) &&
+		(pose.bOrthographicProjection == m_preparedPose.bOrthographicProjection))
+	{
+		return;
+	}
+	m_preparedPose = pose;
+	m_bPreparedPoseValid = true;
+
+	// keep the matrices for the camera block, which passes them
+	// on to every shader program
+	CalculatePoseView(
+		pose,
+		(float)WINDOW_WIDTH / (float)WINDOW_HEIGHT,
+		m_viewMatrix,
+		m_projectionMatrix);
+	m_viewPosition = pose.position;
+
+	// the offset moves the image in the device coordinates, which
+	// serves the perspective and the orthographic projection alike
+	m_preparedJitter = m_projectionJitter;
+	if ((m_projectionJitter.x != 0.0f) || (m_projectionJitter.y != 0.0f))
+	{
+		glm::mat4 jitter(1.0f);
+		jitter[3][0] = m_projectionJitter.x;
+		jitter[3][1] = m_projectionJitter.y;
+		m_projectionMatrix = jitter * m_projectionMatrix;
+	}
+}
 
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+/***********************************************************
+ *  GetFramebufferSize()
+ *
+ *  This method is used for getting the framebuffer size that
+ *  was published with the current snapshot.  GLFW only allows
+ *  the main thread to query it.
+ ***********************************************************/
+void ViewManager::GetFramebufferSize(int& width, int& height) const
+{
+	width = m_renderSnapshot.framebufferWidth;
+	height = m_renderSnapshot.framebufferHeight;
+}
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+/***********************************************************
+ *  CalculateCameraView()
+ *
+ *  This method is used for calculating the view and projection
+ *  of the current camera for an image of the passed in aspect
+ *  ratio.  It reads the camera directly instead of a snapshot,
+ *  so it also works without a display window, such as for the
+ *  software renderer.
+ ***********************************************************/
+void ViewManager::CalculateCameraView(
+	float aspectRatio,
+	glm::mat4& view,
+	glm::mat4& projection,
+	glm::vec3& position) const
+{
+	CAMERA_POSE pose;
+	pose.position = g_pCamera->Position;
+	pose.front = g_pCamera->Front;
+	pose.up = g_pCamera->Up;
+	pose.zoom = g_pCamera->Zoom;
+	pose.bOrthographicProjection = bOrthographicProjection;
+
+	CalculatePoseView(pose, aspectRatio, view, projection);
+	position = pose.position;
+}
 
-	// Create appropriate projection matrix
-	if (bOrthographicProjection)
+/***********************************************************
+ *  GetDefaultPose()
+ *
+ *  This method is used for getting the camera the application
+ *  starts with, or the front view of the scene that the O key
+ *  switches to together with the orthographic projection.
+ ***********************************************************/
+ViewManager::CAMERA_POSE ViewManager::GetDefaultPose(bool bOrthographic)
+{
+	CAMERA_POSE pose;
+	pose.up = glm::vec3(0.0f, 1.0f, 0.0f);
+	pose.zoom = 80.0f;
+	pose.bOrthographicProjection = bOrthographic;
+	if (bOrthographic)
+	{
+		pose.position = glm::vec3(0.0f, 5.0f, 15.0f);
+		pose.front = glm::vec3(0.0f, 0.0f, -1.0f);
+	}
+	else
+	{
+		pose.position = glm::vec3(0.0f, 5.0f, 12.0f);
+		pose.front = glm::vec3(0.0f, -0.5f, -2.0f);
+	}
+
+	return(pose);
+}
+
+/***********************************************************
+ *  CalculatePoseView()
+ *
+ *  This method is used for calculating the view and projection
+ *  of a camera pose, with the same projections as the display
+ *  window.  It does not touch the camera, so several threads
+ *  can calculate their views at the same time.
+ ***********************************************************/
+void ViewManager::CalculatePoseView(
+	const CAMERA_POSE& pose,
+	float aspectRatio,
+	glm::mat4& view,
+	glm::mat4& projection)
+{
+	view = glm::lookAt(pose.position, pose.position + pose.front, pose.up);
+
+	if (pose.bOrthographicProjection)
 	{
-		// Orthographic projection - adjust these values as needed
 		float orthoSize = 10.0f;
 		projection = glm::ortho(
-			-orthoSize, orthoSize,     // left/right
-			-orthoSize, orthoSize,     // bottom/top
-			0.1f, 100.0f);            // near/far
+			-orthoSize, orthoSize,
+			-orthoSize, orthoSize,
+			0.1f, 100.0f);
 	}
 	else
 	{
-		// Perspective projection
 		projection = glm::perspective(
-			glm::radians(g_pCamera->Zoom),
-			(float)WINDOW_WIDTH / (float)WINDOW_HEIGHT,
+			glm::radians(pose.zoom),
+			aspectRatio,
 			0.1f, 100.0f);
 	}
+}
+
+/***********************************************************
+ *  IsDeferredShading()
+ *
+ *  This method is used for checking whether the scene should
+ *  be rendered with the deferred shading path.
+ ***********************************************************/
+bool ViewManager::IsDeferredShading() const
+{
+	return(m_renderSnapshot.bDeferredShading);
+}
+
+/***********************************************************
+ *  SetDeferredShading()
+ *
+ *  This method is used for selecting the forward or the
+ *  deferred shading path.  F1 and F2 switch it at runtime.
+ *  It is read by the render thread with the next snapshot.
+ ***********************************************************/
+void ViewManager::SetDeferredShading(bool bDeferred)
+{
+	bDeferredShading = bDeferred;
+}
+
+/***********************************************************
+ *  IsDynamicResolution()
+ *
+ *  This method is used for checking whether the scene should
+ *  be rendered at the scaled dynamic resolution.
+ ***********************************************************/
+bool ViewManager::IsDynamicResolution() const
+{
+	return(m_renderSnapshot.bDynamicResolution);
+}
+
+/***********************************************************
+ *  SetDynamicResolution()
+ *
+ *  This method is used for turning the dynamic resolution on
+ *  or off.  F3 and F4 switch it at runtime.
+ ***********************************************************/
+void ViewManager::SetDynamicResolution(bool bDynamic)
+{
+	bDynamicResolution = bDynamic;
+}
+
+/***********************************************************
+ *  IsWeightedTransparency()
+ *
+ *  This method is used for checking whether the transparent
+ *  draws should be drawn with weighted blended transparency
+ *  instead of sorted blending.
+ ***********************************************************/
+bool ViewManager::IsWeightedTransparency() const
+{
+	return(m_renderSnapshot.bWeightedTransparency);
+}
+
+/***********************************************************
+ *  SetWeightedTransparency()
+ *
+ *  This method is used for selecting sorted or weighted
+ *  blended transparency.  F6 and F7 switch it at runtime.
+ ***********************************************************/
+void ViewManager::SetWeightedTransparency(bool bWeighted)
+{
+	bWeightedTransparency = bWeighted;
+}
+
+/***********************************************************
+ *  IsDepthPrepass()
+ *
+ *  This method is used for checking whether the opaque draws
+ *  should be preceded by a depth pre-pass.
+ ***********************************************************/
+bool ViewManager::IsDepthPrepass() const
+{
+	return(m_renderSnapshot.bDepthPrepass);
+}
+
+/***********************************************************
+ *  SetDepthPrepass()
+ *
+ *  This method is used for turning the depth pre-pass on or
+ *  off.  F8 and F9 switch it at runtime.
+ ***********************************************************/
+void ViewManager::SetDepthPrepass(bool bPrepass)
+{
+	bDepthPrepass = bPrepass;
+}
+
+/***********************************************************
+ *  IsOverdrawView()
+ *
+ *  This method is used for checking whether the scene should
+ *  be shown as the overdraw heatmap.
+ ***********************************************************/
+bool ViewManager::IsOverdrawView() const
+{
+	return(m_renderSnapshot.bOverdrawView);
+}
+
+/***********************************************************
+ *  SetOverdrawView()
+ *
+ *  This method is used for turning the overdraw heatmap on or
+ *  off.  F10 and F11 switch it at runtime.
+ ***********************************************************/
+void ViewManager::SetOverdrawView(bool bOverdraw)
+{
+	bOverdrawView = bOverdraw;
+}
+
+/***********************************************************
+ *  IsLightmap()
+ *
+ *  This method is used for checking whether the static
+ *  surfaces should read their lighting from the lightmap.
+ ***********************************************************/
+bool ViewManager::IsLightmap() const
+{
+	return(m_renderSnapshot.bLightmap);
+}
+
+/***********************************************************
+ *  SetLightmap()
+ *
+ *  This method is used for turning the baked lighting of the
+ *  static surfaces on or off.  K and L switch it at runtime.
+ ***********************************************************/
+void ViewManager::SetLightmap(bool bLightmapOn)
+{
+	bLightmap = bLightmapOn;
+}
+
+/***********************************************************
+ *  IsGpuCulling()
+ *
+ *  This method is used for checking whether the opaque draws
+ *  should be culled and drawn on the GPU.
+ ***********************************************************/
+bool ViewManager::IsGpuCulling() const
+{
+	return(m_renderSnapshot.bGpuCulling);
+}
+
+/***********************************************************
+ *  SetGpuCulling()
+ *
+ *  This method is used for turning the GPU culling on or off.
+ *  G and H switch it at runtime.
+ ***********************************************************/
+void ViewManager::SetGpuCulling(bool bGpuCullingOn)
+{
+	bGpuCulling = bGpuCullingOn;
+}
+
+/***********************************************************
+ *  IsMultiView()
+ *
+ *  This method is used for checking whether the window should
+ *  be split into several views of the scene.
+ ***********************************************************/
+bool ViewManager::IsMultiView() const
+{
+	return(m_renderSnapshot.bMultiView);
+}
+
+/***********************************************************
+ *  SetMultiView()
+ *
+ *  This method is used for turning the multi-view layout on
+ *  or off.  N and M switch it at runtime.
+ ***********************************************************/
+void ViewManager::SetMultiView(bool bMulti)
+{
+	bMultiView = bMulti;
+}
+/***********************************************************
+ *  TakePickRequest()
+ *
+ *  This method is used for taking the picks that arrived with
+ *  the acquired snapshot, called by the render thread after
+ *  the frame is drawn.  Several presses between two frames
+ *  make a single pick.
+ ***********************************************************/
+bool ViewManager::TakePickRequest()
+{
+	if (m_renderSnapshot.pickCount == m_pickedCount)
+	{
+		return(false);
+	}
+	m_pickedCount = m_renderSnapshot.pickCount;
+	return(true);
+}
+
+/***********************************************************
+ *  GetAntiAliasingMode()
+ *
+ *  This method is used for getting the selected anti-aliasing
+ *  mode, an AntiAliasing::MODE.
+ ***********************************************************/
+int ViewManager::GetAntiAliasingMode() const
+{
+	return(m_renderSnapshot.antiAliasingMode);
+}
 
-	// Set the matrices in the shader
-	if (m_pShaderManager)
+/***********************************************************
+ *  SetAntiAliasingMode()
+ *
+ *  This method is used for selecting the anti-aliasing mode.
+ *  The keys 1 to 6 select it at runtime.
+ ***********************************************************/
+void ViewManager::SetAntiAliasingMode(int mode)
+{
+	if ((mode >= 0) && (mode < ANTI_ALIASING_MODE_COUNT))
 	{
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		antiAliasingMode = mode;
 	}
-}
\ No newline at end of file
+}
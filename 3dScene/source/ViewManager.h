@@ -10,6 +10,7 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "TripleBuffer.h"
 #include "camera.h"
 
 // GLFW library
@@ -18,6 +19,52 @@
 class ViewManager
 {
 public:
+	// immutable view state published after each simulation tick,
+	// it holds the camera of the previous and the latest tick so
+	// the render thread can interpolate between them
+	struct VIEW_SNAPSHOT
+	{
+		glm::vec3 previousPosition;
+		glm::vec3 position;
+		glm::vec3 previousFront;
+		glm::vec3 front;
+		glm::vec3 up;
+		float previousZoom;
+		float zoom;
+		// time the latest tick was published and the tick length
+		double tickTime;
+		double tickInterval;
+		bool bOrthographicProjection;
+		bool bDeferredShading;
+		bool bDynamicResolution;
+		bool bWeightedTransparency;
+		bool bDepthPrepass;
+		bool bOverdrawView;
+		bool bLightmap;
+		bool bGpuCulling;
+		bool bMultiView;
+		// selected AntiAliasing::MODE
+		int antiAliasingMode;
+		// counts the presses of the left mouse button, each one
+		// picks the object under the crosshair
+		unsigned int pickCount;
+		int framebufferWidth;
+		int framebufferHeight;
+		// counts the published snapshots that changed the view
+		unsigned int changeCount;
+	};
+
+	// camera placement and projection of a single view, such as
+	// a view of the batch renderer
+	struct CAMERA_POSE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		float zoom;
+		bool bOrthographicProjection;
+	};
+
 	// constructor
 	ViewManager(
 		ShaderManager* pShaderManager);
@@ -29,12 +76,44 @@ public:
 
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double xoffset, double yoffset);
 
+	// mouse button callback for picking objects in the 3D scene
+	static void Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods);
+
+	// window refresh callback for redrawing a damaged window
+	static void Window_Refresh_Callback(GLFWwindow* window);
+
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// view and projection matrices calculated for the current frame
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// interpolated camera position of the current frame
+	glm::vec3 m_viewPosition;
+	// camera the matrices were calculated from, reused while the
+	// camera does not move
+	CAMERA_POSE m_preparedPose;
+	bool m_bPreparedPoseValid;
+	// offset of the projection for the next frame and the offset
+	// the current matrices were calculated with
+	glm::vec2 m_projectionJitter;
+	glm::vec2 m_preparedJitter;
+	// snapshots handed from the simulation to the render thread
+	TripleBuffer<VIEW_SNAPSHOT> m_snapshots;
+	// snapshot the render thread is currently drawing
+	VIEW_SNAPSHOT m_renderSnapshot;
+	// change count of the snapshot that was drawn last
+	unsigned int m_drawnChangeCount;
+	// interpolation between the ticks of the frame drawn last
+	float m_drawnBlend;
+	// pick count of the snapshot whose pick was taken last
+	unsigned int m_pickedCount;
+	// snapshot published last, kept by the simulation thread
+	// because the triple buffer slots are reused
+	VIEW_SNAPSHOT m_lastSnapshot;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
@@ -43,6 +122,93 @@ public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
 	
+	// advance the camera by one fixed simulation tick, main thread only
+	void UpdateSimulation(float deltaTime);
+	// publish the view state of the latest tick to the render thread,
+	// returns true when the view differs from the last snapshot
+	bool PublishSnapshot(double tickInterval);
+
+	// take the latest published snapshot, called by the render thread
+	// before each frame, returns true when the view must be redrawn
+	bool AcquireSnapshot();
 	// prepare the conversion from 3D object display to 2D scene display
+	// from the acquired snapshot
 	void PrepareSceneView();
+
+	// get the matrices calculated by the last PrepareSceneView() call
+	glm::mat4 GetViewMatrix() const { return(m_viewMatrix); }
+	glm::mat4 GetProjectionMatrix() const { return(m_projectionMatrix); }
+	// get the position of the camera in world space for the current frame
+	glm::vec3 GetCameraPosition() const { return(m_viewPosition); }
+	// get the camera the current matrices were calculated from
+	const CAMERA_POSE& GetCameraPose() const { return(m_preparedPose); }
+	// get the framebuffer size published with the current snapshot
+	void GetFramebufferSize(int& width, int& height) const;
+	// calculate the matrices of the current camera without a window
+	void CalculateCameraView(
+		float aspectRatio,
+		glm::mat4& view,
+		glm::mat4& projection,
+		glm::vec3& position) const;
+	// get the startup camera, or the front view that the O key
+	// selects for the orthographic projection
+	static CAMERA_POSE GetDefaultPose(bool bOrthographic);
+	// calculate the matrices of a pose for an image of the passed
+	// in aspect ratio, with the projections of the interactive view
+	static void CalculatePoseView(
+		const CAMERA_POSE& pose,
+		float aspectRatio,
+		glm::mat4& view,
+		glm::mat4& projection);
+
+	// true when the deferred shading path is selected
+	bool IsDeferredShading() const;
+	// select the forward or deferred shading path
+	void SetDeferredShading(bool bDeferred);
+
+	// true when the scene is rendered at the dynamic resolution
+	bool IsDynamicResolution() const;
+	// turn the dynamic resolution on or off
+	void SetDynamicResolution(bool bDynamic);
+
+	// true when the transparent draws use weighted blended transparency
+	bool IsWeightedTransparency() const;
+	// select sorted or weighted blended transparency
+	void SetWeightedTransparency(bool bWeighted);
+
+	// true when the opaque draws are preceded by a depth pre-pass
+	bool IsDepthPrepass() const;
+	// turn the depth pre-pass on or off
+	void SetDepthPrepass(bool bPrepass);
+
+	// true when the overdraw heatmap replaces the shaded scene
+	bool IsOverdrawView() const;
+	// turn the overdraw heatmap on or off
+	void SetOverdrawView(bool bOverdraw);
+
+	// true when the static surfaces read their baked lighting
+	bool IsLightmap() const;
+	// turn the lightmap on or off
+	void SetLightmap(bool bLightmap);
+
+	// true when the opaque draws are culled on the GPU
+	bool IsGpuCulling() const;
+	// turn the GPU culling on or off
+	void SetGpuCulling(bool bGpuCulling);
+
+	// true when several views share the window
+	bool IsMultiView() const;
+	// turn the multi-view layout on or off
+	void SetMultiView(bool bMulti);
+
+	// selected AntiAliasing::MODE
+	int GetAntiAliasingMode() const;
+	// select the anti-aliasing mode
+	void SetAntiAliasingMode(int mode);
+	// move the projection of the next PrepareSceneView() call by
+	// an offset in normalized device coordinates
+	void SetProjectionJitter(const glm::vec2& jitter) { m_projectionJitter = jitter; }
+
+	// true once for every pick the acquired snapshot asks for
+	bool TakePickRequest();
 };
\ No newline at end of file
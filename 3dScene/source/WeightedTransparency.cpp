@@ -0,0 +1,340 @@
+///////////////////////////////////////////////////////////////////////////////
+// weightedtransparency.cpp
+// ============
+// weighted blended order independent transparency - the transparent
+// surfaces are summed in any order and resolved in one full screen pass
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WeightedTransparency.h"
+#include "GLStateCache.h"
+#include "ResourceRegistry.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texture units of the targets in the composite pass, above
+	// the units of the G-buffer and the dynamic resolution
+	const int ACCUMULATION_UNIT = 21;
+	const int REVEALAGE_UNIT = 22;
+
+	// value of the queried framebuffer before the first query
+	const GLuint UNKNOWN_FRAMEBUFFER = 0xFFFFFFFF;
+}
+
+/***********************************************************
+ *  WeightedTransparency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WeightedTransparency::WeightedTransparency()
+{
+	m_pCompositeShader = new ShaderManager();
+	m_pCompositeShader->m_programID = 0;
+	m_accumulationFBO = 0;
+	m_accumulationTexture = 0;
+	m_revealageTexture = 0;
+	m_depthBuffer = 0;
+	m_depthFormat = GL_NONE;
+	m_emptyVAO = 0;
+	m_width = 0;
+	m_height = 0;
+	m_targetFramebuffer = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_queriedFramebuffer = UNKNOWN_FRAMEBUFFER;
+	m_targetDepthFormat = GL_DEPTH_COMPONENT24;
+}
+
+/***********************************************************
+ *  ~WeightedTransparency()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WeightedTransparency::~WeightedTransparency()
+{
+	DestroyBuffers();
+	if (0 != m_emptyVAO)
+	{
+		GLStateCache::DeleteVertexArrays(1, &m_emptyVAO);
+		m_emptyVAO = 0;
+	}
+	if (NULL != m_pCompositeShader)
+	{
+		delete m_pCompositeShader;
+		m_pCompositeShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for building the composite program.
+ *  It is small, so it is built right away.
+ ***********************************************************/
+bool WeightedTransparency::LoadShaders(
+	ShaderCache* pShaderCache,
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath)
+{
+	if (!pShaderCache->LoadShaders(m_pCompositeShader, vertexShaderPath, fragmentShaderPath))
+	{
+		m_pCompositeShader->m_programID = 0;
+		return(false);
+	}
+
+	GLStateCache::UseProgram(m_pCompositeShader->m_programID);
+	m_pCompositeShader->setSampler2DValue("accumulationTexture", ACCUMULATION_UNIT);
+	m_pCompositeShader->setSampler2DValue("revealageTexture", REVEALAGE_UNIT);
+
+	// the full screen triangle is generated in the vertex shader
+	// but core profile still requires a bound vertex array
+	glGenVertexArrays(1, &m_emptyVAO);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetTarget()
+ *
+ *  This method is used for setting the framebuffer that holds
+ *  the opaque image of the frame, the default framebuffer or
+ *  the dynamic resolution target, and the rendered size.
+ ***********************************************************/
+void WeightedTransparency::SetTarget(GLuint framebuffer, int width, int height)
+{
+	m_targetFramebuffer = framebuffer;
+	m_targetWidth = width;
+	m_targetHeight = height;
+}
+
+/***********************************************************
+ *  QueryDepthFormat()
+ *
+ *  This method is used for reading the depth format of a
+ *  framebuffer.  A depth copy between framebuffers requires
+ *  the same format on both sides, and the default framebuffer
+ *  usually carries a stencil buffer as well.
+ ***********************************************************/
+GLenum WeightedTransparency::QueryDepthFormat(GLuint framebuffer)
+{
+	GLenum depthAttachment = (0 == framebuffer) ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+	GLenum stencilAttachment = (0 == framebuffer) ? GL_STENCIL : GL_STENCIL_ATTACHMENT;
+	GLint depthType = GL_NONE;
+	GLint stencilType = GL_NONE;
+	GLint depthBits = 24;
+	GLint stencilBits = 0;
+	GLint componentType = GL_UNSIGNED_NORMALIZED;
+
+	GLStateCache::BindFramebuffer(framebuffer);
+	glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, depthAttachment,
+		GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &depthType);
+	glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, stencilAttachment,
+		GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &stencilType);
+	if (GL_NONE != depthType)
+	{
+		glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, depthAttachment,
+			GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depthBits);
+		glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, depthAttachment,
+			GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &componentType);
+	}
+	if (GL_NONE != stencilType)
+	{
+		glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, stencilAttachment,
+			GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencilBits);
+	}
+
+	if (stencilBits > 0)
+	{
+		return((GL_FLOAT == componentType) ? GL_DEPTH32F_STENCIL8 : GL_DEPTH24_STENCIL8);
+	}
+	if (GL_FLOAT == componentType)
+	{
+		return(GL_DEPTH_COMPONENT32F);
+	}
+	return((depthBits <= 16) ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT24);
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for allocating the accumulation
+ *  targets.  The sum of the weighted colors needs a half float
+ *  target, while the revealage only holds a fraction.
+ ***********************************************************/
+bool WeightedTransparency::CreateBuffers(int width, int height, GLenum depthFormat)
+{
+	DestroyBuffers();
+
+	glGenFramebuffers(1, &m_accumulationFBO);
+	GLStateCache::BindFramebuffer(m_accumulationFBO);
+
+	glGenTextures(1, &m_accumulationTexture);
+	GLStateCache::BindTextureForUpdate(m_accumulationTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_accumulationTexture, 0);
+
+	glGenTextures(1, &m_revealageTexture);
+	GLStateCache::BindTextureForUpdate(m_revealageTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_revealageTexture, 0);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, depthFormat, width, height);
+	bool bStencil = (depthFormat == GL_DEPTH24_STENCIL8) || (depthFormat == GL_DEPTH32F_STENCIL8);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER,
+		bStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+		GL_RENDERBUFFER, m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Transparency framebuffer is not complete" << std::endl;
+		GLStateCache::BindFramebuffer(0);
+		DestroyBuffers();
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_depthFormat = depthFormat;
+
+	ResourceRegistry::Track(GL_TEXTURE, m_accumulationTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_RGBA16F, width, height, false), "transparency accumulation");
+	ResourceRegistry::Track(GL_TEXTURE, m_revealageTexture, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(GL_R8, width, height, false), "transparency revealage");
+	ResourceRegistry::Track(GL_RENDERBUFFER, m_depthBuffer, ResourceRegistry::CATEGORY_RENDER_TARGET,
+		ResourceRegistry::GetTextureSize(depthFormat, width, height, false), "transparency depth");
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyBuffers()
+ *
+ *  This method is used for freeing the accumulation targets.
+ ***********************************************************/
+void WeightedTransparency::DestroyBuffers()
+{
+	if (0 != m_accumulationTexture)
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_accumulationTexture);
+		GLStateCache::DeleteTextures(1, &m_accumulationTexture);
+		m_accumulationTexture = 0;
+	}
+	if (0 != m_revealageTexture)
+	{
+		ResourceRegistry::Release(GL_TEXTURE, 1, &m_revealageTexture);
+		GLStateCache::DeleteTextures(1, &m_revealageTexture);
+		m_revealageTexture = 0;
+	}
+	if (0 != m_depthBuffer)
+	{
+		ResourceRegistry::Release(GL_RENDERBUFFER, 1, &m_depthBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	if (0 != m_accumulationFBO)
+	{
+		GLStateCache::DeleteFramebuffers(1, &m_accumulationFBO);
+		m_accumulationFBO = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+	m_depthFormat = GL_NONE;
+}
+
+/***********************************************************
+ *  BeginAccumulation()
+ *
+ *  This method is used for preparing the transparent draws.
+ *  The opaque depth is copied into the accumulation targets,
+ *  which are cleared to no color and full revealage.  The
+ *  draws then test against the depth without writing it, add
+ *  their weighted color and multiply the revealage.
+ ***********************************************************/
+bool WeightedTransparency::BeginAccumulation()
+{
+	if (!IsReady() || (m_targetWidth <= 0) || (m_targetHeight <= 0))
+	{
+		return(false);
+	}
+
+	if (m_queriedFramebuffer != m_targetFramebuffer)
+	{
+		m_targetDepthFormat = QueryDepthFormat(m_targetFramebuffer);
+		m_queriedFramebuffer = m_targetFramebuffer;
+	}
+	if ((m_targetWidth > m_width) || (m_targetHeight > m_height) ||
+		(m_targetDepthFormat != m_depthFormat))
+	{
+		int width = (m_targetWidth > m_width) ? m_targetWidth : m_width;
+		int height = (m_targetHeight > m_height) ? m_targetHeight : m_height;
+		if (!CreateBuffers(width, height, m_targetDepthFormat))
+		{
+			return(false);
+		}
+	}
+
+	// the copy binds the read and draw framebuffers separately,
+	// so the cached binding is replaced right after it
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_targetFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_accumulationFBO);
+	glBlitFramebuffer(
+		0, 0, m_targetWidth, m_targetHeight,
+		0, 0, m_targetWidth, m_targetHeight,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	GLStateCache::BindFramebuffer(m_targetFramebuffer);
+	GLStateCache::BindFramebuffer(m_accumulationFBO);
+	GLStateCache::Viewport(0, 0, m_targetWidth, m_targetHeight);
+
+	const GLfloat clearAccumulation[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const GLfloat clearRevealage[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, clearAccumulation);
+	glClearBufferfv(GL_COLOR, 1, clearRevealage);
+
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+	GLStateCache::DepthMask(false);
+	GLStateCache::SetEnabled(GL_BLEND, true);
+	glBlendFunci(0, GL_ONE, GL_ONE);
+	glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+	GLStateCache::InvalidateBlendFunc();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Composite()
+ *
+ *  This method is used for blending the average color of the
+ *  transparent surfaces over the opaque image by the coverage
+ *  that was accumulated, and restoring the opaque state.
+ ***********************************************************/
+void WeightedTransparency::Composite()
+{
+	GLStateCache::BindFramebuffer(m_targetFramebuffer);
+	GLStateCache::Viewport(0, 0, m_targetWidth, m_targetHeight);
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, false);
+	GLStateCache::BlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+	GLStateCache::UseProgram(m_pCompositeShader->m_programID);
+	GLStateCache::BindTexture(ACCUMULATION_UNIT, m_accumulationTexture);
+	GLStateCache::BindTexture(REVEALAGE_UNIT, m_revealageTexture);
+
+	GLStateCache::BindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+
+	// restore the state of the opaque draws
+	GLStateCache::SetEnabled(GL_DEPTH_TEST, true);
+	GLStateCache::DepthMask(true);
+	GLStateCache::SetEnabled(GL_BLEND, false);
+}
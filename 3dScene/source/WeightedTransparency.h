@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// weightedtransparency.h
+// ============
+// weighted blended order independent transparency - the transparent
+// surfaces are summed in any order and resolved in one full screen pass
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderCache.h"
+
+/***********************************************************
+ *  WeightedTransparency
+ *
+ *  This class owns the two targets of weighted blended order
+ *  independent transparency.  The transparent draws add their
+ *  premultiplied color, scaled by a weight that falls off with
+ *  the depth, into an accumulation target, and multiply their
+ *  transmission into a revealage target.  A full screen pass
+ *  then divides the sum by the total weight and blends the
+ *  average over the opaque image by the remaining coverage.
+ *
+ *  The result does not depend on the order of the draws, so
+ *  the transparent draws need no sorting, at the price of an
+ *  approximation where several layers overlap.
+ *
+ *  The depth of the opaque image is copied into the targets,
+ *  so transparent surfaces behind opaque ones are rejected by
+ *  the depth test.  The targets only grow, a smaller render
+ *  size uses their lower left region.
+ ***********************************************************/
+class WeightedTransparency
+{
+public:
+	// constructor
+	WeightedTransparency();
+	// destructor
+	~WeightedTransparency();
+
+	// build the composite program
+	bool LoadShaders(
+		ShaderCache* pShaderCache,
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath);
+	// true once the composite program is built
+	bool IsReady() const { return(0 != m_pCompositeShader->m_programID); }
+
+	// set the framebuffer and size the opaque scene is rendered into
+	void SetTarget(GLuint framebuffer, int width, int height);
+
+	// copy the opaque depth and bind the accumulation targets,
+	// returns false when the transparent draws can not be summed
+	bool BeginAccumulation();
+	// blend the summed transparent surfaces over the target
+	void Composite();
+
+	// read the depth format of a framebuffer, a depth copy needs
+	// the same format on both sides
+	static GLenum QueryDepthFormat(GLuint framebuffer);
+
+private:
+	// shader program of the composite pass
+	ShaderManager* m_pCompositeShader;
+	// accumulation framebuffer and its attachments
+	GLuint m_accumulationFBO;
+	GLuint m_accumulationTexture;
+	GLuint m_revealageTexture;
+	GLuint m_depthBuffer;
+	// format of the depth buffer, it matches the target for the copy
+	GLenum m_depthFormat;
+	// empty vertex array for the full screen triangle
+	GLuint m_emptyVAO;
+	// allocated size of the attachments
+	int m_width;
+	int m_height;
+
+	// framebuffer the opaque scene was rendered into and its size
+	GLuint m_targetFramebuffer;
+	int m_targetWidth;
+	int m_targetHeight;
+	// depth format of the target, queried when the target changes
+	GLuint m_queriedFramebuffer;
+	GLenum m_targetDepthFormat;
+
+	// allocate the attachments for the passed in size
+	bool CreateBuffers(int width, int height, GLenum depthFormat);
+	// free the attachments
+	void DestroyBuffers();
+};